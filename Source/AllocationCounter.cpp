@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// debug build count of heap allocations for checking allocation free paths
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _DEBUG
+
+// declaration of global variables
+namespace
+{
+	// operator new calls made by each thread
+	thread_local size_t g_threadAllocations = 0;
+	// bytes requested by those calls
+	thread_local size_t g_threadAllocatedBytes = 0;
+}
+
+/***********************************************************
+ *  operator new()
+ *
+ *  The global allocation functions are replaced in debug
+ *  builds so every heap allocation made through new, including
+ *  the ones inside the standard containers, is counted.
+ ***********************************************************/
+void* operator new(size_t size)
+{
+	g_threadAllocations++;
+	g_threadAllocatedBytes += size;
+
+	void* pMemory = malloc((size > 0) ? size : 1);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](size_t size)
+{
+	return(operator new(size));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+size_t GetThreadAllocationCount()
+{
+	return(g_threadAllocations);
+}
+
+size_t GetThreadAllocatedBytes()
+{
+	return(g_threadAllocatedBytes);
+}
+
+#else
+
+size_t GetThreadAllocationCount()
+{
+	return(0);
+}
+
+size_t GetThreadAllocatedBytes()
+{
+	return(0);
+}
+
+#endif
@@ -0,0 +1,27 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// debug build count of heap allocations for checking allocation free paths
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+
+// number of operator new calls made by the calling thread, debug
+// builds count them through the replaced global operator new and
+// release builds always return zero
+size_t GetThreadAllocationCount();
+// bytes those calls asked for, zero in release builds as well
+size_t GetThreadAllocatedBytes();
+
+// a block between the BEGIN and END checks must not allocate from
+// the heap whenever bSteady is true at the END check
+#ifdef _DEBUG
+#define ALLOCATION_CHECK_BEGIN(name) const size_t name = GetThreadAllocationCount()
+#define ALLOCATION_CHECK_END(name, bSteady) assert(!(bSteady) || (GetThreadAllocationCount() == (name)))
+#else
+#define ALLOCATION_CHECK_BEGIN(name)
+#define ALLOCATION_CHECK_END(name, bSteady)
+#endif
@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrender.cpp
+// ============
+// render a list of camera views of the 3D scene into image files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRender.h"
+#include "FrameCapture.h"
+#include "RenderTarget.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// frames rendered while waiting for the loader thread to finish
+	// the scene's textures and meshes
+	const int UPLOAD_WAIT_FRAMES = 600;
+	// names of the images of views that do not name their own
+	const char* DEFAULT_VIEW_FILENAME = "view_%05d.tga";
+}
+
+/***********************************************************
+ *  LoadBatchViews()
+ *
+ *  Read the views of a batch, stopping at the first line
+ *  that cannot be read so a typo does not go unnoticed.
+ ***********************************************************/
+bool LoadBatchViews(const char* filename, std::vector<BATCH_VIEW>* pViews)
+{
+	if ((NULL == filename) || (NULL == pViews))
+	{
+		return false;
+	}
+
+	std::ifstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not open the batch file " << filename << std::endl;
+		return false;
+	}
+
+	pViews->clear();
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		std::istringstream fields(line);
+		std::string first;
+		if (!(fields >> first) || (first[0] == '#'))
+		{
+			continue;
+		}
+		fields.clear();
+		fields.seekg(0);
+
+		BATCH_VIEW view;
+		std::string projection;
+		fields >> view.pose.position.x >> view.pose.position.y >> view.pose.position.z
+			>> view.pose.front.x >> view.pose.front.y >> view.pose.front.z
+			>> view.pose.up.x >> view.pose.up.y >> view.pose.up.z
+			>> view.pose.zoom >> projection;
+		if (!fields || ((projection != "perspective") && (projection != "ortho")) ||
+			(glm::length(view.pose.front) <= 0.0f) || (glm::length(view.pose.up) <= 0.0f) ||
+			(view.pose.zoom <= 0.0f) || (view.pose.zoom >= 180.0f))
+		{
+			std::cout << "Could not read the view on line " << lineNumber << " of " << filename << std::endl;
+			return false;
+		}
+		view.pose.bOrthographic = (projection == "ortho");
+		view.pose.front = glm::normalize(view.pose.front);
+		view.pose.up = glm::normalize(view.pose.up);
+
+		if (!(fields >> view.filename))
+		{
+			char defaultName[64];
+			snprintf(defaultName, sizeof(defaultName), DEFAULT_VIEW_FILENAME, (int)pViews->size());
+			view.filename = defaultName;
+		}
+		pViews->push_back(view);
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  RunBatchRender()
+ *
+ *  Render the views of a batch one after the other into an
+ *  offscreen target.  Each image is read back through the
+ *  frame capture while the next view renders, then encoded
+ *  and written by the threads of the write queue.  The camera
+ *  returns to the simulated view afterwards.
+ ***********************************************************/
+bool RunBatchRender(SceneManager* pSceneManager, ViewManager* pViewManager,
+	const RenderFrameFunction& renderFrame, const char* viewsFilename, int width, int height)
+{
+	if ((NULL == pSceneManager) || (NULL == pViewManager))
+	{
+		return false;
+	}
+
+	std::vector<BATCH_VIEW> views;
+	if (LoadBatchViews(viewsFilename, &views) == false)
+	{
+		return false;
+	}
+
+	RenderTarget target;
+	FrameCapture capture;
+	GLenum colorFormat = GL_RGBA8;
+	if ((target.CreateTarget(width, height, &colorFormat, 1, GL_DEPTH_COMPONENT24) == false) ||
+		(capture.CreateCapture(width, height) == false))
+	{
+		return false;
+	}
+	target.Bind();
+	pViewManager->SetViewSize(width, height);
+
+	// every view needs the finished textures and meshes
+	for (int i = 0; (i < UPLOAD_WAIT_FRAMES) && pSceneManager->HasPendingUploads(); i++)
+	{
+		renderFrame();
+	}
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	double renderTime = 0.0;
+	double writeTime = 0.0;
+	ImageWriteQueue writeQueue;
+	for (size_t i = 0; i < views.size(); i++)
+	{
+		std::chrono::high_resolution_clock::time_point viewTime = std::chrono::high_resolution_clock::now();
+		pViewManager->SetFixedView(views[i].pose);
+		renderFrame();
+		renderTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - viewTime).count();
+
+		capture.Capture(views[i].filename, GetImageFormat(views[i].filename.c_str()), &writeQueue);
+	}
+
+	// the last images are still being read and written
+	std::chrono::high_resolution_clock::time_point drainTime = std::chrono::high_resolution_clock::now();
+	capture.Flush();
+	writeQueue.WaitIdle();
+	writeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - drainTime).count();
+	double totalTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	pViewManager->ClearFixedView();
+	pViewManager->SetViewSize(0, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	int viewCount = (int)views.size();
+	int failedCount = writeQueue.GetFailedCount();
+	double perView = (viewCount > 0) ? 1.0 / viewCount : 0.0;
+	std::cout << "INFO: Batch render of " << viewCount << " views, " << width << "x" << height
+		<< ", " << writeQueue.GetEncoderCount() << " encoder threads" << std::endl;
+	std::cout << std::fixed << std::setprecision(3)
+		<< "  total           " << totalTime / 1000.0 << " s, "
+		<< std::setprecision(1) << ((totalTime > 0.0) ? viewCount / (totalTime / 1000.0) : 0.0) << " views/s" << std::endl
+		<< std::setprecision(3)
+		<< "  render          " << renderTime * perView << " ms per view" << std::endl
+		<< "  read back       " << capture.GetReadbackTime() * perView << " ms per view" << std::endl
+		<< "  writer stalls   " << writeQueue.GetSubmitWaitTime() * perView << " ms per view, "
+		<< writeTime << " ms draining at the end" << std::endl
+		<< "  written         " << writeQueue.GetWrittenCount() << " images, " << failedCount << " failed" << std::endl;
+
+	return(0 == failedCount);
+}
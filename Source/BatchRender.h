@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrender.h
+// ============
+// render a list of camera views of the 3D scene into image files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Benchmark.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <string>
+#include <vector>
+
+// one view of a batch and the file it is written to
+struct BATCH_VIEW
+{
+	CAMERA_POSE pose;
+	std::string filename;
+};
+
+// read the views of a batch from a text file, one view per line as
+//   position.xyz front.xyz up.xyz zoom perspective|ortho [file]
+// the extension of the file picks TGA, PNG, QOI or raw pixels, views
+// without a file name are written to view_00000.tga and on, empty
+// lines and lines starting with # are skipped
+bool LoadBatchViews(const char* filename, std::vector<BATCH_VIEW>* pViews);
+
+// render every view of the batch file offscreen, with the scene
+// loaded once, and write the images on worker threads while the
+// next views are rendered
+bool RunBatchRender(SceneManager* pSceneManager, ViewManager* pViewManager,
+	const RenderFrameFunction& renderFrame, const char* viewsFilename, int width, int height);
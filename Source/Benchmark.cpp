@@ -0,0 +1,1147 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.cpp
+// ============
+// offscreen performance runs of the 3D scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmark.h"
+#include "FrameCapture.h"
+#include "MaterialStore.h"
+#include "ImageWriter.h"
+#include "MeshImporter.h"
+#include "RayTracer.h"
+#include "RenderTarget.h"
+#include "ResourceTracker.h"
+#include "ShadowManager.h"
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// frames rendered before measuring starts
+	const int WARMUP_FRAMES = 10;
+	// frames measured for every benchmark step
+	const int MEASURED_FRAMES = 60;
+	// largest light count of the light sweep
+	const int MAX_BENCHMARK_LIGHTS = 4096;
+	// light counts the shading options are compared at
+	const int COMPARE_LIGHT_COUNTS[] = { 2, 64, 1024 };
+	// materials in the material table benchmark
+	const int MATERIAL_BENCHMARK_COUNT = 100000;
+	// passes timed over the material table
+	const int MATERIAL_BENCHMARK_PASSES = 20;
+	// quads along each side of the imported grid, two triangles
+	// each gives just over 10M triangles
+	const int IMPORT_BENCHMARK_GRID = 2237;
+	// imports timed for every thread setup
+	const int IMPORT_BENCHMARK_PASSES = 3;
+	// OBJ file written for the import benchmark
+	const char* IMPORT_BENCHMARK_FILE = "import_benchmark.obj";
+	// frames rendered while waiting for the loader thread to finish
+	// the scene's textures and meshes
+	const int UPLOAD_WAIT_FRAMES = 600;
+	// quads along each side of the grid loaded while rendering, two
+	// triangles each gives 2M triangles
+	const int UPLOAD_BENCHMARK_GRID = 1000;
+	// OBJ file written for the upload benchmark
+	const char* UPLOAD_BENCHMARK_FILE = "upload_benchmark.obj";
+	// seconds the upload benchmark renders before giving up on the mesh
+	const double UPLOAD_BENCHMARK_TIMEOUT = 60.0;
+	// largest channel difference of a pixel that still matches, the
+	// two rasterizers round interpolated values differently
+	const int SOFTWARE_CHANNEL_TOLERANCE = 8;
+	// the share of pixels allowed past the tolerance, these are the
+	// edge pixels the two fill rules hand to different triangles,
+	// and the lowest peak signal to noise ratio of a match
+	const double SOFTWARE_MISMATCH_LIMIT = 0.01;
+	const double SOFTWARE_PSNR_LIMIT = 30.0;
+	// samples along each side of a pixel of the reference image
+	const int REFERENCE_SAMPLE_GRID = 4;
+	// images traced for every thread count of the ray tracer
+	// benchmark, with one sample per pixel
+	const int RAY_TRACER_BENCHMARK_PASSES = 3;
+	// frames captured for every size, format and readback
+	const int CAPTURE_BENCHMARK_FRAMES = 120;
+	// sizes and formats of the capture benchmark
+	const int CAPTURE_SIZES[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+	const IMAGE_FORMAT CAPTURE_FORMATS[3] = { IMAGE_FORMAT_RAW, IMAGE_FORMAT_QOI, IMAGE_FORMAT_PNG };
+	const char* CAPTURE_FORMAT_NAMES[3] = { "raw", "QOI", "PNG" };
+
+	// averaged results of one benchmark step
+	struct FRAME_TIMING
+	{
+		double cpuTime;
+		double gpuTime;
+	};
+
+	/***********************************************************
+	 *  MeasureFrames()
+	 *
+	 *  Render warm up frames, then time the measured frames on
+	 *  the CPU and with GPU timer queries.  The optional step
+	 *  function runs after every measured frame.
+	 ***********************************************************/
+	FRAME_TIMING MeasureFrames(const RenderFrameFunction& renderFrame, const std::function<void()>& afterFrame)
+	{
+		FRAME_TIMING timing = { 0.0, 0.0 };
+
+		for (int i = 0; i < WARMUP_FRAMES; i++)
+		{
+			renderFrame();
+		}
+		glFinish();
+
+		GLuint timerQuery = 0;
+		glGenQueries(1, &timerQuery);
+
+		for (int i = 0; i < MEASURED_FRAMES; i++)
+		{
+			std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+			glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+			renderFrame();
+			glEndQuery(GL_TIME_ELAPSED);
+
+			// waiting on the query keeps the frames from overlapping
+			GLuint64 gpuNanoseconds = 0;
+			glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &gpuNanoseconds);
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+			timing.cpuTime += elapsed.count();
+			timing.gpuTime += (double)gpuNanoseconds / 1000000.0;
+
+			if (afterFrame)
+			{
+				afterFrame();
+			}
+		}
+
+		glDeleteQueries(1, &timerQuery);
+
+		timing.cpuTime /= MEASURED_FRAMES;
+		timing.gpuTime /= MEASURED_FRAMES;
+		return(timing);
+	}
+
+	/***********************************************************
+	 *  WaitForUploads()
+	 *
+	 *  Render frames until the loader thread has finished the
+	 *  scene's textures and meshes, the CPU renderers skip the
+	 *  ones that are still being uploaded.
+	 ***********************************************************/
+	void WaitForUploads(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame)
+	{
+		for (int i = 0; (i < UPLOAD_WAIT_FRAMES) && pSceneManager->HasPendingUploads(); i++)
+		{
+			renderFrame();
+		}
+	}
+
+	/***********************************************************
+	 *  TimeFrame()
+	 *
+	 *  Render one frame and wait for the GPU, so a stall shows
+	 *  up in the frame it happens in.  Returns milliseconds.
+	 ***********************************************************/
+	double TimeFrame(const RenderFrameFunction& renderFrame)
+	{
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		renderFrame();
+		glFinish();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		return(elapsed.count());
+	}
+
+	/***********************************************************
+	 *  WriteGridFile()
+	 *
+	 *  Write a grid of quads on the unit square at y 0 with a uv
+	 *  for every vertex and one shared normal as an OBJ file, so
+	 *  every corner has to go through the vertex hash table.
+	 ***********************************************************/
+	bool WriteGridFile(const char* filename, int gridSize, double* pFileBytes)
+	{
+		FILE* pFile = fopen(filename, "wb");
+		if (NULL == pFile)
+		{
+			std::cout << "Could not write the benchmark file " << filename << std::endl;
+			return false;
+		}
+		int sideVertices = gridSize + 1;
+		for (int z = 0; z < sideVertices; z++)
+		{
+			for (int x = 0; x < sideVertices; x++)
+			{
+				fprintf(pFile, "v %.6f 0 %.6f\n", (float)x / gridSize, (float)z / gridSize);
+			}
+		}
+		for (int z = 0; z < sideVertices; z++)
+		{
+			for (int x = 0; x < sideVertices; x++)
+			{
+				fprintf(pFile, "vt %.6f %.6f\n", (float)x / gridSize, (float)z / gridSize);
+			}
+		}
+		fprintf(pFile, "vn 0 1 0\n");
+		for (int z = 0; z < gridSize; z++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				// counter clockwise seen from above
+				int a = (z * sideVertices) + x + 1;
+				int b = a + 1;
+				int c = a + sideVertices + 1;
+				int d = a + sideVertices;
+				fprintf(pFile, "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, d, d, c, c, b, b);
+			}
+		}
+		*pFileBytes = (double)ftell(pFile);
+		bool bWritten = (0 == ferror(pFile));
+		fclose(pFile);
+		if (!bWritten)
+		{
+			std::cout << "Could not write the benchmark file " << filename << std::endl;
+			remove(filename);
+			return false;
+		}
+		return true;
+	}
+
+	/***********************************************************
+	 *  FillRandomLights()
+	 *
+	 *  Keep the first scene lights and add randomly placed point
+	 *  lights until the passed in light count is reached.
+	 ***********************************************************/
+	void FillRandomLights(LightManager* pLightManager, int sceneLightCount, int lightCount, std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> positionX(-12.0f, 12.0f);
+		std::uniform_real_distribution<float> positionY(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> positionZ(-9.0f, 6.0f);
+		std::uniform_real_distribution<float> radius(2.0f, 4.0f);
+		std::uniform_real_distribution<float> color(0.2f, 1.0f);
+
+		pLightManager->RemoveLightsFrom(sceneLightCount);
+		while (pLightManager->GetLightCount() < lightCount)
+		{
+			LIGHT_DATA light;
+			light.position = glm::vec4(positionX(generator), positionY(generator), positionZ(generator), radius(generator));
+			light.ambientColor = glm::vec4(0.0f, 0.0f, 0.0f, 16.0f);
+			light.diffuseColor = glm::vec4(color(generator), color(generator), color(generator), 0.5f);
+			light.specularColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+			pLightManager->AddLight(light);
+		}
+	}
+}
+
+/***********************************************************
+ *  RunLightBenchmark()
+ *
+ *  Sweep the light count from the scene's own lights up to
+ *  4096 randomly placed point lights and report how the
+ *  clustered lighting scales.
+ ***********************************************************/
+bool RunLightBenchmark(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame, int width, int height)
+{
+	if (NULL == pSceneManager)
+	{
+		return false;
+	}
+
+	RenderTarget target;
+	GLenum colorFormat = GL_RGBA8;
+	if (target.CreateTarget(width, height, &colorFormat, 1, GL_DEPTH_COMPONENT24) == false)
+	{
+		return false;
+	}
+	target.Bind();
+
+	LightManager* pLightManager = pSceneManager->GetLightManager();
+	int sceneLightCount = pLightManager->GetLightCount();
+
+	// the same pseudo random lights for every run
+	std::mt19937 generator(1234);
+
+	std::cout << "INFO: Clustered lighting benchmark, " << width << "x" << height << ", "
+		<< MEASURED_FRAMES << " frames per step" << std::endl;
+	std::cout << std::setw(8) << "lights" << std::setw(14) << "assign ms" << std::setw(14) << "cpu frame ms"
+		<< std::setw(14) << "gpu frame ms" << std::setw(16) << "light indices" << std::endl;
+
+	for (int lightCount = 2; lightCount <= MAX_BENCHMARK_LIGHTS; lightCount *= 2)
+	{
+		// keep the scene lights and fill up with point lights
+		FillRandomLights(pLightManager, sceneLightCount, lightCount, generator);
+
+		double assignTime = 0.0;
+		double indexCount = 0.0;
+		FRAME_TIMING timing = MeasureFrames(renderFrame, [&]()
+		{
+			assignTime += pLightManager->GetLastAssignTime();
+			indexCount += pLightManager->GetLastIndexCount();
+		});
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< std::setw(8) << pLightManager->GetLightCount()
+			<< std::setw(14) << assignTime / MEASURED_FRAMES
+			<< std::setw(14) << timing.cpuTime
+			<< std::setw(14) << timing.gpuTime
+			<< std::setw(16) << std::setprecision(0) << indexCount / MEASURED_FRAMES << std::endl;
+	}
+
+	// put the scene back the way it was
+	pLightManager->RemoveLightsFrom(sceneLightCount);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return true;
+}
+
+
+/***********************************************************
+ *  RunDeferredBenchmark()
+ *
+ *  Render the scene with both shading paths at a few light
+ *  counts.  The forward fragments divided by the pixels the
+ *  deferred path lit gives the overdraw the geometry buffer
+ *  saves, the geometry buffer traffic is what it costs.
+ ***********************************************************/
+bool RunDeferredBenchmark(SceneManager* pSceneManager, RenderPipeline* pRenderPipeline,
+	const RenderFrameFunction& renderFrame, int width, int height)
+{
+	if ((NULL == pSceneManager) || (NULL == pRenderPipeline))
+	{
+		return false;
+	}
+
+	RenderTarget target;
+	GLenum colorFormat = GL_RGBA8;
+	if (target.CreateTarget(width, height, &colorFormat, 1, GL_DEPTH_COMPONENT24) == false)
+	{
+		return false;
+	}
+	target.Bind();
+
+	LightManager* pLightManager = pSceneManager->GetLightManager();
+	int sceneLightCount = pLightManager->GetLightCount();
+	RENDER_PATH startPath = pRenderPipeline->GetRenderPath();
+	bool bStartPrepass = pRenderPipeline->GetDepthPrepass();
+	std::mt19937 generator(1234);
+
+	// both paths draw the geometry with the plain depth test
+	pRenderPipeline->SetDepthPrepass(false);
+	pRenderPipeline->SetRenderPath(RENDER_PATH_DEFERRED);
+	if (pRenderPipeline->GetRenderPath() != RENDER_PATH_DEFERRED)
+	{
+		std::cout << "Deferred shading is not available for the benchmark" << std::endl;
+		pRenderPipeline->SetDepthPrepass(bStartPrepass);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return false;
+	}
+
+	std::cout << "INFO: Forward and deferred shading benchmark, " << width << "x" << height << ", "
+		<< MEASURED_FRAMES << " frames per step" << std::endl;
+	std::cout << std::setw(8) << "lights" << std::setw(10) << "path" << std::setw(14) << "gpu frame ms"
+		<< std::setw(14) << "shaded frags" << std::setw(14) << "covered px" << std::setw(10) << "overdraw"
+		<< std::setw(16) << "gbuffer MB" << std::setw(14) << "shading saved" << std::endl;
+
+	for (int lightCount : COMPARE_LIGHT_COUNTS)
+	{
+		FillRandomLights(pLightManager, sceneLightCount, lightCount, generator);
+
+		// averaged counts of both paths, forward first
+		double shadedFragments[2] = { 0.0, 0.0 };
+		double geometryFragments[2] = { 0.0, 0.0 };
+		double coveredPixels = 0.0;
+		double gpuTime[2] = { 0.0, 0.0 };
+
+		for (int path = RENDER_PATH_FORWARD; path <= RENDER_PATH_DEFERRED; path++)
+		{
+			pRenderPipeline->SetRenderPath((RENDER_PATH)path);
+
+			int statFrames = 0;
+			FRAME_TIMING timing = MeasureFrames(renderFrame, [&]()
+			{
+				// the counts lag a few frames behind, so skip any
+				// that still belong to the other path
+				const RENDER_STATS& stats = pRenderPipeline->GetStats();
+				if (stats.path == path)
+				{
+					shadedFragments[path] += (double)stats.shadedFragments;
+					geometryFragments[path] += (double)stats.geometryFragments;
+					if (RENDER_PATH_DEFERRED == path)
+					{
+						coveredPixels += (double)stats.coveredPixels;
+					}
+					statFrames++;
+				}
+			});
+			gpuTime[path] = timing.gpuTime;
+
+			if (statFrames > 0)
+			{
+				shadedFragments[path] /= statFrames;
+				geometryFragments[path] /= statFrames;
+				if (RENDER_PATH_DEFERRED == path)
+				{
+					coveredPixels /= statFrames;
+				}
+			}
+		}
+
+		// every geometry fragment writes the buffer, every lighting
+		// fragment reads it back
+		double gbufferBytes = (geometryFragments[RENDER_PATH_DEFERRED] + shadedFragments[RENDER_PATH_DEFERRED])
+			* RenderPipeline::GBUFFER_BYTES_PER_PIXEL;
+		double overdraw = (coveredPixels > 0.0) ? shadedFragments[RENDER_PATH_FORWARD] / coveredPixels : 0.0;
+		double shadingSaved = (shadedFragments[RENDER_PATH_FORWARD] > 0.0) ?
+			100.0 * (1.0 - shadedFragments[RENDER_PATH_DEFERRED] / shadedFragments[RENDER_PATH_FORWARD]) : 0.0;
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< std::setw(8) << lightCount << std::setw(10) << "forward"
+			<< std::setw(14) << gpuTime[RENDER_PATH_FORWARD]
+			<< std::setw(14) << std::setprecision(0) << shadedFragments[RENDER_PATH_FORWARD]
+			<< std::setw(14) << "-" << std::setw(10) << std::setprecision(2) << overdraw
+			<< std::setw(16) << "-" << std::setw(14) << "-" << std::endl;
+		std::cout << std::fixed << std::setprecision(3)
+			<< std::setw(8) << lightCount << std::setw(10) << "deferred"
+			<< std::setw(14) << gpuTime[RENDER_PATH_DEFERRED]
+			<< std::setw(14) << std::setprecision(0) << shadedFragments[RENDER_PATH_DEFERRED]
+			<< std::setw(14) << coveredPixels << std::setw(10) << "-"
+			<< std::setw(16) << std::setprecision(2) << gbufferBytes / (1024.0 * 1024.0)
+			<< std::setw(13) << std::setprecision(1) << shadingSaved << "%" << std::endl;
+	}
+
+	// put the scene back the way it was
+	pLightManager->RemoveLightsFrom(sceneLightCount);
+	pRenderPipeline->SetRenderPath(startPath);
+	pRenderPipeline->SetDepthPrepass(bStartPrepass);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return true;
+}
+
+/***********************************************************
+ *  RunPrepassBenchmark()
+ *
+ *  Render the scene with forward shading at a few light counts,
+ *  once drawing and shading in one pass and once shading behind
+ *  a depth pre-pass.  The pre-pass pays off once the shading it
+ *  saves outweighs drawing the scene a second time.
+ ***********************************************************/
+bool RunPrepassBenchmark(SceneManager* pSceneManager, RenderPipeline* pRenderPipeline,
+	const RenderFrameFunction& renderFrame, int width, int height)
+{
+	if ((NULL == pSceneManager) || (NULL == pRenderPipeline))
+	{
+		return false;
+	}
+
+	RenderTarget target;
+	GLenum colorFormat = GL_RGBA8;
+	if (target.CreateTarget(width, height, &colorFormat, 1, GL_DEPTH_COMPONENT24) == false)
+	{
+		return false;
+	}
+	target.Bind();
+
+	LightManager* pLightManager = pSceneManager->GetLightManager();
+	int sceneLightCount = pLightManager->GetLightCount();
+	RENDER_PATH startPath = pRenderPipeline->GetRenderPath();
+	bool bStartPrepass = pRenderPipeline->GetDepthPrepass();
+	std::mt19937 generator(1234);
+
+	pRenderPipeline->SetRenderPath(RENDER_PATH_FORWARD);
+
+	std::cout << "INFO: Depth pre-pass benchmark, " << width << "x" << height << ", "
+		<< MEASURED_FRAMES << " frames per step" << std::endl;
+	std::cout << std::setw(8) << "lights" << std::setw(10) << "pre-pass" << std::setw(14) << "gpu frame ms"
+		<< std::setw(14) << "shaded frags" << std::setw(14) << "covered px" << std::setw(10) << "overdraw"
+		<< std::setw(10) << "speedup" << std::endl;
+
+	for (int lightCount : COMPARE_LIGHT_COUNTS)
+	{
+		FillRandomLights(pLightManager, sceneLightCount, lightCount, generator);
+
+		double gpuTime[2] = { 0.0, 0.0 };
+		for (int prepass = 0; prepass < 2; prepass++)
+		{
+			pRenderPipeline->SetDepthPrepass(prepass != 0);
+
+			double shadedFragments = 0.0;
+			double coveredPixels = 0.0;
+			double overdraw = 0.0;
+			int statFrames = 0;
+			FRAME_TIMING timing = MeasureFrames(renderFrame, [&]()
+			{
+				// skip counts still belonging to the other setting
+				const RENDER_STATS& stats = pRenderPipeline->GetStats();
+				if (stats.bDepthPrepass == (prepass != 0))
+				{
+					shadedFragments += (double)stats.shadedFragments;
+					coveredPixels += (double)stats.coveredPixels;
+					overdraw += stats.overdraw;
+					statFrames++;
+				}
+			});
+			gpuTime[prepass] = timing.gpuTime;
+
+			if (statFrames > 0)
+			{
+				shadedFragments /= statFrames;
+				coveredPixels /= statFrames;
+				overdraw /= statFrames;
+			}
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(8) << lightCount << std::setw(10) << ((prepass != 0) ? "on" : "off")
+				<< std::setw(14) << gpuTime[prepass]
+				<< std::setw(14) << std::setprecision(0) << shadedFragments
+				<< std::setw(14) << coveredPixels
+				<< std::setw(10) << std::setprecision(2) << overdraw;
+			if ((prepass != 0) && (gpuTime[1] > 0.0))
+			{
+				std::cout << std::setw(9) << gpuTime[0] / gpuTime[1] << "x";
+			}
+			std::cout << std::endl;
+		}
+	}
+
+	// put the scene back the way it was
+	pLightManager->RemoveLightsFrom(sceneLightCount);
+	pRenderPipeline->SetRenderPath(startPath);
+	pRenderPipeline->SetDepthPrepass(bStartPrepass);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return true;
+}
+
+/***********************************************************
+ *  RunSoftwareComparison()
+ *
+ *  Render the scene once with forward shading and once with
+ *  the software rasterizer and compare the two images pixel by
+ *  pixel.  The GPU path runs without its shadow maps and the
+ *  pre-pass, which the software path does not have.  The
+ *  loader thread has to finish first, the software path skips
+ *  textures and meshes that are still being uploaded.
+ ***********************************************************/
+bool RunSoftwareComparison(SceneManager* pSceneManager, RenderPipeline* pRenderPipeline,
+	const RenderFrameFunction& renderFrame, int width, int height)
+{
+	if ((NULL == pSceneManager) || (NULL == pRenderPipeline))
+	{
+		return false;
+	}
+
+	RenderTarget target;
+	GLenum colorFormat = GL_RGBA8;
+	if (target.CreateTarget(width, height, &colorFormat, 1, GL_DEPTH_COMPONENT24) == false)
+	{
+		return false;
+	}
+	target.Bind();
+
+	RENDER_PATH startPath = pRenderPipeline->GetRenderPath();
+	bool bStartPrepass = pRenderPipeline->GetDepthPrepass();
+	ShadowManager* pShadowManager = pRenderPipeline->GetShadowManager();
+	bool bStartShadows = pShadowManager->GetEnabled();
+	pRenderPipeline->SetDepthPrepass(false);
+	pShadowManager->SetEnabled(false);
+
+	pRenderPipeline->SetRenderPath(RENDER_PATH_FORWARD);
+	WaitForUploads(pSceneManager, renderFrame);
+
+	// one image from each path, read back bottom row first
+	std::vector<unsigned char> images[2];
+	const RENDER_PATH comparedPaths[2] = { RENDER_PATH_FORWARD, RENDER_PATH_SOFTWARE };
+	for (int path = 0; path < 2; path++)
+	{
+		pRenderPipeline->SetRenderPath(comparedPaths[path]);
+		renderFrame();
+		images[path].resize((size_t)width * height * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, images[path].data());
+	}
+
+	int maxDifference = 0;
+	double squaredError = 0.0;
+	double totalDifference = 0.0;
+	size_t mismatchedPixels = 0;
+	size_t pixelCount = (size_t)width * height;
+	for (size_t pixel = 0; pixel < pixelCount; pixel++)
+	{
+		// the alpha of the framebuffer is not shown, only the color
+		int pixelDifference = 0;
+		for (int channel = 0; channel < 3; channel++)
+		{
+			int difference = abs((int)images[0][(pixel * 4) + channel] - (int)images[1][(pixel * 4) + channel]);
+			pixelDifference = std::max(pixelDifference, difference);
+			squaredError += (double)difference * difference;
+			totalDifference += difference;
+		}
+		maxDifference = std::max(maxDifference, pixelDifference);
+		if (pixelDifference > SOFTWARE_CHANNEL_TOLERANCE)
+		{
+			mismatchedPixels++;
+		}
+	}
+
+	double meanSquaredError = squaredError / (pixelCount * 3.0);
+	double psnr = (meanSquaredError > 0.0) ? 10.0 * log10((255.0 * 255.0) / meanSquaredError) : 99.0;
+	double mismatch = (double)mismatchedPixels / pixelCount;
+	bool bMatch = (mismatch <= SOFTWARE_MISMATCH_LIMIT) && (psnr >= SOFTWARE_PSNR_LIMIT);
+
+	// the software frame time once the copies of the meshes and
+	// textures have been made
+	SoftwareRasterizer* pSoftwareRasterizer = pRenderPipeline->GetSoftwareRasterizer();
+	double softwareTime = 0.0;
+	MeasureFrames(renderFrame, [&]()
+	{
+		softwareTime += pSoftwareRasterizer->GetLastFrameTime();
+	});
+	softwareTime /= MEASURED_FRAMES;
+
+	pRenderPipeline->SetRenderPath(RENDER_PATH_FORWARD);
+	FRAME_TIMING forwardTiming = MeasureFrames(renderFrame, std::function<void()>());
+
+	std::cout << "INFO: Software rasterizer comparison, " << width << "x" << height << ", shadows off" << std::endl;
+	std::cout << std::fixed << std::setprecision(3)
+		<< "  max difference  " << maxDifference << std::endl
+		<< "  mean difference " << totalDifference / (pixelCount * 3.0) << std::endl
+		<< "  mismatched      " << std::setprecision(2) << mismatch * 100.0 << "% of pixels past "
+		<< SOFTWARE_CHANNEL_TOLERANCE << std::endl
+		<< "  PSNR            " << psnr << " dB" << std::endl
+		<< "  software frame  " << std::setprecision(3) << softwareTime << " ms, "
+		<< pSoftwareRasterizer->GetLastTriangleCount() << " triangles" << std::endl
+		<< "  forward frame   " << forwardTiming.gpuTime << " ms GPU" << std::endl
+		<< (bMatch ? "INFO: The software image matches the forward path" :
+			"ERROR: The software image does not match the forward path") << std::endl;
+
+	// put the scene back the way it was
+	pShadowManager->SetEnabled(bStartShadows);
+	pRenderPipeline->SetRenderPath(startPath);
+	pRenderPipeline->SetDepthPrepass(bStartPrepass);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return(bMatch);
+}
+
+/***********************************************************
+ *  RunReferenceRender()
+ *
+ *  Trace the view of the scene with 16 samples per pixel on
+ *  all threads of the scene's pool and write the image.  One
+ *  frame is rendered first to record the draws.
+ ***********************************************************/
+bool RunReferenceRender(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame,
+	const FRAME_DATA& frameData, int width, int height, const char* filename)
+{
+	if ((NULL == pSceneManager) || (NULL == filename))
+	{
+		return false;
+	}
+
+	WaitForUploads(pSceneManager, renderFrame);
+	renderFrame();
+
+	RayTracer rayTracer;
+	if (rayTracer.RenderImage(pSceneManager, frameData, width, height, REFERENCE_SAMPLE_GRID,
+		pSceneManager->GetThreadPool()) == false)
+	{
+		return false;
+	}
+	bool bWritten = WriteImage(filename, (const unsigned char*)rayTracer.GetImage(), width, height);
+
+	double raysPerSecond = (double)rayTracer.GetLastRayCount() / (rayTracer.GetLastTraceTime() / 1000.0);
+	std::cout << "INFO: Reference image, " << width << "x" << height << ", "
+		<< REFERENCE_SAMPLE_GRID * REFERENCE_SAMPLE_GRID << " samples per pixel" << std::endl;
+	std::cout << std::fixed << std::setprecision(3)
+		<< "  triangles       " << rayTracer.GetTriangleCount() << " in " << rayTracer.GetNodeCount() << " nodes" << std::endl
+		<< "  build           " << rayTracer.GetLastBuildTime() << " ms" << std::endl
+		<< "  trace           " << rayTracer.GetLastTraceTime() << " ms on "
+		<< pSceneManager->GetThreadPool()->GetThreadCount() << " threads" << std::endl
+		<< "  rays            " << rayTracer.GetLastRayCount() << ", "
+		<< std::setprecision(2) << raysPerSecond / 1000000.0 << " Mrays/s" << std::endl;
+	if (bWritten)
+	{
+		std::cout << "INFO: Wrote the reference image to " << filename << std::endl;
+	}
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *  RunRayTracerBenchmark()
+ *
+ *  Trace the view of the scene with 1, 2, 4 and more threads
+ *  up to the hardware threads, and report the ray throughput
+ *  and how close each step comes to scaling linearly.
+ ***********************************************************/
+bool RunRayTracerBenchmark(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame,
+	const FRAME_DATA& frameData, int width, int height)
+{
+	if (NULL == pSceneManager)
+	{
+		return false;
+	}
+
+	WaitForUploads(pSceneManager, renderFrame);
+	renderFrame();
+
+	std::vector<int> threadCounts;
+	int hardwareThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+	for (int threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(hardwareThreads);
+
+	std::cout << "INFO: Ray tracer benchmark, " << width << "x" << height << ", 1 sample per pixel" << std::endl;
+	std::cout << "  threads   trace ms    Mrays/s   speedup   efficiency" << std::endl;
+
+	RayTracer rayTracer;
+	double singleThreadTime = 0.0;
+	for (size_t step = 0; step < threadCounts.size(); step++)
+	{
+		ThreadPool threadPool(threadCounts[step]);
+
+		// the hierarchy is rebuilt for every image, only the
+		// tracing is measured
+		double traceTime = 0.0;
+		unsigned long long rayCount = 0;
+		for (int pass = 0; pass < RAY_TRACER_BENCHMARK_PASSES; pass++)
+		{
+			if (rayTracer.RenderImage(pSceneManager, frameData, width, height, 1, &threadPool) == false)
+			{
+				return false;
+			}
+			traceTime += rayTracer.GetLastTraceTime();
+			rayCount += rayTracer.GetLastRayCount();
+		}
+		traceTime /= RAY_TRACER_BENCHMARK_PASSES;
+		rayCount /= RAY_TRACER_BENCHMARK_PASSES;
+
+		if (0 == step)
+		{
+			singleThreadTime = traceTime;
+		}
+		double speedup = singleThreadTime / traceTime;
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::setw(9) << threadPool.GetThreadCount()
+			<< std::setw(11) << traceTime
+			<< std::setw(11) << ((double)rayCount / (traceTime / 1000.0)) / 1000000.0
+			<< std::setw(10) << speedup
+			<< std::setw(12) << (speedup / threadPool.GetThreadCount()) * 100.0 << "%" << std::endl;
+	}
+
+	std::cout << "  build           " << std::setprecision(3) << rayTracer.GetLastBuildTime() << " ms, "
+		<< rayTracer.GetTriangleCount() << " triangles in " << rayTracer.GetNodeCount() << " nodes" << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  RunCaptureBenchmark()
+ *
+ *  Capture a stream of frames at 1080p and 4K in each format
+ *  and report how many frames per second get all the way
+ *  through encoding.  The synchronous readback waits for each
+ *  frame before the next one is recorded, the frame capture
+ *  lets the GPU copy one frame while the next one renders.
+ *  Images are encoded but not written, so the numbers do not
+ *  depend on the disk.
+ ***********************************************************/
+bool RunCaptureBenchmark(SceneManager* pSceneManager, ViewManager* pViewManager,
+	const RenderFrameFunction& renderFrame)
+{
+	if ((NULL == pSceneManager) || (NULL == pViewManager))
+	{
+		return false;
+	}
+
+	std::cout << "INFO: Capture benchmark, " << CAPTURE_BENCHMARK_FRAMES << " frames per step, encoded and not written" << std::endl;
+	std::cout << "  size         format   sync fps   async fps   read back ms   MB per frame" << std::endl;
+
+	ImageWriteQueue writeQueue;
+	for (int size = 0; size < 2; size++)
+	{
+		int width = CAPTURE_SIZES[size][0];
+		int height = CAPTURE_SIZES[size][1];
+
+		RenderTarget target;
+		FrameCapture capture;
+		GLenum colorFormat = GL_RGBA8;
+		if ((target.CreateTarget(width, height, &colorFormat, 1, GL_DEPTH_COMPONENT24) == false) ||
+			(capture.CreateCapture(width, height) == false))
+		{
+			return false;
+		}
+		target.Bind();
+		pViewManager->SetViewSize(width, height);
+		WaitForUploads(pSceneManager, renderFrame);
+		for (int i = 0; i < WARMUP_FRAMES; i++)
+		{
+			renderFrame();
+		}
+		glFinish();
+
+		for (int format = 0; format < 3; format++)
+		{
+			// glReadPixels into memory, every frame waits for the GPU
+			writeQueue.ResetStatistics();
+			std::vector<unsigned char> pixels;
+			std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+			for (int frame = 0; frame < CAPTURE_BENCHMARK_FRAMES; frame++)
+			{
+				renderFrame();
+				pixels.resize((size_t)width * height * 4);
+				glPixelStorei(GL_PACK_ALIGNMENT, 4);
+				glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+				writeQueue.Submit(std::string(), CAPTURE_FORMATS[format], &pixels, width, height);
+			}
+			writeQueue.WaitIdle();
+			double syncTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+			// the same frames through the pixel buffers
+			writeQueue.ResetStatistics();
+			capture.ResetReadbackTime();
+			startTime = std::chrono::high_resolution_clock::now();
+			for (int frame = 0; frame < CAPTURE_BENCHMARK_FRAMES; frame++)
+			{
+				renderFrame();
+				capture.Capture(std::string(), CAPTURE_FORMATS[format], &writeQueue);
+			}
+			capture.Flush();
+			writeQueue.WaitIdle();
+			double asyncTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+			double encodedSize = (double)writeQueue.GetEncodedBytes() / std::max(writeQueue.GetEncodedCount(), 1);
+			std::cout << std::fixed << std::setprecision(1)
+				<< "  " << std::setw(4) << width << "x" << std::setw(4) << height << "    "
+				<< std::setw(6) << CAPTURE_FORMAT_NAMES[format]
+				<< std::setw(11) << CAPTURE_BENCHMARK_FRAMES / syncTime
+				<< std::setw(12) << CAPTURE_BENCHMARK_FRAMES / asyncTime
+				<< std::setprecision(3)
+				<< std::setw(15) << capture.GetReadbackTime() / CAPTURE_BENCHMARK_FRAMES
+				<< std::setprecision(2)
+				<< std::setw(15) << encodedSize / (1024.0 * 1024.0) << std::endl;
+		}
+	}
+
+	pViewManager->SetViewSize(0, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return true;
+}
+
+/***********************************************************
+ *  RunMaterialBenchmark()
+ *
+ *  Fill the interleaved material structs that the scene used
+ *  to keep and a material store with the same random values.
+ *  Time a pass that reads every shading value, and an upload
+ *  of the whole table into a storage buffer.  The interleaved
+ *  table has to be packed before its upload, the store copies
+ *  its hot block as is.
+ ***********************************************************/
+bool RunMaterialBenchmark(SceneManager* pSceneManager)
+{
+	if (NULL == pSceneManager)
+	{
+		return false;
+	}
+
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> value(0.0f, 1.0f);
+
+	std::vector<SceneManager::OBJECT_MATERIAL> interleaved(MATERIAL_BENCHMARK_COUNT);
+	MaterialStore store;
+	for (int i = 0; i < MATERIAL_BENCHMARK_COUNT; i++)
+	{
+		SceneManager::OBJECT_MATERIAL& material = interleaved[i];
+		material.ambientStrength = value(generator);
+		material.ambientColor = glm::vec3(value(generator), value(generator), value(generator));
+		material.diffuseColor = glm::vec3(value(generator), value(generator), value(generator));
+		material.specularColor = glm::vec3(value(generator), value(generator), value(generator));
+		material.shininess = value(generator) * 64.0f;
+		material.tag = "benchmark material " + std::to_string(i);
+
+		store.AddMaterial(material.tag.c_str(), material.ambientStrength, material.ambientColor,
+			material.diffuseColor, material.specularColor, material.shininess);
+	}
+
+	// both scans add up what a shader would read for every
+	// material, the sums keep the loops from being removed
+	double scanTime[2] = { 0.0, 0.0 };
+	float scanSum[2] = { 0.0f, 0.0f };
+	for (int pass = 0; pass < MATERIAL_BENCHMARK_PASSES; pass++)
+	{
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		glm::vec3 sum(0.0f);
+		for (const SceneManager::OBJECT_MATERIAL& material : interleaved)
+		{
+			sum += (material.ambientColor * material.ambientStrength) + material.diffuseColor +
+				(material.specularColor * material.shininess);
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		scanTime[0] += elapsed.count();
+		scanSum[0] += sum.x + sum.y + sum.z;
+
+		startTime = std::chrono::high_resolution_clock::now();
+		const glm::vec4* pAmbient = store.GetArray(MaterialStore::MATERIAL_AMBIENT);
+		const glm::vec4* pDiffuse = store.GetArray(MaterialStore::MATERIAL_DIFFUSE);
+		const glm::vec4* pSpecular = store.GetArray(MaterialStore::MATERIAL_SPECULAR);
+		sum = glm::vec3(0.0f);
+		for (int i = 0; i < store.GetCount(); i++)
+		{
+			sum += (glm::vec3(pAmbient[i]) * pAmbient[i].w) + glm::vec3(pDiffuse[i]) +
+				(glm::vec3(pSpecular[i]) * pSpecular[i].w);
+		}
+		elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		scanTime[1] += elapsed.count();
+		scanSum[1] += sum.x + sum.y + sum.z;
+	}
+
+	// both buffers get their storage ahead of the timing and are
+	// rewritten in place, so only the layout differs.  The uploads
+	// wait for the GPU so the transfer is counted.
+	GLuint bufferID = 0;
+	glGenBuffers(1, &bufferID);
+	std::vector<glm::vec4> packed((size_t)MATERIAL_BENCHMARK_COUNT * 3);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, packed.size() * sizeof(glm::vec4), NULL, GL_STATIC_DRAW);
+	TrackBuffer(bufferID, packed.size() * sizeof(glm::vec4), "Benchmark materials");
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	store.Upload();
+	double uploadTime[2] = { 0.0, 0.0 };
+	glFinish();
+	for (int pass = 0; pass < MATERIAL_BENCHMARK_PASSES; pass++)
+	{
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < MATERIAL_BENCHMARK_COUNT; i++)
+		{
+			const SceneManager::OBJECT_MATERIAL& material = interleaved[i];
+			packed[(size_t)i * 3] = glm::vec4(material.ambientColor, material.ambientStrength);
+			packed[((size_t)i * 3) + 1] = glm::vec4(material.diffuseColor, 0.0f);
+			packed[((size_t)i * 3) + 2] = glm::vec4(material.specularColor, material.shininess);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, packed.size() * sizeof(glm::vec4), packed.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glFinish();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		uploadTime[0] += elapsed.count();
+
+		startTime = std::chrono::high_resolution_clock::now();
+		store.Upload();
+		glFinish();
+		elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		uploadTime[1] += elapsed.count();
+	}
+	UntrackResource(RESOURCE_BUFFER, bufferID);
+	glDeleteBuffers(1, &bufferID);
+
+	std::cout << "INFO: Material table benchmark, " << MATERIAL_BENCHMARK_COUNT << " materials, "
+		<< MATERIAL_BENCHMARK_PASSES << " passes" << std::endl;
+	std::cout << std::setw(14) << "layout" << std::setw(12) << "scan ms" << std::setw(12) << "upload ms"
+		<< std::setw(14) << "upload MB" << std::setw(14) << "checksum" << std::endl;
+	const char* layoutNames[2] = { "interleaved", "store" };
+	double uploadBytes[2] = { (double)(packed.size() * sizeof(glm::vec4)), (double)store.GetHotSize() };
+	for (int layout = 0; layout < 2; layout++)
+	{
+		std::cout << std::fixed << std::setprecision(3)
+			<< std::setw(14) << layoutNames[layout]
+			<< std::setw(12) << scanTime[layout] / MATERIAL_BENCHMARK_PASSES
+			<< std::setw(12) << uploadTime[layout] / MATERIAL_BENCHMARK_PASSES
+			<< std::setw(14) << std::setprecision(2) << uploadBytes[layout] / (1024.0 * 1024.0)
+			<< std::setw(14) << std::setprecision(0) << scanSum[layout] << std::endl;
+	}
+
+	// bind the scene's own materials again
+	store.DestroyBuffer();
+	pSceneManager->GetMaterialStore()->Upload();
+
+	return true;
+}
+
+/***********************************************************
+ *  RunImportBenchmark()
+ *
+ *  Write a grid of quads as an OBJ file and import it through
+ *  the mapped file on the calling thread only and on the
+ *  scene's thread pool.
+ ***********************************************************/
+bool RunImportBenchmark(SceneManager* pSceneManager)
+{
+	if (NULL == pSceneManager)
+	{
+		return false;
+	}
+
+	double fileBytes = 0.0;
+	if (!WriteGridFile(IMPORT_BENCHMARK_FILE, IMPORT_BENCHMARK_GRID, &fileBytes))
+	{
+		return false;
+	}
+
+	ThreadPool* threadPools[2] = { NULL, pSceneManager->GetThreadPool() };
+	double importTime[2] = { 0.0, 0.0 };
+	size_t vertexCount[2] = { 0, 0 };
+	size_t triangleCount[2] = { 0, 0 };
+	for (int setup = 0; setup < 2; setup++)
+	{
+		for (int pass = 0; pass < IMPORT_BENCHMARK_PASSES; pass++)
+		{
+			MESH_DATA mesh;
+			std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+			if (!ImportMesh(IMPORT_BENCHMARK_FILE, threadPools[setup], &mesh))
+			{
+				remove(IMPORT_BENCHMARK_FILE);
+				return false;
+			}
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+			importTime[setup] += elapsed.count();
+			vertexCount[setup] = mesh.vertices.size();
+			triangleCount[setup] = mesh.indices.size() / 3;
+		}
+	}
+	remove(IMPORT_BENCHMARK_FILE);
+
+	std::cout << "INFO: OBJ import benchmark, " << std::fixed << std::setprecision(1)
+		<< fileBytes / (1024.0 * 1024.0) << " MB, " << IMPORT_BENCHMARK_PASSES << " passes" << std::endl;
+	std::cout << std::setw(10) << "threads" << std::setw(12) << "import ms" << std::setw(10) << "MB/s"
+		<< std::setw(14) << "Mtriangles/s" << std::setw(12) << "triangles" << std::setw(12) << "vertices" << std::endl;
+	for (int setup = 0; setup < 2; setup++)
+	{
+		int threads = (NULL != threadPools[setup]) ? threadPools[setup]->GetThreadCount() : 1;
+		double seconds = importTime[setup] / IMPORT_BENCHMARK_PASSES / 1000.0;
+		std::cout << std::fixed << std::setprecision(1)
+			<< std::setw(10) << threads
+			<< std::setw(12) << importTime[setup] / IMPORT_BENCHMARK_PASSES
+			<< std::setw(10) << fileBytes / (1024.0 * 1024.0) / seconds
+			<< std::setw(14) << std::setprecision(2) << triangleCount[setup] / 1000000.0 / seconds
+			<< std::setw(12) << triangleCount[setup]
+			<< std::setw(12) << vertexCount[setup] << std::endl;
+	}
+
+	return true;
+}
+
+
+/***********************************************************
+ *  RunUploadBenchmark()
+ *
+ *  Time the frames of the scene, then request a mesh file of
+ *  2M triangles and keep rendering while the loader thread
+ *  imports and uploads it.  The longest frame while loading
+ *  is printed next to the longest one before, and the mesh
+ *  has to draw in the frame after it is swapped in.
+ ***********************************************************/
+bool RunUploadBenchmark(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame)
+{
+	if (NULL == pSceneManager)
+	{
+		return false;
+	}
+
+	double fileBytes = 0.0;
+	if (!WriteGridFile(UPLOAD_BENCHMARK_FILE, UPLOAD_BENCHMARK_GRID, &fileBytes))
+	{
+		return false;
+	}
+
+	// the scene's own textures are finished before timing starts
+	WaitForUploads(pSceneManager, renderFrame);
+	for (int i = 0; i < WARMUP_FRAMES; i++)
+	{
+		renderFrame();
+	}
+	glFinish();
+
+	double idleTime = 0.0;
+	double idleLongest = 0.0;
+	for (int i = 0; i < MEASURED_FRAMES; i++)
+	{
+		double frameTime = TimeFrame(renderFrame);
+		idleTime += frameTime;
+		idleLongest = std::max(idleLongest, frameTime);
+	}
+
+	// a flat grid on the floor in front of the still life
+	std::chrono::high_resolution_clock::time_point loadStart = std::chrono::high_resolution_clock::now();
+	if (!pSceneManager->RequestImportedMesh(UPLOAD_BENCHMARK_FILE,
+		glm::vec3(8.0f, 1.0f, 4.0f), glm::vec3(-4.0f, -0.5f, -2.0f)))
+	{
+		remove(UPLOAD_BENCHMARK_FILE);
+		return false;
+	}
+	std::chrono::duration<double, std::milli> requestTime = std::chrono::high_resolution_clock::now() - loadStart;
+
+	int loadFrames = 0;
+	double loadTime = 0.0;
+	double loadLongest = 0.0;
+	std::chrono::duration<double> waited(0.0);
+	while (pSceneManager->HasPendingUploads() && (waited.count() < UPLOAD_BENCHMARK_TIMEOUT))
+	{
+		double frameTime = TimeFrame(renderFrame);
+		loadTime += frameTime;
+		loadLongest = std::max(loadLongest, frameTime);
+		loadFrames++;
+		waited = std::chrono::high_resolution_clock::now() - loadStart;
+	}
+	std::chrono::duration<double, std::milli> uploadTime = std::chrono::high_resolution_clock::now() - loadStart;
+	remove(UPLOAD_BENCHMARK_FILE);
+	if (pSceneManager->HasPendingUploads())
+	{
+		std::cout << "WARNING: The mesh file was not uploaded within " << UPLOAD_BENCHMARK_TIMEOUT << " s" << std::endl;
+		return false;
+	}
+
+	// the swapped in mesh has its triangles and a model matrix built
+	// with its bounds, the placeholder's bounds scale it to a point
+	renderFrame();
+	const MeshLibrary* pMeshLibrary = pSceneManager->GetMeshLibrary();
+	int meshID = pSceneManager->GetMeshID(SceneManager::MESH_IMPORTED);
+	const SceneManager::DRAW_COMMAND* pDrawCommands = pSceneManager->GetDrawCommands();
+	bool bDrawn = false;
+	for (int i = 0; i < pSceneManager->GetDrawCommandCount(); i++)
+	{
+		if (SceneManager::MESH_IMPORTED == pDrawCommands[i].mesh)
+		{
+			bDrawn = (meshID >= 0) && (pMeshLibrary->GetMesh(meshID).indexCount > 0) &&
+				(glm::length(glm::vec3(pDrawCommands[i].drawData.model[0])) > 0.0f);
+		}
+	}
+
+	std::cout << "INFO: Mesh upload benchmark, " << std::fixed << std::setprecision(1)
+		<< fileBytes / (1024.0 * 1024.0) << " MB, "
+		<< (2 * UPLOAD_BENCHMARK_GRID * UPLOAD_BENCHMARK_GRID) << " triangles" << std::endl;
+	std::cout << std::setw(10) << "frames" << std::setw(10) << "count" << std::setw(12) << "average ms"
+		<< std::setw(12) << "longest ms" << std::endl;
+	std::cout << std::setw(10) << "idle" << std::setw(10) << MEASURED_FRAMES
+		<< std::setw(12) << std::setprecision(2) << idleTime / MEASURED_FRAMES
+		<< std::setw(12) << idleLongest << std::endl;
+	std::cout << std::setw(10) << "loading" << std::setw(10) << loadFrames
+		<< std::setw(12) << std::setprecision(2) << ((loadFrames > 0) ? (loadTime / loadFrames) : 0.0)
+		<< std::setw(12) << loadLongest << std::endl;
+	std::cout << "INFO: Request took " << requestTime.count() << " ms, the mesh was swapped in after "
+		<< uploadTime.count() << " ms" << std::endl;
+
+	if (!bDrawn)
+	{
+		std::cout << "WARNING: The uploaded mesh is not drawn" << std::endl;
+		return false;
+	}
+	return true;
+}
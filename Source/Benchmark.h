@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.h
+// ============
+// offscreen performance runs of the 3D scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "RenderPipeline.h"
+#include "ViewManager.h"
+
+#include <functional>
+
+// renders one complete frame into the currently bound framebuffer
+typedef std::function<void()> RenderFrameFunction;
+
+// render the scene offscreen with 2 up to 4096 lights and print
+// the cluster assignment, CPU frame and GPU frame times
+bool RunLightBenchmark(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame, int width, int height);
+
+// render the scene offscreen with forward and deferred shading at
+// several light counts and print the time, shading work and
+// geometry buffer traffic of both paths
+bool RunDeferredBenchmark(SceneManager* pSceneManager, RenderPipeline* pRenderPipeline,
+	const RenderFrameFunction& renderFrame, int width, int height);
+
+// render the scene offscreen with forward shading with and without
+// the depth pre-pass and print the time and overdraw of both
+bool RunPrepassBenchmark(SceneManager* pSceneManager, RenderPipeline* pRenderPipeline,
+	const RenderFrameFunction& renderFrame, int width, int height);
+
+// scan and upload a table of 100k materials kept as interleaved
+// structs with their tags and kept in the material store, and
+// print the time of both layouts
+bool RunMaterialBenchmark(SceneManager* pSceneManager);
+
+// render the scene with forward shading and with the software
+// rasterizer, both without shadows, and print how far the two
+// images are apart and the software frame time, false when they
+// differ by more than the rasterization rules explain
+bool RunSoftwareComparison(SceneManager* pSceneManager, RenderPipeline* pRenderPipeline,
+	const RenderFrameFunction& renderFrame, int width, int height);
+
+// trace the view of the frame data with 16 samples per pixel and
+// write the image into a TGA file, with the build and trace times
+// and the ray throughput
+bool RunReferenceRender(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame,
+	const FRAME_DATA& frameData, int width, int height, const char* filename);
+
+// trace the view of the frame data with 1 thread up to all hardware
+// threads and print the ray throughput and the scaling of each step
+bool RunRayTracerBenchmark(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame,
+	const FRAME_DATA& frameData, int width, int height);
+
+// render the scene offscreen at 1080p and 4K and capture every frame
+// as raw pixels, QOI and PNG, once read back synchronously and once
+// through the pixel buffers of the frame capture, and print the
+// frames captured per second of both
+bool RunCaptureBenchmark(SceneManager* pSceneManager, ViewManager* pViewManager,
+	const RenderFrameFunction& renderFrame);
+
+// write an OBJ file of a grid with over 10M triangles, import it
+// on one thread and on the scene's thread pool, and print the
+// time and throughput of both
+bool RunImportBenchmark(SceneManager* pSceneManager);
+
+// render the scene while a mesh file of 2M triangles is imported and
+// uploaded on the loader thread, print the frame times before and
+// during the load, false when the mesh does not draw afterwards
+bool RunUploadBenchmark(SceneManager* pSceneManager, const RenderFrameFunction& renderFrame);
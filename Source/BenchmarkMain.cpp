@@ -0,0 +1,279 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarkmain.cpp
+// ============
+// entry point of the benchmark suite, built as its own executable
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line parsing
+#include <chrono>           // startup timing
+
+#include <GL/glew.h>        // GLEW library
+#include "GLFW/glfw3.h"     // GLFW library
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "FrameArena.h"
+#include "FrameRingBuffer.h"
+#include "RenderPipeline.h"
+#include "UploadQueue.h"
+#include "BenchmarkSuite.h"
+#include "ResourceTracker.h"
+#include "ShaderManager.h"
+
+// Namespace for declaring global variables
+namespace
+{
+	const char* const WINDOW_TITLE = "7-1 FinalProject Benchmark";
+
+	// the 1000x scene records a thousand times the draws of the
+	// application, so the per-frame storage is sized for it
+	const GLsizeiptr BENCHMARK_RING_SIZE = 128 * 1024 * 1024;
+	const size_t BENCHMARK_ARENA_SIZE = 16 * 1024 * 1024;
+	// frames rendered while waiting for the scene's uploads
+	const int STARTUP_UPLOAD_FRAMES = 600;
+
+	// results file and the growth allowed before a value regresses
+	const char* const DEFAULT_OUTPUT_FILE = "benchmark_results.json";
+	const double DEFAULT_THRESHOLD = 0.10;
+	// exit code of a run with regressions, setup errors exit with
+	// EXIT_FAILURE
+	const int EXIT_REGRESSION = 2;
+
+	GLFWwindow* g_Window = nullptr;
+	SceneManager* g_SceneManager = nullptr;
+	ShaderManager* g_ShaderManager = nullptr;
+	ViewManager* g_ViewManager = nullptr;
+	FrameRingBuffer* g_FrameRingBuffer = nullptr;
+	FrameArena* g_FrameArena = nullptr;
+	RenderPipeline* g_RenderPipeline = nullptr;
+	UploadQueue* g_UploadQueue = nullptr;
+}
+
+bool InitializeGLFW();
+bool InitializeGLEW();
+void RenderFrame();
+void DestroyObjects();
+
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  Set up the scene in a hidden window, run the suite and
+ *  write its results.  With --baseline <file> the results
+ *  are compared and a regression exits with a non-zero code.
+ *  --output <file> and --threshold <fraction> change where
+ *  the results go and how much growth is allowed,
+ *  --replay-input <file> adds a recorded camera path,
+ *  --reverse-z renders the camera passes with reverse Z and
+ *  --dynamic-resolution <ms> scales them to fit the budget.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	const char* outputFile = DEFAULT_OUTPUT_FILE;
+	const char* baselineFile = NULL;
+	const char* replayFile = NULL;
+	double threshold = DEFAULT_THRESHOLD;
+	bool bReverseDepth = false;
+	double frameBudget = 0.0;
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+		{
+			outputFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--baseline") == 0) && (i + 1 < argc))
+		{
+			baselineFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--replay-input") == 0) && (i + 1 < argc))
+		{
+			replayFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--threshold") == 0) && (i + 1 < argc))
+		{
+			threshold = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--reverse-z") == 0)
+		{
+			bReverseDepth = true;
+		}
+		else if ((strcmp(argv[i], "--dynamic-resolution") == 0) && (i + 1 < argc))
+		{
+			frameBudget = atof(argv[++i]);
+		}
+	}
+
+	// read the baseline first, a missing one should not cost a run
+	SUITE_RUN baseline;
+	if ((NULL != baselineFile) && (ReadSuiteRun(baselineFile, &baseline) == false))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	if (InitializeGLFW() == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	g_ShaderManager = new ShaderManager();
+	g_FrameRingBuffer = new FrameRingBuffer();
+	g_FrameArena = new FrameArena(BENCHMARK_ARENA_SIZE);
+	g_ViewManager = new ViewManager(
+		g_ShaderManager,
+		g_FrameRingBuffer);
+
+	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	if ((NULL == g_Window) || (InitializeGLEW() == false) ||
+		(g_FrameRingBuffer->CreateBuffer(BENCHMARK_RING_SIZE) == false))
+	{
+		DestroyObjects();
+		return(EXIT_FAILURE);
+	}
+
+	TrackProgram(g_ShaderManager->LoadShaders(
+		"vertexShader.glsl",
+		"fragmentShader.glsl"), "scene");
+	g_ShaderManager->use();
+
+	g_UploadQueue = new UploadQueue(g_Window);
+	g_SceneManager = new SceneManager(g_ShaderManager, g_FrameRingBuffer, g_FrameArena, g_UploadQueue);
+	g_SceneManager->PrepareScene();
+
+	g_RenderPipeline = new RenderPipeline(g_ShaderManager, g_FrameRingBuffer);
+	g_RenderPipeline->CreatePipeline(
+		g_ViewManager->GetWindowWidth(),
+		g_ViewManager->GetWindowHeight());
+	g_RenderPipeline->SetReverseDepth(bReverseDepth);
+	if (frameBudget > 0.0)
+	{
+		g_RenderPipeline->GetDynamicResolution()->SetFrameBudget(frameBudget);
+		g_RenderPipeline->GetDynamicResolution()->SetEnabled(true);
+	}
+
+	// the application has started once the first frame shows the
+	// scene with all of its textures and meshes
+	RenderFrame();
+	for (int i = 0; (i < STARTUP_UPLOAD_FRAMES) && g_SceneManager->HasPendingUploads(); i++)
+	{
+		RenderFrame();
+	}
+	glFinish();
+
+	SUITE_RUN run;
+	run.startupTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	bool bSucceeded = RunBenchmarkSuite(g_SceneManager, g_ViewManager, RenderFrame, &run) &&
+		((NULL == replayFile) || RunReplayScene(g_SceneManager, g_ViewManager, RenderFrame, replayFile, &run)) &&
+		WriteSuiteRun(outputFile, run);
+	DestroyObjects();
+
+	if (!bSucceeded)
+	{
+		return(EXIT_FAILURE);
+	}
+	std::cout << "INFO: Benchmark results written to " << outputFile << std::endl;
+
+	if ((NULL != baselineFile) && (CompareSuiteRuns(baseline, run, threshold) > 0))
+	{
+		return(EXIT_REGRESSION);
+	}
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to render one frame of the 3D scene
+ *  into the currently bound framebuffer.
+ ***********************************************************/
+void RenderFrame()
+{
+	g_FrameRingBuffer->BeginFrame();
+	g_FrameArena->Reset();
+
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	g_ViewManager->PrepareSceneView();
+	g_RenderPipeline->RenderFrame(g_SceneManager, g_ViewManager->GetFrameData());
+
+	g_FrameRingBuffer->EndFrame();
+	EndResourceFrame(g_FrameArena->GetUsed());
+}
+
+/***********************************************************
+ *	DestroyObjects()
+ *
+ *  This function is used to free the manager objects, the
+ *  upload queue goes first so no finished upload reaches the
+ *  scene.
+ ***********************************************************/
+void DestroyObjects()
+{
+	delete g_UploadQueue;
+	g_UploadQueue = NULL;
+	delete g_RenderPipeline;
+	g_RenderPipeline = NULL;
+	delete g_SceneManager;
+	g_SceneManager = NULL;
+	delete g_ViewManager;
+	g_ViewManager = NULL;
+	UntrackResources(RESOURCE_PROGRAM, "scene");
+	delete g_ShaderManager;
+	g_ShaderManager = NULL;
+	delete g_FrameRingBuffer;
+	g_FrameRingBuffer = NULL;
+	delete g_FrameArena;
+	g_FrameArena = NULL;
+	glfwTerminate();
+}
+
+/***********************************************************
+ *	InitializeGLFW()
+ *
+ *  This function is used to initialize the GLFW library with
+ *  the context of the application, the window stays hidden.
+ ***********************************************************/
+bool InitializeGLFW()
+{
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cout << "Failed to initialize GLFW" << std::endl;
+		return false;
+	}
+
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#else
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#endif
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	return(true);
+}
+
+/***********************************************************
+ *	InitializeGLEW()
+ *
+ *  This function is used to initialize the GLEW library.
+ ***********************************************************/
+bool InitializeGLEW()
+{
+	GLenum GLEWInitResult = glewInit();
+	if (GLEW_OK != GLEWInitResult)
+	{
+		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
+		return false;
+	}
+
+	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+	return(true);
+}
@@ -0,0 +1,698 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarksuite.cpp
+// ============
+// regression runs of scaled up scenes, compared against a stored baseline
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BenchmarkSuite.h"
+#include "RenderCounters.h"
+#include "RenderTarget.h"
+#include "ResourceTracker.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// declaration of global variables
+namespace
+{
+	// frames rendered before measuring starts
+	const int SUITE_WARMUP_FRAMES = 10;
+	// frames measured for every scene
+	const int SUITE_MEASURED_FRAMES = 120;
+	// frames rendered while waiting for the loader thread
+	const int SUITE_UPLOAD_WAIT_FRAMES = 600;
+	// version of the result files
+	const int SUITE_FILE_VERSION = 1;
+	// point lights added for the light heavy scene
+	const int SUITE_EXTRA_LIGHTS = 1024;
+	// copies of the still life the recorded camera path flies past
+	const int REPLAY_SCENE_COPIES = 10;
+	// smallest growth of a time in milliseconds and of the memory in
+	// megabytes that counts, below it the noise of the run dominates
+	const double MIN_TIME_REGRESSION = 0.05;
+	const double MIN_MEMORY_REGRESSION = 1.0;
+	// the counts per frame are written with two decimals
+	const double COUNT_ROUNDING = 0.01;
+
+	// one scene of the suite
+	struct SUITE_SCENE
+	{
+		const char* name;
+		// copies of the still life
+		int copies;
+		// point lights added to the scene's own
+		int extraLights;
+		// set when every draw samples its own texture
+		bool bTextureHeavy;
+	};
+
+	// the texture heavy scene goes last, its textures stay loaded
+	const SUITE_SCENE SUITE_SCENES[] =
+	{
+		{ "base", 1, 0, false },
+		{ "scaled_10x", 10, 0, false },
+		{ "scaled_100x", 100, 0, false },
+		{ "scaled_1000x", 1000, 0, false },
+		{ "light_heavy", 10, SUITE_EXTRA_LIGHTS, false },
+		{ "texture_heavy", 10, 0, true }
+	};
+	const int SUITE_SCENE_COUNT = 6;
+
+	/***********************************************************
+	 *  GetSuiteView()
+	 *
+	 *  The camera is pulled back from where the application
+	 *  starts, so the scaled scenes show more than one copy.
+	 ***********************************************************/
+	CAMERA_POSE GetSuiteView()
+	{
+		CAMERA_POSE pose;
+		pose.position = glm::vec3(0.0f, 2.0f, 40.0f);
+		pose.front = glm::vec3(0.0f, 0.0f, -1.0f);
+		pose.up = glm::vec3(0.0f, 1.0f, 0.0f);
+		pose.zoom = 80.0f;
+		pose.bOrthographic = false;
+		return(pose);
+	}
+
+	/***********************************************************
+	 *  GetResidentMemory()
+	 *
+	 *  Megabytes of the process that are held in physical memory,
+	 *  zero where the platform cannot tell.
+	 ***********************************************************/
+	double GetResidentMemory()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return((double)counters.WorkingSetSize / (1024.0 * 1024.0));
+		}
+		return(0.0);
+#else
+		long pages = 0;
+		long residentPages = 0;
+		FILE* pFile = fopen("/proc/self/statm", "r");
+		if (NULL == pFile)
+		{
+			return(0.0);
+		}
+		int fields = fscanf(pFile, "%ld %ld", &pages, &residentPages);
+		fclose(pFile);
+		if (2 != fields)
+		{
+			return(0.0);
+		}
+		return((double)residentPages * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+#endif
+	}
+
+	/***********************************************************
+	 *  AddSpreadLights()
+	 *
+	 *  Add randomly placed point lights over the copies of the
+	 *  still life, the same lights on every run.
+	 ***********************************************************/
+	void AddSpreadLights(LightManager* pLightManager, const glm::vec2& extent, int lightCount)
+	{
+		std::mt19937 generator(1234);
+		std::uniform_real_distribution<float> positionX(-extent.x - 12.0f, extent.x + 12.0f);
+		std::uniform_real_distribution<float> positionY(-extent.y - 10.0f, extent.y + 10.0f);
+		std::uniform_real_distribution<float> positionZ(-9.0f, 6.0f);
+		std::uniform_real_distribution<float> radius(2.0f, 4.0f);
+		std::uniform_real_distribution<float> color(0.2f, 1.0f);
+
+		for (int i = 0; i < lightCount; i++)
+		{
+			LIGHT_DATA light;
+			light.position = glm::vec4(positionX(generator), positionY(generator), positionZ(generator), radius(generator));
+			light.ambientColor = glm::vec4(0.0f, 0.0f, 0.0f, 16.0f);
+			light.diffuseColor = glm::vec4(color(generator), color(generator), color(generator), 0.5f);
+			light.specularColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+			pLightManager->AddLight(light);
+		}
+	}
+
+	/***********************************************************
+	 *  WarmUp()
+	 *
+	 *  Render the frames that are not measured and wait for them.
+	 ***********************************************************/
+	void WarmUp(const RenderFrameFunction& renderFrame)
+	{
+		for (int i = 0; i < SUITE_WARMUP_FRAMES; i++)
+		{
+			renderFrame();
+		}
+		glFinish();
+	}
+
+	/***********************************************************
+	 *  MeasureScene()
+	 *
+	 *  Time the measured frames on the CPU and with GPU timer
+	 *  queries and count their GL calls.  With a replaying view
+	 *  every frame of the replay is measured.
+	 ***********************************************************/
+	void MeasureScene(const RenderFrameFunction& renderFrame, const ViewManager* pReplayView, SUITE_RESULT* pResult)
+	{
+		GLuint timerQuery = 0;
+		glGenQueries(1, &timerQuery);
+
+		double cpuTime = 0.0;
+		double gpuTime = 0.0;
+		int frameCount = 0;
+		ResetRenderCounters();
+		while ((NULL != pReplayView) ? !pReplayView->IsReplayFinished() : (frameCount < SUITE_MEASURED_FRAMES))
+		{
+			std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+			glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+			renderFrame();
+			glEndQuery(GL_TIME_ELAPSED);
+
+			// waiting on the query keeps the frames from overlapping
+			GLuint64 gpuNanoseconds = 0;
+			glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &gpuNanoseconds);
+
+			cpuTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+			gpuTime += (double)gpuNanoseconds / 1000000.0;
+			frameCount++;
+		}
+		const RENDER_COUNTERS& counters = GetRenderCounters();
+
+		glDeleteQueries(1, &timerQuery);
+
+		if (frameCount < 1)
+		{
+			frameCount = 1;
+		}
+		pResult->cpuFrameTime = cpuTime / frameCount;
+		pResult->gpuFrameTime = gpuTime / frameCount;
+		pResult->drawCalls = (double)counters.drawCalls / frameCount;
+		pResult->stateChanges = (double)counters.stateChanges / frameCount;
+		pResult->memory = GetResidentMemory();
+		pResult->gpuMemory = (double)GetResourceTotals().totalBytes / (1024.0 * 1024.0);
+	}
+
+	/***********************************************************
+	 *  PrintResult()
+	 *
+	 *  Print the values measured for one scene on one line.
+	 ***********************************************************/
+	void PrintResult(const SUITE_RESULT& result)
+	{
+		std::cout << "  " << std::left << std::setw(16) << result.scene << std::right << std::fixed << std::setprecision(3)
+			<< "CPU " << result.cpuFrameTime << " ms, GPU " << result.gpuFrameTime << " ms, "
+			<< std::setprecision(0) << result.drawCalls << " draws, " << result.stateChanges << " state changes, "
+			<< std::setprecision(1) << result.memory << " MB, GL " << result.gpuMemory << " MB, setup "
+			<< result.setupTime << " ms" << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+		std::cout << std::setprecision(6);
+	}
+
+	/***********************************************************
+	 *  SkipSpace() / ReadCharacter() / ReadString() / ReadNumber()
+	 *
+	 *  Read the JSON tokens of a result file, the position is
+	 *  moved past what was read.
+	 ***********************************************************/
+	void SkipSpace(const std::string& text, size_t* pPosition)
+	{
+		while ((*pPosition < text.size()) && isspace((unsigned char)text[*pPosition]))
+		{
+			(*pPosition)++;
+		}
+	}
+
+	bool ReadString(const std::string& text, size_t* pPosition, std::string* pValue)
+	{
+		SkipSpace(text, pPosition);
+		if ((*pPosition >= text.size()) || ('"' != text[*pPosition]))
+		{
+			return false;
+		}
+		size_t end = text.find('"', *pPosition + 1);
+		if (std::string::npos == end)
+		{
+			return false;
+		}
+		*pValue = text.substr(*pPosition + 1, end - *pPosition - 1);
+		*pPosition = end + 1;
+		return true;
+	}
+
+	bool ReadNumber(const std::string& text, size_t* pPosition, double* pValue)
+	{
+		SkipSpace(text, pPosition);
+		const char* pStart = text.c_str() + *pPosition;
+		char* pEnd = NULL;
+		*pValue = strtod(pStart, &pEnd);
+		if (pEnd == pStart)
+		{
+			return false;
+		}
+		*pPosition += pEnd - pStart;
+		return true;
+	}
+
+	bool ReadCharacter(const std::string& text, size_t* pPosition, char character)
+	{
+		SkipSpace(text, pPosition);
+		if ((*pPosition >= text.size()) || (character != text[*pPosition]))
+		{
+			return false;
+		}
+		(*pPosition)++;
+		return true;
+	}
+
+	/***********************************************************
+	 *  ReadResult()
+	 *
+	 *  Read the object of one scene, keys that are not known
+	 *  are skipped so newer files can still be compared.
+	 ***********************************************************/
+	bool ReadResult(const std::string& text, size_t* pPosition, SUITE_RESULT* pResult)
+	{
+		if (!ReadCharacter(text, pPosition, '{'))
+		{
+			return false;
+		}
+
+		SUITE_RESULT result = { std::string(), 0.0, 0.0, 0.0, 0.0, 0.0, -1.0, 0.0 };
+		while (!ReadCharacter(text, pPosition, '}'))
+		{
+			std::string key;
+			if (!ReadString(text, pPosition, &key) || !ReadCharacter(text, pPosition, ':'))
+			{
+				return false;
+			}
+
+			double value = 0.0;
+			if ("name" == key)
+			{
+				if (!ReadString(text, pPosition, &result.scene))
+				{
+					return false;
+				}
+			}
+			else if (!ReadNumber(text, pPosition, &value))
+			{
+				return false;
+			}
+			else if ("cpuFrameTime" == key)
+			{
+				result.cpuFrameTime = value;
+			}
+			else if ("gpuFrameTime" == key)
+			{
+				result.gpuFrameTime = value;
+			}
+			else if ("drawCalls" == key)
+			{
+				result.drawCalls = value;
+			}
+			else if ("stateChanges" == key)
+			{
+				result.stateChanges = value;
+			}
+			else if ("memory" == key)
+			{
+				result.memory = value;
+			}
+			else if ("gpuMemory" == key)
+			{
+				result.gpuMemory = value;
+			}
+			else if ("setupTime" == key)
+			{
+				result.setupTime = value;
+			}
+			ReadCharacter(text, pPosition, ',');
+		}
+
+		*pResult = result;
+		return true;
+	}
+
+	/***********************************************************
+	 *  CompareValue()
+	 *
+	 *  Print one value next to its baseline, returns true when
+	 *  it regressed past the allowed growth.
+	 ***********************************************************/
+	bool CompareValue(const char* name, double baseline, double value, double allowedGrowth)
+	{
+		bool bRegressed = (value > (baseline + allowedGrowth));
+		double change = (baseline > 0.0) ? ((value - baseline) * 100.0 / baseline) : 0.0;
+		std::cout << "    " << std::left << std::setw(14) << name << std::right
+			<< std::setw(12) << baseline << std::setw(12) << value
+			<< std::setw(9) << change << "%" << (bRegressed ? "   REGRESSION" : "") << std::endl;
+		return(bRegressed);
+	}
+
+	// the growth a time is allowed, relative to its baseline
+	double AllowedTimeGrowth(double baseline, double threshold)
+	{
+		return(std::max(baseline * threshold, MIN_TIME_REGRESSION));
+	}
+}
+
+/***********************************************************
+ *  RunBenchmarkSuite()
+ *
+ *  Set up each scene of the suite in turn, wait until it has
+ *  rendered with all of its uploads, then measure it.  Every
+ *  scene is put back the way it was found afterwards.
+ ***********************************************************/
+bool RunBenchmarkSuite(SceneManager* pSceneManager, ViewManager* pViewManager,
+	const RenderFrameFunction& renderFrame, SUITE_RUN* pRun)
+{
+	if ((NULL == pSceneManager) || (NULL == pViewManager) || (NULL == pRun))
+	{
+		return false;
+	}
+
+	int width = pViewManager->GetWindowWidth();
+	int height = pViewManager->GetWindowHeight();
+	RenderTarget target;
+	GLenum colorFormat = GL_RGBA8;
+	if (target.CreateTarget(width, height, &colorFormat, 1, GL_DEPTH_COMPONENT24) == false)
+	{
+		return false;
+	}
+	target.Bind();
+	pViewManager->SetFixedView(GetSuiteView());
+
+	LightManager* pLightManager = pSceneManager->GetLightManager();
+	int sceneLightCount = pLightManager->GetLightCount();
+
+	std::cout << "INFO: Benchmark suite, " << width << "x" << height << ", "
+		<< SUITE_MEASURED_FRAMES << " frames per scene" << std::endl;
+
+	for (int i = 0; i < SUITE_SCENE_COUNT; i++)
+	{
+		const SUITE_SCENE& scene = SUITE_SCENES[i];
+
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		pSceneManager->SetSceneCopies(scene.copies);
+		if (scene.extraLights > 0)
+		{
+			AddSpreadLights(pLightManager, pSceneManager->GetSceneCopyExtent(), scene.extraLights);
+		}
+		if (scene.bTextureHeavy)
+		{
+			pSceneManager->FillTextureSlots();
+			pSceneManager->SetTextureEveryDraw(true);
+		}
+		renderFrame();
+		for (int frame = 0; (frame < SUITE_UPLOAD_WAIT_FRAMES) && pSceneManager->HasPendingUploads(); frame++)
+		{
+			renderFrame();
+		}
+		glFinish();
+
+		SUITE_RESULT result;
+		result.scene = scene.name;
+		result.setupTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		WarmUp(renderFrame);
+		MeasureScene(renderFrame, NULL, &result);
+		pRun->results.push_back(result);
+
+		PrintResult(result);
+
+		pLightManager->RemoveLightsFrom(sceneLightCount);
+		pSceneManager->SetTextureEveryDraw(false);
+	}
+
+	pSceneManager->SetSceneCopies(1);
+	pViewManager->ClearFixedView();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return true;
+}
+
+/***********************************************************
+ *  RunReplayScene()
+ *
+ *  Replay a recorded camera path through the scene with ten
+ *  copies of the still life, measuring every frame of it.
+ *  The replay renders a fixed time step per frame, so every
+ *  run renders the same frames.
+ ***********************************************************/
+bool RunReplayScene(SceneManager* pSceneManager, ViewManager* pViewManager,
+	const RenderFrameFunction& renderFrame, const char* filename, SUITE_RUN* pRun)
+{
+	if ((NULL == pSceneManager) || (NULL == pViewManager) || (NULL == filename) || (NULL == pRun))
+	{
+		return false;
+	}
+
+	RenderTarget target;
+	GLenum colorFormat = GL_RGBA8;
+	if (target.CreateTarget(pViewManager->GetWindowWidth(), pViewManager->GetWindowHeight(),
+		&colorFormat, 1, GL_DEPTH_COMPONENT24) == false)
+	{
+		return false;
+	}
+	target.Bind();
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	pSceneManager->SetSceneCopies(REPLAY_SCENE_COPIES);
+	renderFrame();
+	for (int frame = 0; (frame < SUITE_UPLOAD_WAIT_FRAMES) && pSceneManager->HasPendingUploads(); frame++)
+	{
+		renderFrame();
+	}
+	WarmUp(renderFrame);
+
+	SUITE_RESULT result;
+	result.scene = "replay";
+	result.setupTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	if (pViewManager->StartReplay(filename) == false)
+	{
+		pSceneManager->SetSceneCopies(1);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return false;
+	}
+	MeasureScene(renderFrame, pViewManager, &result);
+	pRun->results.push_back(result);
+
+	PrintResult(result);
+
+	pSceneManager->SetSceneCopies(1);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return true;
+}
+
+/***********************************************************
+ *  WriteSuiteRun()
+ *
+ *  Write the run as a JSON object with the startup time and
+ *  an array of the scene results.
+ ***********************************************************/
+bool WriteSuiteRun(const char* filename, const SUITE_RUN& run)
+{
+	FILE* pFile = fopen(filename, "w");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write the benchmark results " << filename << std::endl;
+		return false;
+	}
+
+	fprintf(pFile, "{\n  \"version\": %d,\n  \"startupTime\": %.4f,\n  \"scenes\": [\n",
+		SUITE_FILE_VERSION, run.startupTime);
+	for (size_t i = 0; i < run.results.size(); i++)
+	{
+		const SUITE_RESULT& result = run.results[i];
+		fprintf(pFile,
+			"    {\n"
+			"      \"name\": \"%s\",\n"
+			"      \"cpuFrameTime\": %.4f,\n"
+			"      \"gpuFrameTime\": %.4f,\n"
+			"      \"drawCalls\": %.2f,\n"
+			"      \"stateChanges\": %.2f,\n"
+			"      \"memory\": %.2f,\n"
+			"      \"gpuMemory\": %.2f,\n"
+			"      \"setupTime\": %.4f\n"
+			"    }%s\n",
+			result.scene.c_str(), result.cpuFrameTime, result.gpuFrameTime, result.drawCalls,
+			result.stateChanges, result.memory, result.gpuMemory, result.setupTime,
+			((i + 1) < run.results.size()) ? "," : "");
+	}
+	fprintf(pFile, "  ]\n}\n");
+
+	bool bWritten = (ferror(pFile) == 0);
+	bWritten = (fclose(pFile) == 0) && bWritten;
+	if (!bWritten)
+	{
+		std::cout << "Could not write the benchmark results " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  ReadSuiteRun()
+ *
+ *  Read a run back from a file WriteSuiteRun() wrote, the
+ *  top level keys may come in any order.
+ ***********************************************************/
+bool ReadSuiteRun(const char* filename, SUITE_RUN* pRun)
+{
+	FILE* pFile = fopen(filename, "r");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not open the benchmark baseline " << filename << std::endl;
+		return false;
+	}
+	std::string text;
+	char buffer[4096];
+	size_t bytesRead = 0;
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+	{
+		text.append(buffer, bytesRead);
+	}
+	fclose(pFile);
+
+	SUITE_RUN run;
+	run.startupTime = 0.0;
+	size_t position = 0;
+	bool bRead = ReadCharacter(text, &position, '{');
+	while (bRead && !ReadCharacter(text, &position, '}'))
+	{
+		std::string key;
+		double value = 0.0;
+		bRead = ReadString(text, &position, &key) && ReadCharacter(text, &position, ':');
+		if (!bRead)
+		{
+			break;
+		}
+
+		if ("scenes" == key)
+		{
+			bRead = ReadCharacter(text, &position, '[');
+			while (bRead && !ReadCharacter(text, &position, ']'))
+			{
+				SUITE_RESULT result;
+				bRead = ReadResult(text, &position, &result);
+				if (bRead)
+				{
+					run.results.push_back(result);
+				}
+				ReadCharacter(text, &position, ',');
+			}
+		}
+		else
+		{
+			bRead = ReadNumber(text, &position, &value);
+			if ("startupTime" == key)
+			{
+				run.startupTime = value;
+			}
+		}
+		ReadCharacter(text, &position, ',');
+	}
+
+	if (!bRead)
+	{
+		std::cout << "The benchmark baseline " << filename << " could not be read" << std::endl;
+		return false;
+	}
+	*pRun = run;
+	return true;
+}
+
+/***********************************************************
+ *  CompareSuiteRuns()
+ *
+ *  Print the values of every scene next to the baseline and
+ *  count the ones that regressed.  A scene of the baseline
+ *  that was not run counts as a regression, a new scene is
+ *  only reported.
+ ***********************************************************/
+int CompareSuiteRuns(const SUITE_RUN& baseline, const SUITE_RUN& run, double threshold)
+{
+	int regressions = 0;
+
+	std::cout << "INFO: Compared against the baseline, " << (threshold * 100.0) << "% allowed" << std::endl;
+	std::cout << "    value             baseline     current   change" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+
+	if (CompareValue("startup ms", baseline.startupTime, run.startupTime,
+		AllowedTimeGrowth(baseline.startupTime, threshold)))
+	{
+		regressions++;
+	}
+
+	for (size_t i = 0; i < baseline.results.size(); i++)
+	{
+		const SUITE_RESULT& expected = baseline.results[i];
+		const SUITE_RESULT* pResult = NULL;
+		for (size_t j = 0; j < run.results.size(); j++)
+		{
+			if (run.results[j].scene == expected.scene)
+			{
+				pResult = &run.results[j];
+			}
+		}
+
+		std::cout << "  " << expected.scene << std::endl;
+		if (NULL == pResult)
+		{
+			std::cout << "    not run   REGRESSION" << std::endl;
+			regressions++;
+			continue;
+		}
+
+		regressions += CompareValue("CPU ms", expected.cpuFrameTime, pResult->cpuFrameTime,
+			AllowedTimeGrowth(expected.cpuFrameTime, threshold)) ? 1 : 0;
+		regressions += CompareValue("GPU ms", expected.gpuFrameTime, pResult->gpuFrameTime,
+			AllowedTimeGrowth(expected.gpuFrameTime, threshold)) ? 1 : 0;
+		regressions += CompareValue("draw calls", expected.drawCalls, pResult->drawCalls, COUNT_ROUNDING) ? 1 : 0;
+		regressions += CompareValue("state changes", expected.stateChanges, pResult->stateChanges, COUNT_ROUNDING) ? 1 : 0;
+		regressions += CompareValue("memory MB", expected.memory, pResult->memory,
+			std::max(expected.memory * threshold, MIN_MEMORY_REGRESSION)) ? 1 : 0;
+		if (expected.gpuMemory >= 0.0)
+		{
+			regressions += CompareValue("GL memory MB", expected.gpuMemory, pResult->gpuMemory,
+				std::max(expected.gpuMemory * threshold, MIN_MEMORY_REGRESSION)) ? 1 : 0;
+		}
+		regressions += CompareValue("setup ms", expected.setupTime, pResult->setupTime,
+			AllowedTimeGrowth(expected.setupTime, threshold)) ? 1 : 0;
+	}
+
+	for (size_t i = 0; i < run.results.size(); i++)
+	{
+		bool bKnown = false;
+		for (size_t j = 0; j < baseline.results.size(); j++)
+		{
+			bKnown = bKnown || (baseline.results[j].scene == run.results[i].scene);
+		}
+		if (!bKnown)
+		{
+			std::cout << "  " << run.results[i].scene << " is not in the baseline" << std::endl;
+		}
+	}
+
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+	std::cout << "INFO: " << regressions << " regressions" << std::endl;
+	return(regressions);
+}
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarksuite.h
+// ============
+// regression runs of scaled up scenes, compared against a stored baseline
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Benchmark.h"
+
+#include <string>
+#include <vector>
+
+// measured values of one suite scene
+struct SUITE_RESULT
+{
+	std::string scene;
+	// average CPU and GPU time of a frame in milliseconds
+	double cpuFrameTime;
+	double gpuFrameTime;
+	// draw calls and state changes of a frame
+	double drawCalls;
+	double stateChanges;
+	// resident memory of the process after the scene, in megabytes
+	double memory;
+	// megabytes of the tracked GL objects, negative when a baseline
+	// was written before they were tracked
+	double gpuMemory;
+	// milliseconds from switching to the scene until a frame with
+	// all of its uploads was rendered
+	double setupTime;
+};
+
+// everything one run of the suite measured
+struct SUITE_RUN
+{
+	// milliseconds from the start of the process until the first
+	// scene was ready
+	double startupTime;
+	std::vector<SUITE_RESULT> results;
+};
+
+// render the scene as built, scaled up 10x, 100x and 1000x, and
+// with many lights and many textures, offscreen from a fixed view,
+// and add a result for every scene to the run
+bool RunBenchmarkSuite(SceneManager* pSceneManager, ViewManager* pViewManager,
+	const RenderFrameFunction& renderFrame, SUITE_RUN* pRun);
+
+// replay a camera path recorded with --record-input through the
+// scene scaled up 10x and add its result to the run as "replay"
+bool RunReplayScene(SceneManager* pSceneManager, ViewManager* pViewManager,
+	const RenderFrameFunction& renderFrame, const char* filename, SUITE_RUN* pRun);
+
+// write a run into a JSON file, and read one back from a file
+// written the same way
+bool WriteSuiteRun(const char* filename, const SUITE_RUN& run);
+bool ReadSuiteRun(const char* filename, SUITE_RUN* pRun);
+
+// print every value of the run next to the baseline and return
+// how many regressed.  Times and memory regress when they grow by
+// more than the threshold, a fraction of the baseline, and the
+// counts regress when they grow at all.
+int CompareSuiteRuns(const SUITE_RUN& baseline, const SUITE_RUN& run, double threshold);
@@ -0,0 +1,391 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpuscene.cpp
+// ============
+// copies of the scene resources and the scene shading for the CPU renderers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CpuScene.h"
+#include "SceneManager.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  DecodeOctahedral()
+	 *
+	 *  Unfold a compact vertex normal the same way the vertex
+	 *  shader does.
+	 ***********************************************************/
+	glm::vec3 DecodeOctahedral(glm::vec2 folded)
+	{
+		glm::vec3 normal = glm::vec3(folded.x, folded.y, 1.0f - fabsf(folded.x) - fabsf(folded.y));
+		float lower = std::max(-normal.z, 0.0f);
+		normal.x += (normal.x >= 0.0f) ? -lower : lower;
+		normal.y += (normal.y >= 0.0f) ? -lower : lower;
+		return(glm::normalize(normal));
+	}
+
+	/***********************************************************
+	 *  UnpackSigned()
+	 *
+	 *  Convert a snorm16 value as GL does for normalized vertex
+	 *  attributes.
+	 ***********************************************************/
+	float UnpackSigned(short value)
+	{
+		return(std::max(value / 32767.0f, -1.0f));
+	}
+}
+
+/***********************************************************
+ *  CpuScene()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CpuScene::CpuScene()
+{
+	m_shading.viewPosition = glm::vec3(0.0f);
+	m_shading.pMaterialAmbient = NULL;
+	m_shading.pMaterialDiffuse = NULL;
+	m_shading.pMaterialSpecular = NULL;
+	m_shading.materialCount = 0;
+	m_shading.pLights = NULL;
+	m_shading.lightCount = 0;
+	for (int i = 0; i < CPU_TEXTURE_SLOTS; i++)
+	{
+		m_shading.pSlotTextures[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~CpuScene()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CpuScene::~CpuScene()
+{
+	ReleaseResources();
+}
+
+/***********************************************************
+ *  ReleaseResources()
+ *
+ *  This method is used to drop the copied meshes and
+ *  textures.
+ ***********************************************************/
+void CpuScene::ReleaseResources()
+{
+	m_meshes.clear();
+	m_textures.clear();
+	for (int i = 0; i < CPU_TEXTURE_SLOTS; i++)
+	{
+		m_shading.pSlotTextures[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  GatherShading()
+ *
+ *  This method is used to collect what the fragment shader
+ *  reads for the frame: the material arrays, a copy of the
+ *  lights and the textures bound to the texture slots.
+ ***********************************************************/
+void CpuScene::GatherShading(SceneManager* pSceneManager, const FRAME_DATA& frameData)
+{
+	m_shading.viewPosition = frameData.viewPosition;
+
+	const MaterialStore* pMaterialStore = pSceneManager->GetMaterialStore();
+	m_shading.pMaterialAmbient = pMaterialStore->GetArray(MaterialStore::MATERIAL_AMBIENT);
+	m_shading.pMaterialDiffuse = pMaterialStore->GetArray(MaterialStore::MATERIAL_DIFFUSE);
+	m_shading.pMaterialSpecular = pMaterialStore->GetArray(MaterialStore::MATERIAL_SPECULAR);
+	m_shading.materialCount = pMaterialStore->GetCount();
+
+	const LightManager* pLightManager = pSceneManager->GetLightManager();
+	m_lights.resize(pLightManager->GetLightCount());
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		m_lights[i] = pLightManager->GetLight((int)i);
+	}
+	m_shading.pLights = m_lights.data();
+	m_shading.lightCount = (int)m_lights.size();
+
+	for (int slot = 0; slot < CPU_TEXTURE_SLOTS; slot++)
+	{
+		GLuint textureID = pSceneManager->GetSlotTexture(slot);
+		m_shading.pSlotTextures[slot] = (0 != textureID) ? FindTexture(textureID) : NULL;
+	}
+}
+
+/***********************************************************
+ *  FindMesh()
+ *
+ *  This method is used to get the copy of a mesh, reading
+ *  its vertex and index buffers back and unpacking the
+ *  vertices the first time.  Meshes still being uploaded
+ *  return NULL and are not drawn.
+ ***********************************************************/
+const CPU_MESH* CpuScene::FindMesh(const SceneManager* pSceneManager, int meshID)
+{
+	const MeshLibrary* pMeshLibrary = pSceneManager->GetMeshLibrary();
+	if ((meshID < 0) || (meshID >= pMeshLibrary->GetMeshCount()))
+	{
+		return(NULL);
+	}
+
+	std::map<int, CPU_MESH>::const_iterator found = m_meshes.find(meshID);
+	if (found != m_meshes.end())
+	{
+		return(&found->second);
+	}
+
+	const GPU_MESH& gpuMesh = pMeshLibrary->GetMesh(meshID);
+	if (0 == gpuMesh.indexCount)
+	{
+		return(NULL);
+	}
+
+	size_t stride = MeshCache::GetVertexSize((VERTEX_FORMAT)gpuMesh.vertexFormat);
+	std::vector<unsigned char> vertexData(stride * gpuMesh.vertexCount);
+	size_t indexSize = (GL_UNSIGNED_SHORT == gpuMesh.indexType) ? 2 : 4;
+	std::vector<unsigned char> indexData(indexSize * gpuMesh.indexCount);
+	glBindBuffer(GL_COPY_READ_BUFFER, gpuMesh.vertexBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)vertexData.size(), vertexData.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, gpuMesh.indexBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)indexData.size(), indexData.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	CPU_MESH& mesh = m_meshes[meshID];
+	mesh.vertices.resize(gpuMesh.vertexCount);
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		const unsigned char* pVertex = &vertexData[i * stride];
+		CPU_VERTEX& vertex = mesh.vertices[i];
+		if (VERTEX_FORMAT_COMPACT == gpuMesh.vertexFormat)
+		{
+			const COMPACT_VERTEX* pCompact = (const COMPACT_VERTEX*)pVertex;
+			vertex.position = glm::vec3(UnpackSigned(pCompact->position[0]), UnpackSigned(pCompact->position[1]),
+				UnpackSigned(pCompact->position[2]));
+			vertex.normal = DecodeOctahedral(glm::vec2(UnpackSigned(pCompact->normal[0]), UnpackSigned(pCompact->normal[1])));
+			vertex.uv = glm::vec2(glm::unpackHalf1x16(pCompact->uv[0]), glm::unpackHalf1x16(pCompact->uv[1]));
+		}
+		else
+		{
+			const PACKED_VERTEX* pPacked = (const PACKED_VERTEX*)pVertex;
+			vertex.position = glm::vec3(UnpackSigned(pPacked->position[0]), UnpackSigned(pPacked->position[1]),
+				UnpackSigned(pPacked->position[2]));
+			vertex.normal = glm::vec3(UnpackSigned(pPacked->normal[0]), UnpackSigned(pPacked->normal[1]),
+				UnpackSigned(pPacked->normal[2]));
+			vertex.uv = glm::vec2(pPacked->uv[0] / 65535.0f, pPacked->uv[1] / 65535.0f);
+		}
+	}
+
+	mesh.indices.resize(gpuMesh.indexCount);
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		mesh.indices[i] = (2 == indexSize) ? ((const unsigned short*)indexData.data())[i] :
+			((const unsigned int*)indexData.data())[i];
+	}
+
+	return(&mesh);
+}
+
+/***********************************************************
+ *  FindTexture()
+ *
+ *  This method is used to get the copy of a texture, reading
+ *  its levels back the first time.  Only the base level is
+ *  read when the min filter does not use the mipmaps.
+ ***********************************************************/
+const CPU_TEXTURE* CpuScene::FindTexture(GLuint textureID)
+{
+	std::map<GLuint, CPU_TEXTURE>::const_iterator found = m_textures.find(textureID);
+	if (found != m_textures.end())
+	{
+		return(&found->second);
+	}
+
+	// the texture unit keeps the texture it had
+	GLint boundTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	GLint minFilter = GL_LINEAR;
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &minFilter);
+
+	CPU_TEXTURE& texture = m_textures[textureID];
+	texture.bMipmapped = (GL_NEAREST != minFilter) && (GL_LINEAR != minFilter);
+	int levelCount = texture.bMipmapped ? 16 : 1;
+	for (int level = 0; level < levelCount; level++)
+	{
+		GLint width = 0;
+		GLint height = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+		if ((width <= 0) || (height <= 0))
+		{
+			break;
+		}
+
+		texture.levelOffset.push_back((int)texture.texels.size());
+		texture.levelWidth.push_back(width);
+		texture.levelHeight.push_back(height);
+		texture.texels.resize(texture.texels.size() + ((size_t)width * height));
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, &texture.texels[texture.levelOffset.back()]);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, (GLuint)boundTexture);
+	return(&texture);
+}
+
+/***********************************************************
+ *  UnpackRGBA8() / PackRGBA8()
+ *
+ *  Convert between a RGBA8 texel and a color in 0..1.
+ ***********************************************************/
+glm::vec4 UnpackRGBA8(unsigned int texel)
+{
+	return(glm::vec4((float)(texel & 0xFF), (float)((texel >> 8) & 0xFF),
+		(float)((texel >> 16) & 0xFF), (float)(texel >> 24)) * (1.0f / 255.0f));
+}
+
+unsigned int PackRGBA8(const glm::vec4& color)
+{
+	unsigned int packed = 0;
+	for (int channel = 0; channel < 4; channel++)
+	{
+		float value = std::min(std::max(color[channel], 0.0f), 1.0f);
+		packed |= (unsigned int)lroundf(value * 255.0f) << (channel * 8);
+	}
+	return(packed);
+}
+
+/***********************************************************
+ *  SampleTexture()
+ *
+ *  Read a texture with GL_REPEAT wrapping.  Each level is
+ *  filtered bilinearly, mipmapped textures blend the two
+ *  levels around the passed in level of detail.
+ ***********************************************************/
+glm::vec4 SampleTexture(const CPU_TEXTURE& texture, glm::vec2 uv, float lod)
+{
+	int levelCount = (int)texture.levelWidth.size();
+	if (0 == levelCount)
+	{
+		return(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	float level = texture.bMipmapped ? std::min(std::max(lod, 0.0f), (float)(levelCount - 1)) : 0.0f;
+	int firstLevel = (int)level;
+	float levelBlend = level - firstLevel;
+
+	glm::vec4 result = glm::vec4(0.0f);
+	for (int step = 0; step < 2; step++)
+	{
+		float weight = (0 == step) ? (1.0f - levelBlend) : levelBlend;
+		if (weight <= 0.0f)
+		{
+			continue;
+		}
+
+		int mip = std::min(firstLevel + step, levelCount - 1);
+		int width = texture.levelWidth[mip];
+		int height = texture.levelHeight[mip];
+		const unsigned int* pTexels = &texture.texels[texture.levelOffset[mip]];
+
+		float u = (uv.x * width) - 0.5f;
+		float v = (uv.y * height) - 0.5f;
+		float floorU = floorf(u);
+		float floorV = floorf(v);
+		float blendU = u - floorU;
+		float blendV = v - floorV;
+		int x0 = (int)(((long long)floorU % width + width) % width);
+		int y0 = (int)(((long long)floorV % height + height) % height);
+		int x1 = (x0 + 1) % width;
+		int y1 = (y0 + 1) % height;
+
+		glm::vec4 bottom = glm::mix(UnpackRGBA8(pTexels[(y0 * width) + x0]), UnpackRGBA8(pTexels[(y0 * width) + x1]), blendU);
+		glm::vec4 top = glm::mix(UnpackRGBA8(pTexels[(y1 * width) + x0]), UnpackRGBA8(pTexels[(y1 * width) + x1]), blendU);
+		result += glm::mix(bottom, top, blendV) * weight;
+	}
+
+	return(result);
+}
+
+/***********************************************************
+ *  ShadeSurface()
+ *
+ *  The fragment shader with lighting enabled, as
+ *  SetupSceneLights() leaves it.  Every light is visited, the
+ *  bounded ones fade to nothing at their radius just as the
+ *  cluster lists of the GL path leave them out.  Like the
+ *  shadow maps, the visibility only blocks the direct light.
+ ***********************************************************/
+glm::vec4 ShadeSurface(const CPU_SHADING& shading, const DRAW_DATA& drawData, const glm::vec3& position,
+	const glm::vec3& normal, const glm::vec2& uv, float lod, const float* pLightVisibility)
+{
+	int material = std::min(std::max(drawData.materialIndex, 0), std::max(shading.materialCount - 1, 0));
+	glm::vec3 materialAmbient = glm::vec3(0.0f);
+	float ambientStrength = 0.0f;
+	glm::vec3 materialDiffuse = glm::vec3(0.0f);
+	glm::vec3 materialSpecular = glm::vec3(0.0f);
+	float shininess = 0.0f;
+	if (shading.materialCount > 0)
+	{
+		materialAmbient = glm::vec3(shading.pMaterialAmbient[material]);
+		ambientStrength = shading.pMaterialAmbient[material].w;
+		materialDiffuse = glm::vec3(shading.pMaterialDiffuse[material]);
+		materialSpecular = glm::vec3(shading.pMaterialSpecular[material]);
+		shininess = shading.pMaterialSpecular[material].w;
+	}
+
+	glm::vec3 lightNormal = glm::normalize(normal);
+	glm::vec3 viewDirection = glm::normalize(shading.viewPosition - position);
+
+	glm::vec3 phongResult = glm::vec3(0.0f);
+	for (int i = 0; i < shading.lightCount; i++)
+	{
+		const LIGHT_DATA& light = shading.pLights[i];
+
+		float attenuation = 1.0f;
+		if (light.position.w > 0.0f)
+		{
+			float range = glm::clamp(glm::length(glm::vec3(light.position) - position) / light.position.w, 0.0f, 1.0f);
+			attenuation = (1.0f - (range * range)) * (1.0f - (range * range));
+			if (attenuation <= 0.0f)
+			{
+				continue;
+			}
+		}
+
+		glm::vec3 ambient = glm::vec3(light.ambientColor) + (materialAmbient * ambientStrength);
+		glm::vec3 lightDirection = glm::normalize(glm::vec3(light.position) - position);
+		float impact = std::max(glm::dot(lightNormal, lightDirection), 0.0f);
+		glm::vec3 diffuse = impact * materialDiffuse;
+		glm::vec3 reflectDirection = glm::reflect(-lightDirection, lightNormal);
+		float specularComponent = powf(std::max(glm::dot(viewDirection, reflectDirection), 0.0f), light.ambientColor.w);
+		glm::vec3 specular = (light.diffuseColor.w * shininess) * specularComponent * materialSpecular;
+		float visibility = (NULL != pLightVisibility) ? pLightVisibility[i] : 1.0f;
+
+		phongResult += (ambient + ((diffuse + specular) * visibility)) * attenuation;
+	}
+
+	if (0 != drawData.bUseTexture)
+	{
+		const CPU_TEXTURE* pTexture = ((drawData.textureSlot >= 0) && (drawData.textureSlot < CPU_TEXTURE_SLOTS)) ?
+			shading.pSlotTextures[drawData.textureSlot] : NULL;
+		glm::vec4 textureColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		if (NULL != pTexture)
+		{
+			textureColor = SampleTexture(*pTexture, uv * drawData.UVscale, lod);
+		}
+		return(glm::vec4(phongResult * glm::vec3(textureColor), 1.0f));
+	}
+
+	return(glm::vec4(phongResult * glm::vec3(drawData.objectColor), drawData.objectColor.w));
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpuscene.h
+// ============
+// copies of the scene resources and the scene shading for the CPU renderers
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderInterface.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <vector>
+
+class SceneManager;
+
+// texture slots the scene can bind
+const int CPU_TEXTURE_SLOTS = 16;
+
+// one vertex of a copied mesh in object space
+struct CPU_VERTEX
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+};
+
+// a mesh copied from its GL buffers
+struct CPU_MESH
+{
+	std::vector<CPU_VERTEX> vertices;
+	std::vector<unsigned int> indices;
+};
+
+// a texture copied from GL with all of its mip levels
+struct CPU_TEXTURE
+{
+	// RGBA8 texels of every level back to back
+	std::vector<unsigned int> texels;
+	std::vector<int> levelOffset;
+	std::vector<int> levelWidth;
+	std::vector<int> levelHeight;
+	// set when the min filter reads the mip levels
+	bool bMipmapped;
+};
+
+// the values the fragment shader reads from its blocks and samplers
+struct CPU_SHADING
+{
+	glm::vec3 viewPosition;
+	const glm::vec4* pMaterialAmbient;
+	const glm::vec4* pMaterialDiffuse;
+	const glm::vec4* pMaterialSpecular;
+	int materialCount;
+	const LIGHT_DATA* pLights;
+	int lightCount;
+	// copied texture of every texture slot, NULL when empty
+	const CPU_TEXTURE* pSlotTextures[CPU_TEXTURE_SLOTS];
+};
+
+/***********************************************************
+ *  CpuScene
+ *
+ *  Keeps the CPU copies of the meshes and textures a CPU
+ *  renderer draws with, read back from the GL objects the
+ *  first time they are used, and gathers the lights and
+ *  materials of a frame.  Only the thread owning the GL
+ *  context may call it, the renderers read the results from
+ *  any thread.  The scene is still loaded into GL objects,
+ *  so a CPU renderer needs a GL context too; on a machine
+ *  without a GPU that is a software driver like Mesa
+ *  llvmpipe.
+ ***********************************************************/
+class CpuScene
+{
+public:
+	// constructor
+	CpuScene();
+	// destructor
+	~CpuScene();
+
+	// read the lights, materials and slot textures of the frame
+	void GatherShading(SceneManager* pSceneManager, const FRAME_DATA& frameData);
+	const CPU_SHADING& GetShading() const { return(m_shading); }
+
+	// copy of a mesh library mesh, NULL while it is being uploaded
+	const CPU_MESH* FindMesh(const SceneManager* pSceneManager, int meshID);
+	// forget the copied meshes and textures
+	void ReleaseResources();
+
+private:
+	// copied meshes by mesh library id and textures by GL name
+	std::map<int, CPU_MESH> m_meshes;
+	std::map<GLuint, CPU_TEXTURE> m_textures;
+	// lights of the frame
+	std::vector<LIGHT_DATA> m_lights;
+	// shading values of the frame
+	CPU_SHADING m_shading;
+
+	// copy a texture on first use
+	const CPU_TEXTURE* FindTexture(GLuint textureID);
+};
+
+// convert between a RGBA8 texel and a color in 0..1
+glm::vec4 UnpackRGBA8(unsigned int texel);
+unsigned int PackRGBA8(const glm::vec4& color);
+// filtered lookup with GL_REPEAT wrapping, bilinear in a level and
+// between two levels when the texture is mipmapped
+glm::vec4 SampleTexture(const CPU_TEXTURE& texture, glm::vec2 uv, float lod);
+// light and texture one surface point the way fragmentShader.glsl
+// does with lighting enabled, every light is visited and the
+// optional visibility of each light scales its direct light
+glm::vec4 ShadeSurface(const CPU_SHADING& shading, const DRAW_DATA& drawData, const glm::vec3& position,
+	const glm::vec3& normal, const glm::vec2& uv, float lod, const float* pLightVisibility);
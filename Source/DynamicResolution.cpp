@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// pick the resolution of the camera passes from the measured GPU frame time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// budget of a 60 Hz display
+	const double DEFAULT_FRAME_BUDGET = 1000.0 / 60.0;
+	// fraction of the budget the scale is chosen for, the rest
+	// absorbs the noise of the measurements
+	const double BUDGET_HEADROOM = 0.9;
+	// weight of a new frame in the smoothed time
+	const double TIME_SMOOTHING = 0.25;
+	// frames measured before the scale may change again, and
+	// before it may go back up
+	const int SETTLE_FRAMES = 3;
+	const int RAISE_FRAMES = 30;
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution()
+{
+	m_bEnabled = false;
+	m_frameBudget = DEFAULT_FRAME_BUDGET;
+	m_scaleSteps = SCALE_STEPS;
+	m_averageTime = 0.0;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  SetEnabled()
+ *
+ *  This method is used to start or stop adapting the scale,
+ *  either way the next frames start at full resolution.
+ ***********************************************************/
+void DynamicResolution::SetEnabled(bool bEnabled)
+{
+	if (bEnabled == m_bEnabled)
+	{
+		return;
+	}
+	m_bEnabled = bEnabled;
+	m_scaleSteps = SCALE_STEPS;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  SetFrameBudget()
+ *
+ *  This method is used to set the GPU time a frame may take.
+ ***********************************************************/
+void DynamicResolution::SetFrameBudget(double frameBudget)
+{
+	if (frameBudget > 0.0)
+	{
+		m_frameBudget = frameBudget;
+		m_frameCount = 0;
+	}
+}
+
+/***********************************************************
+ *  AddFrameTime()
+ *
+ *  This method is used to smooth the GPU time of the frames
+ *  rendered at the current scale and move the scale once a
+ *  few of them were measured.  The time is taken to grow with
+ *  the number of pixels, so the side scale that fits the
+ *  budget follows the square root of the time ratio.  Passes
+ *  that do not depend on the resolution, like the shadow maps,
+ *  make that estimate too low, which the next measurements
+ *  correct.
+ ***********************************************************/
+void DynamicResolution::AddFrameTime(double gpuTime, float frameScale)
+{
+	if (!m_bEnabled || (gpuTime <= 0.0) || (frameScale != GetScale()))
+	{
+		return;
+	}
+
+	if (0 == m_frameCount)
+	{
+		m_averageTime = gpuTime;
+	}
+	else
+	{
+		m_averageTime += (gpuTime - m_averageTime) * TIME_SMOOTHING;
+	}
+	m_frameCount++;
+	if (m_frameCount < SETTLE_FRAMES)
+	{
+		return;
+	}
+
+	double fittingSteps = m_scaleSteps * std::sqrt((m_frameBudget * BUDGET_HEADROOM) / m_averageTime);
+	int scaleSteps = m_scaleSteps;
+	if (m_averageTime > m_frameBudget)
+	{
+		// over the budget, drop at least one step
+		scaleSteps = (int)std::floor(fittingSteps);
+		if (scaleSteps >= m_scaleSteps)
+		{
+			scaleSteps = m_scaleSteps - 1;
+		}
+	}
+	else if ((m_frameCount >= RAISE_FRAMES) && (fittingSteps >= m_scaleSteps + 1))
+	{
+		// the next step is expected to fit as well
+		scaleSteps = m_scaleSteps + 1;
+	}
+
+	if (scaleSteps < MIN_SCALE_STEPS)
+	{
+		scaleSteps = MIN_SCALE_STEPS;
+	}
+	if (scaleSteps > SCALE_STEPS)
+	{
+		scaleSteps = SCALE_STEPS;
+	}
+	if (scaleSteps != m_scaleSteps)
+	{
+		m_scaleSteps = scaleSteps;
+		m_frameCount = 0;
+	}
+}
+
+/***********************************************************
+ *  GetScale()
+ *
+ *  This method is used to get the fraction of the output width
+ *  and height the next frame renders at.
+ ***********************************************************/
+float DynamicResolution::GetScale() const
+{
+	if (!m_bEnabled)
+	{
+		return(1.0f);
+	}
+	return((float)m_scaleSteps / (float)SCALE_STEPS);
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// pick the resolution of the camera passes from the measured GPU frame time
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  The GPU time of the finished frames is compared against a
+ *  budget.  A frame over the budget drops the scale right away
+ *  to where the time is expected to fit, the scale only goes
+ *  back up one step at a time after a run of frames with room
+ *  to spare.  The scale moves in fixed steps so the targets
+ *  and light clusters sized from it change rarely.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	// constructor
+	DynamicResolution();
+
+	// adapt the scale of the next frames, a disabled controller
+	// keeps them at full resolution
+	void SetEnabled(bool bEnabled);
+	bool IsEnabled() const { return(m_bEnabled); }
+
+	// GPU milliseconds a frame may take
+	void SetFrameBudget(double frameBudget);
+	double GetFrameBudget() const { return(m_frameBudget); }
+
+	// add the GPU time of a finished frame and the scale it was
+	// rendered at, frames from before the last change are ignored
+	void AddFrameTime(double gpuTime, float frameScale);
+
+	// fraction of the output width and height to render at
+	float GetScale() const;
+
+	// scale steps from zero to full resolution, and the fewest
+	// the controller goes down to
+	static const int SCALE_STEPS = 20;
+	static const int MIN_SCALE_STEPS = 10;
+
+private:
+	// set while the scale follows the frame time
+	bool m_bEnabled;
+	// GPU milliseconds a frame may take
+	double m_frameBudget;
+	// current scale in steps of 1 / SCALE_STEPS
+	int m_scaleSteps;
+	// smoothed GPU time of the frames at the current scale
+	double m_averageTime;
+	// frames measured at the current scale
+	int m_frameCount;
+};
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// linear allocator for transient data that only lives for one frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <cstdlib>
+#include <new>
+
+// declaration of global variables
+namespace
+{
+	// room in front of an overflow allocation for the block link,
+	// large enough to keep the data aligned for any plain type
+	const size_t OVERFLOW_HEADER = 64;
+}
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t capacity)
+{
+	m_pBlock = (unsigned char*)malloc(capacity);
+	m_capacity = (NULL != m_pBlock) ? capacity : 0;
+	m_head = 0;
+	m_used = 0;
+	m_peak = 0;
+	m_pOverflow = NULL;
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	FreeOverflow();
+	free(m_pBlock);
+	m_pBlock = NULL;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used to release all of the previous frame's
+ *  allocations at once.  When the frame spilled into overflow
+ *  blocks the main block is replaced by one that holds the
+ *  whole frame, the old data is not kept.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	FreeOverflow();
+
+	// the alignment padding is counted in m_used, so the peak
+	// is enough for the same sequence of requests
+	if (m_peak > m_capacity)
+	{
+		size_t capacity = m_peak + (m_peak / 4);
+		unsigned char* pBlock = (unsigned char*)malloc(capacity);
+		if (NULL != pBlock)
+		{
+			free(m_pBlock);
+			m_pBlock = pBlock;
+			m_capacity = capacity;
+		}
+	}
+
+	m_head = 0;
+	m_used = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used to reserve space for the current frame.
+ *  The alignment must be a power of two no larger than the
+ *  overflow header.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	size_t start = (m_head + alignment - 1) & ~(alignment - 1);
+	if ((start + size) <= m_capacity)
+	{
+		m_used += (start + size) - m_head;
+		m_head = start + size;
+		if (m_used > m_peak)
+		{
+			m_peak = m_used;
+		}
+		return(m_pBlock + start);
+	}
+
+	// keep the frame running from the heap until the next Reset()
+	unsigned char* pOverflow = (unsigned char*)malloc(OVERFLOW_HEADER + size);
+	if (NULL == pOverflow)
+	{
+		throw std::bad_alloc();
+	}
+	*(void**)pOverflow = m_pOverflow;
+	m_pOverflow = pOverflow;
+
+	m_used += size + alignment;
+	if (m_used > m_peak)
+	{
+		m_peak = m_used;
+	}
+	return(pOverflow + OVERFLOW_HEADER);
+}
+
+/***********************************************************
+ *  FreeOverflow()
+ *
+ *  This method is used to free the heap blocks used after the
+ *  main block was full.
+ ***********************************************************/
+void FrameArena::FreeOverflow()
+{
+	while (NULL != m_pOverflow)
+	{
+		void* pPrevious = *(void**)m_pOverflow;
+		free(m_pOverflow);
+		m_pOverflow = pPrevious;
+	}
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// linear allocator for transient data that only lives for one frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  Allocations bump a pointer through one block and are all
+ *  released together by Reset() at the start of the next
+ *  frame.  Requests that do not fit go to overflow blocks for
+ *  the rest of the frame, and the next Reset() grows the block
+ *  to the frame's peak, so a steady scene stops touching the
+ *  heap after its first frames.  Only plain data types may be
+ *  placed in the arena, no constructors or destructors run.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor, capacity is the initial block size in bytes
+	FrameArena(size_t capacity);
+	// destructor
+	~FrameArena();
+
+	// release everything allocated during the previous frame
+	void Reset();
+
+	// reserve aligned space for the current frame, never NULL
+	void* Allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT);
+	// reserve an uninitialized array for the current frame
+	template <typename T>
+	T* AllocateArray(size_t count) { return((T*)Allocate(count * sizeof(T), alignof(T))); }
+
+	// bytes allocated during the current frame
+	size_t GetUsed() const { return(m_used); }
+	// size of the main block
+	size_t GetCapacity() const { return(m_capacity); }
+	// highest number of bytes used by any frame
+	size_t GetPeak() const { return(m_peak); }
+
+private:
+	// alignment of allocations that do not ask for one
+	static const size_t DEFAULT_ALIGNMENT = 16;
+
+	// main block
+	unsigned char* m_pBlock;
+	// bytes in the main block
+	size_t m_capacity;
+	// next free byte in the main block
+	size_t m_head;
+	// bytes requested this frame, including the overflow
+	size_t m_used;
+	// highest m_used of any frame
+	size_t m_peak;
+	// heap blocks of this frame's allocations that did not fit,
+	// each one starts with the pointer to the previous one
+	void* m_pOverflow;
+
+	// free the overflow blocks of the current frame
+	void FreeOverflow();
+};
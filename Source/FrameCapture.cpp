@@ -0,0 +1,230 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// read rendered frames back through pixel buffers without stalling
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+#include "ResourceTracker.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// how long to wait on a read before checking again, in nanoseconds
+	const GLuint64 READ_FENCE_TIMEOUT = 1000000000;
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture()
+{
+	m_nextSlot = 0;
+	m_width = 0;
+	m_height = 0;
+	m_readbackTime = 0.0;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	DestroyCapture();
+}
+
+/***********************************************************
+ *  CreateCapture()
+ *
+ *  This method is used to create the pixel buffers, each
+ *  mapped once for the lifetime of the capture.
+ ***********************************************************/
+bool FrameCapture::CreateCapture(int width, int height, int bufferCount)
+{
+	DestroyCapture();
+
+	if ((width <= 0) || (height <= 0) || (bufferCount <= 0))
+	{
+		return false;
+	}
+	// immutable storage is needed for persistent mapping
+	if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+	{
+		std::cout << "Persistent buffer mapping is not supported by this OpenGL driver" << std::endl;
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	GLsizeiptr imageSize = (GLsizeiptr)width * height * 4;
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	m_slots.resize(bufferCount);
+	for (int i = 0; i < bufferCount; i++)
+	{
+		m_slots[i].bufferID = 0;
+		m_slots[i].pMappedData = NULL;
+		m_slots[i].fence = NULL;
+		m_slots[i].format = IMAGE_FORMAT_TGA;
+		m_slots[i].pWriteQueue = NULL;
+	}
+	for (int i = 0; i < bufferCount; i++)
+	{
+		CAPTURE_SLOT& slot = m_slots[i];
+		glGenBuffers(1, &slot.bufferID);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+		glBufferStorage(GL_PIXEL_PACK_BUFFER, imageSize, NULL, flags);
+		TrackBuffer(slot.bufferID, imageSize, "FrameCapture");
+		slot.pMappedData = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, imageSize, flags);
+		if (NULL == slot.pMappedData)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			std::cout << "Could not map the frame capture buffers" << std::endl;
+			DestroyCapture();
+			return false;
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_nextSlot = 0;
+	return true;
+}
+
+/***********************************************************
+ *  DestroyCapture()
+ *
+ *  This method is used to release the fences and buffers.
+ ***********************************************************/
+void FrameCapture::DestroyCapture()
+{
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		CAPTURE_SLOT& slot = m_slots[i];
+		if (NULL != slot.fence)
+		{
+			glDeleteSync(slot.fence);
+		}
+		if (0 != slot.bufferID)
+		{
+			if (NULL != slot.pMappedData)
+			{
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			}
+			UntrackResource(RESOURCE_BUFFER, slot.bufferID);
+			glDeleteBuffers(1, &slot.bufferID);
+		}
+	}
+	m_slots.clear();
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method is used to read the bound framebuffer into the
+ *  next pixel buffer.  Earlier captures whose reads have
+ *  finished are queued first, and the capture that last used
+ *  the buffer is waited for if it is still in flight.
+ ***********************************************************/
+bool FrameCapture::Capture(const std::string& filename, IMAGE_FORMAT format, ImageWriteQueue* pWriteQueue)
+{
+	if (m_slots.empty() || (NULL == pWriteQueue))
+	{
+		return false;
+	}
+
+	// the slots from the next one on are in the order they were read
+	int slotCount = (int)m_slots.size();
+	for (int i = 0; i < slotCount; i++)
+	{
+		CAPTURE_SLOT& slot = m_slots[(m_nextSlot + i) % slotCount];
+		if ((NULL != slot.fence) && (FinishSlot(&slot, 0 == i) == false))
+		{
+			break;
+		}
+	}
+
+	CAPTURE_SLOT& slot = m_slots[m_nextSlot];
+	slot.filename = filename;
+	slot.format = format;
+	slot.pWriteQueue = pWriteQueue;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_nextSlot = (m_nextSlot + 1) % slotCount;
+	return true;
+}
+
+/***********************************************************
+ *  Flush()
+ *
+ *  This method is used to queue every capture in flight, in
+ *  the order they were read.
+ ***********************************************************/
+void FrameCapture::Flush()
+{
+	int slotCount = (int)m_slots.size();
+	for (int i = 0; i < slotCount; i++)
+	{
+		CAPTURE_SLOT& slot = m_slots[(m_nextSlot + i) % slotCount];
+		if (NULL != slot.fence)
+		{
+			FinishSlot(&slot, true);
+		}
+	}
+}
+
+/***********************************************************
+ *  FinishSlot()
+ *
+ *  This method is used to copy a capture out of its pixel
+ *  buffer and into the write queue.  The buffer is coherent,
+ *  the signalled fence is all that is needed before reading.
+ ***********************************************************/
+bool FrameCapture::FinishSlot(CAPTURE_SLOT* pSlot, bool bWait)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	GLenum waitResult = glClientWaitSync(pSlot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (bWait && (GL_TIMEOUT_EXPIRED == waitResult))
+	{
+		waitResult = glClientWaitSync(pSlot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, READ_FENCE_TIMEOUT);
+	}
+	if (GL_TIMEOUT_EXPIRED == waitResult)
+	{
+		return false;
+	}
+	glDeleteSync(pSlot->fence);
+	pSlot->fence = NULL;
+
+	if (GL_WAIT_FAILED == waitResult)
+	{
+		std::cout << "Could not wait for the capture of " << pSlot->filename << std::endl;
+		return true;
+	}
+
+	size_t imageSize = (size_t)m_width * m_height * 4;
+	m_pixels.resize(imageSize);
+	memcpy(m_pixels.data(), pSlot->pMappedData, imageSize);
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	m_readbackTime += elapsed.count();
+
+	pSlot->pWriteQueue->Submit(pSlot->filename, pSlot->format, &m_pixels, m_width, m_height);
+	return true;
+}
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// read rendered frames back through pixel buffers without stalling
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ImageWriteQueue.h"
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  glReadPixels into client memory waits until the GPU has
+ *  finished the frame.  Here the read goes into one of a ring
+ *  of persistently mapped pixel pack buffers and is fenced,
+ *  so the GPU copies frame N while the next frame is being
+ *  recorded.  A capture is copied out and handed to the write
+ *  queue once its fence has signalled, at the latest when its
+ *  buffer comes around again.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture();
+	// destructor
+	~FrameCapture();
+
+	// create the pixel buffers for frames of the given size, two
+	// buffers let one frame be read while the next one renders
+	bool CreateCapture(int width, int height, int bufferCount = 2);
+	// release the buffers, captures still in flight are dropped
+	void DestroyCapture();
+
+	// start reading the bound read framebuffer, the image is queued
+	// for encoding once the read has finished
+	bool Capture(const std::string& filename, IMAGE_FORMAT format, ImageWriteQueue* pWriteQueue);
+	// queue every capture still in flight, waiting for their reads
+	void Flush();
+
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	// milliseconds spent waiting on reads and copying the pixels out
+	double GetReadbackTime() const { return(m_readbackTime); }
+	void ResetReadbackTime() { m_readbackTime = 0.0; }
+
+private:
+	// one pixel buffer and the capture it holds
+	struct CAPTURE_SLOT
+	{
+		GLuint bufferID;
+		const unsigned char* pMappedData;
+		// signalled when the read into the buffer has finished
+		GLsync fence;
+		std::string filename;
+		IMAGE_FORMAT format;
+		ImageWriteQueue* pWriteQueue;
+	};
+
+	std::vector<CAPTURE_SLOT> m_slots;
+	// slot of the next capture, also the oldest one in flight
+	int m_nextSlot;
+	int m_width;
+	int m_height;
+	// pixels on their way into the write queue
+	std::vector<unsigned char> m_pixels;
+	double m_readbackTime;
+
+	// copy a finished capture out and queue it, false when its read
+	// has not finished and bWait is not set
+	bool FinishSlot(CAPTURE_SLOT* pSlot, bool bWait);
+};
@@ -0,0 +1,211 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameringbuffer.cpp
+// ============
+// persistently mapped ring buffer for per-frame dynamic shader data
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameRingBuffer.h"
+#include "RenderCounters.h"
+#include "ResourceTracker.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// how long to wait on a frame fence before reporting a stall, in nanoseconds
+	const GLuint64 FENCE_TIMEOUT = 1000000000;
+}
+
+/***********************************************************
+ *  FrameRingBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameRingBuffer::FrameRingBuffer()
+{
+	m_bufferID = 0;
+	m_pMappedData = NULL;
+	m_frameSize = 0;
+	m_alignment = 256;
+	m_frameIndex = 0;
+	m_frameHead = 0;
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++)
+	{
+		m_frameFences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~FrameRingBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameRingBuffer::~FrameRingBuffer()
+{
+	DestroyBuffer();
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used to create the ring buffer storage and
+ *  map it once for the lifetime of the buffer.
+ ***********************************************************/
+bool FrameRingBuffer::CreateBuffer(GLsizeiptr frameSize)
+{
+	// immutable storage is needed for persistent mapping
+	if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+	{
+		std::cout << "Persistent buffer mapping is not supported by this OpenGL driver" << std::endl;
+		return false;
+	}
+
+	// every binding offset must satisfy both uniform and storage alignment
+	GLint uniformAlignment = 0;
+	GLint storageAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	m_alignment = (uniformAlignment > storageAlignment) ? uniformAlignment : storageAlignment;
+	if (m_alignment < 16)
+	{
+		m_alignment = 16;
+	}
+
+	// round the segment size so every segment starts aligned
+	m_frameSize = ((frameSize + m_alignment - 1) / m_alignment) * m_alignment;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferID);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, m_frameSize * FRAMES_IN_FLIGHT, NULL, flags);
+	TrackBuffer(m_bufferID, m_frameSize * FRAMES_IN_FLIGHT, "FrameRingBuffer");
+	m_pMappedData = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_frameSize * FRAMES_IN_FLIGHT, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (NULL == m_pMappedData)
+	{
+		std::cout << "Could not map the frame ring buffer" << std::endl;
+		DestroyBuffer();
+		return false;
+	}
+
+	m_frameIndex = 0;
+	m_frameHead = 0;
+
+	return true;
+}
+
+/***********************************************************
+ *  DestroyBuffer()
+ *
+ *  This method is used to release the fences and the buffer.
+ ***********************************************************/
+void FrameRingBuffer::DestroyBuffer()
+{
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++)
+	{
+		if (NULL != m_frameFences[i])
+		{
+			glDeleteSync(m_frameFences[i]);
+			m_frameFences[i] = NULL;
+		}
+	}
+
+	if (0 != m_bufferID)
+	{
+		if (NULL != m_pMappedData)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferID);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		UntrackResource(RESOURCE_BUFFER, m_bufferID);
+		glDeleteBuffers(1, &m_bufferID);
+	}
+
+	m_bufferID = 0;
+	m_pMappedData = NULL;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used to wait for the GPU to finish reading
+ *  the segment written FRAMES_IN_FLIGHT frames ago, so it can
+ *  be reused for this frame.
+ ***********************************************************/
+void FrameRingBuffer::BeginFrame()
+{
+	GLsync fence = m_frameFences[m_frameIndex];
+	if (NULL != fence)
+	{
+		GLenum waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+		while (waitResult == GL_TIMEOUT_EXPIRED)
+		{
+			std::cout << "Waiting on the GPU for frame ring buffer space" << std::endl;
+			waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+		}
+		glDeleteSync(fence);
+		m_frameFences[m_frameIndex] = NULL;
+	}
+
+	m_frameHead = 0;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used to fence the commands that read this
+ *  frame's segment and move on to the next segment.
+ ***********************************************************/
+void FrameRingBuffer::EndFrame()
+{
+	m_frameFences[m_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_frameIndex = (m_frameIndex + 1) % FRAMES_IN_FLIGHT;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used to reserve aligned space in the current
+ *  frame's segment.  The returned pointer can be written to
+ *  directly, no upload call is needed.
+ ***********************************************************/
+void* FrameRingBuffer::Allocate(GLsizeiptr size, GLintptr* pOffset)
+{
+	if (NULL == m_pMappedData)
+	{
+		return(NULL);
+	}
+
+	GLsizeiptr alignedSize = ((size + m_alignment - 1) / m_alignment) * m_alignment;
+	if ((m_frameHead + alignedSize) > m_frameSize)
+	{
+		std::cout << "Frame ring buffer is full, " << size << " bytes were not allocated" << std::endl;
+		return(NULL);
+	}
+
+	GLintptr offset = (m_frameSize * m_frameIndex) + m_frameHead;
+	m_frameHead += alignedSize;
+
+	if (NULL != pOffset)
+	{
+		*pOffset = offset;
+	}
+
+	return(m_pMappedData + offset);
+}
+
+/***********************************************************
+ *  BindRange()
+ *
+ *  This method is used to bind an allocated range of the ring
+ *  buffer to a uniform or storage block binding point.
+ ***********************************************************/
+void FrameRingBuffer::BindRange(GLenum target, GLuint binding, GLintptr offset, GLsizeiptr size)
+{
+	glBindBufferRange(target, binding, m_bufferID, offset, size);
+	CountStateChanges(1);
+}
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameringbuffer.h
+// ============
+// persistently mapped ring buffer for per-frame dynamic shader data
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  FrameRingBuffer
+ *
+ *  One GL buffer split into a segment per frame in flight.
+ *  The buffer stays mapped for its whole lifetime, so the CPU
+ *  writes shader data straight into GPU visible memory, and a
+ *  fence per segment keeps the CPU from overwriting data that
+ *  the GPU has not consumed yet.
+ ***********************************************************/
+class FrameRingBuffer
+{
+public:
+	// constructor
+	FrameRingBuffer();
+	// destructor
+	~FrameRingBuffer();
+
+	// create and map the buffer, with frameSize bytes per frame
+	bool CreateBuffer(GLsizeiptr frameSize);
+	// unmap and free the buffer
+	void DestroyBuffer();
+
+	// wait until the GPU is done with this frame's segment
+	void BeginFrame();
+	// fence the segment written during this frame
+	void EndFrame();
+
+	// reserve space in this frame's segment, returns the mapped
+	// write pointer and the buffer offset for binding
+	void* Allocate(GLsizeiptr size, GLintptr* pOffset);
+	// bind a range of the buffer to an indexed binding point
+	void BindRange(GLenum target, GLuint binding, GLintptr offset, GLsizeiptr size);
+
+	// offset alignment required for uniform and storage bindings
+	GLsizeiptr GetAlignment() const { return(m_alignment); }
+	// the GL name of the buffer
+	GLuint GetBufferID() const { return(m_bufferID); }
+
+private:
+	// number of frames the CPU may run ahead of the GPU
+	static const int FRAMES_IN_FLIGHT = 3;
+
+	// GL buffer object
+	GLuint m_bufferID;
+	// persistently mapped base address
+	unsigned char* m_pMappedData;
+	// bytes in each frame segment
+	GLsizeiptr m_frameSize;
+	// binding offset alignment
+	GLsizeiptr m_alignment;
+	// segment used by the current frame
+	int m_frameIndex;
+	// next free byte within the current segment
+	GLsizeiptr m_frameHead;
+	// fence guarding each segment
+	GLsync m_frameFences[FRAMES_IN_FLIGHT];
+};
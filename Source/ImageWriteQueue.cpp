@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewritequeue.cpp
+// ============
+// encode and write rendered images on worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageWriteQueue.h"
+
+#include <algorithm>
+#include <chrono>
+
+/***********************************************************
+ *  ImageWriteQueue()
+ *
+ *  The constructor for the class.  The render thread keeps a
+ *  core of its own, so one core less is used for encoding.
+ ***********************************************************/
+ImageWriteQueue::ImageWriteQueue(int encoderCount, int maxPending)
+{
+	m_busyEncoders = 0;
+	m_bWriterBusy = false;
+	m_encodedCount = 0;
+	m_writtenCount = 0;
+	m_failedCount = 0;
+	m_encodedBytes = 0;
+	m_submitWaitTime = 0.0;
+	m_bStopping = false;
+
+	if (encoderCount <= 0)
+	{
+		encoderCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	}
+	m_maxPending = (maxPending > 0) ? maxPending : encoderCount * 2;
+
+	for (int i = 0; i < encoderCount; i++)
+	{
+		m_encoders.push_back(std::thread(&ImageWriteQueue::EncodeLoop, this));
+	}
+	m_writer = std::thread(&ImageWriteQueue::WriteLoop, this);
+}
+
+/***********************************************************
+ *  ~ImageWriteQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImageWriteQueue::~ImageWriteQueue()
+{
+	WaitIdle();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_encodeCondition.notify_all();
+	m_writeCondition.notify_all();
+
+	for (size_t i = 0; i < m_encoders.size(); i++)
+	{
+		m_encoders[i].join();
+	}
+	m_writer.join();
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used to queue an image for the encoders.
+ *  When the queue is full the caller waits for an encoder to
+ *  take an image off it.
+ ***********************************************************/
+void ImageWriteQueue::Submit(const std::string& filename, IMAGE_FORMAT format, std::vector<unsigned char>* pPixels,
+	int width, int height)
+{
+	if (NULL == pPixels)
+	{
+		return;
+	}
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_doneCondition.wait(lock, [this]() { return((int)m_encodeJobs.size() < m_maxPending); });
+
+		m_encodeJobs.push_back(ENCODE_JOB());
+		ENCODE_JOB& job = m_encodeJobs.back();
+		job.filename = filename;
+		job.format = format;
+		job.pixels.swap(*pPixels);
+		job.width = width;
+		job.height = height;
+
+		pPixels->clear();
+		if (!m_freeBuffers.empty())
+		{
+			pPixels->swap(m_freeBuffers.back());
+			m_freeBuffers.pop_back();
+		}
+	}
+	m_encodeCondition.notify_one();
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	m_submitWaitTime += elapsed.count();
+}
+
+/***********************************************************
+ *  WaitIdle()
+ *
+ *  This method is used to wait until both queues are empty
+ *  and no thread is busy.
+ ***********************************************************/
+void ImageWriteQueue::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]()
+	{
+		return(m_encodeJobs.empty() && (0 == m_busyEncoders) && m_writeJobs.empty() && !m_bWriterBusy);
+	});
+}
+
+/***********************************************************
+ *  GetEncodedCount() / GetWrittenCount() / GetFailedCount()
+ *  GetEncodedBytes() / ResetStatistics()
+ *
+ *  These methods are used to count the finished images.
+ ***********************************************************/
+int ImageWriteQueue::GetEncodedCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_encodedCount);
+}
+
+int ImageWriteQueue::GetWrittenCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_writtenCount);
+}
+
+int ImageWriteQueue::GetFailedCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_failedCount);
+}
+
+unsigned long long ImageWriteQueue::GetEncodedBytes()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_encodedBytes);
+}
+
+void ImageWriteQueue::ResetStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_encodedCount = 0;
+	m_writtenCount = 0;
+	m_failedCount = 0;
+	m_encodedBytes = 0;
+	m_submitWaitTime = 0.0;
+}
+
+/***********************************************************
+ *  EncodeLoop()
+ *
+ *  This method runs on every encoder thread, taking one image
+ *  at a time.  The queues are left unlocked while the image
+ *  is encoded.
+ ***********************************************************/
+void ImageWriteQueue::EncodeLoop()
+{
+	while (true)
+	{
+		ENCODE_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_encodeCondition.wait(lock, [this]() { return(m_bStopping || !m_encodeJobs.empty()); });
+			if (m_encodeJobs.empty())
+			{
+				break;
+			}
+			job.filename.swap(m_encodeJobs.front().filename);
+			job.format = m_encodeJobs.front().format;
+			job.pixels.swap(m_encodeJobs.front().pixels);
+			job.width = m_encodeJobs.front().width;
+			job.height = m_encodeJobs.front().height;
+			m_encodeJobs.pop_front();
+			m_busyEncoders++;
+		}
+		// a slot in the encode queue has opened up
+		m_doneCondition.notify_all();
+
+		WRITE_JOB output;
+		bool bEncoded = EncodeImage(job.format, job.pixels.data(), job.width, job.height, &output.data);
+		output.filename.swap(job.filename);
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if ((int)m_freeBuffers.size() < m_maxPending)
+			{
+				m_freeBuffers.push_back(std::vector<unsigned char>());
+				m_freeBuffers.back().swap(job.pixels);
+			}
+
+			if (!bEncoded)
+			{
+				m_failedCount++;
+			}
+			else
+			{
+				m_encodedCount++;
+				m_encodedBytes += output.data.size();
+				if (!output.filename.empty())
+				{
+					// wait for the writer when the disk falls behind
+					m_doneCondition.wait(lock, [this]() { return((int)m_writeJobs.size() < m_maxPending); });
+					m_writeJobs.push_back(WRITE_JOB());
+					m_writeJobs.back().filename.swap(output.filename);
+					m_writeJobs.back().data.swap(output.data);
+					m_writeCondition.notify_one();
+				}
+			}
+			m_busyEncoders--;
+		}
+		m_doneCondition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  WriteLoop()
+ *
+ *  This method runs on the writer thread, writing the files
+ *  in the order they were encoded.
+ ***********************************************************/
+void ImageWriteQueue::WriteLoop()
+{
+	while (true)
+	{
+		WRITE_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_writeCondition.wait(lock, [this]() { return(m_bStopping || !m_writeJobs.empty()); });
+			if (m_writeJobs.empty())
+			{
+				break;
+			}
+			job.filename.swap(m_writeJobs.front().filename);
+			job.data.swap(m_writeJobs.front().data);
+			m_writeJobs.pop_front();
+			m_bWriterBusy = true;
+		}
+		// a slot in the write queue has opened up
+		m_doneCondition.notify_all();
+
+		bool bWritten = WriteFileData(job.filename.c_str(), job.data);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bWriterBusy = false;
+			if (bWritten)
+			{
+				m_writtenCount++;
+			}
+			else
+			{
+				m_failedCount++;
+			}
+		}
+		m_doneCondition.notify_all();
+	}
+}
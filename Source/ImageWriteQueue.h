@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewritequeue.h
+// ============
+// encode and write rendered images on worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ImageWriter.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  ImageWriteQueue
+ *
+ *  Read back images pass through two stages.  A pool of
+ *  encoder threads compresses them, and one writer thread
+ *  writes the files one after the other, which is what disks
+ *  handle best.  Both queues hold a limited number of images,
+ *  a full write queue holds up the encoders and a full encode
+ *  queue blocks Submit(), so a slow disk slows the render
+ *  loop down instead of piling up images in memory.  The
+ *  pixel buffers are handed back to the caller for reuse.
+ ***********************************************************/
+class ImageWriteQueue
+{
+public:
+	// constructor, zero encoder threads means one less than the
+	// hardware cores and zero pending images means two per thread
+	ImageWriteQueue(int encoderCount = 0, int maxPending = 0);
+	// destructor, writes the images that are still queued
+	~ImageWriteQueue();
+
+	// queue RGBA8 pixels with the bottom row first.  The pixels are
+	// taken over and the vector gets an earlier buffer back, or is
+	// left empty.  Without a file name the image is only encoded.
+	void Submit(const std::string& filename, IMAGE_FORMAT format, std::vector<unsigned char>* pPixels,
+		int width, int height);
+	// block until every queued image has been encoded and written
+	void WaitIdle();
+
+	int GetEncoderCount() const { return((int)m_encoders.size()); }
+	// images encoded, written and failed, and the encoded bytes
+	int GetEncodedCount();
+	int GetWrittenCount();
+	int GetFailedCount();
+	unsigned long long GetEncodedBytes();
+	// milliseconds Submit() spent waiting for a free slot
+	double GetSubmitWaitTime() const { return(m_submitWaitTime); }
+	void ResetStatistics();
+
+private:
+	// one image waiting for an encoder
+	struct ENCODE_JOB
+	{
+		std::string filename;
+		IMAGE_FORMAT format;
+		std::vector<unsigned char> pixels;
+		int width;
+		int height;
+	};
+
+	// one encoded image waiting for the writer
+	struct WRITE_JOB
+	{
+		std::string filename;
+		std::vector<unsigned char> data;
+	};
+
+	std::vector<std::thread> m_encoders;
+	std::thread m_writer;
+	// guards the queues and the counts below
+	std::mutex m_mutex;
+	// signalled when an image is queued for the encoders
+	std::condition_variable m_encodeCondition;
+	// signalled when an image is queued for the writer
+	std::condition_variable m_writeCondition;
+	// signalled when a queue slot opens up or a stage goes idle
+	std::condition_variable m_doneCondition;
+	std::deque<ENCODE_JOB> m_encodeJobs;
+	std::deque<WRITE_JOB> m_writeJobs;
+	// pixel buffers the encoders are done with
+	std::vector<std::vector<unsigned char> > m_freeBuffers;
+	// most images either queue may hold
+	int m_maxPending;
+	int m_busyEncoders;
+	bool m_bWriterBusy;
+	int m_encodedCount;
+	int m_writtenCount;
+	int m_failedCount;
+	unsigned long long m_encodedBytes;
+	// only touched by the submitting thread
+	double m_submitWaitTime;
+	// set when the threads should exit
+	bool m_bStopping;
+
+	// encoder and writer thread entry points
+	void EncodeLoop();
+	void WriteLoop();
+};
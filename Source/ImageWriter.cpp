@@ -0,0 +1,595 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.cpp
+// ============
+// encode rendered images and write them to disk
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageWriter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// size of the TGA file header
+	const int TGA_HEADER_SIZE = 18;
+	// uncompressed true color image type
+	const unsigned char TGA_TRUE_COLOR = 2;
+	// image descriptor with 8 alpha bits and the rows bottom up
+	const unsigned char TGA_ALPHA_BOTTOM_UP = 8;
+
+	// the eight bytes every PNG file starts with
+	const unsigned char PNG_SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	// 8 bits per channel RGBA
+	const unsigned char PNG_COLOR_RGBA = 6;
+	// every row is stored as the difference to the row above it
+	const unsigned char PNG_FILTER_UP = 2;
+
+	// positions hashed for finding repeated bytes, and how far back
+	// and how long a repeat may be
+	const int DEFLATE_HASH_BITS = 15;
+	const int DEFLATE_WINDOW = 32768;
+	const int DEFLATE_MIN_MATCH = 4;
+	const int DEFLATE_MAX_MATCH = 258;
+	// block header of the last block, coded with the fixed codes
+	const unsigned int DEFLATE_FINAL_FIXED_BLOCK = 3;
+	const int DEFLATE_END_OF_BLOCK = 256;
+
+	// first length of every length symbol and its extra bits
+	const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+		67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+		5, 5, 5, 5, 0 };
+	// first distance of every distance symbol and its extra bits
+	const int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+		513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const int DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9,
+		10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// QOI chunk tags
+	const unsigned char QOI_OP_INDEX = 0x00;
+	const unsigned char QOI_OP_DIFF = 0x40;
+	const unsigned char QOI_OP_LUMA = 0x80;
+	const unsigned char QOI_OP_RUN = 0xC0;
+	const unsigned char QOI_OP_RGB = 0xFE;
+	const unsigned char QOI_OP_RGBA = 0xFF;
+	// longest run one chunk can hold
+	const int QOI_MAX_RUN = 62;
+
+	// the fixed deflate codes, bit reversed for writing, and the
+	// symbol of every length and distance
+	struct DEFLATE_TABLES
+	{
+		unsigned short literalCode[288];
+		unsigned char literalBits[288];
+		unsigned char lengthSymbol[DEFLATE_MAX_MATCH + 1];
+		// distances up to 256 directly, longer ones by 128s
+		unsigned char distanceSymbol[512];
+		unsigned int crcTable[256];
+	};
+
+	// output of the deflate coder, least significant bit first
+	struct BIT_WRITER
+	{
+		std::vector<unsigned char>* pOutput;
+		unsigned long long bits;
+		int bitCount;
+	};
+
+	/***********************************************************
+	 *  ReverseBits()
+	 *
+	 *  Huffman codes are packed starting with their most
+	 *  significant bit, the rest of deflate the other way round.
+	 ***********************************************************/
+	unsigned int ReverseBits(unsigned int code, int bitCount)
+	{
+		unsigned int reversed = 0;
+		for (int i = 0; i < bitCount; i++)
+		{
+			reversed = (reversed << 1) | ((code >> i) & 1);
+		}
+		return(reversed);
+	}
+
+	/***********************************************************
+	 *  BuildDeflateTables()
+	 *
+	 *  Fill in the code tables, called once for the program.
+	 ***********************************************************/
+	DEFLATE_TABLES BuildDeflateTables()
+	{
+		DEFLATE_TABLES tables;
+		for (int symbol = 0; symbol < 288; symbol++)
+		{
+			unsigned int code = 0;
+			int bitCount = 0;
+			if (symbol < 144)
+			{
+				code = 0x30 + symbol;
+				bitCount = 8;
+			}
+			else if (symbol < 256)
+			{
+				code = 0x190 + (symbol - 144);
+				bitCount = 9;
+			}
+			else if (symbol < 280)
+			{
+				code = symbol - 256;
+				bitCount = 7;
+			}
+			else
+			{
+				code = 0xC0 + (symbol - 280);
+				bitCount = 8;
+			}
+			tables.literalCode[symbol] = (unsigned short)ReverseBits(code, bitCount);
+			tables.literalBits[symbol] = (unsigned char)bitCount;
+		}
+
+		for (int symbol = 0; symbol < 29; symbol++)
+		{
+			int last = (symbol < 28) ? LENGTH_BASE[symbol + 1] : DEFLATE_MAX_MATCH + 1;
+			for (int length = LENGTH_BASE[symbol]; length < last; length++)
+			{
+				tables.lengthSymbol[length] = (unsigned char)symbol;
+			}
+		}
+
+		for (int symbol = 0; symbol < 30; symbol++)
+		{
+			for (int distance = DISTANCE_BASE[symbol]; distance < DISTANCE_BASE[symbol] + (1 << DISTANCE_EXTRA[symbol]); distance++)
+			{
+				int slot = (distance <= 256) ? distance - 1 : 256 + ((distance - 1) >> 7);
+				tables.distanceSymbol[slot] = (unsigned char)symbol;
+			}
+		}
+
+		for (unsigned int i = 0; i < 256; i++)
+		{
+			unsigned int crc = i;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 1) ? (0xEDB88320u ^ (crc >> 1)) : (crc >> 1);
+			}
+			tables.crcTable[i] = crc;
+		}
+
+		return(tables);
+	}
+
+	/***********************************************************
+	 *  GetDeflateTables()
+	 *
+	 *  The tables are built by the first encoder that needs them.
+	 ***********************************************************/
+	const DEFLATE_TABLES& GetDeflateTables()
+	{
+		static const DEFLATE_TABLES tables = BuildDeflateTables();
+		return(tables);
+	}
+
+	/***********************************************************
+	 *  PutBits()
+	 *
+	 *  Append bits to the deflate stream.
+	 ***********************************************************/
+	void PutBits(BIT_WRITER* pWriter, unsigned int value, int bitCount)
+	{
+		pWriter->bits |= (unsigned long long)value << pWriter->bitCount;
+		pWriter->bitCount += bitCount;
+		while (pWriter->bitCount >= 8)
+		{
+			pWriter->pOutput->push_back((unsigned char)(pWriter->bits & 0xFF));
+			pWriter->bits >>= 8;
+			pWriter->bitCount -= 8;
+		}
+	}
+
+	/***********************************************************
+	 *  PutBigEndian()
+	 *
+	 *  Append a 32 bit value with its most significant byte
+	 *  first, as PNG and QOI store them.
+	 ***********************************************************/
+	void PutBigEndian(std::vector<unsigned char>* pOutput, unsigned int value)
+	{
+		pOutput->push_back((unsigned char)(value >> 24));
+		pOutput->push_back((unsigned char)(value >> 16));
+		pOutput->push_back((unsigned char)(value >> 8));
+		pOutput->push_back((unsigned char)value);
+	}
+
+	/***********************************************************
+	 *  Deflate()
+	 *
+	 *  Compress the data into a zlib stream of one block coded
+	 *  with the fixed Huffman codes.  Repeats are found through
+	 *  a table holding the last position of every hashed four
+	 *  bytes, which is quick and finds the long runs of equal
+	 *  rows and pixels that rendered images are made of.
+	 ***********************************************************/
+	void Deflate(const std::vector<unsigned char>& data, std::vector<unsigned char>* pOutput)
+	{
+		const DEFLATE_TABLES& tables = GetDeflateTables();
+
+		// no preset dictionary, the smallest window flag that still
+		// allows the full window
+		pOutput->push_back(0x78);
+		pOutput->push_back(0x01);
+
+		BIT_WRITER writer = { pOutput, 0, 0 };
+		PutBits(&writer, DEFLATE_FINAL_FIXED_BLOCK, 3);
+
+		std::vector<int> lastPosition((size_t)1 << DEFLATE_HASH_BITS, -DEFLATE_WINDOW - 1);
+		int size = (int)data.size();
+		const unsigned char* pData = data.data();
+		int position = 0;
+		while (position < size)
+		{
+			int matchLength = 0;
+			int matchDistance = 0;
+			if (position + DEFLATE_MIN_MATCH <= size)
+			{
+				unsigned int key;
+				memcpy(&key, pData + position, sizeof(key));
+				unsigned int hash = (key * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+				int candidate = lastPosition[hash];
+				lastPosition[hash] = position;
+
+				if ((position - candidate <= DEFLATE_WINDOW) && (memcmp(pData + candidate, pData + position, DEFLATE_MIN_MATCH) == 0))
+				{
+					int longest = (size - position < DEFLATE_MAX_MATCH) ? size - position : DEFLATE_MAX_MATCH;
+					matchLength = DEFLATE_MIN_MATCH;
+					while ((matchLength < longest) && (pData[candidate + matchLength] == pData[position + matchLength]))
+					{
+						matchLength++;
+					}
+					matchDistance = position - candidate;
+				}
+			}
+
+			if (0 == matchLength)
+			{
+				int literal = pData[position];
+				PutBits(&writer, tables.literalCode[literal], tables.literalBits[literal]);
+				position++;
+				continue;
+			}
+
+			int lengthSymbol = tables.lengthSymbol[matchLength];
+			PutBits(&writer, tables.literalCode[257 + lengthSymbol], tables.literalBits[257 + lengthSymbol]);
+			PutBits(&writer, matchLength - LENGTH_BASE[lengthSymbol], LENGTH_EXTRA[lengthSymbol]);
+
+			int distanceSymbol = tables.distanceSymbol[(matchDistance <= 256) ? matchDistance - 1 : 256 + ((matchDistance - 1) >> 7)];
+			PutBits(&writer, ReverseBits(distanceSymbol, 5), 5);
+			PutBits(&writer, matchDistance - DISTANCE_BASE[distanceSymbol], DISTANCE_EXTRA[distanceSymbol]);
+			position += matchLength;
+		}
+
+		PutBits(&writer, tables.literalCode[DEFLATE_END_OF_BLOCK], tables.literalBits[DEFLATE_END_OF_BLOCK]);
+		PutBits(&writer, 0, 7);
+
+		// Adler-32 of the uncompressed data, summed in runs short
+		// enough that the sums cannot overflow
+		unsigned int sumA = 1;
+		unsigned int sumB = 0;
+		for (int start = 0; start < size; start += 5552)
+		{
+			int end = (start + 5552 < size) ? start + 5552 : size;
+			for (int i = start; i < end; i++)
+			{
+				sumA += pData[i];
+				sumB += sumA;
+			}
+			sumA %= 65521;
+			sumB %= 65521;
+		}
+		PutBigEndian(pOutput, (sumB << 16) | sumA);
+	}
+
+	/***********************************************************
+	 *  PutChunk()
+	 *
+	 *  Append a PNG chunk with its length and checksum.
+	 ***********************************************************/
+	void PutChunk(std::vector<unsigned char>* pOutput, const char* type, const unsigned char* pData, size_t size)
+	{
+		const DEFLATE_TABLES& tables = GetDeflateTables();
+
+		PutBigEndian(pOutput, (unsigned int)size);
+		size_t start = pOutput->size();
+		pOutput->insert(pOutput->end(), type, type + 4);
+		pOutput->insert(pOutput->end(), pData, pData + size);
+
+		unsigned int crc = 0xFFFFFFFFu;
+		for (size_t i = start; i < pOutput->size(); i++)
+		{
+			crc = tables.crcTable[(crc ^ (*pOutput)[i]) & 0xFF] ^ (crc >> 8);
+		}
+		PutBigEndian(pOutput, crc ^ 0xFFFFFFFFu);
+	}
+
+	/***********************************************************
+	 *  EncodeTGA()
+	 *
+	 *  TGA stores its rows bottom up like GL, only the channels
+	 *  have to be turned around into BGRA.
+	 ***********************************************************/
+	bool EncodeTGA(const unsigned char* pPixels, int width, int height, std::vector<unsigned char>* pEncoded)
+	{
+		if ((width > 0xFFFF) || (height > 0xFFFF))
+		{
+			return false;
+		}
+
+		pEncoded->assign(TGA_HEADER_SIZE + ((size_t)width * height * 4), 0);
+		std::vector<unsigned char>& image = *pEncoded;
+		image[2] = TGA_TRUE_COLOR;
+		image[12] = (unsigned char)(width & 0xFF);
+		image[13] = (unsigned char)(width >> 8);
+		image[14] = (unsigned char)(height & 0xFF);
+		image[15] = (unsigned char)(height >> 8);
+		image[16] = 32;
+		image[17] = TGA_ALPHA_BOTTOM_UP;
+
+		unsigned char* pOutput = &image[TGA_HEADER_SIZE];
+		for (size_t pixel = 0; pixel < (size_t)width * height; pixel++)
+		{
+			pOutput[(pixel * 4) + 0] = pPixels[(pixel * 4) + 2];
+			pOutput[(pixel * 4) + 1] = pPixels[(pixel * 4) + 1];
+			pOutput[(pixel * 4) + 2] = pPixels[(pixel * 4) + 0];
+			pOutput[(pixel * 4) + 3] = pPixels[(pixel * 4) + 3];
+		}
+		return true;
+	}
+
+	/***********************************************************
+	 *  EncodePNG()
+	 *
+	 *  PNG stores its rows top down, each one filtered against
+	 *  the row above, which turns the smooth gradients of a
+	 *  rendered image into long runs of small values.
+	 ***********************************************************/
+	bool EncodePNG(const unsigned char* pPixels, int width, int height, std::vector<unsigned char>* pEncoded)
+	{
+		size_t rowSize = (size_t)width * 4;
+		std::vector<unsigned char> filtered(((rowSize + 1) * height), 0);
+		for (int row = 0; row < height; row++)
+		{
+			const unsigned char* pRow = pPixels + ((size_t)(height - 1 - row) * rowSize);
+			unsigned char* pOutput = &filtered[(size_t)row * (rowSize + 1)];
+			pOutput[0] = PNG_FILTER_UP;
+			if (0 == row)
+			{
+				memcpy(pOutput + 1, pRow, rowSize);
+				continue;
+			}
+			const unsigned char* pAbove = pRow + rowSize;
+			for (size_t i = 0; i < rowSize; i++)
+			{
+				pOutput[i + 1] = (unsigned char)(pRow[i] - pAbove[i]);
+			}
+		}
+
+		pEncoded->clear();
+		pEncoded->insert(pEncoded->end(), PNG_SIGNATURE, PNG_SIGNATURE + 8);
+
+		std::vector<unsigned char> header;
+		PutBigEndian(&header, (unsigned int)width);
+		PutBigEndian(&header, (unsigned int)height);
+		header.push_back(8);
+		header.push_back(PNG_COLOR_RGBA);
+		// deflate, the filters of the standard, no interlacing
+		header.push_back(0);
+		header.push_back(0);
+		header.push_back(0);
+		PutChunk(pEncoded, "IHDR", header.data(), header.size());
+
+		std::vector<unsigned char> compressed;
+		compressed.reserve(filtered.size() / 4);
+		Deflate(filtered, &compressed);
+		PutChunk(pEncoded, "IDAT", compressed.data(), compressed.size());
+		PutChunk(pEncoded, "IEND", NULL, 0);
+		return true;
+	}
+
+	/***********************************************************
+	 *  EncodeQOI()
+	 *
+	 *  QOI stores its rows top down, every pixel as a run of the
+	 *  one before, a recently seen color, a small difference to
+	 *  the one before or in full.
+	 ***********************************************************/
+	bool EncodeQOI(const unsigned char* pPixels, int width, int height, std::vector<unsigned char>* pEncoded)
+	{
+		pEncoded->clear();
+		pEncoded->reserve((size_t)width * height);
+		pEncoded->push_back('q');
+		pEncoded->push_back('o');
+		pEncoded->push_back('i');
+		pEncoded->push_back('f');
+		PutBigEndian(pEncoded, (unsigned int)width);
+		PutBigEndian(pEncoded, (unsigned int)height);
+		// four channels, sRGB with linear alpha
+		pEncoded->push_back(4);
+		pEncoded->push_back(0);
+
+		unsigned char seen[64][4];
+		memset(seen, 0, sizeof(seen));
+		unsigned char previous[4] = { 0, 0, 0, 255 };
+		int run = 0;
+		size_t pixelCount = (size_t)width * height;
+		size_t pixelIndex = 0;
+		for (int row = height - 1; row >= 0; row--)
+		{
+			const unsigned char* pRow = pPixels + ((size_t)row * width * 4);
+			for (int column = 0; column < width; column++, pixelIndex++)
+			{
+				const unsigned char* pPixel = pRow + ((size_t)column * 4);
+				if (memcmp(pPixel, previous, 4) == 0)
+				{
+					run++;
+					if ((QOI_MAX_RUN == run) || (pixelIndex + 1 == pixelCount))
+					{
+						pEncoded->push_back((unsigned char)(QOI_OP_RUN | (run - 1)));
+						run = 0;
+					}
+					continue;
+				}
+
+				if (run > 0)
+				{
+					pEncoded->push_back((unsigned char)(QOI_OP_RUN | (run - 1)));
+					run = 0;
+				}
+
+				int slot = ((pPixel[0] * 3) + (pPixel[1] * 5) + (pPixel[2] * 7) + (pPixel[3] * 11)) % 64;
+				if (memcmp(seen[slot], pPixel, 4) == 0)
+				{
+					pEncoded->push_back((unsigned char)(QOI_OP_INDEX | slot));
+				}
+				else
+				{
+					memcpy(seen[slot], pPixel, 4);
+					if (pPixel[3] == previous[3])
+					{
+						int red = (signed char)(pPixel[0] - previous[0]);
+						int green = (signed char)(pPixel[1] - previous[1]);
+						int blue = (signed char)(pPixel[2] - previous[2]);
+						int redGreen = red - green;
+						int blueGreen = blue - green;
+						if ((red >= -2) && (red <= 1) && (green >= -2) && (green <= 1) && (blue >= -2) && (blue <= 1))
+						{
+							pEncoded->push_back((unsigned char)(QOI_OP_DIFF | ((red + 2) << 4) | ((green + 2) << 2) | (blue + 2)));
+						}
+						else if ((redGreen >= -8) && (redGreen <= 7) && (green >= -32) && (green <= 31) &&
+							(blueGreen >= -8) && (blueGreen <= 7))
+						{
+							pEncoded->push_back((unsigned char)(QOI_OP_LUMA | (green + 32)));
+							pEncoded->push_back((unsigned char)(((redGreen + 8) << 4) | (blueGreen + 8)));
+						}
+						else
+						{
+							pEncoded->push_back(QOI_OP_RGB);
+							pEncoded->insert(pEncoded->end(), pPixel, pPixel + 3);
+						}
+					}
+					else
+					{
+						pEncoded->push_back(QOI_OP_RGBA);
+						pEncoded->insert(pEncoded->end(), pPixel, pPixel + 4);
+					}
+				}
+				memcpy(previous, pPixel, 4);
+			}
+		}
+
+		// the stream ends with seven zeros and a one
+		pEncoded->insert(pEncoded->end(), 7, 0);
+		pEncoded->push_back(1);
+		return true;
+	}
+}
+
+/***********************************************************
+ *  GetImageFormat()
+ *
+ *  Pick the format from the extension of a file name.
+ ***********************************************************/
+IMAGE_FORMAT GetImageFormat(const char* filename)
+{
+	const char* pExtension = (NULL != filename) ? strrchr(filename, '.') : NULL;
+	if (NULL == pExtension)
+	{
+		return(IMAGE_FORMAT_TGA);
+	}
+	if ((strcmp(pExtension, ".png") == 0) || (strcmp(pExtension, ".PNG") == 0))
+	{
+		return(IMAGE_FORMAT_PNG);
+	}
+	if ((strcmp(pExtension, ".qoi") == 0) || (strcmp(pExtension, ".QOI") == 0))
+	{
+		return(IMAGE_FORMAT_QOI);
+	}
+	if ((strcmp(pExtension, ".raw") == 0) || (strcmp(pExtension, ".RAW") == 0))
+	{
+		return(IMAGE_FORMAT_RAW);
+	}
+	return(IMAGE_FORMAT_TGA);
+}
+
+/***********************************************************
+ *  EncodeImage()
+ *
+ *  Encode the pixels into the bytes of an image file.
+ ***********************************************************/
+bool EncodeImage(IMAGE_FORMAT format, const unsigned char* pPixels, int width, int height,
+	std::vector<unsigned char>* pEncoded)
+{
+	if ((NULL == pPixels) || (NULL == pEncoded) || (width <= 0) || (height <= 0))
+	{
+		return false;
+	}
+
+	switch (format)
+	{
+	case IMAGE_FORMAT_PNG:
+		return(EncodePNG(pPixels, width, height, pEncoded));
+	case IMAGE_FORMAT_QOI:
+		return(EncodeQOI(pPixels, width, height, pEncoded));
+	case IMAGE_FORMAT_RAW:
+		pEncoded->assign(pPixels, pPixels + ((size_t)width * height * 4));
+		return true;
+	default:
+		return(EncodeTGA(pPixels, width, height, pEncoded));
+	}
+}
+
+/***********************************************************
+ *  WriteFileData()
+ *
+ *  Write the bytes into a file.
+ ***********************************************************/
+bool WriteFileData(const char* filename, const std::vector<unsigned char>& data)
+{
+	if (NULL == filename)
+	{
+		return false;
+	}
+
+	FILE* pFile = fopen(filename, "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write the image file " << filename << std::endl;
+		return false;
+	}
+	size_t written = fwrite(data.data(), 1, data.size(), pFile);
+	bool bClosed = (fclose(pFile) == 0);
+	if ((written != data.size()) || !bClosed)
+	{
+		std::cout << "Could not write the image file " << filename << std::endl;
+		remove(filename);
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  Encode the pixels and write them into the file.
+ ***********************************************************/
+bool WriteImage(const char* filename, const unsigned char* pPixels, int width, int height)
+{
+	std::vector<unsigned char> encoded;
+	if (EncodeImage(GetImageFormat(filename), pPixels, width, height, &encoded) == false)
+	{
+		return false;
+	}
+	return(WriteFileData(filename, encoded));
+}
@@ -0,0 +1,38 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.h
+// ============
+// encode rendered images and write them to disk
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+// file formats rendered images can be written in
+enum IMAGE_FORMAT
+{
+	// uncompressed 32 bit TGA
+	IMAGE_FORMAT_TGA = 0,
+	// RGBA PNG, deflated with the fixed Huffman codes
+	IMAGE_FORMAT_PNG = 1,
+	// RGBA QOI
+	IMAGE_FORMAT_QOI = 2,
+	// the RGBA8 pixels as they were read back, without a header
+	IMAGE_FORMAT_RAW = 3
+};
+
+// format that goes with the extension of a file name, TGA when the
+// extension is not known
+IMAGE_FORMAT GetImageFormat(const char* filename);
+
+// encode RGBA8 pixels with the bottom row first, as glReadPixels
+// returns them, into the bytes of an image file
+bool EncodeImage(IMAGE_FORMAT format, const unsigned char* pPixels, int width, int height,
+	std::vector<unsigned char>* pEncoded);
+
+// write encoded bytes into a file, a partly written file is removed
+bool WriteFileData(const char* filename, const std::vector<unsigned char>& data);
+
+// encode the pixels in the format of the file name's extension and
+// write them into the file
+bool WriteImage(const char* filename, const unsigned char* pPixels, int width, int height);
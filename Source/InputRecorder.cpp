@@ -0,0 +1,245 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.cpp
+// ============
+// record the camera input of a run and play it back step for step
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputRecorder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// first bytes and version of a recording
+	const char RECORDING_MAGIC[4] = { 'I', 'N', 'R', 'C' };
+	const unsigned int RECORDING_VERSION = 1;
+
+	/***********************************************************
+	 *  SameInput()
+	 *
+	 *  Whether two steps have the same input.  A step with mouse
+	 *  motion always differs, the offsets do not carry over.
+	 ***********************************************************/
+	bool SameInput(const RECORDED_INPUT& first, const RECORDED_INPUT& second)
+	{
+		return((first.buttons == second.buttons) && (first.speed == second.speed) &&
+			(0.0f == second.mouseOffsetX) && (0.0f == second.mouseOffsetY));
+	}
+}
+
+/***********************************************************
+ *  InputRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputRecorder::InputRecorder()
+{
+	memset(&m_startCamera, 0, sizeof(m_startCamera));
+	memset(&m_lastInput, 0, sizeof(m_lastInput));
+	m_stepTime = 0.0;
+	m_stepCount = 0;
+	m_nextStep = 0;
+	m_nextEvent = 0;
+	m_bRecording = false;
+	m_bReplaying = false;
+}
+
+/***********************************************************
+ *  ~InputRecorder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputRecorder::~InputRecorder()
+{
+	if (m_bRecording)
+	{
+		EndRecording();
+	}
+}
+
+/***********************************************************
+ *  BeginRecording()
+ *
+ *  This method is used to start a recording, which is kept
+ *  in memory until it is ended.
+ ***********************************************************/
+bool InputRecorder::BeginRecording(const char* filename, double stepTime)
+{
+	if ((NULL == filename) || (stepTime <= 0.0) || m_bReplaying)
+	{
+		return false;
+	}
+
+	m_filename = filename;
+	m_events.clear();
+	m_stepTime = stepTime;
+	m_stepCount = 0;
+	m_bRecording = true;
+	return true;
+}
+
+/***********************************************************
+ *  SetStartCamera()
+ *
+ *  This method is used to keep the camera of the first step.
+ ***********************************************************/
+void InputRecorder::SetStartCamera(const RECORDED_CAMERA& camera)
+{
+	m_startCamera = camera;
+}
+
+/***********************************************************
+ *  RecordStep()
+ *
+ *  This method is used to add a step to the recording, an
+ *  event is only kept when the input has changed.
+ ***********************************************************/
+void InputRecorder::RecordStep(const RECORDED_INPUT& input)
+{
+	if (!m_bRecording)
+	{
+		return;
+	}
+
+	if ((0 == m_stepCount) || !SameInput(m_lastInput, input))
+	{
+		INPUT_EVENT event;
+		event.step = m_stepCount;
+		event.input = input;
+		m_events.push_back(event);
+	}
+	m_lastInput = input;
+	m_stepCount++;
+}
+
+/***********************************************************
+ *  EndRecording()
+ *
+ *  This method is used to write the header and the events
+ *  into the file.
+ ***********************************************************/
+bool InputRecorder::EndRecording()
+{
+	if (!m_bRecording)
+	{
+		return false;
+	}
+	m_bRecording = false;
+
+	RECORDING_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+	header.version = RECORDING_VERSION;
+	header.stepTime = m_stepTime;
+	header.stepCount = m_stepCount;
+	header.eventCount = (unsigned int)m_events.size();
+	header.startCamera = m_startCamera;
+
+	FILE* pFile = fopen(m_filename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write the input recording " << m_filename << std::endl;
+		return false;
+	}
+	bool bWritten = (fwrite(&header, sizeof(header), 1, pFile) == 1);
+	if (bWritten && !m_events.empty())
+	{
+		bWritten = (fwrite(m_events.data(), sizeof(INPUT_EVENT), m_events.size(), pFile) == m_events.size());
+	}
+	bWritten = (fclose(pFile) == 0) && bWritten;
+	if (!bWritten)
+	{
+		std::cout << "Could not write the input recording " << m_filename << std::endl;
+		remove(m_filename.c_str());
+		return false;
+	}
+
+	std::cout << "INFO: Recorded " << m_stepCount << " input steps as " << m_events.size()
+		<< " events into " << m_filename << std::endl;
+	return true;
+}
+
+/***********************************************************
+ *  LoadReplay()
+ *
+ *  This method is used to read a recording back.  The steps
+ *  only replay the same way at the step time they were
+ *  recorded at.
+ ***********************************************************/
+bool InputRecorder::LoadReplay(const char* filename, double stepTime)
+{
+	if ((NULL == filename) || m_bRecording)
+	{
+		return false;
+	}
+
+	FILE* pFile = fopen(filename, "rb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not open the input recording " << filename << std::endl;
+		return false;
+	}
+
+	RECORDING_HEADER header;
+	bool bRead = (fread(&header, sizeof(header), 1, pFile) == 1) &&
+		(memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) == 0) &&
+		(RECORDING_VERSION == header.version) && (header.eventCount <= header.stepCount);
+	if (bRead)
+	{
+		m_events.resize(header.eventCount);
+		bRead = m_events.empty() ||
+			(fread(m_events.data(), sizeof(INPUT_EVENT), m_events.size(), pFile) == m_events.size());
+	}
+	fclose(pFile);
+	if (!bRead)
+	{
+		std::cout << "The input recording " << filename << " could not be read" << std::endl;
+		m_events.clear();
+		return false;
+	}
+	if (header.stepTime != stepTime)
+	{
+		std::cout << "The input recording " << filename << " was made with another simulation step" << std::endl;
+		m_events.clear();
+		return false;
+	}
+
+	m_filename = filename;
+	m_stepTime = header.stepTime;
+	m_stepCount = header.stepCount;
+	m_startCamera = header.startCamera;
+	memset(&m_lastInput, 0, sizeof(m_lastInput));
+	m_nextStep = 0;
+	m_nextEvent = 0;
+	m_bReplaying = true;
+	return true;
+}
+
+/***********************************************************
+ *  ReplayStep()
+ *
+ *  This method is used to get the input of the next step,
+ *  which is the last event's input without its mouse motion
+ *  until the next event comes up.
+ ***********************************************************/
+bool InputRecorder::ReplayStep(RECORDED_INPUT* pInput)
+{
+	if (!m_bReplaying || (NULL == pInput) || (m_nextStep >= m_stepCount))
+	{
+		return false;
+	}
+
+	m_lastInput.mouseOffsetX = 0.0f;
+	m_lastInput.mouseOffsetY = 0.0f;
+	if ((m_nextEvent < m_events.size()) && (m_events[m_nextEvent].step == m_nextStep))
+	{
+		m_lastInput = m_events[m_nextEvent].input;
+		m_nextEvent++;
+	}
+	*pInput = m_lastInput;
+	m_nextStep++;
+	return true;
+}
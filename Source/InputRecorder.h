@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.h
+// ============
+// record the camera input of a run and play it back step for step
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// held buttons of a simulation step
+const unsigned int INPUT_BUTTON_FORWARD = 0x01;
+const unsigned int INPUT_BUTTON_BACKWARD = 0x02;
+const unsigned int INPUT_BUTTON_LEFT = 0x04;
+const unsigned int INPUT_BUTTON_RIGHT = 0x08;
+const unsigned int INPUT_BUTTON_UP = 0x10;
+const unsigned int INPUT_BUTTON_DOWN = 0x20;
+const unsigned int INPUT_BUTTON_ORTHOGRAPHIC = 0x40;
+
+// input consumed by one simulation step, stored as is in the file
+struct RECORDED_INPUT
+{
+	unsigned int buttons;
+	float mouseOffsetX;
+	float mouseOffsetY;
+	float speed;
+};
+
+// camera the recording started from with everything its movement
+// depends on, stored as is in the file
+struct RECORDED_CAMERA
+{
+	glm::vec3 position;
+	glm::vec3 front;
+	glm::vec3 up;
+	glm::vec3 right;
+	glm::vec3 worldUp;
+	float yaw;
+	float pitch;
+	float movementSpeed;
+	float mouseSensitivity;
+	float zoom;
+	unsigned int bOrthographic;
+};
+
+/***********************************************************
+ *  InputRecorder
+ *
+ *  The camera is moved in fixed simulation steps, so the
+ *  input each step consumed is all it takes to move it the
+ *  same way again.  A recording keeps a step only when its
+ *  input differs from the one before, and the step number is
+ *  its timestamp.  A replay hands the input back step by
+ *  step.  The file is little endian, as written by x86.
+ ***********************************************************/
+class InputRecorder
+{
+public:
+	// constructor
+	InputRecorder();
+	// destructor, writes a recording that was not ended
+	~InputRecorder();
+
+	// start recording steps of stepTime seconds into the file
+	bool BeginRecording(const char* filename, double stepTime);
+	// keep the camera the first step starts from
+	void SetStartCamera(const RECORDED_CAMERA& camera);
+	// keep the input of the next step
+	void RecordStep(const RECORDED_INPUT& input);
+	// write the recording into its file
+	bool EndRecording();
+	bool IsRecording() const { return(m_bRecording); }
+
+	// read a recording for replay, its step time has to match
+	bool LoadReplay(const char* filename, double stepTime);
+	// input of the next step, false once every step has been replayed
+	bool ReplayStep(RECORDED_INPUT* pInput);
+	bool IsReplaying() const { return(m_bReplaying); }
+	bool IsReplayFinished() const { return(m_bReplaying && (m_nextStep >= m_stepCount)); }
+	const RECORDED_CAMERA& GetStartCamera() const { return(m_startCamera); }
+
+	// steps recorded or replayed so far
+	unsigned int GetStepCount() const { return(m_bReplaying ? m_nextStep : m_stepCount); }
+
+private:
+	// the input of a step that differs from the step before
+	struct INPUT_EVENT
+	{
+		unsigned int step;
+		RECORDED_INPUT input;
+	};
+
+	// start of the file
+	struct RECORDING_HEADER
+	{
+		char magic[4];
+		unsigned int version;
+		double stepTime;
+		unsigned int stepCount;
+		unsigned int eventCount;
+		RECORDED_CAMERA startCamera;
+	};
+
+	std::string m_filename;
+	std::vector<INPUT_EVENT> m_events;
+	RECORDED_CAMERA m_startCamera;
+	double m_stepTime;
+	// steps recorded, or in the replay
+	unsigned int m_stepCount;
+	// replay position
+	unsigned int m_nextStep;
+	size_t m_nextEvent;
+	// input of the last step, which carries over until an event
+	RECORDED_INPUT m_lastInput;
+	bool m_bRecording;
+	bool m_bReplaying;
+};
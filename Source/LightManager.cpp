@@ -0,0 +1,489 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.cpp
+// ============
+// manage the scene light sources and their clustered assignment
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightManager.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define LIGHTMANAGER_USE_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// edge length of a screen tile in pixels
+	const int TILE_SIZE = 64;
+	// number of exponential depth slices
+	const int DEPTH_SLICES = 24;
+	// bounds used for the padding clusters so nothing touches them
+	const float EMPTY_BOUND = 1.0e30f;
+
+	/***********************************************************
+	 *  TestSphereClusters()
+	 *
+	 *  Test a view space sphere against four consecutive cluster
+	 *  bounds, returns a bit mask of the clusters it touches.
+	 ***********************************************************/
+	int TestSphereClusters(
+		const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ,
+		const glm::vec4& sphere)
+	{
+#ifdef LIGHTMANAGER_USE_SSE
+		const __m128 zero = _mm_setzero_ps();
+		__m128 center = _mm_set1_ps(sphere.x);
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX), center), _mm_sub_ps(center, _mm_loadu_ps(maxX))), zero);
+		center = _mm_set1_ps(sphere.y);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minY), center), _mm_sub_ps(center, _mm_loadu_ps(maxY))), zero);
+		center = _mm_set1_ps(sphere.z);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minZ), center), _mm_sub_ps(center, _mm_loadu_ps(maxZ))), zero);
+		__m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		return(_mm_movemask_ps(_mm_cmple_ps(distance2, _mm_set1_ps(sphere.w * sphere.w))));
+#else
+		int mask = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			float dx = std::fmax(std::fmax(minX[i] - sphere.x, sphere.x - maxX[i]), 0.0f);
+			float dy = std::fmax(std::fmax(minY[i] - sphere.y, sphere.y - maxY[i]), 0.0f);
+			float dz = std::fmax(std::fmax(minZ[i] - sphere.z, sphere.z - maxZ[i]), 0.0f);
+			if ((dx * dx + dy * dy + dz * dz) <= (sphere.w * sphere.w))
+			{
+				mask |= (1 << i);
+			}
+		}
+		return(mask);
+#endif
+	}
+
+	/***********************************************************
+	 *  SliceDepth()
+	 *
+	 *  Get the view depth where an exponential depth slice starts.
+	 ***********************************************************/
+	float SliceDepth(int slice, float nearPlane, float farPlane)
+	{
+		return(nearPlane * std::pow(farPlane / nearPlane, (float)slice / (float)DEPTH_SLICES));
+	}
+}
+
+/***********************************************************
+ *  LightManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightManager::LightManager(FrameRingBuffer* pFrameRingBuffer, ThreadPool* pThreadPool, FrameArena* pFrameArena)
+{
+	m_pFrameRingBuffer = pFrameRingBuffer;
+	m_pThreadPool = pThreadPool;
+	m_pFrameArena = pFrameArena;
+	m_pViewLights = NULL;
+	m_viewLightCount = 0;
+	m_clusterProjection = glm::mat4(0.0f);
+	m_clusterViewport = glm::vec4(0.0f);
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_rowStride = 0;
+	m_lastAssignTime = 0.0;
+	m_lastIndexCount = 0;
+
+	m_directionalShadow.lightIndex = -1;
+	m_directionalShadow.aim = glm::vec3(0.0f, -1.0f, 0.0f);
+	m_directionalShadow.fieldOfView = 0.0f;
+	m_spotShadow.lightIndex = -1;
+	m_spotShadow.aim = glm::vec3(0.0f);
+	m_spotShadow.fieldOfView = 0.0f;
+}
+
+/***********************************************************
+ *  ~LightManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightManager::~LightManager()
+{
+	m_pFrameRingBuffer = NULL;
+	m_pThreadPool = NULL;
+	m_pFrameArena = NULL;
+	m_pViewLights = NULL;
+	m_lights.clear();
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used to add a light source to the scene.
+ ***********************************************************/
+int LightManager::AddLight(const LIGHT_DATA& light)
+{
+	m_lights.push_back(light);
+	return((int)m_lights.size() - 1);
+}
+
+/***********************************************************
+ *  RemoveLightsFrom()
+ *
+ *  This method is used to remove the lights starting at the
+ *  passed in index.
+ ***********************************************************/
+void LightManager::RemoveLightsFrom(int firstIndex)
+{
+	if ((firstIndex >= 0) && (firstIndex < (int)m_lights.size()))
+	{
+		m_lights.resize(firstIndex);
+	}
+
+	// removed lights stop casting shadows
+	if (m_directionalShadow.lightIndex >= (int)m_lights.size())
+	{
+		m_directionalShadow.lightIndex = -1;
+	}
+	if (m_spotShadow.lightIndex >= (int)m_lights.size())
+	{
+		m_spotShadow.lightIndex = -1;
+	}
+}
+
+/***********************************************************
+ *  SetDirectionalShadow()
+ *
+ *  This method is used to let a light cast shadows as a
+ *  directional light shining in the passed in direction.
+ ***********************************************************/
+void LightManager::SetDirectionalShadow(int lightIndex, const glm::vec3& direction)
+{
+	m_directionalShadow.lightIndex = ((lightIndex >= 0) && (lightIndex < (int)m_lights.size())) ? lightIndex : -1;
+	m_directionalShadow.aim = glm::normalize(direction);
+	m_directionalShadow.fieldOfView = 0.0f;
+}
+
+/***********************************************************
+ *  SetSpotShadow()
+ *
+ *  This method is used to let a light cast shadows as a spot
+ *  light looking at the passed in point.
+ ***********************************************************/
+void LightManager::SetSpotShadow(int lightIndex, const glm::vec3& target, float fieldOfView)
+{
+	m_spotShadow.lightIndex = ((lightIndex >= 0) && (lightIndex < (int)m_lights.size())) ? lightIndex : -1;
+	m_spotShadow.aim = target;
+	m_spotShadow.fieldOfView = fieldOfView;
+}
+
+/***********************************************************
+ *  BuildClusterBounds()
+ *
+ *  This method is used to compute the view space bounding box
+ *  of every cluster.  The corners of each screen tile are
+ *  unprojected into view rays, which are cut at the near and
+ *  far depth of each slice, so both perspective and
+ *  orthographic projections are handled.
+ ***********************************************************/
+void LightManager::BuildClusterBounds(const FRAME_DATA& frameData)
+{
+	float width = frameData.viewport.x;
+	float height = frameData.viewport.y;
+	float nearPlane = frameData.viewport.z;
+	float farPlane = frameData.viewport.w;
+
+	m_tilesX = ((int)width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = ((int)height + TILE_SIZE - 1) / TILE_SIZE;
+	m_rowStride = (m_tilesX + 3) & ~3;
+
+	size_t paddedCount = (size_t)m_rowStride * m_tilesY * DEPTH_SLICES;
+	m_clusterMinX.assign(paddedCount, EMPTY_BOUND);
+	m_clusterMinY.assign(paddedCount, EMPTY_BOUND);
+	m_clusterMinZ.assign(paddedCount, EMPTY_BOUND);
+	m_clusterMaxX.assign(paddedCount, -EMPTY_BOUND);
+	m_clusterMaxY.assign(paddedCount, -EMPTY_BOUND);
+	m_clusterMaxZ.assign(paddedCount, -EMPTY_BOUND);
+	m_clusterLightCounts.assign(paddedCount, 0);
+	m_sliceLights.resize(DEPTH_SLICES);
+	m_clusterOffsets.resize((size_t)m_tilesX * m_tilesY * DEPTH_SLICES);
+	m_clusterCursors.resize((size_t)m_tilesX * m_tilesY * DEPTH_SLICES);
+
+	glm::mat4 inverseProjection = glm::inverse(frameData.projection);
+
+	for (int slice = 0; slice < DEPTH_SLICES; slice++)
+	{
+		float sliceDepths[2];
+		sliceDepths[0] = SliceDepth(slice, nearPlane, farPlane);
+		sliceDepths[1] = SliceDepth(slice + 1, nearPlane, farPlane);
+
+		for (int tileY = 0; tileY < m_tilesY; tileY++)
+		{
+			for (int tileX = 0; tileX < m_tilesX; tileX++)
+			{
+				glm::vec3 boundsMin(EMPTY_BOUND);
+				glm::vec3 boundsMax(-EMPTY_BOUND);
+
+				for (int corner = 0; corner < 4; corner++)
+				{
+					float pixelX = (float)((tileX + (corner & 1)) * TILE_SIZE);
+					float pixelY = (float)((tileY + (corner >> 1)) * TILE_SIZE);
+					float ndcX = (std::fmin(pixelX, width) / width) * 2.0f - 1.0f;
+					float ndcY = (std::fmin(pixelY, height) / height) * 2.0f - 1.0f;
+
+					// the view ray through this tile corner
+					glm::vec4 rayStart = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+					glm::vec4 rayEnd = inverseProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+					glm::vec3 start = glm::vec3(rayStart) / rayStart.w;
+					glm::vec3 end = glm::vec3(rayEnd) / rayEnd.w;
+
+					for (int depth = 0; depth < 2; depth++)
+					{
+						float t = (-sliceDepths[depth] - start.z) / (end.z - start.z);
+						glm::vec3 point = start + (end - start) * t;
+						boundsMin = glm::min(boundsMin, point);
+						boundsMax = glm::max(boundsMax, point);
+					}
+				}
+
+				size_t cluster = ((size_t)slice * m_tilesY + tileY) * m_rowStride + tileX;
+				m_clusterMinX[cluster] = boundsMin.x;
+				m_clusterMinY[cluster] = boundsMin.y;
+				m_clusterMinZ[cluster] = boundsMin.z;
+				m_clusterMaxX[cluster] = boundsMax.x;
+				m_clusterMaxY[cluster] = boundsMax.y;
+				m_clusterMaxZ[cluster] = boundsMax.z;
+			}
+		}
+	}
+
+	m_clusterProjection = frameData.projection;
+	m_clusterViewport = frameData.viewport;
+}
+
+/***********************************************************
+ *  AssignSlice()
+ *
+ *  This method is used to find the lights touching each
+ *  cluster of one depth slice.  A cluster takes any number of
+ *  lights, each hit is counted and appended to the slice's
+ *  list, which UpdateClusters() sorts into the compacted
+ *  index list.  Every slice is written by exactly one thread,
+ *  so no locking is needed.
+ ***********************************************************/
+void LightManager::AssignSlice(int slice, float sliceNear, float sliceFar)
+{
+	size_t sliceStart = (size_t)slice * m_tilesY * m_rowStride;
+	size_t sliceEnd = sliceStart + (size_t)m_tilesY * m_rowStride;
+	std::vector<unsigned int>& sliceLights = m_sliceLights[slice];
+
+	memset(&m_clusterLightCounts[sliceStart], 0, (sliceEnd - sliceStart) * sizeof(unsigned int));
+	sliceLights.clear();
+
+	for (int light = 0; light < m_viewLightCount; light++)
+	{
+		const glm::vec4& sphere = m_pViewLights[light];
+
+		// unbounded lights reach every cluster
+		if (sphere.w <= 0.0f)
+		{
+			for (int tileY = 0; tileY < m_tilesY; tileY++)
+			{
+				size_t rowStart = sliceStart + (size_t)tileY * m_rowStride;
+				for (int tileX = 0; tileX < m_tilesX; tileX++)
+				{
+					m_clusterLightCounts[rowStart + tileX]++;
+					sliceLights.push_back((unsigned int)(tileY * m_tilesX + tileX));
+					sliceLights.push_back((unsigned int)light);
+				}
+			}
+			continue;
+		}
+
+		// skip lights that are entirely in front of or behind the slice
+		float depth = -sphere.z;
+		if (((depth + sphere.w) < sliceNear) || ((depth - sphere.w) > sliceFar))
+		{
+			continue;
+		}
+
+		for (int tileY = 0; tileY < m_tilesY; tileY++)
+		{
+			size_t rowStart = sliceStart + (size_t)tileY * m_rowStride;
+			for (int tileX = 0; tileX < m_rowStride; tileX += 4)
+			{
+				size_t group = rowStart + tileX;
+				int mask = TestSphereClusters(
+					&m_clusterMinX[group], &m_clusterMinY[group], &m_clusterMinZ[group],
+					&m_clusterMaxX[group], &m_clusterMaxY[group], &m_clusterMaxZ[group],
+					sphere);
+
+				while (mask != 0)
+				{
+					int bit = 0;
+					while ((mask & (1 << bit)) == 0)
+					{
+						bit++;
+					}
+					mask &= ~(1 << bit);
+
+					// the padding clusters are never touched, so the
+					// tile is always inside the row
+					m_clusterLightCounts[group + bit]++;
+					sliceLights.push_back((unsigned int)(tileY * m_tilesX + tileX + bit));
+					sliceLights.push_back((unsigned int)light);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  UploadLights()
+ *
+ *  This method is used to write the light table into the frame
+ *  ring buffer and bind it for the shaders.
+ ***********************************************************/
+bool LightManager::UploadLights()
+{
+	if (NULL == m_pFrameRingBuffer)
+	{
+		return(false);
+	}
+
+	size_t lightCount = (m_lights.size() > 0) ? m_lights.size() : 1;
+	GLintptr lightOffset = 0;
+	LIGHT_DATA* pLights = (LIGHT_DATA*)m_pFrameRingBuffer->Allocate(lightCount * sizeof(LIGHT_DATA), &lightOffset);
+	if (NULL == pLights)
+	{
+		return(false);
+	}
+
+	if (m_lights.size() > 0)
+	{
+		memcpy(pLights, m_lights.data(), m_lights.size() * sizeof(LIGHT_DATA));
+	}
+
+	m_pFrameRingBuffer->BindRange(GL_SHADER_STORAGE_BUFFER, LIGHT_DATA_BINDING, lightOffset, lightCount * sizeof(LIGHT_DATA));
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateClusters()
+ *
+ *  This method is used to assign the lights to the clusters of
+ *  the current view, write the light table, the cluster grid
+ *  and the compacted light index list into the frame ring
+ *  buffer, and bind them for the shaders.
+ ***********************************************************/
+void LightManager::UpdateClusters(const FRAME_DATA& frameData)
+{
+	if ((NULL == m_pFrameRingBuffer) || (NULL == m_pThreadPool))
+	{
+		return;
+	}
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	float nearPlane = frameData.viewport.z;
+	float farPlane = frameData.viewport.w;
+
+	// the cluster bounds only change with the projection
+	if ((m_rowStride == 0) ||
+		(memcmp(&m_clusterProjection, &frameData.projection, sizeof(glm::mat4)) != 0) ||
+		(memcmp(&m_clusterViewport, &frameData.viewport, sizeof(glm::vec4)) != 0))
+	{
+		BuildClusterBounds(frameData);
+	}
+
+	// move the light spheres into view space, they are only
+	// needed until the clusters are assigned
+	m_viewLightCount = (int)m_lights.size();
+	m_pViewLights = m_pFrameArena->AllocateArray<glm::vec4>(m_viewLightCount);
+	for (int i = 0; i < m_viewLightCount; i++)
+	{
+		glm::vec4 center = frameData.view * glm::vec4(glm::vec3(m_lights[i].position), 1.0f);
+		m_pViewLights[i] = glm::vec4(glm::vec3(center), m_lights[i].position.w);
+	}
+
+	// each depth slice is assigned on its own thread
+	m_pThreadPool->ParallelFor(DEPTH_SLICES, [this, nearPlane, farPlane](int slice)
+	{
+		AssignSlice(slice, SliceDepth(slice, nearPlane, farPlane), SliceDepth(slice + 1, nearPlane, farPlane));
+	});
+
+	// compact the per-cluster lists into one index list
+	unsigned int indexCount = 0;
+	size_t clusterIndex = 0;
+	for (int slice = 0; slice < DEPTH_SLICES; slice++)
+	{
+		for (int tileY = 0; tileY < m_tilesY; tileY++)
+		{
+			size_t rowStart = ((size_t)slice * m_tilesY + tileY) * m_rowStride;
+			for (int tileX = 0; tileX < m_tilesX; tileX++)
+			{
+				m_clusterOffsets[clusterIndex] = indexCount;
+				indexCount += m_clusterLightCounts[rowStart + tileX];
+				clusterIndex++;
+			}
+		}
+	}
+	size_t clusterCount = clusterIndex;
+
+	// reserve this frame's light, cluster and index data
+	size_t indexSpace = (indexCount > 0) ? indexCount : 1;
+	GLintptr clusterDataOffset = 0;
+	GLintptr gridOffset = 0;
+	GLintptr indexOffset = 0;
+	if (!UploadLights())
+	{
+		return;
+	}
+	CLUSTER_DATA* pClusterData = (CLUSTER_DATA*)m_pFrameRingBuffer->Allocate(sizeof(CLUSTER_DATA), &clusterDataOffset);
+	unsigned int* pGrid = (unsigned int*)m_pFrameRingBuffer->Allocate(clusterCount * 2 * sizeof(unsigned int), &gridOffset);
+	unsigned int* pIndices = (unsigned int*)m_pFrameRingBuffer->Allocate(indexSpace * sizeof(unsigned int), &indexOffset);
+	if ((NULL == pClusterData) || (NULL == pGrid) || (NULL == pIndices))
+	{
+		return;
+	}
+
+	float sliceScale = (float)DEPTH_SLICES / std::log(farPlane / nearPlane);
+	pClusterData->clusterGrid = glm::uvec4(m_tilesX, m_tilesY, DEPTH_SLICES, TILE_SIZE);
+	pClusterData->clusterDepth = glm::vec4(sliceScale, -sliceScale * std::log(nearPlane), nearPlane, farPlane);
+
+	// write the grid and the index list, one slice per thread.  The
+	// pairs of a slice are in light order, so every cluster's list
+	// comes out sorted as well.
+	m_pThreadPool->ParallelFor(DEPTH_SLICES, [this, pGrid, pIndices](int slice)
+	{
+		size_t firstCluster = (size_t)slice * m_tilesY * m_tilesX;
+		size_t clusterIndex = firstCluster;
+		for (int tileY = 0; tileY < m_tilesY; tileY++)
+		{
+			size_t rowStart = ((size_t)slice * m_tilesY + tileY) * m_rowStride;
+			for (int tileX = 0; tileX < m_tilesX; tileX++)
+			{
+				unsigned int offset = m_clusterOffsets[clusterIndex];
+				pGrid[clusterIndex * 2] = offset;
+				pGrid[clusterIndex * 2 + 1] = m_clusterLightCounts[rowStart + tileX];
+				m_clusterCursors[clusterIndex] = offset;
+				clusterIndex++;
+			}
+		}
+
+		const std::vector<unsigned int>& sliceLights = m_sliceLights[slice];
+		unsigned int* pCursors = &m_clusterCursors[firstCluster];
+		for (size_t entry = 0; entry < sliceLights.size(); entry += 2)
+		{
+			pIndices[pCursors[sliceLights[entry]]++] = sliceLights[entry + 1];
+		}
+	});
+
+	m_pFrameRingBuffer->BindRange(GL_UNIFORM_BUFFER, CLUSTER_DATA_BINDING, clusterDataOffset, sizeof(CLUSTER_DATA));
+	m_pFrameRingBuffer->BindRange(GL_SHADER_STORAGE_BUFFER, CLUSTER_GRID_BINDING, gridOffset, clusterCount * 2 * sizeof(unsigned int));
+	m_pFrameRingBuffer->BindRange(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BINDING, indexOffset, indexSpace * sizeof(unsigned int));
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	m_lastAssignTime = elapsed.count();
+	m_lastIndexCount = (int)indexCount;
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.h
+// ============
+// manage the scene light sources and their clustered assignment
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameArena.h"
+#include "FrameRingBuffer.h"
+#include "ShaderInterface.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+// a light that casts shadows and how its shadow map is aimed
+struct SHADOW_CASTER
+{
+	// index of the light, -1 when no light is set
+	int lightIndex;
+	// direction the light shines for a directional shadow, the
+	// point the light looks at for a spot shadow
+	glm::vec3 aim;
+	// full cone angle of a spot shadow in degrees
+	float fieldOfView;
+};
+
+/***********************************************************
+ *  LightManager
+ *
+ *  The view frustum is split into a grid of screen tiles by
+ *  exponential depth slices.  Every frame the lights are
+ *  assigned to the clusters they touch, so the fragment shader
+ *  only walks the lights of the cluster it falls in.
+ ***********************************************************/
+class LightManager
+{
+public:
+	// constructor
+	LightManager(FrameRingBuffer* pFrameRingBuffer, ThreadPool* pThreadPool, FrameArena* pFrameArena);
+	// destructor
+	~LightManager();
+
+	// add a light source, returns its index
+	int AddLight(const LIGHT_DATA& light);
+	// remove every light from the passed in index onwards
+	void RemoveLightsFrom(int firstIndex);
+	// number of defined lights
+	int GetLightCount() const { return((int)m_lights.size()); }
+	// get a defined light by index
+	const LIGHT_DATA& GetLight(int index) const { return(m_lights[index]); }
+
+	// let a light cast shadows as a directional light or as a spot
+	// light aimed at a point
+	void SetDirectionalShadow(int lightIndex, const glm::vec3& direction);
+	void SetSpotShadow(int lightIndex, const glm::vec3& target, float fieldOfView);
+	const SHADOW_CASTER& GetDirectionalShadow() const { return(m_directionalShadow); }
+	const SHADOW_CASTER& GetSpotShadow() const { return(m_spotShadow); }
+
+	// write the light table into the ring buffer and bind it
+	bool UploadLights();
+	// assign the lights to clusters for the passed in view and
+	// bind the light, cluster and index buffers for the shaders
+	void UpdateClusters(const FRAME_DATA& frameData);
+
+	// CPU time spent in the last cluster assignment, in milliseconds
+	double GetLastAssignTime() const { return(m_lastAssignTime); }
+	// light indices written by the last cluster assignment
+	int GetLastIndexCount() const { return(m_lastIndexCount); }
+
+private:
+	// pointer to the per-frame dynamic data buffer
+	FrameRingBuffer* m_pFrameRingBuffer;
+	// pointer to the worker threads
+	ThreadPool* m_pThreadPool;
+	// defined light sources
+	std::vector<LIGHT_DATA> m_lights;
+	// lights casting shadows
+	SHADOW_CASTER m_directionalShadow;
+	SHADOW_CASTER m_spotShadow;
+
+	// projection and viewport the cluster bounds were built for
+	glm::mat4 m_clusterProjection;
+	glm::vec4 m_clusterViewport;
+	// cluster grid dimensions
+	int m_tilesX;
+	int m_tilesY;
+	// clusters per row, padded to a multiple of four for SIMD tests
+	int m_rowStride;
+	// view space bounds of every cluster, structure of arrays
+	std::vector<float> m_clusterMinX;
+	std::vector<float> m_clusterMinY;
+	std::vector<float> m_clusterMinZ;
+	std::vector<float> m_clusterMaxX;
+	std::vector<float> m_clusterMaxY;
+	std::vector<float> m_clusterMaxZ;
+	// number of lights touching each cluster
+	std::vector<unsigned int> m_clusterLightCounts;
+	// cluster and light index pairs found for each depth slice, in
+	// light order, the cluster counted within the slice without
+	// the row padding.  The lists keep their storage across frames.
+	std::vector<std::vector<unsigned int>> m_sliceLights;
+	// next compacted index of each cluster while the lists are written
+	std::vector<unsigned int> m_clusterCursors;
+	// transient storage for the per-frame data below
+	FrameArena* m_pFrameArena;
+	// view space light spheres, xyz center and radius in w
+	glm::vec4* m_pViewLights;
+	int m_viewLightCount;
+	// first compacted index of each cluster
+	std::vector<unsigned int> m_clusterOffsets;
+
+	// statistics of the last assignment
+	double m_lastAssignTime;
+	int m_lastIndexCount;
+
+	// rebuild the view space cluster bounds for a new projection
+	void BuildClusterBounds(const FRAME_DATA& frameData);
+	// assign the lights to the clusters of one depth slice
+	void AssignSlice(int slice, float sliceNear, float sliceFar);
+};
@@ -1,5 +1,8 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line parsing
+#include <cstdio>           // window title formatting
+#include <chrono>           // replay timing
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -11,7 +14,14 @@
 
 #include "SceneManager.h"
 #include "ViewManager.h"
-#include "ShapeMeshes.h"
+#include "FrameArena.h"
+#include "FrameRingBuffer.h"
+#include "RenderPipeline.h"
+#include "SoftwareRasterizer.h"
+#include "UploadQueue.h"
+#include "Benchmark.h"
+#include "BatchRender.h"
+#include "ResourceTracker.h"
 #include "ShaderManager.h"
 
 // Namespace for declaring global variables
@@ -20,6 +30,14 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// seconds between refreshes of the statistics in the window title
+	const double TITLE_UPDATE_INTERVAL = 0.5;
+
+	// bytes of dynamic shader data available to each frame
+	const GLsizeiptr FRAME_RING_SIZE = 4 * 1024 * 1024;
+	// bytes of CPU side transient data available to each frame
+	const size_t FRAME_ARENA_SIZE = 1024 * 1024;
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -29,12 +47,22 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// persistently mapped buffer for per-frame shader data
+	FrameRingBuffer* g_FrameRingBuffer = nullptr;
+	// linear allocator for CPU data that only lives for one frame
+	FrameArena* g_FrameArena = nullptr;
+	// forward and deferred shading of the 3D scene
+	RenderPipeline* g_RenderPipeline = nullptr;
+	// loader thread that creates textures and meshes off the frame
+	UploadQueue* g_UploadQueue = nullptr;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void RenderFrame();
+void UpdateWindowTitle();
 
 
 /***********************************************************
@@ -53,9 +81,14 @@ int main(int argc, char* argv[])
 
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
+	// create the frame ring buffer object, its storage is created
+	// once the OpenGL context is ready
+	g_FrameRingBuffer = new FrameRingBuffer();
+	g_FrameArena = new FrameArena(FRAME_ARENA_SIZE);
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
-		g_ShaderManager);
+		g_ShaderManager,
+		g_FrameRingBuffer);
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
@@ -66,42 +99,193 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// create the mapped storage for the per-frame shader data
+	if (g_FrameRingBuffer->CreateBuffer(FRAME_RING_SIZE) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// kill -USR1 prints the memory of the GL objects and frames
+	InstallResourceReportSignal();
+
 	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
+	TrackProgram(g_ShaderManager->LoadShaders(
 		"vertexShader.glsl",
-		"fragmentShader.glsl");
+		"fragmentShader.glsl"), "scene");
 	g_ShaderManager->use();
 
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	// try to create a new scene manager object and prepare the 3D scene,
+	// the compact vertex format is picked on the command line
+	// the scene's textures are loaded on a thread whose context
+	// shares its objects with the main window
+	g_UploadQueue = new UploadQueue(g_Window);
+	g_SceneManager = new SceneManager(g_ShaderManager, g_FrameRingBuffer, g_FrameArena, g_UploadQueue);
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--compact-vertices") == 0)
+		{
+			g_SceneManager->SetVertexFormat(VERTEX_FORMAT_COMPACT);
+		}
+	}
 	g_SceneManager->PrepareScene();
 
-	// loop will keep running until the application is closed 
-	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	// set up the shading paths, forward shading is used until the
+	// deferred path is selected
+	g_RenderPipeline = new RenderPipeline(g_ShaderManager, g_FrameRingBuffer);
+	g_RenderPipeline->CreatePipeline(
+		g_ViewManager->GetWindowWidth(),
+		g_ViewManager->GetWindowHeight());
+
+	// the depth and resolution options are read before any benchmark
+	// or batch runs so those renders use them as well
+	for (int i = 1; i < argc; i++)
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		if (strcmp(argv[i], "--reverse-z") == 0)
+		{
+			g_ViewManager->SetReverseDepth(true);
+		}
+		else if ((strcmp(argv[i], "--dynamic-resolution") == 0) && (i + 1 < argc))
+		{
+			// the GPU milliseconds a frame may take
+			g_RenderPipeline->GetDynamicResolution()->SetFrameBudget(atof(argv[++i]));
+			g_ViewManager->SetDynamicResolution(true);
+		}
+	}
+	g_RenderPipeline->SetReverseDepth(g_ViewManager->GetReverseDepth());
+	g_RenderPipeline->GetDynamicResolution()->SetEnabled(g_ViewManager->GetDynamicResolution());
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// look for a benchmark run on the command line
+	bool bBenchmark = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--benchmark-lights") == 0)
+		{
+			RunLightBenchmark(g_SceneManager, RenderFrame,
+				g_ViewManager->GetWindowWidth(), g_ViewManager->GetWindowHeight());
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--benchmark-deferred") == 0)
+		{
+			RunDeferredBenchmark(g_SceneManager, g_RenderPipeline, RenderFrame,
+				g_ViewManager->GetWindowWidth(), g_ViewManager->GetWindowHeight());
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--benchmark-prepass") == 0)
+		{
+			RunPrepassBenchmark(g_SceneManager, g_RenderPipeline, RenderFrame,
+				g_ViewManager->GetWindowWidth(), g_ViewManager->GetWindowHeight());
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--benchmark-materials") == 0)
+		{
+			RunMaterialBenchmark(g_SceneManager);
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--benchmark-import") == 0)
+		{
+			RunImportBenchmark(g_SceneManager);
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--benchmark-upload") == 0)
+		{
+			RunUploadBenchmark(g_SceneManager, RenderFrame);
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--compare-software") == 0)
+		{
+			RunSoftwareComparison(g_SceneManager, g_RenderPipeline, RenderFrame,
+				g_ViewManager->GetWindowWidth(), g_ViewManager->GetWindowHeight());
+			bBenchmark = true;
+		}
+		else if ((strcmp(argv[i], "--batch") == 0) && (i + 1 < argc))
+		{
+			// the scene is loaded once for all views of the batch
+			RunBatchRender(g_SceneManager, g_ViewManager, RenderFrame, argv[++i],
+				g_ViewManager->GetWindowWidth(), g_ViewManager->GetWindowHeight());
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--benchmark-capture") == 0)
+		{
+			RunCaptureBenchmark(g_SceneManager, g_ViewManager, RenderFrame);
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--render-reference") == 0)
+		{
+			RunReferenceRender(g_SceneManager, RenderFrame, g_ViewManager->GetFrameData(),
+				g_ViewManager->GetWindowWidth(), g_ViewManager->GetWindowHeight(), "reference.tga");
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--benchmark-raytracer") == 0)
+		{
+			RunRayTracerBenchmark(g_SceneManager, RenderFrame, g_ViewManager->GetFrameData(),
+				g_ViewManager->GetWindowWidth(), g_ViewManager->GetWindowHeight());
+			bBenchmark = true;
+		}
+		else if ((strcmp(argv[i], "--record-input") == 0) && (i + 1 < argc))
+		{
+			g_ViewManager->StartRecording(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--replay-input") == 0) && (i + 1 < argc))
+		{
+			g_ViewManager->StartReplay(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--dynamic-resolution") == 0) && (i + 1 < argc))
+		{
+			// already applied, skip the budget
+			i++;
+		}
+	}
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+	// a replay renders the same frames every run, time them for comparisons
+	bool bReplay = g_ViewManager->IsReplaying();
+	int replayFrames = 0;
+	std::chrono::steady_clock::time_point replayStart = std::chrono::steady_clock::now();
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+	// loop will keep running until the application is closed 
+	// or until an error has occurred
+	while (!bBenchmark && !glfwWindowShouldClose(g_Window) && !g_ViewManager->IsReplayFinished())
+	{
+		// pick up the shading options chosen with the keyboard
+		g_RenderPipeline->SetRenderPath(g_ViewManager->GetRenderPath());
+		g_RenderPipeline->SetDepthPrepass(g_ViewManager->GetDepthPrepass());
+		g_RenderPipeline->SetReverseDepth(g_ViewManager->GetReverseDepth());
+		g_RenderPipeline->GetDynamicResolution()->SetEnabled(g_ViewManager->GetDynamicResolution());
 
+		// draw the 3D scene into the back buffer
+		RenderFrame();
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
 
 		// query the latest GLFW events
 		glfwPollEvents();
+
+		// show how much overdraw the shading pass is paying for
+		UpdateWindowTitle();
+
+		replayFrames++;
 	}
 
-	// clear the allocated manager objects from memory
+	if (bReplay && (replayFrames > 0))
+	{
+		double replayTime = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - replayStart).count();
+		std::cout << "INFO: Replay finished after " << replayFrames << " frames, "
+			<< (replayTime / replayFrames) << " ms per frame" << std::endl;
+	}
+
+	// clear the allocated manager objects from memory, the upload
+	// queue goes first so no finished upload reaches the scene
+	if (NULL != g_UploadQueue)
+	{
+		delete g_UploadQueue;
+		g_UploadQueue = NULL;
+	}
+	if (NULL != g_RenderPipeline)
+	{
+		delete g_RenderPipeline;
+		g_RenderPipeline = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -114,14 +298,120 @@ int main(int argc, char* argv[])
 	}
 	if (NULL != g_ShaderManager)
 	{
+		UntrackResources(RESOURCE_PROGRAM, "scene");
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_FrameRingBuffer)
+	{
+		delete g_FrameRingBuffer;
+		g_FrameRingBuffer = NULL;
+	}
+	if (NULL != g_FrameArena)
+	{
+		delete g_FrameArena;
+		g_FrameArena = NULL;
+	}
+
+	// every GL object is freed with its owner, what is still
+	// tracked here has leaked
+	RESOURCE_TOTALS resourceTotals = GetResourceTotals();
+	if ((resourceTotals.counts[RESOURCE_TEXTURE] + resourceTotals.counts[RESOURCE_BUFFER] +
+		resourceTotals.counts[RESOURCE_PROGRAM]) > 0)
+	{
+		std::cout << "WARNING: GL objects were not freed" << std::endl;
+		PrintResourceReport();
+	}
 
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
 }
 
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to render one frame of the 3D scene
+ *  into the currently bound framebuffer.
+ ***********************************************************/
+void RenderFrame()
+{
+	// wait until this frame's part of the ring buffer is free and
+	// release the transient data of the previous frame
+	g_FrameRingBuffer->BeginFrame();
+	g_FrameArena->Reset();
+
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
+
+	// Clear the frame and z buffers
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// convert from 3D object space to 2D view
+	g_ViewManager->PrepareSceneView();
+
+	// refresh the 3D scene with the selected shading path
+	g_RenderPipeline->RenderFrame(g_SceneManager, g_ViewManager->GetFrameData());
+
+	// fence the ring buffer data used by this frame
+	g_FrameRingBuffer->EndFrame();
+
+	// the arena holds everything the frame allocated on the CPU
+	EndResourceFrame(g_FrameArena->GetUsed());
+}
+
+/***********************************************************
+ *	UpdateWindowTitle()
+ *
+ *  This function is used to show the shading path, the GPU
+ *  frame time and the overdraw of the scene in the window
+ *  title.  An overdraw well above one means the depth pre-pass
+ *  can save more shading than the extra pass costs.  With
+ *  dynamic resolution the scale of the measured frame is
+ *  shown as well.  The software path shows its CPU frame time
+ *  instead.
+ ***********************************************************/
+void UpdateWindowTitle()
+{
+	static double lastUpdateTime = 0.0;
+
+	double currentTime = glfwGetTime();
+	if ((currentTime - lastUpdateTime) < TITLE_UPDATE_INTERVAL)
+	{
+		return;
+	}
+	lastUpdateTime = currentTime;
+
+	char title[256];
+	if (RENDER_PATH_SOFTWARE == g_RenderPipeline->GetRenderPath())
+	{
+		const SoftwareRasterizer* pSoftwareRasterizer = g_RenderPipeline->GetSoftwareRasterizer();
+		snprintf(title, sizeof(title), "%s - software - CPU %.2f ms - triangles %d",
+			WINDOW_TITLE,
+			pSoftwareRasterizer->GetLastFrameTime(),
+			pSoftwareRasterizer->GetLastTriangleCount());
+		glfwSetWindowTitle(g_Window, title);
+		return;
+	}
+
+	const RENDER_STATS& stats = g_RenderPipeline->GetStats();
+	char scaleText[32] = "";
+	if (g_RenderPipeline->GetDynamicResolution()->IsEnabled())
+	{
+		snprintf(scaleText, sizeof(scaleText), " + %d%% resolution", (int)(stats.renderScale * 100.0f + 0.5f));
+	}
+	snprintf(title, sizeof(title), "%s - %s%s%s%s - GPU %.2f ms - shaded %llu - overdraw %.2fx",
+		WINDOW_TITLE,
+		(RENDER_PATH_DEFERRED == stats.path) ? "deferred" : "forward",
+		stats.bDepthPrepass ? " + depth pre-pass" : "",
+		g_RenderPipeline->GetReverseDepth() ? " + reverse Z" : "",
+		scaleText,
+		stats.gpuTime,
+		(unsigned long long)stats.shadedFragments,
+		stats.overdraw);
+	glfwSetWindowTitle(g_Window, title);
+}
+
 /***********************************************************
  *	InitializeGLFW()
  * 
@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// read only memory mapping of a whole file
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  Maps a file into the address space so its contents can be
+ *  handed to the GPU without reading them into a buffer first.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the whole file, false when it does not exist or is empty
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	// start and size of the mapped contents
+	const unsigned char* GetData() const { return(m_pData); }
+	size_t GetSize() const { return(m_size); }
+
+private:
+	// mapped contents
+	const unsigned char* m_pData;
+	// bytes mapped
+	size_t m_size;
+#ifdef _WIN32
+	// file and mapping object handles
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+};
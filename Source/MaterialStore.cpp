@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+// materialstore.cpp
+// ============
+// object materials split into hot GPU mirrored arrays and a cold tag table
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MaterialStore.h"
+#include "ShaderInterface.h"
+#include "ResourceTracker.h"
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// storage block binding point of each hot array
+	const GLuint MATERIAL_BINDINGS[MaterialStore::MATERIAL_ARRAY_COUNT] =
+	{
+		MATERIAL_AMBIENT_BINDING,
+		MATERIAL_DIFFUSE_BINDING,
+		MATERIAL_SPECULAR_BINDING
+	};
+}
+
+/***********************************************************
+ *  MaterialStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MaterialStore::MaterialStore()
+{
+	m_count = 0;
+	m_capacity = 0;
+	m_bufferID = 0;
+	m_bufferSize = 0;
+}
+
+/***********************************************************
+ *  ~MaterialStore()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MaterialStore::~MaterialStore()
+{
+	DestroyBuffer();
+}
+
+/***********************************************************
+ *  AddMaterial()
+ *
+ *  This method is used to append a material to the hot arrays
+ *  and its tag to the tag table.
+ ***********************************************************/
+int MaterialStore::AddMaterial(const char* tag, float ambientStrength, const glm::vec3& ambientColor,
+	const glm::vec3& diffuseColor, const glm::vec3& specularColor, float shininess)
+{
+	if (m_count == m_capacity)
+	{
+		Grow((m_capacity > 0) ? (m_capacity * 2) : CAPACITY_GRANULE);
+	}
+
+	int index = m_count;
+	m_hotData[((size_t)MATERIAL_AMBIENT * m_capacity) + index] = glm::vec4(ambientColor, ambientStrength);
+	m_hotData[((size_t)MATERIAL_DIFFUSE * m_capacity) + index] = glm::vec4(diffuseColor, 0.0f);
+	m_hotData[((size_t)MATERIAL_SPECULAR * m_capacity) + index] = glm::vec4(specularColor, shininess);
+	m_tags.push_back(tag);
+	m_count++;
+
+	return(index);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used to remove all materials.
+ ***********************************************************/
+void MaterialStore::Clear()
+{
+	m_hotData.clear();
+	m_tags.clear();
+	m_count = 0;
+	m_capacity = 0;
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used to get the index of the material with
+ *  the passed in tag.  Only the tag table is scanned.
+ ***********************************************************/
+int MaterialStore::FindMaterial(const char* tag) const
+{
+	for (int index = 0; index < m_count; index++)
+	{
+		if (m_tags[index].compare(tag) == 0)
+		{
+			return(index);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  Grow()
+ *
+ *  This method is used to enlarge the hot arrays.  Every
+ *  array moves to its new start, so the block keeps the
+ *  layout the shaders bind.
+ ***********************************************************/
+void MaterialStore::Grow(int capacity)
+{
+	capacity = ((capacity + CAPACITY_GRANULE - 1) / CAPACITY_GRANULE) * CAPACITY_GRANULE;
+
+	std::vector<glm::vec4> hotData((size_t)capacity * MATERIAL_ARRAY_COUNT, glm::vec4(0.0f));
+	for (int array = 0; array < MATERIAL_ARRAY_COUNT; array++)
+	{
+		if (m_count > 0)
+		{
+			memcpy(&hotData[(size_t)array * capacity], &m_hotData[(size_t)array * m_capacity], sizeof(glm::vec4) * m_count);
+		}
+	}
+
+	m_hotData.swap(hotData);
+	m_tags.reserve(capacity);
+	m_capacity = capacity;
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used to copy the whole hot block into the
+ *  GPU buffer with one call.  The buffer is only reallocated
+ *  when the block has grown.
+ ***********************************************************/
+bool MaterialStore::Upload()
+{
+	if (0 == m_count)
+	{
+		return false;
+	}
+
+	if (0 == m_bufferID)
+	{
+		glGenBuffers(1, &m_bufferID);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_bufferID);
+	if (m_bufferSize != GetHotSize())
+	{
+		m_bufferSize = GetHotSize();
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_bufferSize, m_hotData.data(), GL_STATIC_DRAW);
+		TrackBuffer(m_bufferID, m_bufferSize, "MaterialStore");
+	}
+	else
+	{
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_bufferSize, m_hotData.data());
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	GLsizeiptr arraySize = (GLsizeiptr)m_capacity * sizeof(glm::vec4);
+	for (int array = 0; array < MATERIAL_ARRAY_COUNT; array++)
+	{
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDINGS[array], m_bufferID, array * arraySize, arraySize);
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  DestroyBuffer()
+ *
+ *  This method is used to free the GPU copy of the materials.
+ ***********************************************************/
+void MaterialStore::DestroyBuffer()
+{
+	if (0 != m_bufferID)
+	{
+		UntrackResource(RESOURCE_BUFFER, m_bufferID);
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+	m_bufferSize = 0;
+}
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// materialstore.h
+// ============
+// object materials split into hot GPU mirrored arrays and a cold tag table
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  MaterialStore
+ *
+ *  The values read while shading are kept as one array per
+ *  value, ambient, diffuse and specular, each a run of vec4s
+ *  in a single block.  A vec4 array has the same layout under
+ *  std140 and std430, so the block is copied to the GPU as is
+ *  and every array is bound as its own storage block.  The
+ *  material tags are only needed for lookups by name and live
+ *  in a separate table.
+ ***********************************************************/
+class MaterialStore
+{
+public:
+	// the hot arrays in the order they are stored
+	enum MATERIAL_ARRAY
+	{
+		// rgb ambient color, ambient strength in w
+		MATERIAL_AMBIENT,
+		// rgb diffuse color
+		MATERIAL_DIFFUSE,
+		// rgb specular color, shininess in w
+		MATERIAL_SPECULAR,
+		MATERIAL_ARRAY_COUNT
+	};
+
+	// constructor
+	MaterialStore();
+	// destructor
+	~MaterialStore();
+
+	// add a material, returns its index
+	int AddMaterial(const char* tag, float ambientStrength, const glm::vec3& ambientColor,
+		const glm::vec3& diffuseColor, const glm::vec3& specularColor, float shininess);
+	// remove all materials, the GPU buffer is kept for reuse
+	void Clear();
+	// find the index of a material by tag, -1 when not found
+	int FindMaterial(const char* tag) const;
+
+	// number of materials
+	int GetCount() const { return(m_count); }
+	// first entry of one of the hot arrays
+	const glm::vec4* GetArray(MATERIAL_ARRAY array) const { return(&m_hotData[(size_t)array * m_capacity]); }
+	// bytes of the hot block, the size of every upload
+	size_t GetHotSize() const { return(m_hotData.size() * sizeof(glm::vec4)); }
+
+	// copy the hot block into the GPU buffer and bind the arrays
+	// to their storage block binding points
+	bool Upload();
+	// free the GPU buffer
+	void DestroyBuffer();
+
+private:
+	// materials per array are rounded to this many entries, so
+	// each array starts on a 256 byte boundary, the largest
+	// storage buffer offset alignment OpenGL allows
+	static const int CAPACITY_GRANULE = 16;
+
+	// hot arrays back to back, m_capacity entries each
+	std::vector<glm::vec4> m_hotData;
+	// tags in material order
+	std::vector<std::string> m_tags;
+	// number of materials
+	int m_count;
+	// entries reserved in each hot array
+	int m_capacity;
+	// GPU copy of the hot block
+	GLuint m_bufferID;
+	// bytes allocated for the GPU buffer
+	size_t m_bufferSize;
+
+	// move the hot arrays apart to make room for more entries
+	void Grow(int capacity);
+};
@@ -0,0 +1,373 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.cpp
+// ============
+// generated meshes kept on disk as packed binary files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static_assert(sizeof(PACKED_VERTEX) == 20, "PACKED_VERTEX must match the vertex attribute layout");
+static_assert(sizeof(COMPACT_VERTEX) == 16, "COMPACT_VERTEX must match the vertex attribute layout");
+
+// declaration of global variables
+namespace
+{
+	// "MESH" read as a little endian integer
+	const unsigned int MESH_FILE_MAGIC = 0x4853454D;
+	// bump whenever the generator or the packing changes, so old
+	// files are built again
+	const unsigned int MESH_FILE_VERSION = 3;
+	// sort the triangle clusters of the cached meshes for overdraw
+	const bool OPTIMIZE_OVERDRAW = true;
+
+	/***********************************************************
+	 *  PackSigned()
+	 *
+	 *  Convert a value in -1..1 to a snorm16.
+	 ***********************************************************/
+	short PackSigned(float value)
+	{
+		value = std::min(std::max(value, -1.0f), 1.0f);
+		return((short)lroundf(value * 32767.0f));
+	}
+
+	/***********************************************************
+	 *  PackUnsigned()
+	 *
+	 *  Convert a value in 0..1 to a unorm16.
+	 ***********************************************************/
+	unsigned short PackUnsigned(float value)
+	{
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		return((unsigned short)lroundf(value * 65535.0f));
+	}
+
+	/***********************************************************
+	 *  EncodeOctahedral()
+	 *
+	 *  Project a unit normal onto the octahedron |x|+|y|+|z| = 1
+	 *  and unfold the lower half over the corners, giving a point
+	 *  in -1..1 on both axes.  The vertex shader reverses it.
+	 ***********************************************************/
+	glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+	{
+		float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+		if (length <= 0.0f)
+		{
+			return(glm::vec2(0.0f));
+		}
+
+		glm::vec2 folded = glm::vec2(normal.x, normal.y) / length;
+		if (normal.z < 0.0f)
+		{
+			glm::vec2 mirrored = glm::vec2(1.0f - fabsf(folded.y), 1.0f - fabsf(folded.x));
+			folded.x = (folded.x >= 0.0f) ? mirrored.x : -mirrored.x;
+			folded.y = (folded.y >= 0.0f) ? mirrored.y : -mirrored.y;
+		}
+		return(folded);
+	}
+}
+
+/***********************************************************
+ *  MeshCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshCache::MeshCache(const char* directory)
+{
+	m_directory = directory;
+}
+
+/***********************************************************
+ *  ~MeshCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshCache::~MeshCache()
+{
+	CloseMesh();
+}
+
+/***********************************************************
+ *  OpenMesh()
+ *
+ *  This method is used to get the packed mesh for a key from
+ *  its cache file.  On a miss the mesh is generated, reordered
+ *  for the vertex caches, packed and written, and is served
+ *  from memory when the file cannot be written.
+ ***********************************************************/
+bool MeshCache::OpenMesh(const MESH_KEY& key, VERTEX_FORMAT format, MESH_VIEW* pView)
+{
+	CloseMesh();
+
+	std::string filename = GetFilename(key, format);
+	if (m_file.Open(filename.c_str()))
+	{
+		if (ReadImage(m_file.GetData(), m_file.GetSize(), key, format, pView))
+		{
+			return true;
+		}
+		m_file.Close();
+	}
+
+	MESH_DATA mesh;
+	if (!GenerateMesh(key, &mesh))
+	{
+		std::cout << "Could not generate the " << GetPrimitiveName(key.primitive) << " mesh" << std::endl;
+		return false;
+	}
+
+	// the generator emits triangles in the order of its loops, the
+	// optimized order is worked out here once and kept in the file
+	VERTEX_CACHE_STATS before = AnalyzeVertexCache(mesh);
+	OptimizeVertexCache(&mesh, OPTIMIZE_OVERDRAW);
+	OptimizeVertexFetch(&mesh);
+	VERTEX_CACHE_STATS after = AnalyzeVertexCache(mesh);
+	std::cout << "Optimized the " << GetPrimitiveName(key.primitive) << " mesh: ACMR " << before.acmr << " -> " <<
+		after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+
+	if (!PackMesh(key, mesh, format, &m_image))
+	{
+		std::cout << "Could not pack the " << GetPrimitiveName(key.primitive) << " mesh" << std::endl;
+		return false;
+	}
+
+#ifdef _WIN32
+	_mkdir(m_directory.c_str());
+#else
+	mkdir(m_directory.c_str(), 0755);
+#endif
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL != pFile)
+	{
+		size_t written = fwrite(m_image.data(), 1, m_image.size(), pFile);
+		fclose(pFile);
+		if (written != m_image.size())
+		{
+			remove(filename.c_str());
+		}
+	}
+	else
+	{
+		std::cout << "Could not write the mesh cache file " << filename << std::endl;
+	}
+
+	return(ReadImage(m_image.data(), m_image.size(), key, format, pView));
+}
+
+/***********************************************************
+ *  CloseMesh()
+ *
+ *  This method is used to release the mapped file or the
+ *  image of the last opened mesh.
+ ***********************************************************/
+void MeshCache::CloseMesh()
+{
+	m_file.Close();
+	m_image.clear();
+	m_image.shrink_to_fit();
+}
+
+/***********************************************************
+ *  PackMesh()
+ *
+ *  This method is used to build the file image of a mesh.
+ *  Positions are stored relative to the center of the mesh
+ *  bounds, scaled so the bounds fill the snorm16 range.  The
+ *  compact format also folds the normals to two components
+ *  and stores the texture coordinates as half floats.
+ ***********************************************************/
+bool MeshCache::PackMesh(const MESH_KEY& key, const MESH_DATA& mesh, VERTEX_FORMAT format,
+	std::vector<unsigned char>* pImage)
+{
+	if ((NULL == pImage) || mesh.vertices.empty() || mesh.indices.empty() || (0 == GetVertexSize(format)))
+	{
+		return false;
+	}
+
+	glm::vec3 boundsMin = mesh.vertices[0].position;
+	glm::vec3 boundsMax = boundsMin;
+	for (size_t i = 1; i < mesh.vertices.size(); i++)
+	{
+		boundsMin = glm::min(boundsMin, mesh.vertices[i].position);
+		boundsMax = glm::max(boundsMax, mesh.vertices[i].position);
+	}
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+	// a flat axis packs to zero whatever its scale
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (extent[axis] <= 0.0f)
+		{
+			extent[axis] = 1.0f;
+		}
+	}
+
+	MESH_FILE_HEADER header;
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.key = key;
+	header.vertexFormat = format;
+	header.vertexCount = (unsigned int)mesh.vertices.size();
+	header.indexCount = (unsigned int)mesh.indices.size();
+	header.indexSize = (mesh.vertices.size() <= 65536) ? 2 : 4;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		header.boundsCenter[axis] = center[axis];
+		header.boundsExtent[axis] = extent[axis];
+	}
+
+	size_t vertexBytes = GetVertexSize(format) * header.vertexCount;
+	size_t indexBytes = (size_t)header.indexSize * header.indexCount;
+	pImage->resize(sizeof(MESH_FILE_HEADER) + vertexBytes + indexBytes);
+	unsigned char* pData = pImage->data();
+	memcpy(pData, &header, sizeof(MESH_FILE_HEADER));
+
+	if (VERTEX_FORMAT_COMPACT == format)
+	{
+		COMPACT_VERTEX* pVertices = (COMPACT_VERTEX*)(pData + sizeof(MESH_FILE_HEADER));
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			const MESH_VERTEX& vertex = mesh.vertices[i];
+			glm::vec3 position = (vertex.position - center) / extent;
+			glm::vec2 normal = EncodeOctahedral(vertex.normal);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				pVertices[i].position[axis] = PackSigned(position[axis]);
+			}
+			pVertices[i].position[3] = 0;
+			pVertices[i].normal[0] = PackSigned(normal.x);
+			pVertices[i].normal[1] = PackSigned(normal.y);
+			pVertices[i].uv[0] = (unsigned short)glm::packHalf1x16(vertex.uv.x);
+			pVertices[i].uv[1] = (unsigned short)glm::packHalf1x16(vertex.uv.y);
+		}
+	}
+	else
+	{
+		// the unorm16 uv clamps, a tiling mesh has to use the
+		// compact format
+		bool bClampedUV = false;
+		PACKED_VERTEX* pVertices = (PACKED_VERTEX*)(pData + sizeof(MESH_FILE_HEADER));
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			const MESH_VERTEX& vertex = mesh.vertices[i];
+			glm::vec3 position = (vertex.position - center) / extent;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				pVertices[i].position[axis] = PackSigned(position[axis]);
+				pVertices[i].normal[axis] = PackSigned(vertex.normal[axis]);
+			}
+			pVertices[i].position[3] = 0;
+			pVertices[i].normal[3] = 0;
+			pVertices[i].uv[0] = PackUnsigned(vertex.uv.x);
+			pVertices[i].uv[1] = PackUnsigned(vertex.uv.y);
+			bClampedUV = bClampedUV || (vertex.uv.x < 0.0f) || (vertex.uv.x > 1.0f) ||
+				(vertex.uv.y < 0.0f) || (vertex.uv.y > 1.0f);
+		}
+		if (bClampedUV)
+		{
+			std::cout << "WARNING: Texture coordinates outside 0..1 were clamped by the packed vertex format" << std::endl;
+		}
+	}
+
+	unsigned char* pIndices = pData + sizeof(MESH_FILE_HEADER) + vertexBytes;
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		if (2 == header.indexSize)
+		{
+			((unsigned short*)pIndices)[i] = (unsigned short)mesh.indices[i];
+		}
+		else
+		{
+			((unsigned int*)pIndices)[i] = mesh.indices[i];
+		}
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  ReadImage()
+ *
+ *  This method is used to check a file image and point the
+ *  view at its parts.  Files of another version, another key,
+ *  another vertex format or with missing data are rejected.
+ ***********************************************************/
+bool MeshCache::ReadImage(const unsigned char* pData, size_t size, const MESH_KEY& key, VERTEX_FORMAT format,
+	MESH_VIEW* pView)
+{
+	if ((NULL == pData) || (size < sizeof(MESH_FILE_HEADER)))
+	{
+		return false;
+	}
+
+	const MESH_FILE_HEADER* pHeader = (const MESH_FILE_HEADER*)pData;
+	if ((MESH_FILE_MAGIC != pHeader->magic) || (MESH_FILE_VERSION != pHeader->version) ||
+		(key.primitive != pHeader->key.primitive) || (key.segments != pHeader->key.segments) ||
+		(key.rings != pHeader->key.rings) || ((unsigned int)format != pHeader->vertexFormat) ||
+		((2 != pHeader->indexSize) && (4 != pHeader->indexSize)))
+	{
+		return false;
+	}
+
+	size_t vertexBytes = GetVertexSize(format) * (size_t)pHeader->vertexCount;
+	size_t indexBytes = (size_t)pHeader->indexSize * pHeader->indexCount;
+	if ((0 == vertexBytes) || (size != (sizeof(MESH_FILE_HEADER) + vertexBytes + indexBytes)))
+	{
+		return false;
+	}
+
+	pView->pHeader = pHeader;
+	pView->pVertices = pData + sizeof(MESH_FILE_HEADER);
+	pView->pIndices = pData + sizeof(MESH_FILE_HEADER) + vertexBytes;
+	return true;
+}
+
+/***********************************************************
+ *  GetVertexSize()
+ *
+ *  This method is used to get the bytes per vertex of a
+ *  vertex format, 0 for an unknown format.
+ ***********************************************************/
+size_t MeshCache::GetVertexSize(VERTEX_FORMAT format)
+{
+	switch (format)
+	{
+	case VERTEX_FORMAT_PACKED:
+		return(sizeof(PACKED_VERTEX));
+	case VERTEX_FORMAT_COMPACT:
+		return(sizeof(COMPACT_VERTEX));
+	default:
+		return(0);
+	}
+}
+
+/***********************************************************
+ *  GetFilename()
+ *
+ *  This method is used to build the cache file path of a key,
+ *  such as MeshCache/sphere_48x24.mesh, the compact format
+ *  is kept next to it as sphere_48x24_compact.mesh.
+ ***********************************************************/
+std::string MeshCache::GetFilename(const MESH_KEY& key, VERTEX_FORMAT format) const
+{
+	char filename[64];
+	snprintf(filename, sizeof(filename), "/%s_%dx%d%s.mesh", GetPrimitiveName(key.primitive), key.segments, key.rings,
+		(VERTEX_FORMAT_COMPACT == format) ? "_compact" : "");
+	return(m_directory + filename);
+}
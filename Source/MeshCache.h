@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.h
+// ============
+// generated meshes kept on disk as packed binary files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include "MeshGenerator.h"
+
+#include <string>
+#include <vector>
+
+// vertex layouts the cache can store a mesh in
+enum VERTEX_FORMAT
+{
+	// snorm16 position and normal, unorm16 uv limited to 0..1
+	VERTEX_FORMAT_PACKED,
+	// snorm16 position, octahedral normal, half float uv
+	VERTEX_FORMAT_COMPACT,
+	VERTEX_FORMAT_COUNT
+};
+
+// one vertex as stored in the cache files and in the GPU vertex
+// buffers, read by the shaders through normalized attributes
+struct PACKED_VERTEX
+{
+	// position scaled into the mesh bounds, snorm16, w unused
+	short position[4];
+	// unit normal, snorm16, w unused
+	short normal[4];
+	// texture coordinate, unorm16
+	unsigned short uv[2];
+};
+
+// smaller vertex of the compact format, the vertex shader turns
+// the octahedral normal back into a unit vector
+struct COMPACT_VERTEX
+{
+	// position scaled into the mesh bounds, snorm16, w unused so
+	// the following attributes stay four byte aligned
+	short position[4];
+	// unit normal folded onto the octahedron, snorm16
+	short normal[2];
+	// texture coordinate, half float
+	unsigned short uv[2];
+};
+
+// start of every cache file, the vertices follow it and the
+// indices follow the vertices
+struct MESH_FILE_HEADER
+{
+	unsigned int magic;
+	unsigned int version;
+	MESH_KEY key;
+	// VERTEX_FORMAT of the stored vertices
+	unsigned int vertexFormat;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	// bytes per index, 2 or 4
+	unsigned int indexSize;
+	// object space position = center + extent * packed position
+	float boundsCenter[3];
+	float boundsExtent[3];
+};
+
+// a packed mesh, pointing into a mapped cache file or into memory
+struct MESH_VIEW
+{
+	const MESH_FILE_HEADER* pHeader;
+	// PACKED_VERTEX or COMPACT_VERTEX array, as the header says
+	const void* pVertices;
+	const void* pIndices;
+};
+
+/***********************************************************
+ *  MeshCache
+ *
+ *  Every mesh key has its own file in the cache directory.
+ *  A missing or stale file is generated, packed and written
+ *  once, later runs map the file and hand its contents to the
+ *  GPU as they are.
+ ***********************************************************/
+class MeshCache
+{
+public:
+	// constructor
+	MeshCache(const char* directory);
+	// destructor
+	~MeshCache();
+
+	// get the packed mesh for a key, it stays valid until the
+	// next OpenMesh() or CloseMesh()
+	bool OpenMesh(const MESH_KEY& key, VERTEX_FORMAT format, MESH_VIEW* pView);
+	// release the data of the last opened mesh
+	void CloseMesh();
+
+	// build the file image of a mesh
+	static bool PackMesh(const MESH_KEY& key, const MESH_DATA& mesh, VERTEX_FORMAT format,
+		std::vector<unsigned char>* pImage);
+	// point a view into a file image, false when it does not hold
+	// a complete mesh for the key in the format
+	static bool ReadImage(const unsigned char* pData, size_t size, const MESH_KEY& key, VERTEX_FORMAT format,
+		MESH_VIEW* pView);
+	// bytes per vertex of a format
+	static size_t GetVertexSize(VERTEX_FORMAT format);
+
+private:
+	// folder holding the cache files
+	std::string m_directory;
+	// mapping of the opened cache file
+	MappedFile m_file;
+	// image of a mesh that could not be written to the cache
+	std::vector<unsigned char> m_image;
+
+	// path of the cache file for a key
+	std::string GetFilename(const MESH_KEY& key, VERTEX_FORMAT format) const;
+};
@@ -0,0 +1,364 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgenerator.cpp
+// ============
+// build the vertices and triangles of the basic shapes from their tessellation
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshGenerator.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// names of the primitives in MESH_PRIMITIVE order
+	const char* PRIMITIVE_NAMES[PRIMITIVE_COUNT] =
+	{
+		"plane", "box", "sphere", "torus", "halftorus", "taperedcylinder"
+	};
+
+	// torus ring and tube radii
+	const float TORUS_RADIUS = 1.0f;
+	const float TORUS_TUBE_RADIUS = 0.1f;
+	// tapered cylinder radii at the bottom and the top
+	const float TAPER_BOTTOM_RADIUS = 1.0f;
+	const float TAPER_TOP_RADIUS = 0.5f;
+
+	/***********************************************************
+	 *  AddVertex()
+	 *
+	 *  Append a vertex and return its index.
+	 ***********************************************************/
+	unsigned int AddVertex(MESH_DATA* pMesh, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+	{
+		MESH_VERTEX vertex;
+		vertex.position = position;
+		vertex.normal = normal;
+		vertex.uv = uv;
+		pMesh->vertices.push_back(vertex);
+		return((unsigned int)pMesh->vertices.size() - 1);
+	}
+
+	/***********************************************************
+	 *  AddGrid()
+	 *
+	 *  Append the two triangles of every cell of a grid of
+	 *  vertices stored row after row, starting at firstVertex.
+	 *  The corners a, b, c and d of a cell go counter clockwise
+	 *  seen from the front.
+	 ***********************************************************/
+	void AddGrid(MESH_DATA* pMesh, unsigned int firstVertex, int columns, int rows)
+	{
+		unsigned int rowLength = (unsigned int)columns + 1;
+		for (int row = 0; row < rows; row++)
+		{
+			for (int column = 0; column < columns; column++)
+			{
+				unsigned int a = firstVertex + (row * rowLength) + column;
+				unsigned int b = a + 1;
+				unsigned int c = a + rowLength + 1;
+				unsigned int d = a + rowLength;
+				pMesh->indices.push_back(a);
+				pMesh->indices.push_back(b);
+				pMesh->indices.push_back(c);
+				pMesh->indices.push_back(a);
+				pMesh->indices.push_back(c);
+				pMesh->indices.push_back(d);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  AddQuadFace()
+	 *
+	 *  Append a tessellated square face of the box.  The u and
+	 *  v axes are picked so that u x v is the face normal.
+	 ***********************************************************/
+	void AddQuadFace(MESH_DATA* pMesh, const glm::vec3& normal, const glm::vec3& uAxis, const glm::vec3& vAxis, int divisions)
+	{
+		unsigned int firstVertex = (unsigned int)pMesh->vertices.size();
+		for (int row = 0; row <= divisions; row++)
+		{
+			float v = (float)row / divisions;
+			for (int column = 0; column <= divisions; column++)
+			{
+				float u = (float)column / divisions;
+				glm::vec3 position = (normal * 0.5f) + (uAxis * (u - 0.5f)) + (vAxis * (v - 0.5f));
+				AddVertex(pMesh, position, normal, glm::vec2(u, v));
+			}
+		}
+		AddGrid(pMesh, firstVertex, divisions, divisions);
+	}
+
+	/***********************************************************
+	 *  GeneratePlane()
+	 ***********************************************************/
+	void GeneratePlane(MESH_DATA* pMesh, int columns, int rows)
+	{
+		for (int row = 0; row <= rows; row++)
+		{
+			float v = (float)row / rows;
+			for (int column = 0; column <= columns; column++)
+			{
+				float u = (float)column / columns;
+				AddVertex(pMesh, glm::vec3((u * 2.0f) - 1.0f, 0.0f, 1.0f - (v * 2.0f)),
+					glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(u, v));
+			}
+		}
+		AddGrid(pMesh, 0, columns, rows);
+	}
+
+	/***********************************************************
+	 *  GenerateBox()
+	 ***********************************************************/
+	void GenerateBox(MESH_DATA* pMesh, int divisions)
+	{
+		AddQuadFace(pMesh, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), divisions);
+		AddQuadFace(pMesh, glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f), divisions);
+		AddQuadFace(pMesh, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), divisions);
+		AddQuadFace(pMesh, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), divisions);
+		AddQuadFace(pMesh, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), divisions);
+		AddQuadFace(pMesh, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), divisions);
+	}
+
+	/***********************************************************
+	 *  GenerateSphere()
+	 *
+	 *  Rings of latitude from the top pole down.  The cells at
+	 *  the poles only keep their one non degenerate triangle.
+	 ***********************************************************/
+	void GenerateSphere(MESH_DATA* pMesh, int segments, int rings)
+	{
+		for (int ring = 0; ring <= rings; ring++)
+		{
+			float phi = glm::pi<float>() * ring / rings;
+			for (int segment = 0; segment <= segments; segment++)
+			{
+				float theta = glm::two_pi<float>() * segment / segments;
+				glm::vec3 normal(sinf(phi) * sinf(theta), cosf(phi), sinf(phi) * cosf(theta));
+				AddVertex(pMesh, normal, normal, glm::vec2((float)segment / segments, 1.0f - ((float)ring / rings)));
+			}
+		}
+
+		unsigned int rowLength = (unsigned int)segments + 1;
+		for (int ring = 0; ring < rings; ring++)
+		{
+			for (int segment = 0; segment < segments; segment++)
+			{
+				unsigned int a = (ring * rowLength) + segment;
+				unsigned int b = a + rowLength;
+				unsigned int c = b + 1;
+				unsigned int d = a + 1;
+				if (ring > 0)
+				{
+					pMesh->indices.push_back(a);
+					pMesh->indices.push_back(b);
+					pMesh->indices.push_back(d);
+				}
+				if (ring < (rings - 1))
+				{
+					pMesh->indices.push_back(d);
+					pMesh->indices.push_back(b);
+					pMesh->indices.push_back(c);
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  GenerateTorus()
+	 *
+	 *  The ring lies in the XY plane, sweepAngle is the part of
+	 *  the ring that is built.
+	 ***********************************************************/
+	void GenerateTorus(MESH_DATA* pMesh, int segments, int rings, float sweepAngle)
+	{
+		for (int segment = 0; segment <= segments; segment++)
+		{
+			float mainAngle = sweepAngle * segment / segments;
+			glm::vec3 outward(cosf(mainAngle), sinf(mainAngle), 0.0f);
+			for (int ring = 0; ring <= rings; ring++)
+			{
+				float tubeAngle = glm::two_pi<float>() * ring / rings;
+				glm::vec3 normal = (outward * cosf(tubeAngle)) + glm::vec3(0.0f, 0.0f, sinf(tubeAngle));
+				glm::vec3 position = (outward * TORUS_RADIUS) + (normal * TORUS_TUBE_RADIUS);
+				AddVertex(pMesh, position, normal, glm::vec2((float)segment / segments, (float)ring / rings));
+			}
+		}
+
+		// the rows run along the tube, so the cell corners are
+		// taken in the order that keeps the outside facing out
+		unsigned int rowLength = (unsigned int)rings + 1;
+		for (int segment = 0; segment < segments; segment++)
+		{
+			for (int ring = 0; ring < rings; ring++)
+			{
+				unsigned int a = (segment * rowLength) + ring;
+				unsigned int b = a + rowLength;
+				unsigned int c = b + 1;
+				unsigned int d = a + 1;
+				pMesh->indices.push_back(a);
+				pMesh->indices.push_back(b);
+				pMesh->indices.push_back(c);
+				pMesh->indices.push_back(a);
+				pMesh->indices.push_back(c);
+				pMesh->indices.push_back(d);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  GenerateTaperedCylinder()
+	 *
+	 *  The side is split into rings along the height, the caps
+	 *  are fans around their centers.
+	 ***********************************************************/
+	void GenerateTaperedCylinder(MESH_DATA* pMesh, int segments, int rings)
+	{
+		// the side normal leans up by the change of radius over the height
+		float slope = TAPER_BOTTOM_RADIUS - TAPER_TOP_RADIUS;
+		for (int ring = 0; ring <= rings; ring++)
+		{
+			float height = (float)ring / rings;
+			float radius = TAPER_BOTTOM_RADIUS + ((TAPER_TOP_RADIUS - TAPER_BOTTOM_RADIUS) * height);
+			for (int segment = 0; segment <= segments; segment++)
+			{
+				float theta = glm::two_pi<float>() * segment / segments;
+				glm::vec3 direction(sinf(theta), 0.0f, cosf(theta));
+				AddVertex(pMesh, (direction * radius) + glm::vec3(0.0f, height, 0.0f),
+					glm::normalize(direction + glm::vec3(0.0f, slope, 0.0f)),
+					glm::vec2((float)segment / segments, height));
+			}
+		}
+		AddGrid(pMesh, 0, segments, rings);
+
+		for (int cap = 0; cap < 2; cap++)
+		{
+			float height = (cap == 0) ? 0.0f : 1.0f;
+			float radius = (cap == 0) ? TAPER_BOTTOM_RADIUS : TAPER_TOP_RADIUS;
+			glm::vec3 normal(0.0f, (cap == 0) ? -1.0f : 1.0f, 0.0f);
+
+			unsigned int center = AddVertex(pMesh, glm::vec3(0.0f, height, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+			for (int segment = 0; segment <= segments; segment++)
+			{
+				float theta = glm::two_pi<float>() * segment / segments;
+				glm::vec3 direction(sinf(theta), 0.0f, cosf(theta));
+				AddVertex(pMesh, (direction * radius) + glm::vec3(0.0f, height, 0.0f), normal,
+					glm::vec2(0.5f + (direction.x * 0.5f), 0.5f + (direction.z * 0.5f)));
+			}
+			for (int segment = 0; segment < segments; segment++)
+			{
+				unsigned int rim = center + 1 + segment;
+				pMesh->indices.push_back(center);
+				pMesh->indices.push_back((cap == 0) ? (rim + 1) : rim);
+				pMesh->indices.push_back((cap == 0) ? rim : (rim + 1));
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetDefaultMeshKey()
+ *
+ *  Return the tessellation the scene draws a primitive with.
+ ***********************************************************/
+MESH_KEY GetDefaultMeshKey(MESH_PRIMITIVE primitive)
+{
+	MESH_KEY key;
+	key.primitive = primitive;
+	key.segments = 1;
+	key.rings = 1;
+
+	switch (primitive)
+	{
+	case PRIMITIVE_SPHERE:
+		key.segments = 48;
+		key.rings = 24;
+		break;
+	case PRIMITIVE_TORUS:
+		key.segments = 30;
+		key.rings = 30;
+		break;
+	case PRIMITIVE_HALF_TORUS:
+		key.segments = 15;
+		key.rings = 30;
+		break;
+	case PRIMITIVE_TAPERED_CYLINDER:
+		key.segments = 36;
+		key.rings = 1;
+		break;
+	default:
+		break;
+	}
+
+	return(key);
+}
+
+/***********************************************************
+ *  GetPrimitiveName()
+ ***********************************************************/
+const char* GetPrimitiveName(int primitive)
+{
+	if ((primitive < 0) || (primitive >= PRIMITIVE_COUNT))
+	{
+		return("unknown");
+	}
+	return(PRIMITIVE_NAMES[primitive]);
+}
+
+/***********************************************************
+ *  GenerateMesh()
+ *
+ *  Build the triangle list of a primitive with the passed in
+ *  tessellation.  All shapes wind counter clockwise seen from
+ *  the outside.
+ ***********************************************************/
+bool GenerateMesh(const MESH_KEY& key, MESH_DATA* pMesh)
+{
+	if ((NULL == pMesh) || (key.segments < 1) || (key.rings < 1))
+	{
+		return false;
+	}
+
+	pMesh->vertices.clear();
+	pMesh->indices.clear();
+
+	switch (key.primitive)
+	{
+	case PRIMITIVE_PLANE:
+		GeneratePlane(pMesh, key.segments, key.rings);
+		break;
+	case PRIMITIVE_BOX:
+		GenerateBox(pMesh, key.segments);
+		break;
+	case PRIMITIVE_SPHERE:
+		if ((key.segments < 3) || (key.rings < 2))
+		{
+			return false;
+		}
+		GenerateSphere(pMesh, key.segments, key.rings);
+		break;
+	case PRIMITIVE_TORUS:
+	case PRIMITIVE_HALF_TORUS:
+		if ((key.segments < 3) || (key.rings < 3))
+		{
+			return false;
+		}
+		GenerateTorus(pMesh, key.segments, key.rings,
+			(PRIMITIVE_TORUS == key.primitive) ? glm::two_pi<float>() : glm::pi<float>());
+		break;
+	case PRIMITIVE_TAPERED_CYLINDER:
+		if (key.segments < 3)
+		{
+			return false;
+		}
+		GenerateTaperedCylinder(pMesh, key.segments, key.rings);
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
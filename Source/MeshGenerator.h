@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgenerator.h
+// ============
+// build the vertices and triangles of the basic shapes from their tessellation
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// shapes the generator can build, the sizes match the shapes the
+// scene was laid out with
+enum MESH_PRIMITIVE
+{
+	// 2 x 2 square in the XZ plane facing up
+	PRIMITIVE_PLANE,
+	// unit cube around the origin
+	PRIMITIVE_BOX,
+	// sphere of radius 1
+	PRIMITIVE_SPHERE,
+	// ring of radius 1 around the Z axis with a 0.1 thick tube
+	PRIMITIVE_TORUS,
+	// upper half of the torus
+	PRIMITIVE_HALF_TORUS,
+	// cylinder from radius 1 at y = 0 to radius 0.5 at y = 1, capped
+	PRIMITIVE_TAPERED_CYLINDER,
+	PRIMITIVE_COUNT
+};
+
+// a primitive and its tessellation, every distinct key is a
+// distinct mesh
+struct MESH_KEY
+{
+	int primitive;
+	// divisions around the shape, or along X for the plane
+	int segments;
+	// divisions across the shape, or along Z for the plane
+	int rings;
+};
+
+// one vertex as generated, before any packing
+struct MESH_VERTEX
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+};
+
+// triangle list of a generated mesh
+struct MESH_DATA
+{
+	std::vector<MESH_VERTEX> vertices;
+	std::vector<unsigned int> indices;
+};
+
+// the tessellation the scene uses for a primitive
+MESH_KEY GetDefaultMeshKey(MESH_PRIMITIVE primitive);
+// short lower case name of a primitive, used for file names
+const char* GetPrimitiveName(int primitive);
+// build the mesh for a key, false when the key is not valid
+bool GenerateMesh(const MESH_KEY& key, MESH_DATA* pMesh);
@@ -0,0 +1,1339 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.cpp
+// ============
+// read triangle meshes from OBJ and binary glTF files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshImporter.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// smallest part of an OBJ file handed to one task
+	const size_t MIN_OBJ_CHUNK_SIZE = 1024 * 1024;
+	// OBJ parts per pool thread, so parts of uneven cost still
+	// keep every thread busy
+	const int OBJ_CHUNKS_PER_THREAD = 4;
+	// index of an OBJ corner without a uv or normal
+	const int OBJ_MISSING = INT_MIN;
+	// vertices converted by one task
+	const size_t VERTICES_PER_TASK = 65536;
+	// slot of the vertex hash table that holds no vertex
+	const unsigned int EMPTY_SLOT = 0xFFFFFFFF;
+	// mantissa digits beyond this only move the exponent
+	const unsigned long long MAX_MANTISSA = 100000000000000000ULL;
+	// powers of ten that are exact in a double
+	const double POWERS_OF_TEN[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	// "glTF" read as a little endian integer, and the chunk types
+	const unsigned int GLB_MAGIC = 0x46546C67;
+	const unsigned int GLB_CHUNK_JSON = 0x4E4F534A;
+	const unsigned int GLB_CHUNK_BIN = 0x004E4942;
+	// glTF component types
+	const int GLTF_BYTE = 5120;
+	const int GLTF_UNSIGNED_BYTE = 5121;
+	const int GLTF_SHORT = 5122;
+	const int GLTF_UNSIGNED_SHORT = 5123;
+	const int GLTF_UNSIGNED_INT = 5125;
+	const int GLTF_FLOAT = 5126;
+	// glTF primitive mode of a triangle list
+	const int GLTF_TRIANGLES = 4;
+	// deepest nesting accepted in the glTF JSON
+	const int MAX_JSON_DEPTH = 64;
+
+	// one corner of an OBJ face with its position, uv and normal
+	// index, a set bit of relativeMask marks an index that counts
+	// from the start of the corner's chunk
+	struct OBJ_CORNER
+	{
+		int index[3];
+		int relativeMask;
+	};
+
+	// what one task read from its part of an OBJ file
+	struct OBJ_CHUNK
+	{
+		const char* pStart;
+		const char* pEnd;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		// three corners per triangle
+		std::vector<OBJ_CORNER> corners;
+		// attributes read by the chunks before this one
+		int firstIndex[3];
+		bool bValid;
+	};
+
+	enum JSON_TYPE
+	{
+		JSON_NULL,
+		JSON_FALSE,
+		JSON_TRUE,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// one value of a JSON document, arrays and objects refer to
+	// their children by node index
+	struct JSON_NODE
+	{
+		JSON_TYPE type;
+		double number;
+		std::string text;
+		std::vector<int> children;
+		// key of each child of an object
+		std::vector<std::string> keys;
+	};
+
+	// the parts of a binary glTF file
+	struct GLTF_FILE
+	{
+		std::vector<JSON_NODE> nodes;
+		const unsigned char* pBinary;
+		size_t binarySize;
+	};
+
+	// where the elements of a glTF accessor are in the binary chunk
+	struct GLTF_ACCESSOR
+	{
+		const unsigned char* pData;
+		size_t count;
+		size_t stride;
+		int componentType;
+		int componentSize;
+		int components;
+		bool bNormalized;
+	};
+
+	// a triangle primitive of a glTF mesh and its place in the
+	// merged mesh
+	struct GLTF_PRIMITIVE
+	{
+		GLTF_ACCESSOR positions;
+		GLTF_ACCESSOR normals;
+		GLTF_ACCESSOR uvs;
+		GLTF_ACCESSOR indices;
+		bool bNormals;
+		bool bUVs;
+		bool bIndices;
+		size_t firstVertex;
+		size_t firstIndex;
+		size_t indexCount;
+	};
+
+	// a range of vertices or indices of one glTF primitive
+	struct GLTF_TASK
+	{
+		size_t primitive;
+		size_t first;
+		size_t count;
+	};
+
+	/***********************************************************
+	 *  RunTasks()
+	 *
+	 *  Run task(index) for every index on the pool, or on the
+	 *  calling thread when there is no pool.
+	 ***********************************************************/
+	void RunTasks(ThreadPool* pThreadPool, int taskCount, const std::function<void(int)>& task)
+	{
+		if (NULL != pThreadPool)
+		{
+			pThreadPool->ParallelFor(taskCount, task);
+			return;
+		}
+		for (int i = 0; i < taskCount; i++)
+		{
+			task(i);
+		}
+	}
+
+	/***********************************************************
+	 *  IsSpace()
+	 *
+	 *  Check for a blank that does not end the line.
+	 ***********************************************************/
+	bool IsSpace(char character)
+	{
+		return((' ' == character) || ('\t' == character) || ('\r' == character));
+	}
+
+	/***********************************************************
+	 *  IsDigit()
+	 ***********************************************************/
+	bool IsDigit(char character)
+	{
+		return((character >= '0') && (character <= '9'));
+	}
+
+	/***********************************************************
+	 *  SkipSpaces()
+	 ***********************************************************/
+	void SkipSpaces(const char** ppText, const char* pEnd)
+	{
+		while ((*ppText < pEnd) && IsSpace(**ppText))
+		{
+			(*ppText)++;
+		}
+	}
+
+	/***********************************************************
+	 *  SkipLine()
+	 *
+	 *  Return the start of the next line.
+	 ***********************************************************/
+	const char* SkipLine(const char* pText, const char* pEnd)
+	{
+		const char* pLineEnd = (const char*)memchr(pText, '\n', pEnd - pText);
+		return((NULL != pLineEnd) ? (pLineEnd + 1) : pEnd);
+	}
+
+	/***********************************************************
+	 *  ParseNumber()
+	 *
+	 *  Read a decimal number in place.  The digits are gathered
+	 *  in an integer and scaled once, which is exact for the
+	 *  short numbers mesh files hold.
+	 ***********************************************************/
+	bool ParseNumber(const char** ppText, const char* pEnd, double* pValue)
+	{
+		const char* pText = *ppText;
+		bool bNegative = false;
+		if ((pText < pEnd) && (('-' == *pText) || ('+' == *pText)))
+		{
+			bNegative = ('-' == *pText);
+			pText++;
+		}
+
+		unsigned long long mantissa = 0;
+		int exponent = 0;
+		int digits = 0;
+		while ((pText < pEnd) && IsDigit(*pText))
+		{
+			if (mantissa < MAX_MANTISSA)
+			{
+				mantissa = (mantissa * 10) + (*pText - '0');
+			}
+			else
+			{
+				exponent++;
+			}
+			pText++;
+			digits++;
+		}
+		if ((pText < pEnd) && ('.' == *pText))
+		{
+			pText++;
+			while ((pText < pEnd) && IsDigit(*pText))
+			{
+				if (mantissa < MAX_MANTISSA)
+				{
+					mantissa = (mantissa * 10) + (*pText - '0');
+					exponent--;
+				}
+				pText++;
+				digits++;
+			}
+		}
+		if (0 == digits)
+		{
+			return false;
+		}
+
+		if ((pText < pEnd) && (('e' == *pText) || ('E' == *pText)))
+		{
+			pText++;
+			bool bNegativeExponent = false;
+			if ((pText < pEnd) && (('-' == *pText) || ('+' == *pText)))
+			{
+				bNegativeExponent = ('-' == *pText);
+				pText++;
+			}
+			int value = 0;
+			while ((pText < pEnd) && IsDigit(*pText))
+			{
+				value = std::min((value * 10) + (*pText - '0'), 1000);
+				pText++;
+			}
+			exponent += bNegativeExponent ? -value : value;
+		}
+
+		double value = (double)mantissa;
+		if ((exponent >= 0) && (exponent <= 22))
+		{
+			value *= POWERS_OF_TEN[exponent];
+		}
+		else if ((exponent < 0) && (exponent >= -22))
+		{
+			value /= POWERS_OF_TEN[-exponent];
+		}
+		else
+		{
+			value *= pow(10.0, exponent);
+		}
+
+		*pValue = bNegative ? -value : value;
+		*ppText = pText;
+		return true;
+	}
+
+	/***********************************************************
+	 *  ParseFloats()
+	 *
+	 *  Read a run of blank separated numbers of an OBJ line.
+	 ***********************************************************/
+	bool ParseFloats(const char** ppText, const char* pEnd, int count, float* pValues)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			SkipSpaces(ppText, pEnd);
+			double value = 0.0;
+			if (!ParseNumber(ppText, pEnd, &value))
+			{
+				return false;
+			}
+			pValues[i] = (float)value;
+		}
+		return true;
+	}
+
+	/***********************************************************
+	 *  ParseIndex()
+	 *
+	 *  Read a signed OBJ index in place.
+	 ***********************************************************/
+	bool ParseIndex(const char** ppText, const char* pEnd, int* pValue)
+	{
+		const char* pText = *ppText;
+		bool bNegative = false;
+		if ((pText < pEnd) && ('-' == *pText))
+		{
+			bNegative = true;
+			pText++;
+		}
+		if ((pText >= pEnd) || !IsDigit(*pText))
+		{
+			return false;
+		}
+
+		long long value = 0;
+		while ((pText < pEnd) && IsDigit(*pText))
+		{
+			value = std::min((value * 10) + (*pText - '0'), (long long)INT_MAX);
+			pText++;
+		}
+
+		*pValue = (int)(bNegative ? -value : value);
+		*ppText = pText;
+		return true;
+	}
+
+	/***********************************************************
+	 *  ParseCorner()
+	 *
+	 *  Read a face corner written as v, v/vt, v//vn or v/vt/vn.
+	 *  Negative indices count back from the attributes the
+	 *  chunk has read so far.
+	 ***********************************************************/
+	bool ParseCorner(const char** ppText, const char* pEnd, const OBJ_CHUNK& chunk, OBJ_CORNER* pCorner)
+	{
+		int counts[3] = { (int)chunk.positions.size(), (int)chunk.uvs.size(), (int)chunk.normals.size() };
+		pCorner->relativeMask = 0;
+
+		for (int attribute = 0; attribute < 3; attribute++)
+		{
+			pCorner->index[attribute] = OBJ_MISSING;
+			if (attribute > 0)
+			{
+				if ((*ppText >= pEnd) || ('/' != **ppText))
+				{
+					continue;
+				}
+				(*ppText)++;
+				if ((*ppText >= pEnd) || (!IsDigit(**ppText) && ('-' != **ppText)))
+				{
+					continue;
+				}
+			}
+
+			int value = 0;
+			if (!ParseIndex(ppText, pEnd, &value) || (0 == value))
+			{
+				return false;
+			}
+			if (value > 0)
+			{
+				pCorner->index[attribute] = value - 1;
+			}
+			else
+			{
+				pCorner->index[attribute] = counts[attribute] + value;
+				pCorner->relativeMask |= (1 << attribute);
+			}
+		}
+		return true;
+	}
+
+	/***********************************************************
+	 *  ParseOBJChunk()
+	 *
+	 *  Read the vertices and faces of one part of an OBJ file.
+	 *  Polygons are split into triangle fans as they are read,
+	 *  and everything but v, vt, vn and f lines is skipped.
+	 ***********************************************************/
+	void ParseOBJChunk(OBJ_CHUNK* pChunk)
+	{
+		pChunk->bValid = false;
+		const char* pText = pChunk->pStart;
+		const char* pEnd = pChunk->pEnd;
+
+		while (pText < pEnd)
+		{
+			SkipSpaces(&pText, pEnd);
+			if ((pText + 1 < pEnd) && ('v' == pText[0]))
+			{
+				if (IsSpace(pText[1]))
+				{
+					pText += 2;
+					float values[3];
+					if (!ParseFloats(&pText, pEnd, 3, values))
+					{
+						return;
+					}
+					pChunk->positions.push_back(glm::vec3(values[0], values[1], values[2]));
+				}
+				else if (('t' == pText[1]) && (pText + 2 < pEnd) && IsSpace(pText[2]))
+				{
+					pText += 3;
+					float values[2];
+					if (!ParseFloats(&pText, pEnd, 2, values))
+					{
+						return;
+					}
+					pChunk->uvs.push_back(glm::vec2(values[0], values[1]));
+				}
+				else if (('n' == pText[1]) && (pText + 2 < pEnd) && IsSpace(pText[2]))
+				{
+					pText += 3;
+					float values[3];
+					if (!ParseFloats(&pText, pEnd, 3, values))
+					{
+						return;
+					}
+					pChunk->normals.push_back(glm::vec3(values[0], values[1], values[2]));
+				}
+			}
+			else if ((pText + 1 < pEnd) && ('f' == pText[0]) && IsSpace(pText[1]))
+			{
+				pText += 2;
+				OBJ_CORNER first;
+				OBJ_CORNER previous;
+				int cornerCount = 0;
+				for (;;)
+				{
+					SkipSpaces(&pText, pEnd);
+					if ((pText >= pEnd) || ('\n' == *pText) || ('#' == *pText))
+					{
+						break;
+					}
+
+					OBJ_CORNER corner;
+					if (!ParseCorner(&pText, pEnd, *pChunk, &corner))
+					{
+						return;
+					}
+					if (0 == cornerCount)
+					{
+						first = corner;
+					}
+					else if (cornerCount >= 2)
+					{
+						pChunk->corners.push_back(first);
+						pChunk->corners.push_back(previous);
+						pChunk->corners.push_back(corner);
+					}
+					previous = corner;
+					cornerCount++;
+				}
+			}
+
+			pText = SkipLine(pText, pEnd);
+		}
+
+		pChunk->bValid = true;
+	}
+
+	/***********************************************************
+	 *  ResolveOBJChunk()
+	 *
+	 *  Turn the indices of a chunk's corners into indices of the
+	 *  whole file, false when one is out of range.
+	 ***********************************************************/
+	bool ResolveOBJChunk(OBJ_CHUNK* pChunk, const int totals[3])
+	{
+		for (size_t i = 0; i < pChunk->corners.size(); i++)
+		{
+			OBJ_CORNER& corner = pChunk->corners[i];
+			for (int attribute = 0; attribute < 3; attribute++)
+			{
+				if (OBJ_MISSING == corner.index[attribute])
+				{
+					continue;
+				}
+				if (corner.relativeMask & (1 << attribute))
+				{
+					corner.index[attribute] += pChunk->firstIndex[attribute];
+				}
+				if ((corner.index[attribute] < 0) || (corner.index[attribute] >= totals[attribute]))
+				{
+					return false;
+				}
+			}
+			corner.relativeMask = 0;
+		}
+		return true;
+	}
+
+	/***********************************************************
+	 *  HashCorner()
+	 ***********************************************************/
+	size_t HashCorner(const OBJ_CORNER& corner)
+	{
+		unsigned long long hash = (unsigned int)corner.index[0];
+		hash = (hash * 0x9E3779B97F4A7C15ULL) ^ (unsigned int)corner.index[1];
+		hash = (hash * 0x9E3779B97F4A7C15ULL) ^ (unsigned int)corner.index[2];
+		hash ^= hash >> 29;
+		hash *= 0xBF58476D1CE4E5B9ULL;
+		hash ^= hash >> 32;
+		return((size_t)hash);
+	}
+
+	/***********************************************************
+	 *  GenerateMissingNormals()
+	 *
+	 *  Give the flagged vertices the area weighted sum of the
+	 *  normals of the triangles around them.
+	 ***********************************************************/
+	void GenerateMissingNormals(MESH_DATA* pMesh, const std::vector<unsigned char>& missingNormals)
+	{
+		for (size_t i = 0; i < missingNormals.size(); i++)
+		{
+			if (missingNormals[i])
+			{
+				pMesh->vertices[i].normal = glm::vec3(0.0f);
+			}
+		}
+
+		for (size_t i = 0; i + 2 < pMesh->indices.size(); i += 3)
+		{
+			const unsigned int* pTriangle = &pMesh->indices[i];
+			glm::vec3 a = pMesh->vertices[pTriangle[0]].position;
+			glm::vec3 faceNormal = glm::cross(pMesh->vertices[pTriangle[1]].position - a,
+				pMesh->vertices[pTriangle[2]].position - a);
+			for (int corner = 0; corner < 3; corner++)
+			{
+				if (missingNormals[pTriangle[corner]])
+				{
+					pMesh->vertices[pTriangle[corner]].normal += faceNormal;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < missingNormals.size(); i++)
+		{
+			if (missingNormals[i])
+			{
+				glm::vec3& normal = pMesh->vertices[i].normal;
+				normal = (glm::length(normal) > 0.0f) ? glm::normalize(normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  ReadUInt()
+	 *
+	 *  Read a little endian 32 bit value of a glTF file.
+	 ***********************************************************/
+	unsigned int ReadUInt(const unsigned char* pData)
+	{
+		return((unsigned int)pData[0] | ((unsigned int)pData[1] << 8) | ((unsigned int)pData[2] << 16) |
+			((unsigned int)pData[3] << 24));
+	}
+
+	/***********************************************************
+	 *  SkipJSONSpaces()
+	 ***********************************************************/
+	void SkipJSONSpaces(const char** ppText, const char* pEnd)
+	{
+		while ((*ppText < pEnd) && (IsSpace(**ppText) || ('\n' == **ppText)))
+		{
+			(*ppText)++;
+		}
+	}
+
+	/***********************************************************
+	 *  ParseJSONString()
+	 *
+	 *  Read a quoted JSON string.  glTF keys and names of the
+	 *  fields read here are plain ASCII, so \u escapes only need
+	 *  to be skipped.
+	 ***********************************************************/
+	bool ParseJSONString(const char** ppText, const char* pEnd, std::string* pText)
+	{
+		const char* pCursor = *ppText;
+		if ((pCursor >= pEnd) || ('"' != *pCursor))
+		{
+			return false;
+		}
+		pCursor++;
+
+		pText->clear();
+		while ((pCursor < pEnd) && ('"' != *pCursor))
+		{
+			if ('\\' != *pCursor)
+			{
+				pText->push_back(*pCursor++);
+				continue;
+			}
+			if (++pCursor >= pEnd)
+			{
+				return false;
+			}
+			switch (*pCursor)
+			{
+			case 'b': pText->push_back('\b'); break;
+			case 'f': pText->push_back('\f'); break;
+			case 'n': pText->push_back('\n'); break;
+			case 'r': pText->push_back('\r'); break;
+			case 't': pText->push_back('\t'); break;
+			case 'u':
+				if (pEnd - pCursor < 5)
+				{
+					return false;
+				}
+				pText->push_back('?');
+				pCursor += 4;
+				break;
+			default: pText->push_back(*pCursor); break;
+			}
+			pCursor++;
+		}
+		if (pCursor >= pEnd)
+		{
+			return false;
+		}
+
+		*ppText = pCursor + 1;
+		return true;
+	}
+
+	/***********************************************************
+	 *  ParseJSONValue()
+	 *
+	 *  Read one JSON value and its children into the node list,
+	 *  returns the index of its node or -1.
+	 ***********************************************************/
+	int ParseJSONValue(std::vector<JSON_NODE>* pNodes, const char** ppText, const char* pEnd, int depth)
+	{
+		SkipJSONSpaces(ppText, pEnd);
+		if ((*ppText >= pEnd) || (depth > MAX_JSON_DEPTH))
+		{
+			return(-1);
+		}
+
+		int nodeIndex = (int)pNodes->size();
+		pNodes->push_back(JSON_NODE());
+		(*pNodes)[nodeIndex].type = JSON_NULL;
+		(*pNodes)[nodeIndex].number = 0.0;
+
+		char first = **ppText;
+		if (('{' == first) || ('[' == first))
+		{
+			bool bObject = ('{' == first);
+			char closing = bObject ? '}' : ']';
+			(*pNodes)[nodeIndex].type = bObject ? JSON_OBJECT : JSON_ARRAY;
+			(*ppText)++;
+			SkipJSONSpaces(ppText, pEnd);
+			if ((*ppText < pEnd) && (closing == **ppText))
+			{
+				(*ppText)++;
+				return(nodeIndex);
+			}
+
+			for (;;)
+			{
+				std::string key;
+				if (bObject)
+				{
+					SkipJSONSpaces(ppText, pEnd);
+					if (!ParseJSONString(ppText, pEnd, &key))
+					{
+						return(-1);
+					}
+					SkipJSONSpaces(ppText, pEnd);
+					if ((*ppText >= pEnd) || (':' != **ppText))
+					{
+						return(-1);
+					}
+					(*ppText)++;
+				}
+
+				// the child may move the node list, so the node is
+				// looked up again after it was read
+				int child = ParseJSONValue(pNodes, ppText, pEnd, depth + 1);
+				if (child < 0)
+				{
+					return(-1);
+				}
+				(*pNodes)[nodeIndex].children.push_back(child);
+				if (bObject)
+				{
+					(*pNodes)[nodeIndex].keys.push_back(key);
+				}
+
+				SkipJSONSpaces(ppText, pEnd);
+				if ((*ppText < pEnd) && (',' == **ppText))
+				{
+					(*ppText)++;
+					continue;
+				}
+				if ((*ppText < pEnd) && (closing == **ppText))
+				{
+					(*ppText)++;
+					return(nodeIndex);
+				}
+				return(-1);
+			}
+		}
+
+		if ('"' == first)
+		{
+			std::string text;
+			if (!ParseJSONString(ppText, pEnd, &text))
+			{
+				return(-1);
+			}
+			(*pNodes)[nodeIndex].type = JSON_STRING;
+			(*pNodes)[nodeIndex].text = text;
+			return(nodeIndex);
+		}
+
+		const char* KEYWORDS[3] = { "null", "false", "true" };
+		const JSON_TYPE KEYWORD_TYPES[3] = { JSON_NULL, JSON_FALSE, JSON_TRUE };
+		for (int keyword = 0; keyword < 3; keyword++)
+		{
+			size_t length = strlen(KEYWORDS[keyword]);
+			if (((size_t)(pEnd - *ppText) >= length) && (0 == memcmp(*ppText, KEYWORDS[keyword], length)))
+			{
+				(*pNodes)[nodeIndex].type = KEYWORD_TYPES[keyword];
+				*ppText += length;
+				return(nodeIndex);
+			}
+		}
+
+		double number = 0.0;
+		if (!ParseNumber(ppText, pEnd, &number))
+		{
+			return(-1);
+		}
+		(*pNodes)[nodeIndex].type = JSON_NUMBER;
+		(*pNodes)[nodeIndex].number = number;
+		return(nodeIndex);
+	}
+
+	/***********************************************************
+	 *  FindMember()
+	 *
+	 *  Return the node of an object member, or -1.
+	 ***********************************************************/
+	int FindMember(const GLTF_FILE& file, int node, const char* key)
+	{
+		if ((node < 0) || (JSON_OBJECT != file.nodes[node].type))
+		{
+			return(-1);
+		}
+		const JSON_NODE& object = file.nodes[node];
+		for (size_t i = 0; i < object.keys.size(); i++)
+		{
+			if (object.keys[i] == key)
+			{
+				return(object.children[i]);
+			}
+		}
+		return(-1);
+	}
+
+	/***********************************************************
+	 *  GetElement()
+	 *
+	 *  Return the node of an array element, or -1.
+	 ***********************************************************/
+	int GetElement(const GLTF_FILE& file, int node, int index)
+	{
+		if ((node < 0) || (JSON_ARRAY != file.nodes[node].type) || (index < 0) ||
+			(index >= (int)file.nodes[node].children.size()))
+		{
+			return(-1);
+		}
+		return(file.nodes[node].children[index]);
+	}
+
+	/***********************************************************
+	 *  GetNumber()
+	 *
+	 *  Return a number member of an object, or the default
+	 *  value when it is not there.
+	 ***********************************************************/
+	double GetNumber(const GLTF_FILE& file, int node, const char* key, double defaultValue)
+	{
+		int member = FindMember(file, node, key);
+		if ((member < 0) || (JSON_NUMBER != file.nodes[member].type))
+		{
+			return(defaultValue);
+		}
+		return(file.nodes[member].number);
+	}
+
+	/***********************************************************
+	 *  GetAccessor()
+	 *
+	 *  Locate the elements of a glTF accessor in the binary
+	 *  chunk.  Sparse accessors and external buffers are not
+	 *  read.
+	 ***********************************************************/
+	bool GetAccessor(const GLTF_FILE& file, int accessorIndex, GLTF_ACCESSOR* pAccessor)
+	{
+		int accessor = GetElement(file, FindMember(file, 0, "accessors"), accessorIndex);
+		if ((accessor < 0) || (FindMember(file, accessor, "sparse") >= 0))
+		{
+			return false;
+		}
+		int view = GetElement(file, FindMember(file, 0, "bufferViews"), (int)GetNumber(file, accessor, "bufferView", -1));
+		if ((view < 0) || (0 != (int)GetNumber(file, view, "buffer", 0)))
+		{
+			return false;
+		}
+
+		int type = FindMember(file, accessor, "type");
+		const char* TYPE_NAMES[4] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+		pAccessor->components = 0;
+		for (int components = 1; (type >= 0) && (components <= 4); components++)
+		{
+			if (file.nodes[type].text == TYPE_NAMES[components - 1])
+			{
+				pAccessor->components = components;
+			}
+		}
+
+		pAccessor->componentType = (int)GetNumber(file, accessor, "componentType", 0);
+		switch (pAccessor->componentType)
+		{
+		case GLTF_BYTE:
+		case GLTF_UNSIGNED_BYTE:
+			pAccessor->componentSize = 1;
+			break;
+		case GLTF_SHORT:
+		case GLTF_UNSIGNED_SHORT:
+			pAccessor->componentSize = 2;
+			break;
+		case GLTF_UNSIGNED_INT:
+		case GLTF_FLOAT:
+			pAccessor->componentSize = 4;
+			break;
+		default:
+			return false;
+		}
+		int normalized = FindMember(file, accessor, "normalized");
+		pAccessor->bNormalized = (normalized >= 0) && (JSON_TRUE == file.nodes[normalized].type);
+
+		double count = GetNumber(file, accessor, "count", 0);
+		double accessorOffset = GetNumber(file, accessor, "byteOffset", 0);
+		double viewOffset = GetNumber(file, view, "byteOffset", 0);
+		double viewLength = GetNumber(file, view, "byteLength", 0);
+		size_t elementSize = (size_t)pAccessor->componentSize * pAccessor->components;
+		double stride = GetNumber(file, view, "byteStride", (double)elementSize);
+		if ((0 == pAccessor->components) || (count < 1) || (accessorOffset < 0) || (viewOffset < 0) ||
+			(stride < (double)elementSize) || ((viewOffset + viewLength) > (double)file.binarySize) ||
+			((accessorOffset + ((count - 1) * stride) + elementSize) > viewLength))
+		{
+			return false;
+		}
+
+		pAccessor->pData = file.pBinary + (size_t)viewOffset + (size_t)accessorOffset;
+		pAccessor->count = (size_t)count;
+		pAccessor->stride = (size_t)stride;
+		return true;
+	}
+
+	/***********************************************************
+	 *  ReadComponent()
+	 *
+	 *  Read one component of an accessor element as a float,
+	 *  normalized integers are mapped to 0..1 or -1..1.
+	 ***********************************************************/
+	float ReadComponent(const GLTF_ACCESSOR& accessor, size_t element, int component)
+	{
+		const unsigned char* pData = accessor.pData + (element * accessor.stride) + (component * accessor.componentSize);
+		switch (accessor.componentType)
+		{
+		case GLTF_FLOAT:
+		{
+			float value;
+			memcpy(&value, pData, sizeof(float));
+			return(value);
+		}
+		case GLTF_UNSIGNED_BYTE:
+			return(accessor.bNormalized ? (pData[0] / 255.0f) : (float)pData[0]);
+		case GLTF_BYTE:
+			return(accessor.bNormalized ? std::max((signed char)pData[0] / 127.0f, -1.0f) : (float)(signed char)pData[0]);
+		case GLTF_UNSIGNED_SHORT:
+		{
+			unsigned short value;
+			memcpy(&value, pData, sizeof(value));
+			return(accessor.bNormalized ? (value / 65535.0f) : (float)value);
+		}
+		case GLTF_SHORT:
+		{
+			short value;
+			memcpy(&value, pData, sizeof(value));
+			return(accessor.bNormalized ? std::max(value / 32767.0f, -1.0f) : (float)value);
+		}
+		default:
+		{
+			unsigned int value;
+			memcpy(&value, pData, sizeof(value));
+			return((float)value);
+		}
+		}
+	}
+
+	/***********************************************************
+	 *  ReadIndex()
+	 *
+	 *  Read one element of an index accessor.
+	 ***********************************************************/
+	unsigned int ReadIndex(const GLTF_ACCESSOR& accessor, size_t element)
+	{
+		const unsigned char* pData = accessor.pData + (element * accessor.stride);
+		if (GLTF_UNSIGNED_BYTE == accessor.componentType)
+		{
+			return(pData[0]);
+		}
+		if (GLTF_UNSIGNED_SHORT == accessor.componentType)
+		{
+			unsigned short value;
+			memcpy(&value, pData, sizeof(value));
+			return(value);
+		}
+		unsigned int value;
+		memcpy(&value, pData, sizeof(value));
+		return(value);
+	}
+
+	/***********************************************************
+	 *  GetPrimitive()
+	 *
+	 *  Locate the attributes and indices of a glTF primitive,
+	 *  false for primitives that are not triangle lists or lack
+	 *  their positions.
+	 ***********************************************************/
+	bool GetPrimitive(const GLTF_FILE& file, int node, GLTF_PRIMITIVE* pPrimitive)
+	{
+		if (GLTF_TRIANGLES != (int)GetNumber(file, node, "mode", GLTF_TRIANGLES))
+		{
+			return false;
+		}
+
+		int attributes = FindMember(file, node, "attributes");
+		if (!GetAccessor(file, (int)GetNumber(file, attributes, "POSITION", -1), &pPrimitive->positions) ||
+			(pPrimitive->positions.components != 3))
+		{
+			return false;
+		}
+		pPrimitive->bNormals = GetAccessor(file, (int)GetNumber(file, attributes, "NORMAL", -1), &pPrimitive->normals) &&
+			(pPrimitive->normals.components == 3) && (pPrimitive->normals.count == pPrimitive->positions.count);
+		pPrimitive->bUVs = GetAccessor(file, (int)GetNumber(file, attributes, "TEXCOORD_0", -1), &pPrimitive->uvs) &&
+			(pPrimitive->uvs.components == 2) && (pPrimitive->uvs.count == pPrimitive->positions.count);
+
+		pPrimitive->bIndices = false;
+		pPrimitive->indexCount = pPrimitive->positions.count;
+		if (FindMember(file, node, "indices") >= 0)
+		{
+			if (!GetAccessor(file, (int)GetNumber(file, node, "indices", -1), &pPrimitive->indices) ||
+				(pPrimitive->indices.components != 1) || (GLTF_FLOAT == pPrimitive->indices.componentType) ||
+				(GLTF_BYTE == pPrimitive->indices.componentType) || (GLTF_SHORT == pPrimitive->indices.componentType))
+			{
+				return false;
+			}
+			pPrimitive->bIndices = true;
+			pPrimitive->indexCount = pPrimitive->indices.count;
+		}
+		pPrimitive->indexCount -= pPrimitive->indexCount % 3;
+		return true;
+	}
+}
+
+/***********************************************************
+ *  ImportMesh()
+ *
+ *  Map a mesh file and read it with the importer that matches
+ *  its extension.
+ ***********************************************************/
+bool ImportMesh(const char* filename, ThreadPool* pThreadPool, MESH_DATA* pMesh)
+{
+	if ((NULL == filename) || (NULL == pMesh))
+	{
+		return false;
+	}
+
+	std::string extension = filename;
+	size_t dot = extension.find_last_of('.');
+	extension = (std::string::npos != dot) ? extension.substr(dot + 1) : "";
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	MappedFile file;
+	if (!file.Open(filename))
+	{
+		std::cout << "Could not open the mesh file " << filename << std::endl;
+		return false;
+	}
+
+	bool bImported = false;
+	if ("obj" == extension)
+	{
+		bImported = ImportOBJ((const char*)file.GetData(), file.GetSize(), pThreadPool, pMesh);
+	}
+	else if ("glb" == extension)
+	{
+		bImported = ImportGLB(file.GetData(), file.GetSize(), pThreadPool, pMesh);
+	}
+	else
+	{
+		std::cout << "Mesh files of type " << extension << " are not supported" << std::endl;
+		return false;
+	}
+
+	if (!bImported)
+	{
+		std::cout << "Could not read the mesh file " << filename << std::endl;
+	}
+	return(bImported);
+}
+
+/***********************************************************
+ *  ImportOBJ()
+ *
+ *  Split the text at line ends into one part per task and
+ *  read the parts in parallel, straight from the mapped file.
+ *  The parts are then joined, and every distinct corner of
+ *  the faces becomes one vertex through a hash table over its
+ *  position, uv and normal indices.
+ ***********************************************************/
+bool ImportOBJ(const char* pText, size_t size, ThreadPool* pThreadPool, MESH_DATA* pMesh)
+{
+	if ((NULL == pText) || (NULL == pMesh))
+	{
+		return false;
+	}
+
+	int threadCount = (NULL != pThreadPool) ? pThreadPool->GetThreadCount() : 1;
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(size / MIN_OBJ_CHUNK_SIZE,
+		(size_t)threadCount * OBJ_CHUNKS_PER_THREAD));
+	std::vector<OBJ_CHUNK> chunks(chunkCount);
+	const char* pEnd = pText + size;
+	const char* pStart = pText;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* pChunkEnd = pEnd;
+		if (i + 1 < chunkCount)
+		{
+			pChunkEnd = std::max(SkipLine(pText + ((size * (i + 1)) / chunkCount), pEnd), pStart);
+		}
+		chunks[i].pStart = pStart;
+		chunks[i].pEnd = pChunkEnd;
+		pStart = pChunkEnd;
+	}
+
+	RunTasks(pThreadPool, (int)chunkCount, [&chunks](int chunk)
+	{
+		ParseOBJChunk(&chunks[chunk]);
+	});
+
+	// number the attributes of every chunk after the ones before it
+	int totals[3] = { 0, 0, 0 };
+	size_t cornerCount = 0;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		if (!chunks[i].bValid)
+		{
+			return false;
+		}
+		chunks[i].firstIndex[0] = totals[0];
+		chunks[i].firstIndex[1] = totals[1];
+		chunks[i].firstIndex[2] = totals[2];
+		totals[0] += (int)chunks[i].positions.size();
+		totals[1] += (int)chunks[i].uvs.size();
+		totals[2] += (int)chunks[i].normals.size();
+		cornerCount += chunks[i].corners.size();
+	}
+	if (0 == cornerCount)
+	{
+		return false;
+	}
+
+	std::vector<glm::vec3> positions(totals[0]);
+	std::vector<glm::vec2> uvs(totals[1]);
+	std::vector<glm::vec3> normals(totals[2]);
+	std::vector<unsigned char> chunkValid(chunkCount, 0);
+	RunTasks(pThreadPool, (int)chunkCount, [&](int chunk)
+	{
+		OBJ_CHUNK& source = chunks[chunk];
+		std::copy(source.positions.begin(), source.positions.end(), positions.begin() + source.firstIndex[0]);
+		std::copy(source.uvs.begin(), source.uvs.end(), uvs.begin() + source.firstIndex[1]);
+		std::copy(source.normals.begin(), source.normals.end(), normals.begin() + source.firstIndex[2]);
+		chunkValid[chunk] = ResolveOBJChunk(&source, totals) ? 1 : 0;
+	});
+	if (std::find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end())
+	{
+		return false;
+	}
+
+	// the table only holds vertex numbers, the corners they stand
+	// for are kept in vertex order next to it
+	std::vector<OBJ_CORNER> vertexCorners;
+	vertexCorners.reserve(totals[0]);
+	size_t tableSize = 1024;
+	while (tableSize < (size_t)totals[0] * 2)
+	{
+		tableSize *= 2;
+	}
+	std::vector<unsigned int> table(tableSize, EMPTY_SLOT);
+
+	pMesh->vertices.clear();
+	pMesh->indices.clear();
+	pMesh->indices.reserve(cornerCount);
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		const std::vector<OBJ_CORNER>& corners = chunks[chunk].corners;
+		for (size_t i = 0; i < corners.size(); i++)
+		{
+			const OBJ_CORNER& corner = corners[i];
+			size_t mask = table.size() - 1;
+			size_t slot = HashCorner(corner) & mask;
+			unsigned int vertex = table[slot];
+			while ((EMPTY_SLOT != vertex) && (0 != memcmp(vertexCorners[vertex].index, corner.index, sizeof(corner.index))))
+			{
+				slot = (slot + 1) & mask;
+				vertex = table[slot];
+			}
+
+			if (EMPTY_SLOT == vertex)
+			{
+				vertex = (unsigned int)vertexCorners.size();
+				table[slot] = vertex;
+				vertexCorners.push_back(corner);
+
+				// keep the table at most half full
+				if (vertexCorners.size() * 2 > table.size())
+				{
+					table.assign(table.size() * 2, EMPTY_SLOT);
+					mask = table.size() - 1;
+					for (size_t existing = 0; existing < vertexCorners.size(); existing++)
+					{
+						size_t rehashed = HashCorner(vertexCorners[existing]) & mask;
+						while (EMPTY_SLOT != table[rehashed])
+						{
+							rehashed = (rehashed + 1) & mask;
+						}
+						table[rehashed] = (unsigned int)existing;
+					}
+				}
+			}
+			pMesh->indices.push_back(vertex);
+		}
+	}
+
+	pMesh->vertices.resize(vertexCorners.size());
+	std::vector<unsigned char> missingNormals(vertexCorners.size(), 0);
+	int taskCount = (int)((vertexCorners.size() + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK);
+	RunTasks(pThreadPool, taskCount, [&](int task)
+	{
+		size_t last = std::min((size_t)(task + 1) * VERTICES_PER_TASK, vertexCorners.size());
+		for (size_t i = (size_t)task * VERTICES_PER_TASK; i < last; i++)
+		{
+			const OBJ_CORNER& corner = vertexCorners[i];
+			MESH_VERTEX& vertex = pMesh->vertices[i];
+			vertex.position = positions[corner.index[0]];
+			vertex.uv = (OBJ_MISSING != corner.index[1]) ? uvs[corner.index[1]] : glm::vec2(0.0f);
+			vertex.normal = (OBJ_MISSING != corner.index[2]) ? normals[corner.index[2]] : glm::vec3(0.0f);
+			missingNormals[i] = (OBJ_MISSING == corner.index[2]) ? 1 : 0;
+		}
+	});
+
+	if (std::find(missingNormals.begin(), missingNormals.end(), 1) != missingNormals.end())
+	{
+		GenerateMissingNormals(pMesh, missingNormals);
+	}
+	return true;
+}
+
+/***********************************************************
+ *  ImportGLB()
+ *
+ *  Read the JSON chunk of a binary glTF file and copy the
+ *  triangle primitives of every mesh out of the binary chunk.
+ *  glTF primitives are indexed already, so their vertices are
+ *  taken over as they are, converted in parallel ranges.
+ *  glTF puts the texture origin at the top left while the
+ *  scene's textures are loaded flipped, so v is flipped too.
+ ***********************************************************/
+bool ImportGLB(const unsigned char* pData, size_t size, ThreadPool* pThreadPool, MESH_DATA* pMesh)
+{
+	if ((NULL == pData) || (NULL == pMesh) || (size < 20))
+	{
+		return false;
+	}
+	size_t length = ReadUInt(pData + 8);
+	if ((GLB_MAGIC != ReadUInt(pData)) || (2 != ReadUInt(pData + 4)) || (length > size) ||
+		(GLB_CHUNK_JSON != ReadUInt(pData + 16)))
+	{
+		return false;
+	}
+
+	size_t jsonLength = ReadUInt(pData + 12);
+	if (20 + jsonLength > length)
+	{
+		return false;
+	}
+	GLTF_FILE file;
+	file.pBinary = NULL;
+	file.binarySize = 0;
+	size_t binaryChunk = 20 + jsonLength;
+	if ((binaryChunk + 8 <= length) && (GLB_CHUNK_BIN == ReadUInt(pData + binaryChunk + 4)))
+	{
+		file.binarySize = ReadUInt(pData + binaryChunk);
+		file.pBinary = pData + binaryChunk + 8;
+		if (binaryChunk + 8 + file.binarySize > length)
+		{
+			return false;
+		}
+	}
+
+	const char* pJSON = (const char*)pData + 20;
+	if ((0 != ParseJSONValue(&file.nodes, &pJSON, pJSON + jsonLength, 0)) || (JSON_OBJECT != file.nodes[0].type))
+	{
+		return false;
+	}
+
+	std::vector<GLTF_PRIMITIVE> primitives;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	int meshes = FindMember(file, 0, "meshes");
+	for (int mesh = 0; GetElement(file, meshes, mesh) >= 0; mesh++)
+	{
+		int meshPrimitives = FindMember(file, GetElement(file, meshes, mesh), "primitives");
+		for (int primitive = 0; GetElement(file, meshPrimitives, primitive) >= 0; primitive++)
+		{
+			GLTF_PRIMITIVE found;
+			if (GetPrimitive(file, GetElement(file, meshPrimitives, primitive), &found) && (found.indexCount > 0))
+			{
+				found.firstVertex = vertexCount;
+				found.firstIndex = indexCount;
+				vertexCount += found.positions.count;
+				indexCount += found.indexCount;
+				primitives.push_back(found);
+			}
+		}
+	}
+	if (primitives.empty() || (vertexCount > EMPTY_SLOT))
+	{
+		return false;
+	}
+
+	// split every primitive into ranges of vertices and of indices
+	std::vector<GLTF_TASK> vertexTasks;
+	std::vector<GLTF_TASK> indexTasks;
+	for (size_t primitive = 0; primitive < primitives.size(); primitive++)
+	{
+		for (size_t first = 0; first < primitives[primitive].positions.count; first += VERTICES_PER_TASK)
+		{
+			GLTF_TASK task = { primitive, first, std::min(VERTICES_PER_TASK, primitives[primitive].positions.count - first) };
+			vertexTasks.push_back(task);
+		}
+		for (size_t first = 0; first < primitives[primitive].indexCount; first += VERTICES_PER_TASK)
+		{
+			GLTF_TASK task = { primitive, first, std::min(VERTICES_PER_TASK, primitives[primitive].indexCount - first) };
+			indexTasks.push_back(task);
+		}
+	}
+
+	pMesh->vertices.resize(vertexCount);
+	pMesh->indices.resize(indexCount);
+	std::vector<unsigned char> missingNormals(vertexCount, 0);
+	RunTasks(pThreadPool, (int)vertexTasks.size(), [&](int taskIndex)
+	{
+		const GLTF_TASK& task = vertexTasks[taskIndex];
+		const GLTF_PRIMITIVE& primitive = primitives[task.primitive];
+		for (size_t element = task.first; element < task.first + task.count; element++)
+		{
+			MESH_VERTEX& vertex = pMesh->vertices[primitive.firstVertex + element];
+			vertex.position = glm::vec3(ReadComponent(primitive.positions, element, 0),
+				ReadComponent(primitive.positions, element, 1), ReadComponent(primitive.positions, element, 2));
+			vertex.normal = glm::vec3(0.0f);
+			if (primitive.bNormals)
+			{
+				vertex.normal = glm::vec3(ReadComponent(primitive.normals, element, 0),
+					ReadComponent(primitive.normals, element, 1), ReadComponent(primitive.normals, element, 2));
+			}
+			vertex.uv = glm::vec2(0.0f);
+			if (primitive.bUVs)
+			{
+				vertex.uv = glm::vec2(ReadComponent(primitive.uvs, element, 0), 1.0f - ReadComponent(primitive.uvs, element, 1));
+			}
+			missingNormals[primitive.firstVertex + element] = primitive.bNormals ? 0 : 1;
+		}
+	});
+
+	std::vector<unsigned char> taskValid(indexTasks.size(), 1);
+	RunTasks(pThreadPool, (int)indexTasks.size(), [&](int taskIndex)
+	{
+		const GLTF_TASK& task = indexTasks[taskIndex];
+		const GLTF_PRIMITIVE& primitive = primitives[task.primitive];
+		for (size_t element = task.first; element < task.first + task.count; element++)
+		{
+			size_t index = primitive.bIndices ? ReadIndex(primitive.indices, element) : element;
+			if (index >= primitive.positions.count)
+			{
+				taskValid[taskIndex] = 0;
+				return;
+			}
+			pMesh->indices[primitive.firstIndex + element] = (unsigned int)(primitive.firstVertex + index);
+		}
+	});
+	if (std::find(taskValid.begin(), taskValid.end(), 0) != taskValid.end())
+	{
+		return false;
+	}
+
+	if (std::find(missingNormals.begin(), missingNormals.end(), 1) != missingNormals.end())
+	{
+		GenerateMissingNormals(pMesh, missingNormals);
+	}
+	return true;
+}
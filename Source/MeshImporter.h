@@ -0,0 +1,23 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.h
+// ============
+// read triangle meshes from OBJ and binary glTF files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGenerator.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+
+// read an .obj or .glb file into a triangle list, the format is
+// picked by the file extension and a NULL pool parses on the
+// calling thread only
+bool ImportMesh(const char* filename, ThreadPool* pThreadPool, MESH_DATA* pMesh);
+// parse the text of an OBJ file, polygons are split into fans and
+// corners with the same position, uv and normal share one vertex
+bool ImportOBJ(const char* pText, size_t size, ThreadPool* pThreadPool, MESH_DATA* pMesh);
+// parse a binary glTF 2.0 file, the triangle primitives of all its
+// meshes are merged without their node transforms
+bool ImportGLB(const unsigned char* pData, size_t size, ThreadPool* pThreadPool, MESH_DATA* pMesh);
@@ -0,0 +1,420 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.cpp
+// ============
+// GPU vertex and index buffers of the meshes drawn in the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshLibrary.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "RenderCounters.h"
+#include "ResourceTracker.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  GetImportFormat()
+	 *
+	 *  Get the vertex format an imported mesh is packed in.  The
+	 *  unorm16 uv of the packed format only covers 0..1, which is
+	 *  all the primitives use, but imported assets often tile
+	 *  their textures with coordinates outside of it.  Those
+	 *  meshes take the half float uv of the compact format, the
+	 *  draw data carries the format of every mesh, so the scene
+	 *  can mix both.
+	 ***********************************************************/
+	VERTEX_FORMAT GetImportFormat(const MESH_DATA& mesh, VERTEX_FORMAT format)
+	{
+		if (VERTEX_FORMAT_PACKED != format)
+		{
+			return(format);
+		}
+		for (const MESH_VERTEX& vertex : mesh.vertices)
+		{
+			if ((vertex.uv.x < 0.0f) || (vertex.uv.x > 1.0f) || (vertex.uv.y < 0.0f) || (vertex.uv.y > 1.0f))
+			{
+				return(VERTEX_FORMAT_COMPACT);
+			}
+		}
+		return(format);
+	}
+}
+
+/***********************************************************
+ *  MeshLibrary()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshLibrary::MeshLibrary(const char* cacheDirectory)
+{
+	m_pCache = new MeshCache(cacheDirectory);
+	m_vertexFormat = VERTEX_FORMAT_PACKED;
+	m_meshVersion = 0;
+}
+
+/***********************************************************
+ *  ~MeshLibrary()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshLibrary::~MeshLibrary()
+{
+	DestroyMeshes();
+
+	delete m_pCache;
+	m_pCache = NULL;
+}
+
+/***********************************************************
+ *  LoadPrimitive()
+ *
+ *  This method is used to load the mesh of a primitive with
+ *  the passed in tessellation and the current vertex format.
+ *  A key that was loaded before in the same format returns
+ *  the existing mesh.
+ ***********************************************************/
+int MeshLibrary::LoadPrimitive(const MESH_KEY& key)
+{
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		const MESH_KEY& loadedKey = m_meshes[i].key;
+		if ((loadedKey.primitive == key.primitive) && (loadedKey.segments == key.segments) &&
+			(loadedKey.rings == key.rings) && (m_meshes[i].vertexFormat == m_vertexFormat))
+		{
+			return((int)i);
+		}
+	}
+
+	MESH_VIEW view;
+	if (!m_pCache->OpenMesh(key, m_vertexFormat, &view))
+	{
+		return(-1);
+	}
+	int meshID = UploadMesh(view);
+	m_pCache->CloseMesh();
+
+	return(meshID);
+}
+
+/***********************************************************
+ *  LoadMeshFile()
+ *
+ *  This method is used to import a mesh file and upload it in
+ *  the same packed layout as the primitives, or in the compact
+ *  one when its texture coordinates leave 0..1.  The file
+ *  itself is the asset, so the packed mesh is not written to
+ *  the mesh cache.
+ ***********************************************************/
+int MeshLibrary::LoadMeshFile(const char* filename, ThreadPool* pThreadPool)
+{
+	MESH_DATA mesh;
+	if (!ImportMesh(filename, pThreadPool, &mesh))
+	{
+		return(-1);
+	}
+	OptimizeVertexCache(&mesh, true);
+	OptimizeVertexFetch(&mesh);
+
+	// imported meshes are not one of the primitives
+	MESH_KEY key = { -1, 0, 0 };
+	VERTEX_FORMAT format = GetImportFormat(mesh, m_vertexFormat);
+	std::vector<unsigned char> image;
+	MESH_VIEW view;
+	if (!MeshCache::PackMesh(key, mesh, format, &image) ||
+		!MeshCache::ReadImage(image.data(), image.size(), key, format, &view))
+	{
+		return(-1);
+	}
+
+	return(UploadMesh(view));
+}
+
+/***********************************************************
+ *  RequestMeshFile()
+ *
+ *  This method is used to import a mesh file without holding
+ *  up the frame.  Parsing, packing and the buffer uploads run
+ *  on the loader thread, the vertex array is created and the
+ *  mesh swapped in once the render thread polls the upload.
+ *  The parser runs on the loader thread alone, so the frame's
+ *  worker threads are left to the frame.  The swap bumps the
+ *  mesh version, the placeholder has no bounds, so the model
+ *  matrices built for it have to be built again.
+ ***********************************************************/
+int MeshLibrary::RequestMeshFile(const char* filename, UploadQueue* pUploadQueue)
+{
+	if (NULL == pUploadQueue)
+	{
+		return(LoadMeshFile(filename, NULL));
+	}
+
+	// an empty mesh holds the id until the upload is finished
+	GPU_MESH placeholder;
+	placeholder.key.primitive = -1;
+	placeholder.key.segments = 0;
+	placeholder.key.rings = 0;
+	placeholder.vertexFormat = (int)m_vertexFormat;
+	placeholder.vertexArray = 0;
+	placeholder.vertexBuffer = 0;
+	placeholder.indexBuffer = 0;
+	placeholder.indexType = GL_UNSIGNED_INT;
+	placeholder.indexCount = 0;
+	placeholder.vertexCount = 0;
+	placeholder.boundsCenter = glm::vec3(0.0f);
+	placeholder.boundsExtent = glm::vec3(0.0f);
+	placeholder.meshlets.meshletCount = 0;
+	placeholder.meshlets.paddedCount = 0;
+	placeholder.meshlets.bConeCulling = false;
+	m_meshes.push_back(placeholder);
+	int meshID = (int)m_meshes.size() - 1;
+
+	std::string file = filename;
+	VERTEX_FORMAT format = m_vertexFormat;
+	std::shared_ptr<GPU_MESH> pMesh = std::make_shared<GPU_MESH>(placeholder);
+	pUploadQueue->Submit([file, format, pMesh]()
+	{
+		MESH_DATA mesh;
+		if (!ImportMesh(file.c_str(), NULL, &mesh))
+		{
+			return(false);
+		}
+		OptimizeVertexCache(&mesh, true);
+		OptimizeVertexFetch(&mesh);
+
+		MESH_KEY key = { -1, 0, 0 };
+		VERTEX_FORMAT meshFormat = GetImportFormat(mesh, format);
+		std::vector<unsigned char> image;
+		MESH_VIEW view;
+		if (!MeshCache::PackMesh(key, mesh, meshFormat, &image) ||
+			!MeshCache::ReadImage(image.data(), image.size(), key, meshFormat, &view))
+		{
+			return(false);
+		}
+		CreateMeshBuffers(view, pMesh.get());
+		return(true);
+	},
+	[this, meshID, pMesh](bool bSucceeded)
+	{
+		if (!bSucceeded)
+		{
+			return;
+		}
+		CreateVertexArray(pMesh.get());
+		m_meshes[meshID] = *pMesh;
+		m_meshVersion++;
+	});
+
+	return(meshID);
+}
+
+/***********************************************************
+ *  UploadMesh()
+ *
+ *  This method is used to copy a packed mesh into new GPU
+ *  buffers and describe its vertex layout to the vertex array.
+ ***********************************************************/
+int MeshLibrary::UploadMesh(const MESH_VIEW& view)
+{
+	GPU_MESH mesh;
+	CreateMeshBuffers(view, &mesh);
+	CreateVertexArray(&mesh);
+
+	m_meshes.push_back(mesh);
+	return((int)m_meshes.size() - 1);
+}
+
+/***********************************************************
+ *  CreateMeshBuffers()
+ *
+ *  This method is used to copy a packed mesh into new vertex
+ *  and index buffers and to split it into meshlets.
+ ***********************************************************/
+void MeshLibrary::CreateMeshBuffers(const MESH_VIEW& view, GPU_MESH* pMesh)
+{
+	const MESH_FILE_HEADER* pHeader = view.pHeader;
+
+	pMesh->key = pHeader->key;
+	pMesh->vertexFormat = (int)pHeader->vertexFormat;
+	pMesh->vertexArray = 0;
+	pMesh->indexType = (2 == pHeader->indexSize) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	pMesh->indexCount = (GLsizei)pHeader->indexCount;
+	pMesh->vertexCount = (GLsizei)pHeader->vertexCount;
+	pMesh->boundsCenter = glm::vec3(pHeader->boundsCenter[0], pHeader->boundsCenter[1], pHeader->boundsCenter[2]);
+	pMesh->boundsExtent = glm::vec3(pHeader->boundsExtent[0], pHeader->boundsExtent[1], pHeader->boundsExtent[2]);
+
+	glGenBuffers(1, &pMesh->vertexBuffer);
+	glGenBuffers(1, &pMesh->indexBuffer);
+
+	// the data is only ever read by the GPU
+	glBindBuffer(GL_ARRAY_BUFFER, pMesh->vertexBuffer);
+	GLsizeiptr stride = (GLsizeiptr)MeshCache::GetVertexSize((VERTEX_FORMAT)pHeader->vertexFormat);
+	glBufferStorage(GL_ARRAY_BUFFER, stride * pHeader->vertexCount, view.pVertices, 0);
+	TrackBuffer(pMesh->vertexBuffer, stride * pHeader->vertexCount, "MeshLibrary vertices");
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// the element array binding is vertex array state, so the
+	// indices go through a binding point every context has
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pMesh->indexBuffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)pHeader->indexSize * pHeader->indexCount, view.pIndices, 0);
+	TrackBuffer(pMesh->indexBuffer, (size_t)pHeader->indexSize * pHeader->indexCount, "MeshLibrary indices");
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	BuildMeshMeshlets(view, pMesh);
+}
+
+/***********************************************************
+ *  CreateVertexArray()
+ *
+ *  This method is used to create the vertex array of a mesh
+ *  whose buffers have been created.
+ ***********************************************************/
+void MeshLibrary::CreateVertexArray(GPU_MESH* pMesh)
+{
+	glGenVertexArrays(1, &pMesh->vertexArray);
+	glBindVertexArray(pMesh->vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, pMesh->vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pMesh->indexBuffer);
+
+	// the normalized integer attributes arrive in the shaders as
+	// the same vec3 / vec2 inputs the float vertices used, the
+	// compact normal fills only x and y of its input and is
+	// unfolded by the vertex shader
+	GLsizei stride = (GLsizei)MeshCache::GetVertexSize((VERTEX_FORMAT)pMesh->vertexFormat);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	if (VERTEX_FORMAT_COMPACT == pMesh->vertexFormat)
+	{
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(COMPACT_VERTEX, position));
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(COMPACT_VERTEX, normal));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(COMPACT_VERTEX, uv));
+	}
+	else
+	{
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, position));
+		glVertexAttribPointer(1, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, normal));
+		glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, uv));
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BuildMeshMeshlets()
+ *
+ *  This method is used to split a packed mesh into meshlets.
+ *  The bounds are taken from the packed positions, the space
+ *  the model matrix of a draw starts from.
+ ***********************************************************/
+void MeshLibrary::BuildMeshMeshlets(const MESH_VIEW& view, GPU_MESH* pMesh)
+{
+	const MESH_FILE_HEADER* pHeader = view.pHeader;
+
+	// both vertex formats start with the same snorm16 position
+	size_t stride = MeshCache::GetVertexSize((VERTEX_FORMAT)pHeader->vertexFormat);
+	std::vector<glm::vec3> positions(pHeader->vertexCount);
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		const short* pPosition = (const short*)((const unsigned char*)view.pVertices + (i * stride));
+		for (int axis = 0; axis < 3; axis++)
+		{
+			positions[i][axis] = std::max(pPosition[axis] / 32767.0f, -1.0f);
+		}
+	}
+
+	std::vector<unsigned int> indices(pHeader->indexCount);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		indices[i] = (2 == pHeader->indexSize) ? ((const unsigned short*)view.pIndices)[i] :
+			((const unsigned int*)view.pIndices)[i];
+	}
+
+	BuildMeshlets(positions, indices, &pMesh->meshlets);
+}
+
+/***********************************************************
+ *  DestroyMeshes()
+ *
+ *  This method is used to free the buffers of all meshes.
+ ***********************************************************/
+void MeshLibrary::DestroyMeshes()
+{
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		glDeleteVertexArrays(1, &m_meshes[i].vertexArray);
+		UntrackResource(RESOURCE_BUFFER, m_meshes[i].vertexBuffer);
+		UntrackResource(RESOURCE_BUFFER, m_meshes[i].indexBuffer);
+		glDeleteBuffers(1, &m_meshes[i].vertexBuffer);
+		glDeleteBuffers(1, &m_meshes[i].indexBuffer);
+	}
+	m_meshes.clear();
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used to draw all triangles of a mesh.
+ ***********************************************************/
+void MeshLibrary::DrawMesh(int meshID) const
+{
+	// meshes still being uploaded have no triangles yet
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()) || (0 == m_meshes[meshID].indexCount))
+	{
+		return;
+	}
+
+	const GPU_MESH& mesh = m_meshes[meshID];
+	glBindVertexArray(mesh.vertexArray);
+	glDrawElements(GL_TRIANGLES, mesh.indexCount, mesh.indexType, NULL);
+	glBindVertexArray(0);
+	CountStateChanges(1);
+	CountDrawCalls(1);
+}
+
+/***********************************************************
+ *  DrawMeshlets()
+ *
+ *  This method is used to draw the visible meshlets of a mesh
+ *  with one multi draw, from commands the CPU culling wrote
+ *  into the bound draw indirect buffer.
+ ***********************************************************/
+void MeshLibrary::DrawMeshlets(int meshID, GLintptr commandOffset, GLsizei commandCount) const
+{
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()) || (commandCount <= 0))
+	{
+		return;
+	}
+
+	const GPU_MESH& mesh = m_meshes[meshID];
+	glBindVertexArray(mesh.vertexArray);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType, (const void*)commandOffset, commandCount, 0);
+	glBindVertexArray(0);
+	CountStateChanges(1);
+	CountDrawCalls(1);
+}
+
+/***********************************************************
+ *  GetDequantizeMatrix()
+ *
+ *  This method is used to get the transform that moves the
+ *  packed positions of a mesh back to their object space
+ *  size and place.
+ ***********************************************************/
+glm::mat4 MeshLibrary::GetDequantizeMatrix(int meshID) const
+{
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()))
+	{
+		return(glm::mat4(1.0f));
+	}
+
+	const GPU_MESH& mesh = m_meshes[meshID];
+	return(glm::translate(mesh.boundsCenter) * glm::scale(mesh.boundsExtent));
+}
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.h
+// ============
+// GPU vertex and index buffers of the meshes drawn in the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshCache.h"
+#include "Meshlets.h"
+#include "ThreadPool.h"
+#include "UploadQueue.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// a mesh uploaded to the GPU
+struct GPU_MESH
+{
+	MESH_KEY key;
+	// VERTEX_FORMAT of the vertex buffer
+	int vertexFormat;
+	GLuint vertexArray;
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	GLenum indexType;
+	GLsizei indexCount;
+	GLsizei vertexCount;
+	// maps the packed positions back into object space
+	glm::vec3 boundsCenter;
+	glm::vec3 boundsExtent;
+	// clusters of the index buffer, bounded in the packed
+	// position space
+	MESH_MESHLETS meshlets;
+};
+
+/***********************************************************
+ *  MeshLibrary
+ *
+ *  Loads meshes through the mesh cache and keeps one set of
+ *  buffers per mesh key, however often the mesh is drawn.
+ *  The packed vertices are uploaded as they are stored, the
+ *  model matrix of a draw has to include the mesh's
+ *  dequantize matrix and the draw data has to carry the
+ *  mesh's vertex format.
+ ***********************************************************/
+class MeshLibrary
+{
+public:
+	// constructor
+	MeshLibrary(const char* cacheDirectory);
+	// destructor
+	~MeshLibrary();
+
+	// pick the vertex format of the meshes loaded from now on
+	void SetVertexFormat(VERTEX_FORMAT format) { m_vertexFormat = format; }
+	VERTEX_FORMAT GetVertexFormat() const { return(m_vertexFormat); }
+
+	// load a primitive, returns its mesh id or -1
+	int LoadPrimitive(const MESH_KEY& key);
+	// import an OBJ or binary glTF file, returns its mesh id or -1
+	int LoadMeshFile(const char* filename, ThreadPool* pThreadPool);
+	// import a mesh file on the upload queue's loader thread, the
+	// returned mesh id draws nothing until the upload has finished
+	int RequestMeshFile(const char* filename, UploadQueue* pUploadQueue);
+	// free every loaded mesh
+	void DestroyMeshes();
+
+	// draw a loaded mesh with the active program
+	void DrawMesh(int meshID) const;
+	// draw the meshlet commands CullMeshlets() wrote at an offset
+	// of the bound draw indirect buffer
+	void DrawMeshlets(int meshID, GLintptr commandOffset, GLsizei commandCount) const;
+
+	// number of loaded meshes
+	int GetMeshCount() const { return((int)m_meshes.size()); }
+	// buffers and bounds of a loaded mesh
+	const GPU_MESH& GetMesh(int meshID) const { return(m_meshes[meshID]); }
+	// transform from the packed positions to object space
+	glm::mat4 GetDequantizeMatrix(int meshID) const;
+	// changes whenever a requested mesh replaces its placeholder,
+	// matrices built with the placeholder's bounds are stale then
+	unsigned int GetMeshVersion() const { return(m_meshVersion); }
+
+private:
+	// source of the packed meshes
+	MeshCache* m_pCache;
+	// vertex format used for new meshes
+	VERTEX_FORMAT m_vertexFormat;
+	// loaded meshes, indexed by mesh id
+	std::vector<GPU_MESH> m_meshes;
+	// bumped whenever a requested mesh is swapped in
+	unsigned int m_meshVersion;
+
+	// create the buffers of a packed mesh
+	int UploadMesh(const MESH_VIEW& view);
+	// copy a packed mesh into new buffers, any context of the
+	// share group can do this
+	static void CreateMeshBuffers(const MESH_VIEW& view, GPU_MESH* pMesh);
+	// describe the vertex layout of the buffers, vertex arrays only
+	// exist in the context that creates them
+	static void CreateVertexArray(GPU_MESH* pMesh);
+	// split a packed mesh into meshlets
+	static void BuildMeshMeshlets(const MESH_VIEW& view, GPU_MESH* pMesh);
+};
@@ -0,0 +1,365 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+// ============
+// reorder the triangles and vertices of a mesh for the GPU vertex caches
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// entries of the FIFO cache the reordering and the statistics
+	// assume, a common size for the post-transform caches
+	const int VERTEX_CACHE_SIZE = 16;
+	// remap entry of a vertex no triangle has used yet
+	const unsigned int UNUSED_VERTEX = 0xFFFFFFFF;
+
+	// triangles of a mesh listed per vertex, the triangles of
+	// vertex v are triangles[offsets[v]] to triangles[offsets[v + 1] - 1]
+	struct TRIANGLE_ADJACENCY
+	{
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> triangles;
+	};
+
+	// a run of reordered triangles and its place in the overdraw order
+	struct TRIANGLE_CLUSTER
+	{
+		size_t firstTriangle;
+		size_t triangleCount;
+		// how far the cluster faces away from the mesh center
+		float outwardDistance;
+	};
+
+	/***********************************************************
+	 *  IsTriangleList()
+	 *
+	 *  Check that the indices form whole triangles of existing
+	 *  vertices.
+	 ***********************************************************/
+	bool IsTriangleList(const MESH_DATA& mesh)
+	{
+		if ((mesh.indices.size() % 3) != 0)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			if (mesh.indices[i] >= mesh.vertices.size())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/***********************************************************
+	 *  BuildAdjacency()
+	 *
+	 *  List the triangles that use each vertex.
+	 ***********************************************************/
+	void BuildAdjacency(const MESH_DATA& mesh, TRIANGLE_ADJACENCY* pAdjacency)
+	{
+		size_t vertexCount = mesh.vertices.size();
+		pAdjacency->offsets.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			pAdjacency->offsets[mesh.indices[i] + 1]++;
+		}
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			pAdjacency->offsets[vertex + 1] += pAdjacency->offsets[vertex];
+		}
+
+		std::vector<unsigned int> fill(pAdjacency->offsets.begin(), pAdjacency->offsets.end() - 1);
+		pAdjacency->triangles.resize(mesh.indices.size());
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			pAdjacency->triangles[fill[mesh.indices[i]]++] = (unsigned int)(i / 3);
+		}
+	}
+
+	/***********************************************************
+	 *  SkipDeadEnd()
+	 *
+	 *  Find the next vertex to fan around when no vertex of the
+	 *  last fan has triangles left.  Recently used vertices are
+	 *  tried first, then the vertices in input order.  Returns -1
+	 *  when every triangle was emitted.
+	 ***********************************************************/
+	int SkipDeadEnd(std::vector<unsigned int>* pDeadEnds, const std::vector<int>& liveTriangles, size_t* pCursor)
+	{
+		while (!pDeadEnds->empty())
+		{
+			unsigned int vertex = pDeadEnds->back();
+			pDeadEnds->pop_back();
+			if (liveTriangles[vertex] > 0)
+			{
+				return((int)vertex);
+			}
+		}
+
+		while (*pCursor < liveTriangles.size())
+		{
+			if (liveTriangles[*pCursor] > 0)
+			{
+				return((int)*pCursor);
+			}
+			(*pCursor)++;
+		}
+		return(-1);
+	}
+
+	/***********************************************************
+	 *  SortClustersForOverdraw()
+	 *
+	 *  Put the clusters that face away from the center of the
+	 *  mesh first.  They are the ones most likely to cover the
+	 *  rest of the mesh, so the depth test rejects more of the
+	 *  later fragments.  The triangle order inside a cluster is
+	 *  kept, so the cache reuse only suffers at the seams.
+	 ***********************************************************/
+	void SortClustersForOverdraw(const MESH_DATA& mesh, const std::vector<size_t>& clusterStarts,
+		std::vector<unsigned int>* pIndices)
+	{
+		size_t triangleCount = pIndices->size() / 3;
+
+		glm::vec3 meshCenter = glm::vec3(0.0f);
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			meshCenter += mesh.vertices[i].position;
+		}
+		meshCenter /= (float)mesh.vertices.size();
+
+		std::vector<TRIANGLE_CLUSTER> clusters(clusterStarts.size());
+		for (size_t cluster = 0; cluster < clusters.size(); cluster++)
+		{
+			size_t first = clusterStarts[cluster];
+			size_t last = (cluster + 1 < clusterStarts.size()) ? clusterStarts[cluster + 1] : triangleCount;
+
+			// area weighted normal and center of the cluster
+			glm::vec3 normal = glm::vec3(0.0f);
+			glm::vec3 center = glm::vec3(0.0f);
+			float area = 0.0f;
+			for (size_t triangle = first; triangle < last; triangle++)
+			{
+				const glm::vec3& a = mesh.vertices[(*pIndices)[triangle * 3 + 0]].position;
+				const glm::vec3& b = mesh.vertices[(*pIndices)[triangle * 3 + 1]].position;
+				const glm::vec3& c = mesh.vertices[(*pIndices)[triangle * 3 + 2]].position;
+				glm::vec3 triangleNormal = glm::cross(b - a, c - a);
+				float triangleArea = glm::length(triangleNormal);
+				normal += triangleNormal;
+				center += (a + b + c) * (triangleArea / 3.0f);
+				area += triangleArea;
+			}
+
+			clusters[cluster].firstTriangle = first;
+			clusters[cluster].triangleCount = last - first;
+			clusters[cluster].outwardDistance = 0.0f;
+			if ((area > 0.0f) && (glm::length(normal) > 0.0f))
+			{
+				clusters[cluster].outwardDistance = glm::dot((center / area) - meshCenter, glm::normalize(normal));
+			}
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(),
+			[](const TRIANGLE_CLUSTER& a, const TRIANGLE_CLUSTER& b)
+			{
+				return(a.outwardDistance > b.outwardDistance);
+			});
+
+		std::vector<unsigned int> sorted;
+		sorted.reserve(pIndices->size());
+		for (size_t cluster = 0; cluster < clusters.size(); cluster++)
+		{
+			std::vector<unsigned int>::const_iterator first = pIndices->begin() + (clusters[cluster].firstTriangle * 3);
+			sorted.insert(sorted.end(), first, first + (clusters[cluster].triangleCount * 3));
+		}
+		pIndices->swap(sorted);
+	}
+}
+
+/***********************************************************
+ *  AnalyzeVertexCache()
+ *
+ *  Count the vertex shader runs the triangle order needs with
+ *  a FIFO post-transform cache.  A vertex is still cached when
+ *  fewer than VERTEX_CACHE_SIZE misses happened since it was
+ *  last loaded.
+ ***********************************************************/
+VERTEX_CACHE_STATS AnalyzeVertexCache(const MESH_DATA& mesh)
+{
+	VERTEX_CACHE_STATS stats;
+	stats.acmr = 0.0f;
+	stats.atvr = 0.0f;
+	if (mesh.indices.empty() || !IsTriangleList(mesh))
+	{
+		return(stats);
+	}
+
+	// miss count at the time each vertex was loaded, -1 for never
+	std::vector<int> loadTime(mesh.vertices.size(), -1);
+	int misses = 0;
+	int usedVertices = 0;
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		unsigned int vertex = mesh.indices[i];
+		if (loadTime[vertex] < 0)
+		{
+			usedVertices++;
+		}
+		if ((loadTime[vertex] < 0) || ((misses - loadTime[vertex]) >= VERTEX_CACHE_SIZE))
+		{
+			loadTime[vertex] = misses;
+			misses++;
+		}
+	}
+
+	stats.acmr = (float)misses / (float)(mesh.indices.size() / 3);
+	stats.atvr = (float)misses / (float)usedVertices;
+	return(stats);
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  Reorder the triangles with Tipsify (Sander, Nehab and
+ *  Barczak 2007).  The triangles around one vertex are emitted
+ *  as a fan, and the next fan is centered on the vertex of the
+ *  last fan that will still be in the cache after its own
+ *  remaining triangles are emitted.  Every time the walk runs
+ *  into a dead end a new cluster starts, and the clusters are
+ *  what the overdraw sort moves around.
+ ***********************************************************/
+void OptimizeVertexCache(MESH_DATA* pMesh, bool bSortOverdraw)
+{
+	if ((NULL == pMesh) || pMesh->indices.empty() || !IsTriangleList(*pMesh))
+	{
+		return;
+	}
+
+	size_t triangleCount = pMesh->indices.size() / 3;
+	TRIANGLE_ADJACENCY adjacency;
+	BuildAdjacency(*pMesh, &adjacency);
+
+	// triangles of each vertex that are not emitted yet
+	std::vector<int> liveTriangles(pMesh->vertices.size());
+	for (size_t vertex = 0; vertex < liveTriangles.size(); vertex++)
+	{
+		liveTriangles[vertex] = (int)(adjacency.offsets[vertex + 1] - adjacency.offsets[vertex]);
+	}
+	// time stamp of each vertex's last cache load
+	std::vector<int> cacheTime(pMesh->vertices.size(), 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> indices;
+	indices.reserve(pMesh->indices.size());
+	// first triangle of every cluster in the new order
+	std::vector<size_t> clusterStarts(1, 0);
+
+	int time = VERTEX_CACHE_SIZE + 1;
+	size_t cursor = 0;
+	int fanVertex = SkipDeadEnd(&deadEnds, liveTriangles, &cursor);
+	while (fanVertex >= 0)
+	{
+		candidates.clear();
+		for (unsigned int entry = adjacency.offsets[fanVertex]; entry < adjacency.offsets[fanVertex + 1]; entry++)
+		{
+			unsigned int triangle = adjacency.triangles[entry];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = pMesh->indices[triangle * 3 + corner];
+				indices.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if ((time - cacheTime[vertex]) > VERTEX_CACHE_SIZE)
+				{
+					cacheTime[vertex] = time;
+					time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// prefer the oldest candidate that stays cached while its
+		// remaining triangles are emitted, each of them can push
+		// at most two new vertices into the cache
+		int nextVertex = -1;
+		int bestPriority = -1;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			unsigned int vertex = candidates[i];
+			if (liveTriangles[vertex] <= 0)
+			{
+				continue;
+			}
+
+			int priority = 0;
+			if ((time - cacheTime[vertex] + 2 * liveTriangles[vertex]) <= VERTEX_CACHE_SIZE)
+			{
+				priority = time - cacheTime[vertex];
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				nextVertex = (int)vertex;
+			}
+		}
+
+		if (nextVertex < 0)
+		{
+			nextVertex = SkipDeadEnd(&deadEnds, liveTriangles, &cursor);
+			if ((nextVertex >= 0) && ((indices.size() / 3) > clusterStarts.back()))
+			{
+				clusterStarts.push_back(indices.size() / 3);
+			}
+		}
+		fanVertex = nextVertex;
+	}
+
+	if (bSortOverdraw && (clusterStarts.size() > 1))
+	{
+		SortClustersForOverdraw(*pMesh, clusterStarts, &indices);
+	}
+	pMesh->indices.swap(indices);
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  Renumber the vertices in the order of their first use, so
+ *  the vertex fetches walk through the vertex buffer instead
+ *  of jumping around in it.
+ ***********************************************************/
+void OptimizeVertexFetch(MESH_DATA* pMesh)
+{
+	if ((NULL == pMesh) || !IsTriangleList(*pMesh))
+	{
+		return;
+	}
+
+	std::vector<unsigned int> remap(pMesh->vertices.size(), UNUSED_VERTEX);
+	std::vector<MESH_VERTEX> vertices;
+	vertices.reserve(pMesh->vertices.size());
+	for (size_t i = 0; i < pMesh->indices.size(); i++)
+	{
+		unsigned int vertex = pMesh->indices[i];
+		if (UNUSED_VERTEX == remap[vertex])
+		{
+			remap[vertex] = (unsigned int)vertices.size();
+			vertices.push_back(pMesh->vertices[vertex]);
+		}
+		pMesh->indices[i] = remap[vertex];
+	}
+	pMesh->vertices.swap(vertices);
+}
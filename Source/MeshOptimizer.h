@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+// ============
+// reorder the triangles and vertices of a mesh for the GPU vertex caches
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGenerator.h"
+
+// how well a triangle order reuses transformed vertices, measured
+// with a FIFO post-transform cache
+struct VERTEX_CACHE_STATS
+{
+	// average cache misses per triangle, 0.5 is the best possible
+	// for a closed grid and 3 the worst
+	float acmr;
+	// average cache misses per vertex, 1 is the best possible
+	float atvr;
+};
+
+// simulate the post-transform cache over the triangles of a mesh
+VERTEX_CACHE_STATS AnalyzeVertexCache(const MESH_DATA& mesh);
+// reorder the triangles for post-transform cache reuse, and
+// optionally put the triangle clusters facing outward first so
+// they hide the ones behind them
+void OptimizeVertexCache(MESH_DATA* pMesh, bool bSortOverdraw);
+// renumber the vertices in the order the triangles first use them,
+// dropping vertices no triangle uses
+void OptimizeVertexFetch(MESH_DATA* pMesh);
@@ -0,0 +1,397 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlets.cpp
+// ============
+// split meshes into small triangle clusters that are culled one by one
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define MESHLET_CULLING_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// meshlets tested together
+	const int MESHLET_GROUP_SIZE = 4;
+	// radius of the padding meshlets, it puts them outside of
+	// every plane
+	const float PADDING_RADIUS = -1.0e30f;
+	// frustum planes the meshlets are tested against
+	const int CULLING_PLANES = 4;
+
+	/***********************************************************
+	 *  IsClosedMesh()
+	 *
+	 *  Check that every edge is shared by exactly two triangles.
+	 *  Vertices that were split at uv seams have the same
+	 *  position, so the edges are matched by welded position.
+	 ***********************************************************/
+	bool IsClosedMesh(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices)
+	{
+		std::vector<unsigned int> order(positions.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = (unsigned int)i;
+		}
+		// compared by value, so -0 and 0 weld together
+		std::sort(order.begin(), order.end(), [&positions](unsigned int a, unsigned int b)
+		{
+			const glm::vec3& pa = positions[a];
+			const glm::vec3& pb = positions[b];
+			if (pa.x != pb.x)
+			{
+				return(pa.x < pb.x);
+			}
+			if (pa.y != pb.y)
+			{
+				return(pa.y < pb.y);
+			}
+			return(pa.z < pb.z);
+		});
+
+		std::vector<unsigned int> welded(positions.size());
+		unsigned int weldedID = 0;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			if ((i > 0) && (positions[order[i]] != positions[order[i - 1]]))
+			{
+				weldedID++;
+			}
+			welded[order[i]] = weldedID;
+		}
+
+		std::vector<unsigned long long> edges;
+		edges.reserve(indices.size());
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			unsigned long long corners[3] = { welded[indices[i]], welded[indices[i + 1]], welded[indices[i + 2]] };
+
+			// triangles collapsed to a line, such as the ones at the
+			// poles of a sphere, cover nothing
+			if ((corners[0] == corners[1]) || (corners[1] == corners[2]) || (corners[2] == corners[0]))
+			{
+				continue;
+			}
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned long long a = corners[corner];
+				unsigned long long b = corners[(corner + 1) % 3];
+				edges.push_back((std::min(a, b) << 32) | std::max(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		for (size_t i = 0; i < edges.size(); i += 2)
+		{
+			if ((i + 1 >= edges.size()) || (edges[i] != edges[i + 1]) ||
+				((i + 2 < edges.size()) && (edges[i + 2] == edges[i])))
+			{
+				return false;
+			}
+		}
+		return(!edges.empty());
+	}
+
+	/***********************************************************
+	 *  SetMeshletBounds()
+	 *
+	 *  Work out the bounding sphere and the normal cone of one
+	 *  meshlet.  The cone holds every face normal, a meshlet is
+	 *  back facing when the camera looks at all of its faces
+	 *  from behind, and the cutoff is the sine of the cone's
+	 *  half angle so the test needs no trigonometry.
+	 ***********************************************************/
+	void SetMeshletBounds(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+		int meshlet, MESH_MESHLETS* pMeshlets)
+	{
+		GLuint first = pMeshlets->firstIndex[meshlet];
+		GLuint last = first + pMeshlets->indexCount[meshlet];
+
+		glm::vec3 boundsMin = positions[indices[first]];
+		glm::vec3 boundsMax = boundsMin;
+		glm::vec3 normalSum = glm::vec3(0.0f);
+		for (GLuint i = first; i < last; i += 3)
+		{
+			const glm::vec3& a = positions[indices[i]];
+			const glm::vec3& b = positions[indices[i + 1]];
+			const glm::vec3& c = positions[indices[i + 2]];
+			boundsMin = glm::min(glm::min(boundsMin, a), glm::min(b, c));
+			boundsMax = glm::max(glm::max(boundsMax, a), glm::max(b, c));
+
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			if (glm::length(normal) > 0.0f)
+			{
+				normalSum += glm::normalize(normal);
+			}
+		}
+
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
+		for (GLuint i = first; i < last; i++)
+		{
+			radius = std::max(radius, glm::length(positions[indices[i]] - center));
+		}
+
+		glm::vec3 axis = glm::vec3(0.0f);
+		float cutoff = 1.0f;
+		if (pMeshlets->bConeCulling && (glm::length(normalSum) > 0.0f))
+		{
+			axis = glm::normalize(normalSum);
+			float minimumDot = 1.0f;
+			for (GLuint i = first; i < last; i += 3)
+			{
+				const glm::vec3& a = positions[indices[i]];
+				glm::vec3 normal = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+				if (glm::length(normal) > 0.0f)
+				{
+					minimumDot = std::min(minimumDot, glm::dot(glm::normalize(normal), axis));
+				}
+			}
+
+			// a cone wider than a half sphere is never fully back facing
+			if (minimumDot > 0.0f)
+			{
+				cutoff = sqrtf(1.0f - (minimumDot * minimumDot));
+			}
+			else
+			{
+				axis = glm::vec3(0.0f);
+			}
+		}
+
+		float* pBounds = pMeshlets->bounds.data();
+		int padded = pMeshlets->paddedCount;
+		pBounds[(MESHLET_CENTER_X * padded) + meshlet] = center.x;
+		pBounds[(MESHLET_CENTER_Y * padded) + meshlet] = center.y;
+		pBounds[(MESHLET_CENTER_Z * padded) + meshlet] = center.z;
+		pBounds[(MESHLET_RADIUS * padded) + meshlet] = radius;
+		pBounds[(MESHLET_AXIS_X * padded) + meshlet] = axis.x;
+		pBounds[(MESHLET_AXIS_Y * padded) + meshlet] = axis.y;
+		pBounds[(MESHLET_AXIS_Z * padded) + meshlet] = axis.z;
+		pBounds[(MESHLET_CUTOFF * padded) + meshlet] = cutoff;
+	}
+}
+
+/***********************************************************
+ *  BuildMeshlets()
+ *
+ *  Walk the triangles in index order and start a new meshlet
+ *  whenever the next triangle would go over the vertex or the
+ *  triangle limit.  The index buffer is optimized for the
+ *  vertex cache before, so neighbouring triangles already
+ *  share most of their vertices and every meshlet stays a
+ *  single range of the index buffer.
+ ***********************************************************/
+void BuildMeshlets(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+	MESH_MESHLETS* pMeshlets)
+{
+	pMeshlets->firstIndex.clear();
+	pMeshlets->indexCount.clear();
+	pMeshlets->bounds.clear();
+	pMeshlets->meshletCount = 0;
+	pMeshlets->paddedCount = 0;
+	pMeshlets->bConeCulling = false;
+	if (indices.size() < 3)
+	{
+		return;
+	}
+
+	// meshlet that last used each vertex
+	std::vector<int> vertexMeshlet(positions.size(), -1);
+	int meshlet = 0;
+	int vertexCount = 0;
+	int triangleCount = 0;
+	size_t first = 0;
+	size_t triangleEnd = indices.size() - (indices.size() % 3);
+	for (size_t i = 0; i < triangleEnd; i += 3)
+	{
+		int newVertices = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			newVertices += (vertexMeshlet[indices[i + corner]] != meshlet) ? 1 : 0;
+		}
+
+		if ((MESHLET_MAX_TRIANGLES == triangleCount) || ((vertexCount + newVertices) > MESHLET_MAX_VERTICES))
+		{
+			pMeshlets->firstIndex.push_back((GLuint)first);
+			pMeshlets->indexCount.push_back((GLuint)(i - first));
+			first = i;
+			meshlet++;
+			vertexCount = 0;
+			triangleCount = 0;
+		}
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = indices[i + corner];
+			if (vertexMeshlet[vertex] != meshlet)
+			{
+				vertexMeshlet[vertex] = meshlet;
+				vertexCount++;
+			}
+		}
+		triangleCount++;
+	}
+	pMeshlets->firstIndex.push_back((GLuint)first);
+	pMeshlets->indexCount.push_back((GLuint)(triangleEnd - first));
+
+	pMeshlets->meshletCount = (int)pMeshlets->firstIndex.size();
+	pMeshlets->paddedCount = ((pMeshlets->meshletCount + MESHLET_GROUP_SIZE - 1) / MESHLET_GROUP_SIZE) * MESHLET_GROUP_SIZE;
+	pMeshlets->bConeCulling = IsClosedMesh(positions, indices);
+
+	pMeshlets->bounds.assign((size_t)MESHLET_BOUND_COUNT * pMeshlets->paddedCount, 0.0f);
+	for (int padding = pMeshlets->meshletCount; padding < pMeshlets->paddedCount; padding++)
+	{
+		pMeshlets->bounds[(MESHLET_RADIUS * pMeshlets->paddedCount) + padding] = PADDING_RADIUS;
+		pMeshlets->bounds[(MESHLET_CUTOFF * pMeshlets->paddedCount) + padding] = 1.0f;
+	}
+	for (int i = 0; i < pMeshlets->meshletCount; i++)
+	{
+		SetMeshletBounds(positions, indices, i, pMeshlets);
+	}
+}
+
+/***********************************************************
+ *  CullMeshlets()
+ *
+ *  Test the meshlets of one draw against the view.  The four
+ *  side planes of the frustum are moved into the meshlets'
+ *  space, where a sphere is outside a plane p when
+ *  dot(p.xyz, center) + p.w < -radius * length(p.xyz).  That
+ *  also holds for the ellipsoid a non-uniform scale turns the
+ *  sphere into, and the side planes alone already reject
+ *  everything behind the camera.  The cone test runs in the
+ *  same space with the camera moved into it, which gives the
+ *  world space answer as long as the model does not mirror.
+ ***********************************************************/
+int CullMeshlets(const MESH_MESHLETS& meshlets, const glm::mat4& model, const glm::mat4& viewProjection,
+	const glm::vec3& cameraPosition, DRAW_ELEMENTS_INDIRECT_COMMAND* pCommands, int* pVisibleCount)
+{
+	glm::mat4 modelViewProjection = viewProjection * model;
+	float planes[CULLING_PLANES][4];
+	float planeScale[CULLING_PLANES];
+	for (int plane = 0; plane < CULLING_PLANES; plane++)
+	{
+		int axis = plane / 2;
+		float sign = (0 == (plane % 2)) ? 1.0f : -1.0f;
+		for (int component = 0; component < 4; component++)
+		{
+			planes[plane][component] = modelViewProjection[component][3] + (sign * modelViewProjection[component][axis]);
+		}
+		planeScale[plane] = -glm::length(glm::vec3(planes[plane][0], planes[plane][1], planes[plane][2]));
+	}
+
+	glm::mat3 linear = glm::mat3(model);
+	bool bConeCulling = meshlets.bConeCulling && (glm::determinant(linear) > 0.0f);
+	glm::vec3 camera = glm::vec3(0.0f);
+	if (bConeCulling)
+	{
+		camera = glm::inverse(linear) * (cameraPosition - glm::vec3(model[3]));
+	}
+
+	int padded = meshlets.paddedCount;
+	const float* pBounds = meshlets.bounds.data();
+	const float* pCenterX = pBounds + (MESHLET_CENTER_X * padded);
+	const float* pCenterY = pBounds + (MESHLET_CENTER_Y * padded);
+	const float* pCenterZ = pBounds + (MESHLET_CENTER_Z * padded);
+	const float* pRadius = pBounds + (MESHLET_RADIUS * padded);
+	const float* pAxisX = pBounds + (MESHLET_AXIS_X * padded);
+	const float* pAxisY = pBounds + (MESHLET_AXIS_Y * padded);
+	const float* pAxisZ = pBounds + (MESHLET_AXIS_Z * padded);
+	const float* pCutoff = pBounds + (MESHLET_CUTOFF * padded);
+
+	int commandCount = 0;
+	int visibleCount = 0;
+	for (int group = 0; group < padded; group += MESHLET_GROUP_SIZE)
+	{
+		int visibleMask = 0;
+
+#ifdef MESHLET_CULLING_SSE
+		__m128 centerX = _mm_loadu_ps(pCenterX + group);
+		__m128 centerY = _mm_loadu_ps(pCenterY + group);
+		__m128 centerZ = _mm_loadu_ps(pCenterZ + group);
+		__m128 radius = _mm_loadu_ps(pRadius + group);
+		__m128 inside = _mm_cmpeq_ps(radius, radius);
+		for (int plane = 0; plane < CULLING_PLANES; plane++)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(planes[plane][0])), _mm_mul_ps(centerY, _mm_set1_ps(planes[plane][1]))),
+				_mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(planes[plane][2])), _mm_set1_ps(planes[plane][3])));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_mul_ps(radius, _mm_set1_ps(planeScale[plane]))));
+		}
+		if (bConeCulling)
+		{
+			__m128 offsetX = _mm_sub_ps(centerX, _mm_set1_ps(camera.x));
+			__m128 offsetY = _mm_sub_ps(centerY, _mm_set1_ps(camera.y));
+			__m128 offsetZ = _mm_sub_ps(centerZ, _mm_set1_ps(camera.z));
+			__m128 alongAxis = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(offsetX, _mm_loadu_ps(pAxisX + group)), _mm_mul_ps(offsetY, _mm_loadu_ps(pAxisY + group))),
+				_mm_mul_ps(offsetZ, _mm_loadu_ps(pAxisZ + group)));
+			__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY)), _mm_mul_ps(offsetZ, offsetZ)));
+			__m128 backFacing = _mm_cmpge_ps(alongAxis,
+				_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pCutoff + group), distance), radius));
+			inside = _mm_andnot_ps(backFacing, inside);
+		}
+		visibleMask = _mm_movemask_ps(inside);
+#else
+		for (int lane = 0; lane < MESHLET_GROUP_SIZE; lane++)
+		{
+			int i = group + lane;
+			bool bInside = true;
+			for (int plane = 0; plane < CULLING_PLANES; plane++)
+			{
+				float distance = (pCenterX[i] * planes[plane][0]) + (pCenterY[i] * planes[plane][1]) +
+					(pCenterZ[i] * planes[plane][2]) + planes[plane][3];
+				bInside = bInside && (distance >= (pRadius[i] * planeScale[plane]));
+			}
+			if (bInside && bConeCulling)
+			{
+				glm::vec3 offset = glm::vec3(pCenterX[i], pCenterY[i], pCenterZ[i]) - camera;
+				float alongAxis = glm::dot(offset, glm::vec3(pAxisX[i], pAxisY[i], pAxisZ[i]));
+				bInside = (alongAxis < ((pCutoff[i] * glm::length(offset)) + pRadius[i]));
+			}
+			visibleMask |= bInside ? (1 << lane) : 0;
+		}
+#endif
+
+		for (int lane = 0; lane < MESHLET_GROUP_SIZE; lane++)
+		{
+			int i = group + lane;
+			if ((0 == (visibleMask & (1 << lane))) || (i >= meshlets.meshletCount))
+			{
+				continue;
+			}
+
+			visibleCount++;
+			// meshlets are consecutive ranges, so a run of visible
+			// meshlets is drawn by one command
+			if ((commandCount > 0) &&
+				((pCommands[commandCount - 1].firstIndex + pCommands[commandCount - 1].count) == meshlets.firstIndex[i]))
+			{
+				pCommands[commandCount - 1].count += meshlets.indexCount[i];
+				continue;
+			}
+
+			DRAW_ELEMENTS_INDIRECT_COMMAND& command = pCommands[commandCount];
+			command.count = meshlets.indexCount[i];
+			command.instanceCount = 1;
+			command.firstIndex = meshlets.firstIndex[i];
+			command.baseVertex = 0;
+			command.baseInstance = 0;
+			commandCount++;
+		}
+	}
+
+	if (NULL != pVisibleCount)
+	{
+		*pVisibleCount = visibleCount;
+	}
+	return(commandCount);
+}
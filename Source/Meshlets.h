@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlets.h
+// ============
+// split meshes into small triangle clusters that are culled one by one
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// most vertices and triangles one meshlet may hold
+const int MESHLET_MAX_VERTICES = 64;
+const int MESHLET_MAX_TRIANGLES = 124;
+
+// one command of glMultiDrawElementsIndirect() as GL reads it
+struct DRAW_ELEMENTS_INDIRECT_COMMAND
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// the culling bounds of the meshlets are kept as one float array
+// per value, so four meshlets are tested with one SSE operation
+enum MESHLET_BOUND
+{
+	// bounding sphere
+	MESHLET_CENTER_X,
+	MESHLET_CENTER_Y,
+	MESHLET_CENTER_Z,
+	MESHLET_RADIUS,
+	// normal cone, a zero axis never counts as back facing
+	MESHLET_AXIS_X,
+	MESHLET_AXIS_Y,
+	MESHLET_AXIS_Z,
+	MESHLET_CUTOFF,
+	MESHLET_BOUND_COUNT
+};
+
+// the meshlets of one mesh, each is a run of consecutive
+// triangles of the mesh's index buffer
+struct MESH_MESHLETS
+{
+	// index range of every meshlet
+	std::vector<GLuint> firstIndex;
+	std::vector<GLuint> indexCount;
+	// MESHLET_BOUND_COUNT arrays of paddedCount floats, the
+	// padding meshlets are always outside the frustum
+	std::vector<float> bounds;
+	int meshletCount;
+	int paddedCount;
+	// only closed meshes can skip their back facing meshlets,
+	// the scene draws open surfaces from both sides
+	bool bConeCulling;
+};
+
+// split the triangle list into meshlets in index order, positions
+// are in the space the culling is done in
+void BuildMeshlets(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+	MESH_MESHLETS* pMeshlets);
+// write the draw commands of the meshlets that face the camera and
+// touch the view frustum, neighbouring visible meshlets share one
+// command, returns the number of commands written
+int CullMeshlets(const MESH_MESHLETS& meshlets, const glm::mat4& model, const glm::mat4& viewProjection,
+	const glm::vec3& cameraPosition, DRAW_ELEMENTS_INDIRECT_COMMAND* pCommands, int* pVisibleCount);
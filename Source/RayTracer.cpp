@@ -0,0 +1,891 @@
+///////////////////////////////////////////////////////////////////////////////
+// raytracer.cpp
+// ============
+// trace reference images of the recorded scene on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RayTracer.h"
+#include "SceneManager.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RAY_TRACER_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// pixels along each side of a tile handed to a thread
+	const int TILE_SIZE = 16;
+	// bins the centroids are sorted into when a node is split
+	const int BVH_BINS = 12;
+	// nodes with this many triangles or fewer are never split
+	const int BVH_LEAF_SIZE = 4;
+	// nodes up to this size become leaves when no split is cheaper
+	const int BVH_MAX_LEAF_SIZE = 16;
+	// deepest node, keeps the traversal stack bounded
+	const int BVH_MAX_DEPTH = 48;
+	const int TRAVERSAL_STACK_SIZE = BVH_MAX_DEPTH + 2;
+	// transparent surfaces a ray passes before it stops
+	const int MAX_LAYERS = 8;
+	// remaining weight below which a ray is not continued
+	const float MIN_LAYER_WEIGHT = 1.0f / 512.0f;
+	// shadow rays start this far off the surface, relative to the
+	// size of the position
+	const float SURFACE_OFFSET = 1.0e-4f;
+	// step past a transparent hit along the view ray, whose
+	// parameter runs from 0 at the near to 1 at the far plane
+	const float LAYER_STEP = 1.0e-6f;
+	// the image is cleared to opaque black like the GL paths
+	const unsigned int CLEAR_COLOR = 0xFF000000;
+
+	// pixel offsets of the packet lanes in a 2x2 quad
+	const int LANE_X[4] = { 0, 1, 0, 1 };
+	const int LANE_Y[4] = { 0, 0, 1, 1 };
+
+	/***********************************************************
+	 *  SurfaceArea()
+	 *
+	 *  Surface area of a box, the chance of a ray hitting it
+	 *  scales with it.
+	 ***********************************************************/
+	float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+		return(2.0f * ((size.x * size.y) + (size.y * size.z) + (size.z * size.x)));
+	}
+
+	/***********************************************************
+	 *  CountLanes()
+	 *
+	 *  Number of lanes set in a packet mask.
+	 ***********************************************************/
+	int CountLanes(int mask)
+	{
+		return((mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+	}
+}
+
+/***********************************************************
+ *  RayTracer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RayTracer::RayTracer()
+{
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_sampleGrid = 1;
+	m_inverseViewProjection = glm::mat4(1.0f);
+	m_rayCount = 0;
+	m_lastBuildTime = 0.0;
+	m_lastTraceTime = 0.0;
+	m_lastRayCount = 0;
+}
+
+/***********************************************************
+ *  ~RayTracer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RayTracer::~RayTracer()
+{
+	ReleaseResources();
+}
+
+/***********************************************************
+ *  ReleaseResources()
+ *
+ *  This method is used to drop the copied resources, the
+ *  flattened scene and the image.
+ ***********************************************************/
+void RayTracer::ReleaseResources()
+{
+	m_scene.ReleaseResources();
+	m_drawData.clear();
+	m_vertices.clear();
+	m_triangles.clear();
+	m_nodes.clear();
+	m_image.clear();
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  RenderImage()
+ *
+ *  This method is used to trace the view of the frame.  The
+ *  resources are copied and the hierarchy is built on the
+ *  calling thread, which owns the GL context, then the tiles
+ *  are traced on all threads of the pool.
+ ***********************************************************/
+bool RayTracer::RenderImage(SceneManager* pSceneManager, const FRAME_DATA& frameData, int width, int height,
+	int sampleGrid, ThreadPool* pThreadPool)
+{
+	if ((NULL == pSceneManager) || (NULL == pThreadPool) || (width <= 0) || (height <= 0))
+	{
+		return false;
+	}
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	m_scene.GatherShading(pSceneManager, frameData);
+	GatherTriangles(pSceneManager);
+	BuildHierarchy();
+
+	std::chrono::high_resolution_clock::time_point buildTime = std::chrono::high_resolution_clock::now();
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_sampleGrid = std::max(sampleGrid, 1);
+	m_image.assign((size_t)width * height, CLEAR_COLOR);
+	m_inverseViewProjection = glm::inverse(frameData.projection * frameData.view);
+	m_rayCount = 0;
+
+	pThreadPool->ParallelFor(m_tilesX * m_tilesY, [this](int tile)
+	{
+		TraceTile(tile);
+	});
+
+	std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+	m_lastBuildTime = std::chrono::duration<double, std::milli>(buildTime - startTime).count();
+	m_lastTraceTime = std::chrono::duration<double, std::milli>(endTime - buildTime).count();
+	m_lastRayCount = m_rayCount;
+
+	return true;
+}
+
+/***********************************************************
+ *  GatherTriangles()
+ *
+ *  This method is used to run the vertex shader over every
+ *  recorded draw and collect the triangles in world space.
+ *  Meshes still being uploaded are left out.
+ ***********************************************************/
+void RayTracer::GatherTriangles(SceneManager* pSceneManager)
+{
+	m_drawData.clear();
+	m_vertices.clear();
+	m_triangles.clear();
+
+	int drawCount = pSceneManager->GetDrawCommandCount();
+	const SceneManager::DRAW_COMMAND* pDrawCommands = pSceneManager->GetDrawCommands();
+	for (int draw = 0; draw < drawCount; draw++)
+	{
+		const CPU_MESH* pMesh = m_scene.FindMesh(pSceneManager, pSceneManager->GetMeshID(pDrawCommands[draw].mesh));
+		if (NULL == pMesh)
+		{
+			continue;
+		}
+
+		const DRAW_DATA& drawData = pDrawCommands[draw].drawData;
+		int drawIndex = (int)m_drawData.size();
+		m_drawData.push_back(drawData);
+
+		glm::mat3 normalMatrix = glm::mat3(glm::vec3(drawData.normalMatrix[0]), glm::vec3(drawData.normalMatrix[1]),
+			glm::vec3(drawData.normalMatrix[2]));
+		int firstVertex = (int)m_vertices.size();
+		for (size_t i = 0; i < pMesh->vertices.size(); i++)
+		{
+			const CPU_VERTEX& vertex = pMesh->vertices[i];
+			RT_VERTEX worldVertex;
+			worldVertex.position = glm::vec3(drawData.model * glm::vec4(vertex.position, 1.0f));
+			worldVertex.normal = normalMatrix * vertex.normal;
+			worldVertex.uv = vertex.uv;
+			m_vertices.push_back(worldVertex);
+		}
+
+		for (size_t i = 0; i + 2 < pMesh->indices.size(); i += 3)
+		{
+			RT_TRIANGLE triangle;
+			triangle.draw = drawIndex;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				triangle.vertices[corner] = firstVertex + (int)pMesh->indices[i + corner];
+			}
+			triangle.v0 = m_vertices[triangle.vertices[0]].position;
+			triangle.edge1 = m_vertices[triangle.vertices[1]].position - triangle.v0;
+			triangle.edge2 = m_vertices[triangle.vertices[2]].position - triangle.v0;
+
+			// collapsed triangles can never be hit
+			glm::vec3 cross = glm::cross(triangle.edge1, triangle.edge2);
+			if (glm::dot(cross, cross) > 0.0f)
+			{
+				m_triangles.push_back(triangle);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildHierarchy()
+ *
+ *  This method is used to build the bounding volume
+ *  hierarchy over the triangles from the top down, and to
+ *  store the triangles in leaf order.
+ ***********************************************************/
+void RayTracer::BuildHierarchy()
+{
+	m_nodes.clear();
+	int triangleCount = (int)m_triangles.size();
+	if (0 == triangleCount)
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centroids(triangleCount);
+	std::vector<glm::vec3> boundsMin(triangleCount);
+	std::vector<glm::vec3> boundsMax(triangleCount);
+	std::vector<int> order(triangleCount);
+	for (int i = 0; i < triangleCount; i++)
+	{
+		const RT_TRIANGLE& triangle = m_triangles[i];
+		glm::vec3 v1 = triangle.v0 + triangle.edge1;
+		glm::vec3 v2 = triangle.v0 + triangle.edge2;
+		boundsMin[i] = glm::min(glm::min(triangle.v0, v1), v2);
+		boundsMax[i] = glm::max(glm::max(triangle.v0, v1), v2);
+		centroids[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+		order[i] = i;
+	}
+
+	m_nodes.reserve((size_t)triangleCount * 2);
+	m_nodes.push_back(BVH_NODE());
+	BuildNode(0, 0, triangleCount, 0, &order, centroids, boundsMin, boundsMax);
+
+	std::vector<RT_TRIANGLE> sorted(triangleCount);
+	for (int i = 0; i < triangleCount; i++)
+	{
+		sorted[i] = m_triangles[order[i]];
+	}
+	m_triangles.swap(sorted);
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used to bound a run of triangles and split
+ *  it where the surface area heuristic expects the fewest
+ *  triangle tests.  The centroids are sorted into bins along
+ *  the axis they spread most on, and every boundary between
+ *  two bins is tried.  The left child is stored right after
+ *  its parent and built first.
+ ***********************************************************/
+void RayTracer::BuildNode(int nodeIndex, int first, int count, int depth, std::vector<int>* pOrder,
+	const std::vector<glm::vec3>& centroids, const std::vector<glm::vec3>& boundsMin,
+	const std::vector<glm::vec3>& boundsMax)
+{
+	std::vector<int>& order = *pOrder;
+
+	glm::vec3 nodeMin = glm::vec3(FLT_MAX);
+	glm::vec3 nodeMax = glm::vec3(-FLT_MAX);
+	glm::vec3 centroidMin = glm::vec3(FLT_MAX);
+	glm::vec3 centroidMax = glm::vec3(-FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		int triangle = order[i];
+		nodeMin = glm::min(nodeMin, boundsMin[triangle]);
+		nodeMax = glm::max(nodeMax, boundsMax[triangle]);
+		centroidMin = glm::min(centroidMin, centroids[triangle]);
+		centroidMax = glm::max(centroidMax, centroids[triangle]);
+	}
+
+	// every node starts out as a leaf
+	m_nodes[nodeIndex].boundsMin = nodeMin;
+	m_nodes[nodeIndex].boundsMax = nodeMax;
+	m_nodes[nodeIndex].offset = first;
+	m_nodes[nodeIndex].count = count;
+	m_nodes[nodeIndex].axis = 0;
+
+	if ((count <= BVH_LEAF_SIZE) || (depth >= BVH_MAX_DEPTH))
+	{
+		return;
+	}
+
+	glm::vec3 extent = centroidMax - centroidMin;
+	int axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+	if (extent[axis] <= 0.0f)
+	{
+		return;
+	}
+
+	float binScale = BVH_BINS / extent[axis];
+	float axisMin = centroidMin[axis];
+	int binCount[BVH_BINS] = { 0 };
+	glm::vec3 binMin[BVH_BINS];
+	glm::vec3 binMax[BVH_BINS];
+	for (int bin = 0; bin < BVH_BINS; bin++)
+	{
+		binMin[bin] = glm::vec3(FLT_MAX);
+		binMax[bin] = glm::vec3(-FLT_MAX);
+	}
+	for (int i = first; i < first + count; i++)
+	{
+		int triangle = order[i];
+		int bin = std::min((int)((centroids[triangle][axis] - axisMin) * binScale), BVH_BINS - 1);
+		binCount[bin]++;
+		binMin[bin] = glm::min(binMin[bin], boundsMin[triangle]);
+		binMax[bin] = glm::max(binMax[bin], boundsMax[triangle]);
+	}
+
+	// sweep from the right to get the area and count of every
+	// right side, then from the left to price each split
+	float rightArea[BVH_BINS];
+	int rightCount[BVH_BINS];
+	glm::vec3 sweepMin = glm::vec3(FLT_MAX);
+	glm::vec3 sweepMax = glm::vec3(-FLT_MAX);
+	int sweepCount = 0;
+	for (int bin = BVH_BINS - 1; bin > 0; bin--)
+	{
+		sweepMin = glm::min(sweepMin, binMin[bin]);
+		sweepMax = glm::max(sweepMax, binMax[bin]);
+		sweepCount += binCount[bin];
+		rightArea[bin] = (sweepCount > 0) ? SurfaceArea(sweepMin, sweepMax) : 0.0f;
+		rightCount[bin] = sweepCount;
+	}
+
+	float bestCost = FLT_MAX;
+	int bestSplit = -1;
+	sweepMin = glm::vec3(FLT_MAX);
+	sweepMax = glm::vec3(-FLT_MAX);
+	sweepCount = 0;
+	for (int bin = 0; bin < BVH_BINS - 1; bin++)
+	{
+		sweepMin = glm::min(sweepMin, binMin[bin]);
+		sweepMax = glm::max(sweepMax, binMax[bin]);
+		sweepCount += binCount[bin];
+		if ((0 == sweepCount) || (0 == rightCount[bin + 1]))
+		{
+			continue;
+		}
+		float cost = (sweepCount * SurfaceArea(sweepMin, sweepMax)) + (rightCount[bin + 1] * rightArea[bin + 1]);
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = bin;
+		}
+	}
+
+	// both costs leave out the area of the node itself, which
+	// scales them alike
+	float leafCost = count * SurfaceArea(nodeMin, nodeMax);
+	if ((bestSplit < 0) || ((bestCost >= leafCost) && (count <= BVH_MAX_LEAF_SIZE)))
+	{
+		return;
+	}
+
+	std::vector<int>::iterator middle = std::partition(order.begin() + first, order.begin() + first + count,
+		[&](int triangle)
+	{
+		int bin = std::min((int)((centroids[triangle][axis] - axisMin) * binScale), BVH_BINS - 1);
+		return(bin <= bestSplit);
+	});
+	int leftCount = (int)(middle - (order.begin() + first));
+	if ((0 == leftCount) || (count == leftCount))
+	{
+		return;
+	}
+
+	m_nodes[nodeIndex].count = 0;
+	m_nodes[nodeIndex].axis = axis;
+
+	int leftIndex = (int)m_nodes.size();
+	m_nodes.push_back(BVH_NODE());
+	BuildNode(leftIndex, first, leftCount, depth + 1, pOrder, centroids, boundsMin, boundsMax);
+
+	int rightIndex = (int)m_nodes.size();
+	m_nodes.push_back(BVH_NODE());
+	m_nodes[nodeIndex].offset = rightIndex;
+	BuildNode(rightIndex, first + leftCount, count - leftCount, depth + 1, pOrder, centroids, boundsMin, boundsMax);
+}
+
+/***********************************************************
+ *  PreparePacket()
+ *
+ *  This method is used to compute the inverse directions the
+ *  box tests divide by.
+ ***********************************************************/
+void RayTracer::PreparePacket(RAY_PACKET* pPacket)
+{
+	for (int lane = 0; lane < 4; lane++)
+	{
+		pPacket->inverseX[lane] = 1.0f / pPacket->directionX[lane];
+		pPacket->inverseY[lane] = 1.0f / pPacket->directionY[lane];
+		pPacket->inverseZ[lane] = 1.0f / pPacket->directionZ[lane];
+	}
+}
+
+/***********************************************************
+ *  IntersectBox()
+ *
+ *  This method is used to clip the ray of every lane against
+ *  the slabs of a node's box.
+ ***********************************************************/
+int RayTracer::IntersectBox(const BVH_NODE& node, const RAY_PACKET& packet, int mask)
+{
+#ifdef RAY_TRACER_SSE
+	__m128 originX = _mm_loadu_ps(packet.originX);
+	__m128 originY = _mm_loadu_ps(packet.originY);
+	__m128 originZ = _mm_loadu_ps(packet.originZ);
+	__m128 inverseX = _mm_loadu_ps(packet.inverseX);
+	__m128 inverseY = _mm_loadu_ps(packet.inverseY);
+	__m128 inverseZ = _mm_loadu_ps(packet.inverseZ);
+
+	__m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.x), originX), inverseX);
+	__m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.x), originX), inverseX);
+	__m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.y), originY), inverseY);
+	__m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.y), originY), inverseY);
+	__m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.z), originZ), inverseZ);
+	__m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.z), originZ), inverseZ);
+
+	__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(nearX, farX), _mm_min_ps(nearY, farY)),
+		_mm_max_ps(_mm_min_ps(nearZ, farZ), _mm_loadu_ps(packet.tMin)));
+	__m128 leave = _mm_min_ps(_mm_min_ps(_mm_max_ps(nearX, farX), _mm_max_ps(nearY, farY)),
+		_mm_min_ps(_mm_max_ps(nearZ, farZ), _mm_loadu_ps(packet.tMax)));
+	return(mask & _mm_movemask_ps(_mm_cmple_ps(enter, leave)));
+#else
+	int hitMask = 0;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if (0 == (mask & (1 << lane)))
+		{
+			continue;
+		}
+		float nearX = (node.boundsMin.x - packet.originX[lane]) * packet.inverseX[lane];
+		float farX = (node.boundsMax.x - packet.originX[lane]) * packet.inverseX[lane];
+		float nearY = (node.boundsMin.y - packet.originY[lane]) * packet.inverseY[lane];
+		float farY = (node.boundsMax.y - packet.originY[lane]) * packet.inverseY[lane];
+		float nearZ = (node.boundsMin.z - packet.originZ[lane]) * packet.inverseZ[lane];
+		float farZ = (node.boundsMax.z - packet.originZ[lane]) * packet.inverseZ[lane];
+		float enter = std::max(std::max(std::min(nearX, farX), std::min(nearY, farY)),
+			std::max(std::min(nearZ, farZ), packet.tMin[lane]));
+		float leave = std::min(std::min(std::max(nearX, farX), std::max(nearY, farY)),
+			std::min(std::max(nearZ, farZ), packet.tMax[lane]));
+		if (enter <= leave)
+		{
+			hitMask |= 1 << lane;
+		}
+	}
+	return(hitMask);
+#endif
+}
+
+/***********************************************************
+ *  IntersectTriangle()
+ *
+ *  This method is used to test the rays of a packet against
+ *  one triangle with the Moller-Trumbore test.  Both sides of
+ *  a triangle are hit, the scene is drawn without culling.
+ ***********************************************************/
+int RayTracer::IntersectTriangle(const RT_TRIANGLE& triangle, int triangleIndex, RAY_PACKET* pPacket, int mask)
+{
+	float t[4];
+	float u[4];
+	float v[4];
+#ifdef RAY_TRACER_SSE
+	__m128 directionX = _mm_loadu_ps(pPacket->directionX);
+	__m128 directionY = _mm_loadu_ps(pPacket->directionY);
+	__m128 directionZ = _mm_loadu_ps(pPacket->directionZ);
+	__m128 edge1X = _mm_set1_ps(triangle.edge1.x);
+	__m128 edge1Y = _mm_set1_ps(triangle.edge1.y);
+	__m128 edge1Z = _mm_set1_ps(triangle.edge1.z);
+	__m128 edge2X = _mm_set1_ps(triangle.edge2.x);
+	__m128 edge2Y = _mm_set1_ps(triangle.edge2.y);
+	__m128 edge2Z = _mm_set1_ps(triangle.edge2.z);
+
+	// p = direction x edge2
+	__m128 pX = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(directionZ, edge2Y));
+	__m128 pY = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(directionX, edge2Z));
+	__m128 pZ = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(directionY, edge2X));
+	__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+	__m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+	// s = origin - v0, q = s x edge1
+	__m128 sX = _mm_sub_ps(_mm_loadu_ps(pPacket->originX), _mm_set1_ps(triangle.v0.x));
+	__m128 sY = _mm_sub_ps(_mm_loadu_ps(pPacket->originY), _mm_set1_ps(triangle.v0.y));
+	__m128 sZ = _mm_sub_ps(_mm_loadu_ps(pPacket->originZ), _mm_set1_ps(triangle.v0.z));
+	__m128 qX = _mm_sub_ps(_mm_mul_ps(sY, edge1Z), _mm_mul_ps(sZ, edge1Y));
+	__m128 qY = _mm_sub_ps(_mm_mul_ps(sZ, edge1X), _mm_mul_ps(sX, edge1Z));
+	__m128 qZ = _mm_sub_ps(_mm_mul_ps(sX, edge1Y), _mm_mul_ps(sY, edge1X));
+
+	__m128 hitU = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, pX), _mm_mul_ps(sY, pY)), _mm_mul_ps(sZ, pZ)), inverse);
+	__m128 hitV = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX), _mm_mul_ps(directionY, qY)),
+		_mm_mul_ps(directionZ, qZ)), inverse);
+	__m128 hitT = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)),
+		_mm_mul_ps(edge2Z, qZ)), inverse);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 hit = _mm_cmpneq_ps(determinant, zero);
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(hitU, zero));
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(hitV, zero));
+	hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(hitU, hitV), _mm_set1_ps(1.0f)));
+	hit = _mm_and_ps(hit, _mm_cmpgt_ps(hitT, _mm_loadu_ps(pPacket->tMin)));
+	hit = _mm_and_ps(hit, _mm_cmplt_ps(hitT, _mm_loadu_ps(pPacket->tMax)));
+	mask &= _mm_movemask_ps(hit);
+	if (0 == mask)
+	{
+		return(0);
+	}
+	_mm_storeu_ps(t, hitT);
+	_mm_storeu_ps(u, hitU);
+	_mm_storeu_ps(v, hitV);
+#else
+	int hitMask = 0;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if (0 == (mask & (1 << lane)))
+		{
+			continue;
+		}
+		glm::vec3 direction = glm::vec3(pPacket->directionX[lane], pPacket->directionY[lane], pPacket->directionZ[lane]);
+		glm::vec3 p = glm::cross(direction, triangle.edge2);
+		float determinant = glm::dot(triangle.edge1, p);
+		if (0.0f == determinant)
+		{
+			continue;
+		}
+		float inverse = 1.0f / determinant;
+		glm::vec3 s = glm::vec3(pPacket->originX[lane], pPacket->originY[lane], pPacket->originZ[lane]) - triangle.v0;
+		glm::vec3 q = glm::cross(s, triangle.edge1);
+		u[lane] = glm::dot(s, p) * inverse;
+		v[lane] = glm::dot(direction, q) * inverse;
+		t[lane] = glm::dot(triangle.edge2, q) * inverse;
+		if ((u[lane] >= 0.0f) && (v[lane] >= 0.0f) && ((u[lane] + v[lane]) <= 1.0f) &&
+			(t[lane] > pPacket->tMin[lane]) && (t[lane] < pPacket->tMax[lane]))
+		{
+			hitMask |= 1 << lane;
+		}
+	}
+	mask = hitMask;
+#endif
+
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if (0 != (mask & (1 << lane)))
+		{
+			pPacket->tMax[lane] = t[lane];
+			pPacket->triangle[lane] = triangleIndex;
+			pPacket->u[lane] = u[lane];
+			pPacket->v[lane] = v[lane];
+		}
+	}
+	return(mask);
+}
+
+/***********************************************************
+ *  IntersectPacket()
+ *
+ *  This method is used to find the closest triangle of every
+ *  active lane.  The packet walks the hierarchy together, a
+ *  node is entered when any lane passes through its box, and
+ *  the child on the side the rays come from is visited first.
+ ***********************************************************/
+void RayTracer::IntersectPacket(RAY_PACKET* pPacket) const
+{
+	for (int lane = 0; lane < 4; lane++)
+	{
+		pPacket->triangle[lane] = -1;
+	}
+	if (m_nodes.empty() || (0 == pPacket->activeMask))
+	{
+		return;
+	}
+
+	// the rays of a packet point the same way, one lane decides
+	int leadLane = 0;
+	while (0 == (pPacket->activeMask & (1 << leadLane)))
+	{
+		leadLane++;
+	}
+	const float* pDirections[3] = { pPacket->directionX, pPacket->directionY, pPacket->directionZ };
+
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+	int nodeIndex = 0;
+	while (true)
+	{
+		const BVH_NODE& node = m_nodes[nodeIndex];
+		if (0 != IntersectBox(node, *pPacket, pPacket->activeMask))
+		{
+			if (0 == node.count)
+			{
+				bool bLeftFirst = (pDirections[node.axis][leadLane] >= 0.0f);
+				stack[stackSize++] = bLeftFirst ? node.offset : nodeIndex + 1;
+				nodeIndex = bLeftFirst ? nodeIndex + 1 : node.offset;
+				continue;
+			}
+
+			for (int i = node.offset; i < node.offset + node.count; i++)
+			{
+				IntersectTriangle(m_triangles[i], i, pPacket, pPacket->activeMask);
+			}
+		}
+
+		if (0 == stackSize)
+		{
+			break;
+		}
+		nodeIndex = stack[--stackSize];
+	}
+}
+
+/***********************************************************
+ *  OccludedPacket()
+ *
+ *  This method is used to find the lanes blocked by any
+ *  triangle before their tMax.  A lane stops walking the
+ *  hierarchy as soon as it is blocked.
+ ***********************************************************/
+int RayTracer::OccludedPacket(RAY_PACKET* pPacket) const
+{
+	int blocked = 0;
+	int open = pPacket->activeMask;
+	if (m_nodes.empty() || (0 == open))
+	{
+		return(0);
+	}
+
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+	int nodeIndex = 0;
+	while (0 != open)
+	{
+		const BVH_NODE& node = m_nodes[nodeIndex];
+		if (0 != IntersectBox(node, *pPacket, open))
+		{
+			if (0 == node.count)
+			{
+				stack[stackSize++] = node.offset;
+				nodeIndex = nodeIndex + 1;
+				continue;
+			}
+
+			for (int i = node.offset; (i < node.offset + node.count) && (0 != open); i++)
+			{
+				int hits = IntersectTriangle(m_triangles[i], i, pPacket, open);
+				blocked |= hits;
+				open &= ~hits;
+			}
+		}
+
+		if (0 == stackSize)
+		{
+			break;
+		}
+		nodeIndex = stack[--stackSize];
+	}
+
+	return(blocked);
+}
+
+/***********************************************************
+ *  TraceTile()
+ *
+ *  This method is used to trace the pixels of one tile, a
+ *  2x2 quad per packet and one packet per sample.  Every hit
+ *  sends a packet of shadow rays toward each light that can
+ *  reach it.  Surfaces that are not opaque add their share and
+ *  let the ray go on to the surfaces behind them.
+ ***********************************************************/
+void RayTracer::TraceTile(int tile)
+{
+	int tileX0 = (tile % m_tilesX) * TILE_SIZE;
+	int tileY0 = (tile / m_tilesX) * TILE_SIZE;
+	int tileX1 = std::min(tileX0 + TILE_SIZE, m_width);
+	int tileY1 = std::min(tileY0 + TILE_SIZE, m_height);
+
+	const CPU_SHADING& shading = m_scene.GetShading();
+	int lightCount = shading.lightCount;
+	std::vector<float> visibility((size_t)std::max(lightCount, 1) * 4, 1.0f);
+	float sampleWeight = 1.0f / (m_sampleGrid * m_sampleGrid);
+	unsigned long long rayCount = 0;
+
+	for (int quadY = tileY0; quadY < tileY1; quadY += 2)
+	{
+		for (int quadX = tileX0; quadX < tileX1; quadX += 2)
+		{
+			// the lanes past the edge of the tile
+			int quadMask = 0xF;
+			if (quadX + 1 >= tileX1)
+			{
+				quadMask &= 0x5;
+			}
+			if (quadY + 1 >= tileY1)
+			{
+				quadMask &= 0x3;
+			}
+
+			glm::vec3 color[4] = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f) };
+			for (int sample = 0; sample < m_sampleGrid * m_sampleGrid; sample++)
+			{
+				float sampleX = ((sample % m_sampleGrid) + 0.5f) / m_sampleGrid;
+				float sampleY = ((sample / m_sampleGrid) + 0.5f) / m_sampleGrid;
+
+				// view rays from the near to the far plane, so the
+				// same depth range is seen as by the raster paths
+				RAY_PACKET packet;
+				float weight[4];
+				for (int lane = 0; lane < 4; lane++)
+				{
+					float ndcX = (((quadX + LANE_X[lane] + sampleX) / m_width) * 2.0f) - 1.0f;
+					float ndcY = (((quadY + LANE_Y[lane] + sampleY) / m_height) * 2.0f) - 1.0f;
+					glm::vec4 nearPoint = m_inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+					glm::vec4 farPoint = m_inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+					glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+					glm::vec3 direction = (glm::vec3(farPoint) / farPoint.w) - origin;
+					packet.originX[lane] = origin.x;
+					packet.originY[lane] = origin.y;
+					packet.originZ[lane] = origin.z;
+					packet.directionX[lane] = direction.x;
+					packet.directionY[lane] = direction.y;
+					packet.directionZ[lane] = direction.z;
+					packet.tMin[lane] = 0.0f;
+					packet.tMax[lane] = 1.0f;
+					weight[lane] = 1.0f;
+				}
+				packet.activeMask = quadMask;
+				PreparePacket(&packet);
+
+				for (int layer = 0; (layer < MAX_LAYERS) && (0 != packet.activeMask); layer++)
+				{
+					IntersectPacket(&packet);
+					rayCount += CountLanes(packet.activeMask);
+
+					// surface values of the lanes that hit something
+					int hitMask = 0;
+					glm::vec3 position[4];
+					glm::vec3 normal[4];
+					glm::vec3 offset[4];
+					glm::vec2 uv[4];
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if ((0 == (packet.activeMask & (1 << lane))) || (packet.triangle[lane] < 0))
+						{
+							continue;
+						}
+						hitMask |= 1 << lane;
+
+						const RT_TRIANGLE& triangle = m_triangles[packet.triangle[lane]];
+						const RT_VERTEX& a = m_vertices[triangle.vertices[0]];
+						const RT_VERTEX& b = m_vertices[triangle.vertices[1]];
+						const RT_VERTEX& c = m_vertices[triangle.vertices[2]];
+						float w = 1.0f - packet.u[lane] - packet.v[lane];
+						position[lane] = (a.position * w) + (b.position * packet.u[lane]) + (c.position * packet.v[lane]);
+						normal[lane] = (a.normal * w) + (b.normal * packet.u[lane]) + (c.normal * packet.v[lane]);
+						uv[lane] = (a.uv * w) + (b.uv * packet.u[lane]) + (c.uv * packet.v[lane]);
+
+						// shadow rays leave from the side the view ray came from
+						glm::vec3 faceNormal = glm::normalize(glm::cross(triangle.edge1, triangle.edge2));
+						glm::vec3 direction = glm::vec3(packet.directionX[lane], packet.directionY[lane], packet.directionZ[lane]);
+						if (glm::dot(faceNormal, direction) > 0.0f)
+						{
+							faceNormal = -faceNormal;
+						}
+						glm::vec3 size = glm::abs(position[lane]);
+						offset[lane] = faceNormal * (SURFACE_OFFSET * (1.0f + std::max(std::max(size.x, size.y), size.z)));
+					}
+
+					for (int light = 0; light < lightCount; light++)
+					{
+						const LIGHT_DATA& lightData = shading.pLights[light];
+						glm::vec3 lightPosition = glm::vec3(lightData.position);
+
+						RAY_PACKET shadow;
+						shadow.activeMask = 0;
+						for (int lane = 0; lane < 4; lane++)
+						{
+							visibility[(lane * lightCount) + light] = 1.0f;
+							if (0 == (hitMask & (1 << lane)))
+							{
+								shadow.originX[lane] = 0.0f;
+								shadow.originY[lane] = 0.0f;
+								shadow.originZ[lane] = 0.0f;
+								shadow.directionX[lane] = 1.0f;
+								shadow.directionY[lane] = 1.0f;
+								shadow.directionZ[lane] = 1.0f;
+								shadow.tMin[lane] = 0.0f;
+								shadow.tMax[lane] = 0.0f;
+								continue;
+							}
+
+							// lights past their radius add nothing to shadow
+							glm::vec3 origin = position[lane] + offset[lane];
+							glm::vec3 toLight = lightPosition - origin;
+							shadow.originX[lane] = origin.x;
+							shadow.originY[lane] = origin.y;
+							shadow.originZ[lane] = origin.z;
+							shadow.directionX[lane] = toLight.x;
+							shadow.directionY[lane] = toLight.y;
+							shadow.directionZ[lane] = toLight.z;
+							shadow.tMin[lane] = 0.0f;
+							shadow.tMax[lane] = 1.0f;
+							if ((lightData.position.w <= 0.0f) || (glm::length(toLight) < lightData.position.w))
+							{
+								shadow.activeMask |= 1 << lane;
+							}
+						}
+						if (0 == shadow.activeMask)
+						{
+							continue;
+						}
+
+						PreparePacket(&shadow);
+						rayCount += CountLanes(shadow.activeMask);
+						int blocked = OccludedPacket(&shadow);
+						for (int lane = 0; lane < 4; lane++)
+						{
+							if (0 != (blocked & (1 << lane)))
+							{
+								visibility[(lane * lightCount) + light] = 0.0f;
+							}
+						}
+					}
+
+					// the framebuffer clamps every color before blending
+					int nextMask = 0;
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if (0 == (hitMask & (1 << lane)))
+						{
+							continue;
+						}
+
+						const RT_TRIANGLE& triangle = m_triangles[packet.triangle[lane]];
+						glm::vec4 surface = ShadeSurface(shading, m_drawData[triangle.draw], position[lane], normal[lane],
+							uv[lane], 0.0f, (lightCount > 0) ? &visibility[lane * lightCount] : NULL);
+						surface = glm::clamp(surface, 0.0f, 1.0f);
+						color[lane] += glm::vec3(surface) * (surface.w * weight[lane] * sampleWeight);
+						weight[lane] *= 1.0f - surface.w;
+
+						if (weight[lane] > MIN_LAYER_WEIGHT)
+						{
+							packet.tMin[lane] = packet.tMax[lane] + LAYER_STEP;
+							packet.tMax[lane] = 1.0f;
+							nextMask |= 1 << lane;
+						}
+					}
+					packet.activeMask = nextMask;
+				}
+			}
+
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (0 != (quadMask & (1 << lane)))
+				{
+					m_image[((size_t)(quadY + LANE_Y[lane]) * m_width) + quadX + LANE_X[lane]] =
+						PackRGBA8(glm::vec4(color[lane], 1.0f));
+				}
+			}
+		}
+	}
+
+	m_rayCount += rayCount;
+}
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// raytracer.h
+// ============
+// trace reference images of the recorded scene on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CpuScene.h"
+#include "ShaderInterface.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <vector>
+
+class SceneManager;
+
+/***********************************************************
+ *  RayTracer
+ *
+ *  Traces the draws SceneManager recorded for a frame with
+ *  the lighting of fragmentShader.glsl, but with exact shadow
+ *  rays toward every light and transparent surfaces blended
+ *  in depth order, as a reference for the raster paths.  The
+ *  draws are flattened into world space triangles under one
+ *  bounding volume hierarchy built with the surface area
+ *  heuristic.  Rays travel in packets of four, one per pixel
+ *  of a 2x2 quad, tested against the boxes and triangles with
+ *  SSE, and the tiles of the image are spread over the
+ *  threads of a pool.
+ ***********************************************************/
+class RayTracer
+{
+public:
+	// constructor
+	RayTracer();
+	// destructor
+	~RayTracer();
+
+	// build the hierarchy over the draws recorded for the frame and
+	// trace the view, with sampleGrid x sampleGrid samples per pixel
+	bool RenderImage(SceneManager* pSceneManager, const FRAME_DATA& frameData, int width, int height,
+		int sampleGrid, ThreadPool* pThreadPool);
+	// forget the copied meshes and textures and free the image
+	void ReleaseResources();
+
+	// RGBA8 pixels with the bottom row first, as glReadPixels
+	// returns them
+	const unsigned int* GetImage() const { return(m_image.data()); }
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+
+	// statistics of the last image
+	double GetLastBuildTime() const { return(m_lastBuildTime); }
+	double GetLastTraceTime() const { return(m_lastTraceTime); }
+	unsigned long long GetLastRayCount() const { return(m_lastRayCount); }
+	int GetTriangleCount() const { return((int)m_triangles.size()); }
+	int GetNodeCount() const { return((int)m_nodes.size()); }
+
+private:
+	// a vertex of the flattened scene in world space
+	struct RT_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// a triangle as the intersection test reads it
+	struct RT_TRIANGLE
+	{
+		glm::vec3 v0;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+		// draw the triangle belongs to and its corners
+		int draw;
+		int vertices[3];
+	};
+
+	// a node of the hierarchy, laid out depth first so the left
+	// child of an inner node always follows it
+	struct BVH_NODE
+	{
+		glm::vec3 boundsMin;
+		// first triangle of a leaf, right child of an inner node
+		int offset;
+		glm::vec3 boundsMax;
+		// triangles of a leaf, 0 for an inner node
+		int count;
+		// axis the inner node was split along
+		int axis;
+	};
+
+	// four rays traced together, one value of every ray per lane
+	struct RAY_PACKET
+	{
+		float originX[4];
+		float originY[4];
+		float originZ[4];
+		float directionX[4];
+		float directionY[4];
+		float directionZ[4];
+		float inverseX[4];
+		float inverseY[4];
+		float inverseZ[4];
+		float tMin[4];
+		float tMax[4];
+		// closest triangle and its barycentrics, -1 for a miss
+		int triangle[4];
+		float u[4];
+		float v[4];
+		// lanes that carry a ray
+		int activeMask;
+	};
+
+	// copied meshes and textures and the shading of the frame
+	CpuScene m_scene;
+	// draws of the frame and the flattened scene
+	std::vector<DRAW_DATA> m_drawData;
+	std::vector<RT_VERTEX> m_vertices;
+	std::vector<RT_TRIANGLE> m_triangles;
+	std::vector<BVH_NODE> m_nodes;
+
+	// image and the view it is traced from
+	std::vector<unsigned int> m_image;
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	int m_sampleGrid;
+	glm::mat4 m_inverseViewProjection;
+
+	// rays of the image, summed by the tile threads
+	std::atomic<unsigned long long> m_rayCount;
+	// statistics of the last image
+	double m_lastBuildTime;
+	double m_lastTraceTime;
+	unsigned long long m_lastRayCount;
+
+	// transform the draws into world space triangles
+	void GatherTriangles(SceneManager* pSceneManager);
+	// build the hierarchy over the gathered triangles
+	void BuildHierarchy();
+	void BuildNode(int nodeIndex, int first, int count, int depth, std::vector<int>* pOrder,
+		const std::vector<glm::vec3>& centroids, const std::vector<glm::vec3>& boundsMin,
+		const std::vector<glm::vec3>& boundsMax);
+	// closest hits of a packet
+	void IntersectPacket(RAY_PACKET* pPacket) const;
+	// lanes of a packet blocked before their tMax
+	int OccludedPacket(RAY_PACKET* pPacket) const;
+	// lanes of a packet whose rays pass through a node's box
+	static int IntersectBox(const BVH_NODE& node, const RAY_PACKET& packet, int mask);
+	// test the lanes of a packet against one triangle, returns
+	// the lanes it hits closer than their tMax and shortens them
+	static int IntersectTriangle(const RT_TRIANGLE& triangle, int triangleIndex, RAY_PACKET* pPacket, int mask);
+	// fill in the inverse directions of a packet
+	static void PreparePacket(RAY_PACKET* pPacket);
+	// trace all samples of one tile
+	void TraceTile(int tile);
+};
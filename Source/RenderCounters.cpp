@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendercounters.cpp
+// ============
+// count the draw calls and state changes the render thread issues
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderCounters.h"
+
+// declaration of global variables
+namespace
+{
+	// counts of the render thread
+	RENDER_COUNTERS g_renderCounters = { 0, 0 };
+}
+
+/***********************************************************
+ *  CountDrawCalls() / CountStateChanges()
+ *
+ *  The counters are plain integers, GL calls are only made
+ *  on the render thread.
+ ***********************************************************/
+void CountDrawCalls(int count)
+{
+	g_renderCounters.drawCalls += count;
+}
+
+void CountStateChanges(int count)
+{
+	g_renderCounters.stateChanges += count;
+}
+
+const RENDER_COUNTERS& GetRenderCounters()
+{
+	return(g_renderCounters);
+}
+
+void ResetRenderCounters()
+{
+	g_renderCounters.drawCalls = 0;
+	g_renderCounters.stateChanges = 0;
+}
@@ -0,0 +1,25 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendercounters.h
+// ============
+// count the draw calls and state changes the render thread issues
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// GL calls issued since the counters were last reset
+struct RENDER_COUNTERS
+{
+	// draw calls, a multi draw counts once
+	unsigned long long drawCalls;
+	// program, framebuffer, texture, vertex array and buffer range
+	// binds, a bind and the reset after it count once
+	unsigned long long stateChanges;
+};
+
+// add to the counters, only the render thread may call these
+void CountDrawCalls(int count);
+void CountStateChanges(int count);
+
+// counts since the last reset
+const RENDER_COUNTERS& GetRenderCounters();
+void ResetRenderCounters();
@@ -0,0 +1,934 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderpipeline.cpp
+// ============
+// choose between the forward, the deferred and the software path for the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderPipeline.h"
+#include "RenderCounters.h"
+#include "ResourceTracker.h"
+#include "SceneManager.h"
+#include "ShadowManager.h"
+#include "SoftwareRasterizer.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texture unit of the first geometry buffer attachment, the
+	// units below it stay with the scene textures
+	const int GBUFFER_TEXTURE_UNIT = 16;
+	// albedo, normal and material index attachments, plus the depth
+	const GLenum GBUFFER_COLOR_FORMATS[3] = { GL_RGBA8, GL_RGB10_A2, GL_R16UI };
+	const int GBUFFER_COLOR_COUNT = 3;
+	const GLenum GBUFFER_DEPTH_FORMAT = GL_DEPTH_COMPONENT32F;
+	// vertices of a light volume box
+	const int LIGHT_VOLUME_VERTICES = 36;
+	// texture unit the upscale pass reads the scene from, above
+	// the geometry buffer and the shadow maps
+	const int UPSCALE_TEXTURE_UNIT = 22;
+	// sharpening of the upscale pass, 0 for plain bilinear
+	const float UPSCALE_SHARPNESS = 0.2f;
+
+	// deferred shader uniform names
+	const char* g_LightPassName = "lightPass";
+	const char* g_GlobalLightCountName = "globalLightCount";
+	const char* g_InverseViewProjectionName = "inverseViewProjection";
+	const char* g_ReverseDepthName = "reverseDepth";
+	// upscale shader uniform names
+	const char* g_RenderScaleName = "renderScale";
+	const char* g_SharpnessName = "sharpness";
+	// coverage shader uniform name
+	const char* g_FarDepthName = "farDepth";
+
+	// attachments of the target the camera passes draw into with
+	// reverse Z on the forward path or at a reduced scale
+	const GLenum SCENE_COLOR_FORMAT = GL_RGBA8;
+	const GLenum SCENE_DEPTH_FORMAT = GL_DEPTH_COMPONENT32F;
+
+	/***********************************************************
+	 *  MakeReverseDepthProjection()
+	 *
+	 *  Replace the depth row of a projection for reverse Z with a
+	 *  [0, 1] clip depth, x, y and w stay so the view covers the
+	 *  same pixels.  A perspective projection gets an infinite far
+	 *  plane with depth = near / distance, an orthographic one
+	 *  maps the near plane to 1 and the far plane to 0.
+	 ***********************************************************/
+	glm::mat4 MakeReverseDepthProjection(const glm::mat4& projection, float nearPlane, float farPlane)
+	{
+		glm::mat4 reversed = projection;
+		reversed[0][2] = 0.0f;
+		reversed[1][2] = 0.0f;
+		// the w row of an orthographic projection is (0, 0, 0, 1)
+		if (0.0f == projection[2][3])
+		{
+			reversed[2][2] = 1.0f / (farPlane - nearPlane);
+			reversed[3][2] = farPlane / (farPlane - nearPlane);
+		}
+		else
+		{
+			reversed[2][2] = 0.0f;
+			reversed[3][2] = nearPlane;
+		}
+		return(reversed);
+	}
+}
+
+/***********************************************************
+ *  RenderPipeline()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderPipeline::RenderPipeline(ShaderManager* pForwardShader, FrameRingBuffer* pFrameRingBuffer)
+{
+	m_pForwardShader = pForwardShader;
+	m_pFrameRingBuffer = pFrameRingBuffer;
+	m_pShadowManager = new ShadowManager(pFrameRingBuffer);
+	m_pSoftwareRasterizer = new SoftwareRasterizer();
+	m_pDepthShader = NULL;
+	m_pGBufferShader = NULL;
+	m_pDeferredShader = NULL;
+	m_pUpscaleShader = NULL;
+	m_pCoverageShader = NULL;
+	m_lightPassLocation = -1;
+	m_globalLightCountLocation = -1;
+	m_inverseViewProjectionLocation = -1;
+	m_reverseDepthLocation = -1;
+	m_renderScaleLocation = -1;
+	m_sharpnessLocation = -1;
+	m_farDepthLocation = -1;
+	m_lightVertexArray = 0;
+	m_bDeferredReady = false;
+	m_renderPath = RENDER_PATH_FORWARD;
+	m_bDepthPrepass = false;
+	m_bReverseDepth = false;
+	m_bClipControl = false;
+	m_bFrameReverseDepth = false;
+
+	for (int frame = 0; frame < QUERY_FRAMES; frame++)
+	{
+		for (int query = 0; query < QUERY_COUNT; query++)
+		{
+			m_queries[frame][query] = 0;
+		}
+		m_queryPath[frame] = -1;
+		m_queryPrepass[frame] = false;
+		m_queryScale[frame] = 1.0f;
+	}
+	m_queryFrame = 0;
+
+	m_stats.path = RENDER_PATH_FORWARD;
+	m_stats.bDepthPrepass = false;
+	m_stats.shadedFragments = 0;
+	m_stats.coveredPixels = 0;
+	m_stats.geometryFragments = 0;
+	m_stats.prepassFragments = 0;
+	m_stats.overdraw = 0.0;
+	m_stats.gpuTime = 0.0;
+	m_stats.renderScale = 1.0f;
+}
+
+/***********************************************************
+ *  ~RenderPipeline()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderPipeline::~RenderPipeline()
+{
+	DestroyPipeline();
+
+	if (NULL != m_pShadowManager)
+	{
+		delete m_pShadowManager;
+		m_pShadowManager = NULL;
+	}
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		delete m_pSoftwareRasterizer;
+		m_pSoftwareRasterizer = NULL;
+	}
+}
+
+/***********************************************************
+ *  CreatePipeline()
+ *
+ *  This method is used to create the frame queries, load the
+ *  depth only, geometry buffer, deferred lighting and upscale
+ *  programs, and create the shadow maps and the geometry
+ *  buffer for the passed in size.  The forward path keeps
+ *  working when the deferred path cannot be set up.
+ ***********************************************************/
+bool RenderPipeline::CreatePipeline(int width, int height)
+{
+	DestroyPipeline();
+
+	glGenQueries(QUERY_FRAMES * QUERY_COUNT, &m_queries[0][0]);
+
+	// reverse Z needs the [0, 1] clip depth range of OpenGL 4.5
+	m_bClipControl = (GLEW_VERSION_4_5 || GLEW_ARB_clip_control);
+
+	// the pre-pass shares the scene vertex shader so the depth
+	// values match the shading pass exactly
+	m_pDepthShader = new ShaderManager();
+	TrackProgram(m_pDepthShader->LoadShaders(
+		"vertexShader.glsl",
+		"depthFragmentShader.glsl"), "RenderPipeline depth");
+
+	// the covered pixels of a forward frame without the pre-pass
+	// are counted by a full screen triangle at the far end
+	m_pCoverageShader = new ShaderManager();
+	GLuint coverageProgram = m_pCoverageShader->LoadShaders(
+		"coverageVertexShader.glsl",
+		"depthFragmentShader.glsl");
+	TrackProgram(coverageProgram, "RenderPipeline coverage");
+	m_farDepthLocation = glGetUniformLocation(coverageProgram, g_FarDepthName);
+
+	// the scene is rendered without shadows when the maps fail
+	m_pShadowManager->CreateShadowMaps();
+
+	// the geometry pass reuses the scene vertex shader
+	m_pGBufferShader = new ShaderManager();
+	TrackProgram(m_pGBufferShader->LoadShaders(
+		"vertexShader.glsl",
+		"gbufferFragmentShader.glsl"), "RenderPipeline geometry");
+
+	m_pDeferredShader = new ShaderManager();
+	GLuint deferredProgram = m_pDeferredShader->LoadShaders(
+		"deferredVertexShader.glsl",
+		"deferredFragmentShader.glsl");
+	TrackProgram(deferredProgram, "RenderPipeline deferred");
+	m_lightPassLocation = glGetUniformLocation(deferredProgram, g_LightPassName);
+	m_globalLightCountLocation = glGetUniformLocation(deferredProgram, g_GlobalLightCountName);
+	m_inverseViewProjectionLocation = glGetUniformLocation(deferredProgram, g_InverseViewProjectionName);
+	m_reverseDepthLocation = glGetUniformLocation(deferredProgram, g_ReverseDepthName);
+
+	m_pUpscaleShader = new ShaderManager();
+	GLuint upscaleProgram = m_pUpscaleShader->LoadShaders(
+		"upscaleVertexShader.glsl",
+		"upscaleFragmentShader.glsl");
+	TrackProgram(upscaleProgram, "RenderPipeline upscale");
+	m_renderScaleLocation = glGetUniformLocation(upscaleProgram, g_RenderScaleName);
+	m_sharpnessLocation = glGetUniformLocation(upscaleProgram, g_SharpnessName);
+
+	// the light geometry is generated from the vertex index
+	glGenVertexArrays(1, &m_lightVertexArray);
+
+	if (m_gbuffer.CreateTarget(width, height, GBUFFER_COLOR_FORMATS, GBUFFER_COLOR_COUNT, GBUFFER_DEPTH_FORMAT) == false)
+	{
+		std::cout << "Deferred shading is unavailable, the geometry buffer could not be created" << std::endl;
+		return false;
+	}
+
+	// the forward program stays active between frames
+	if (NULL != m_pForwardShader)
+	{
+		m_pForwardShader->use();
+	}
+
+	m_bDeferredReady = true;
+	return true;
+}
+
+/***********************************************************
+ *  DestroyPipeline()
+ *
+ *  This method is used to free the deferred shading resources
+ *  and the frame queries.
+ ***********************************************************/
+void RenderPipeline::DestroyPipeline()
+{
+	m_bDeferredReady = false;
+	m_gbuffer.DestroyTarget();
+	m_sceneTarget.DestroyTarget();
+	m_pShadowManager->DestroyShadowMaps();
+	m_pSoftwareRasterizer->ReleaseResources();
+
+	if (0 != m_lightVertexArray)
+	{
+		glDeleteVertexArrays(1, &m_lightVertexArray);
+		m_lightVertexArray = 0;
+	}
+	if (NULL != m_pDepthShader)
+	{
+		UntrackResources(RESOURCE_PROGRAM, "RenderPipeline depth");
+		delete m_pDepthShader;
+		m_pDepthShader = NULL;
+	}
+	if (NULL != m_pCoverageShader)
+	{
+		UntrackResources(RESOURCE_PROGRAM, "RenderPipeline coverage");
+		delete m_pCoverageShader;
+		m_pCoverageShader = NULL;
+	}
+	if (NULL != m_pGBufferShader)
+	{
+		UntrackResources(RESOURCE_PROGRAM, "RenderPipeline geometry");
+		delete m_pGBufferShader;
+		m_pGBufferShader = NULL;
+	}
+	if (NULL != m_pDeferredShader)
+	{
+		UntrackResources(RESOURCE_PROGRAM, "RenderPipeline deferred");
+		delete m_pDeferredShader;
+		m_pDeferredShader = NULL;
+	}
+	if (NULL != m_pUpscaleShader)
+	{
+		UntrackResources(RESOURCE_PROGRAM, "RenderPipeline upscale");
+		delete m_pUpscaleShader;
+		m_pUpscaleShader = NULL;
+	}
+	if (0 != m_queries[0][0])
+	{
+		glDeleteQueries(QUERY_FRAMES * QUERY_COUNT, &m_queries[0][0]);
+		for (int frame = 0; frame < QUERY_FRAMES; frame++)
+		{
+			for (int query = 0; query < QUERY_COUNT; query++)
+			{
+				m_queries[frame][query] = 0;
+			}
+			m_queryPath[frame] = -1;
+			m_queryPrepass[frame] = false;
+			m_queryScale[frame] = 1.0f;
+		}
+	}
+}
+
+/***********************************************************
+ *  SetRenderPath()
+ *
+ *  This method is used to select the shading path of the next
+ *  frames.  The deferred path is only taken once it is ready.
+ ***********************************************************/
+void RenderPipeline::SetRenderPath(RENDER_PATH renderPath)
+{
+	if ((RENDER_PATH_DEFERRED == renderPath) && !m_bDeferredReady)
+	{
+		return;
+	}
+	m_renderPath = renderPath;
+}
+
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This method is used to render the scene with the selected
+ *  path into the framebuffer bound by the caller.  The draws
+ *  are recorded once and the out of date shadow maps are drawn
+ *  before the scene.  The frame is bracketed by timestamp
+ *  queries, the results are read a few frames later so the CPU
+ *  never waits on them.  The software path draws no shadows
+ *  and issues no queries, its time is measured on the CPU.
+ *  With reverse Z only the camera passes change, the shadow
+ *  maps and the CPU side systems keep the regular projection,
+ *  and the forward path draws into its own float depth target
+ *  because the window's depth buffer is fixed point.  With
+ *  dynamic resolution the camera passes draw a smaller image
+ *  into that target, which is then filtered up to the size of
+ *  the output, and each finished frame's GPU time moves the
+ *  scale of the next ones.
+ ***********************************************************/
+void RenderPipeline::RenderFrame(SceneManager* pSceneManager, const FRAME_DATA& frameData)
+{
+	if (NULL == pSceneManager)
+	{
+		return;
+	}
+
+	if (RENDER_PATH_SOFTWARE == m_renderPath)
+	{
+		GLint softwareFramebuffer = 0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &softwareFramebuffer);
+		pSceneManager->PrepareFrame(frameData, false);
+		m_pSoftwareRasterizer->RenderFrame(pSceneManager, frameData);
+		m_pSoftwareRasterizer->Present((GLuint)softwareFramebuffer);
+		return;
+	}
+
+	// the frame queries only exist after CreatePipeline(), and the
+	// scale follows the GPU time they measure
+	bool bQueries = (0 != m_queries[0][0]);
+	if (bQueries)
+	{
+		if (CollectStats())
+		{
+			m_dynamicResolution.AddFrameTime(m_stats.gpuTime, m_stats.renderScale);
+		}
+		glQueryCounter(m_queries[m_queryFrame][QUERY_START_TIME], GL_TIMESTAMP);
+		m_queryPrepass[m_queryFrame] = m_bDepthPrepass && (NULL != m_pDepthShader);
+	}
+
+	// the scene passes go to whatever the caller had bound
+	GLint outputFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outputFramebuffer);
+	int outputWidth = (int)frameData.viewport.x;
+	int outputHeight = (int)frameData.viewport.y;
+
+	// the geometry buffer follows the size of the view
+	if ((RENDER_PATH_DEFERRED == m_renderPath) && m_bDeferredReady &&
+		((outputWidth != m_gbuffer.GetWidth()) || (outputHeight != m_gbuffer.GetHeight())))
+	{
+		if (m_gbuffer.CreateTarget(outputWidth, outputHeight, GBUFFER_COLOR_FORMATS, GBUFFER_COLOR_COUNT, GBUFFER_DEPTH_FORMAT) == false)
+		{
+			m_bDeferredReady = false;
+			m_renderPath = RENDER_PATH_FORWARD;
+		}
+	}
+	bool bDeferred = (RENDER_PATH_DEFERRED == m_renderPath) && m_bDeferredReady;
+
+	// a reduced scale draws the camera passes into the lower left
+	// corner of the full size targets, so a new scale needs no new
+	// textures
+	float renderScale = bQueries ? m_dynamicResolution.GetScale() : 1.0f;
+	int width = (int)(outputWidth * renderScale + 0.5f);
+	int height = (int)(outputHeight * renderScale + 0.5f);
+	width = (width > 0) ? width : 1;
+	height = (height > 0) ? height : 1;
+	bool bScaled = (width != outputWidth) || (height != outputHeight);
+
+	// the scene target follows the size of the view
+	bool bReverseDepth = bQueries && GetReverseDepth();
+	bool bSceneTarget = bScaled || (bReverseDepth && !bDeferred);
+	if (bSceneTarget &&
+		((outputWidth != m_sceneTarget.GetWidth()) || (outputHeight != m_sceneTarget.GetHeight())))
+	{
+		if (m_sceneTarget.CreateTarget(outputWidth, outputHeight, &SCENE_COLOR_FORMAT, 1, SCENE_DEPTH_FORMAT) == false)
+		{
+			std::cout << "Reverse Z and dynamic resolution are unavailable, the scene target could not be created" << std::endl;
+			m_bReverseDepth = false;
+			m_dynamicResolution.SetEnabled(false);
+			bReverseDepth = false;
+			bScaled = false;
+			bSceneTarget = false;
+			renderScale = 1.0f;
+			width = outputWidth;
+			height = outputHeight;
+		}
+		else
+		{
+			// the upscale pass filters the scene color
+			glBindTexture(GL_TEXTURE_2D, m_sceneTarget.GetColorTexture(0));
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}
+
+	// the light clusters are built for the pixels the camera
+	// passes cover
+	FRAME_DATA renderData = frameData;
+	renderData.viewport.x = (float)width;
+	renderData.viewport.y = (float)height;
+
+	// only the forward shader needs the lights sorted into clusters,
+	// a reverse Z perspective draws past the far plane of the view
+	bool bUnboundedDepth = bReverseDepth && (0.0f != frameData.projection[2][3]);
+	pSceneManager->PrepareFrame(renderData, !bDeferred, bUnboundedDepth);
+
+	m_pShadowManager->UpdateShadows(pSceneManager, renderData);
+	glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+	glViewport(0, 0, width, height);
+	CountStateChanges(1);
+
+	if (!bQueries)
+	{
+		m_pForwardShader->use();
+		CountStateChanges(1);
+		pSceneManager->RenderScene();
+		return;
+	}
+
+	FRAME_DATA cameraData = renderData;
+	if (bReverseDepth)
+	{
+		cameraData.projection = MakeReverseDepthProjection(frameData.projection, frameData.viewport.z, frameData.viewport.w);
+	}
+	if (bReverseDepth || bScaled)
+	{
+		BindCameraData(cameraData);
+	}
+	if (bReverseDepth)
+	{
+		BeginReverseDepth();
+	}
+
+	if (bSceneTarget)
+	{
+		// reverse Z clears to the far end at zero
+		const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		const GLfloat clearDepth = bReverseDepth ? 0.0f : 1.0f;
+		m_sceneTarget.Bind();
+		glViewport(0, 0, width, height);
+		glClearBufferfv(GL_COLOR, 0, clearColor);
+		glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+		CountStateChanges(1);
+	}
+
+	if (bDeferred)
+	{
+		RenderDeferred(pSceneManager, cameraData,
+			bSceneTarget ? (GLint)m_sceneTarget.GetFramebufferID() : outputFramebuffer);
+	}
+	else
+	{
+		RenderForward(pSceneManager);
+	}
+
+	if (bReverseDepth)
+	{
+		EndReverseDepth();
+	}
+
+	if (bScaled)
+	{
+		RenderUpscale(width, height, outputFramebuffer, outputWidth, outputHeight);
+	}
+	else if (bSceneTarget)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_sceneTarget.GetFramebufferID());
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+		CountStateChanges(1);
+	}
+
+	glQueryCounter(m_queries[m_queryFrame][QUERY_END_TIME], GL_TIMESTAMP);
+	m_queryPath[m_queryFrame] = m_renderPath;
+	m_queryScale[m_queryFrame] = renderScale;
+	m_queryFrame = (m_queryFrame + 1) % QUERY_FRAMES;
+}
+
+/***********************************************************
+ *  CollectStats()
+ *
+ *  This method is used to read the queries of the frame whose
+ *  query objects are about to be reused.  The results are only
+ *  taken when the GPU has already finished that frame.
+ ***********************************************************/
+bool RenderPipeline::CollectStats()
+{
+	int path = m_queryPath[m_queryFrame];
+	if (path < 0)
+	{
+		return false;
+	}
+	m_queryPath[m_queryFrame] = -1;
+
+	// the queries finish in order, so the last one tells for all
+	GLuint* pQueries = m_queries[m_queryFrame];
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(pQueries[QUERY_END_TIME], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (GL_FALSE == available)
+	{
+		return false;
+	}
+
+	GLuint64 startTime = 0;
+	GLuint64 endTime = 0;
+	GLuint64 geometrySamples = 0;
+	glGetQueryObjectui64v(pQueries[QUERY_START_TIME], GL_QUERY_RESULT, &startTime);
+	glGetQueryObjectui64v(pQueries[QUERY_END_TIME], GL_QUERY_RESULT, &endTime);
+	glGetQueryObjectui64v(pQueries[QUERY_GEOMETRY_SAMPLES], GL_QUERY_RESULT, &geometrySamples);
+
+	GLuint64 prepassSamples = 0;
+	bool bDepthPrepass = m_queryPrepass[m_queryFrame];
+	if (bDepthPrepass)
+	{
+		glGetQueryObjectui64v(pQueries[QUERY_PREPASS_SAMPLES], GL_QUERY_RESULT, &prepassSamples);
+	}
+
+	m_stats.path = (RENDER_PATH)path;
+	m_stats.bDepthPrepass = bDepthPrepass;
+	m_stats.gpuTime = (double)(endTime - startTime) / 1000000.0;
+	m_stats.renderScale = m_queryScale[m_queryFrame];
+	m_stats.geometryFragments = geometrySamples;
+	m_stats.prepassFragments = prepassSamples;
+
+	// the fragments that pass the depth test before the nearest
+	// surface is known, this is what the shading would cost
+	// without a pre-pass
+	GLuint64 depthPassedFragments = bDepthPrepass ? prepassSamples : geometrySamples;
+
+	if (RENDER_PATH_DEFERRED == path)
+	{
+		GLuint64 fullscreenSamples = 0;
+		GLuint64 volumeSamples = 0;
+		glGetQueryObjectui64v(pQueries[QUERY_FULLSCREEN_SAMPLES], GL_QUERY_RESULT, &fullscreenSamples);
+		glGetQueryObjectui64v(pQueries[QUERY_VOLUME_SAMPLES], GL_QUERY_RESULT, &volumeSamples);
+		m_stats.coveredPixels = fullscreenSamples;
+		m_stats.shadedFragments = fullscreenSamples + volumeSamples;
+	}
+	else
+	{
+		// the forward pass lights everything it draws, behind a
+		// pre-pass that is exactly the visible pixels, without one
+		// the coverage pass counted them
+		m_stats.shadedFragments = geometrySamples;
+		if (bDepthPrepass)
+		{
+			m_stats.coveredPixels = geometrySamples;
+		}
+		else
+		{
+			GLuint64 coverageSamples = 0;
+			glGetQueryObjectui64v(pQueries[QUERY_COVERAGE_SAMPLES], GL_QUERY_RESULT, &coverageSamples);
+			m_stats.coveredPixels = coverageSamples;
+		}
+	}
+
+	// a view without any scene has no overdraw
+	m_stats.overdraw = 0.0;
+	if (m_stats.coveredPixels > 0)
+	{
+		m_stats.overdraw = (double)depthPassedFragments / (double)m_stats.coveredPixels;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  RenderForward()
+ *
+ *  This method is used to draw and light the scene in a
+ *  single pass with the clustered forward shader.
+ ***********************************************************/
+void RenderPipeline::RenderForward(SceneManager* pSceneManager)
+{
+	bool bDepthPrepass = m_queryPrepass[m_queryFrame];
+
+	if (bDepthPrepass)
+	{
+		RenderDepthPrepass(pSceneManager);
+		BeginPrepassShading();
+	}
+
+	m_pForwardShader->use();
+	CountStateChanges(1);
+	glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_queryFrame][QUERY_GEOMETRY_SAMPLES]);
+	pSceneManager->RenderScene();
+	glEndQuery(GL_SAMPLES_PASSED);
+
+	if (bDepthPrepass)
+	{
+		EndPrepassShading();
+	}
+	else
+	{
+		RenderCoverage();
+	}
+}
+
+/***********************************************************
+ *  RenderCoverage()
+ *
+ *  This method is used to count the pixels the forward pass
+ *  wrote scene depth into, the overdraw is measured against
+ *  them.  A full screen triangle at the far end of the depth
+ *  range only passes where something nearer was drawn, and
+ *  writes neither color nor depth.
+ ***********************************************************/
+void RenderPipeline::RenderCoverage()
+{
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glDepthFunc(m_bFrameReverseDepth ? GL_LESS : GL_GREATER);
+
+	m_pCoverageShader->use();
+	glUniform1f(m_farDepthLocation, m_bFrameReverseDepth ? 0.0f : 1.0f);
+	glBindVertexArray(m_lightVertexArray);
+	CountStateChanges(2);
+
+	glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_queryFrame][QUERY_COVERAGE_SAMPLES]);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glEndQuery(GL_SAMPLES_PASSED);
+	CountDrawCalls(1);
+
+	glBindVertexArray(0);
+	glDepthFunc(m_bFrameReverseDepth ? GL_GREATER : GL_LESS);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	m_pForwardShader->use();
+	CountStateChanges(1);
+}
+
+/***********************************************************
+ *  RenderDepthPrepass()
+ *
+ *  This method is used to draw the recorded scene into the
+ *  depth buffer only, so the following pass shades just the
+ *  nearest surface of every pixel.
+ ***********************************************************/
+void RenderPipeline::RenderDepthPrepass(SceneManager* pSceneManager)
+{
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	m_pDepthShader->use();
+	CountStateChanges(1);
+
+	glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_queryFrame][QUERY_PREPASS_SAMPLES]);
+	pSceneManager->RenderScene();
+	glEndQuery(GL_SAMPLES_PASSED);
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+/***********************************************************
+ *  BeginPrepassShading() / EndPrepassShading()
+ *
+ *  These methods are used to only pass the fragments that
+ *  match the depth laid down by the pre-pass, and to go back
+ *  to the regular depth test afterwards.
+ ***********************************************************/
+void RenderPipeline::BeginPrepassShading()
+{
+	glDepthFunc(GL_EQUAL);
+	glDepthMask(GL_FALSE);
+}
+
+void RenderPipeline::EndPrepassShading()
+{
+	glDepthFunc(m_bFrameReverseDepth ? GL_GREATER : GL_LESS);
+	glDepthMask(GL_TRUE);
+}
+
+/***********************************************************
+ *  BindCameraData()
+ *
+ *  This method is used to give the camera passes frame data
+ *  with the reverse Z projection or the scaled viewport.  It
+ *  stays bound until the next view is prepared.
+ ***********************************************************/
+void RenderPipeline::BindCameraData(const FRAME_DATA& cameraData)
+{
+	GLintptr offset = 0;
+	FRAME_DATA* pFrameData = (FRAME_DATA*)m_pFrameRingBuffer->Allocate(sizeof(FRAME_DATA), &offset);
+	if (NULL != pFrameData)
+	{
+		*pFrameData = cameraData;
+		m_pFrameRingBuffer->BindRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, offset, sizeof(FRAME_DATA));
+	}
+}
+
+/***********************************************************
+ *  BeginReverseDepth() / EndReverseDepth()
+ *
+ *  These methods are used to give the camera passes a [0, 1]
+ *  clip depth and the greater depth test, and to go back to
+ *  the regular state for the shadow maps of the next frame.
+ ***********************************************************/
+void RenderPipeline::BeginReverseDepth()
+{
+	glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+	glDepthFunc(GL_GREATER);
+	m_bFrameReverseDepth = true;
+}
+
+void RenderPipeline::EndReverseDepth()
+{
+	glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+	glDepthFunc(GL_LESS);
+	m_bFrameReverseDepth = false;
+}
+
+/***********************************************************
+ *  RenderDeferred()
+ *
+ *  This method is used to write the scene surfaces into the
+ *  geometry buffer, then light the covered pixels into the
+ *  caller's framebuffer.  The unbounded lights are applied by
+ *  one full screen triangle, every bounded light is added by
+ *  drawing the back faces of a box around its radius.  Both
+ *  cover the viewport of the frame data, which is a corner of
+ *  the geometry buffer at a reduced scale.
+ ***********************************************************/
+void RenderPipeline::RenderDeferred(SceneManager* pSceneManager, const FRAME_DATA& frameData, GLint outputFramebuffer)
+{
+	GLuint* pQueries = m_queries[m_queryFrame];
+	int width = (int)frameData.viewport.x;
+	int height = (int)frameData.viewport.y;
+
+	int globalLightCount = 0;
+	int volumeLightCount = 0;
+	if (UploadLightList(pSceneManager, &globalLightCount, &volumeLightCount) == false)
+	{
+		return;
+	}
+
+	// geometry pass, the surfaces are written without blending
+	m_gbuffer.Bind();
+	glViewport(0, 0, width, height);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+
+	const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLuint clearMaterial[4] = { 0, 0, 0, 0 };
+	// reverse Z clears to the far end at zero
+	const GLfloat clearDepth = m_bFrameReverseDepth ? 0.0f : 1.0f;
+	glClearBufferfv(GL_COLOR, 0, clearColor);
+	glClearBufferfv(GL_COLOR, 1, clearColor);
+	glClearBufferuiv(GL_COLOR, 2, clearMaterial);
+	glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+
+	// with the depth laid down first each pixel is written once
+	bool bDepthPrepass = m_queryPrepass[m_queryFrame];
+	if (bDepthPrepass)
+	{
+		RenderDepthPrepass(pSceneManager);
+		BeginPrepassShading();
+	}
+
+	m_pGBufferShader->use();
+	CountStateChanges(1);
+	glBeginQuery(GL_SAMPLES_PASSED, pQueries[QUERY_GEOMETRY_SAMPLES]);
+	pSceneManager->RenderScene();
+	glEndQuery(GL_SAMPLES_PASSED);
+
+	if (bDepthPrepass)
+	{
+		EndPrepassShading();
+	}
+
+	// lighting passes read the geometry buffer one pixel at a time
+	glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+	glViewport(0, 0, width, height);
+	glDisable(GL_DEPTH_TEST);
+
+	for (int i = 0; i < m_gbuffer.GetColorCount(); i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + GBUFFER_TEXTURE_UNIT + i);
+		glBindTexture(GL_TEXTURE_2D, m_gbuffer.GetColorTexture(i));
+	}
+	glActiveTexture(GL_TEXTURE0 + GBUFFER_TEXTURE_UNIT + m_gbuffer.GetColorCount());
+	glBindTexture(GL_TEXTURE_2D, m_gbuffer.GetDepthTexture());
+	glActiveTexture(GL_TEXTURE0);
+
+	m_pDeferredShader->use();
+	glm::mat4 inverseViewProjection = glm::inverse(frameData.projection * frameData.view);
+	glUniform1i(m_globalLightCountLocation, globalLightCount);
+	glUniformMatrix4fv(m_inverseViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+	glUniform1i(m_reverseDepthLocation, m_bFrameReverseDepth ? 1 : 0);
+	glBindVertexArray(m_lightVertexArray);
+	// the output framebuffer, the geometry buffer color and depth
+	// textures, the program and the vertex array
+	CountStateChanges(4 + m_gbuffer.GetColorCount());
+
+	// every covered pixel is written once by the unbounded lights,
+	// the query counts the pixels that are not background
+	glUniform1i(m_lightPassLocation, 0);
+	glBeginQuery(GL_SAMPLES_PASSED, pQueries[QUERY_FULLSCREEN_SAMPLES]);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glEndQuery(GL_SAMPLES_PASSED);
+	CountDrawCalls(1);
+
+	// the bounded lights add onto it, the back faces keep the
+	// volumes working with the camera inside them
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_FRONT);
+
+	glUniform1i(m_lightPassLocation, 1);
+	glBeginQuery(GL_SAMPLES_PASSED, pQueries[QUERY_VOLUME_SAMPLES]);
+	if (volumeLightCount > 0)
+	{
+		glDrawArraysInstanced(GL_TRIANGLES, 0, LIGHT_VOLUME_VERTICES, volumeLightCount);
+		CountDrawCalls(1);
+	}
+	glEndQuery(GL_SAMPLES_PASSED);
+
+	// put back the state the rest of the frame expects
+	glCullFace(GL_BACK);
+	glDisable(GL_CULL_FACE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_DEPTH_TEST);
+	glBindVertexArray(0);
+	m_pForwardShader->use();
+	CountStateChanges(1);
+}
+
+/***********************************************************
+ *  UploadLightList()
+ *
+ *  This method is used to write the light indices for the
+ *  lighting passes into the frame ring buffer, the unbounded
+ *  lights first and the lights with a radius after them.
+ ***********************************************************/
+bool RenderPipeline::UploadLightList(SceneManager* pSceneManager, int* pGlobalLightCount, int* pVolumeLightCount)
+{
+	LightManager* pLightManager = pSceneManager->GetLightManager();
+	int lightCount = pLightManager->GetLightCount();
+
+	GLsizeiptr listSize = ((lightCount > 0) ? lightCount : 1) * sizeof(unsigned int);
+	GLintptr listOffset = 0;
+	unsigned int* pList = (unsigned int*)m_pFrameRingBuffer->Allocate(listSize, &listOffset);
+	if (NULL == pList)
+	{
+		return false;
+	}
+
+	int globalLightCount = 0;
+	for (int i = 0; i < lightCount; i++)
+	{
+		if (pLightManager->GetLight(i).position.w <= 0.0f)
+		{
+			pList[globalLightCount] = (unsigned int)i;
+			globalLightCount++;
+		}
+	}
+	int volumeLightCount = 0;
+	for (int i = 0; i < lightCount; i++)
+	{
+		if (pLightManager->GetLight(i).position.w > 0.0f)
+		{
+			pList[globalLightCount + volumeLightCount] = (unsigned int)i;
+			volumeLightCount++;
+		}
+	}
+
+	m_pFrameRingBuffer->BindRange(GL_SHADER_STORAGE_BUFFER, LIGHT_LIST_BINDING, listOffset, listSize);
+
+	*pGlobalLightCount = globalLightCount;
+	*pVolumeLightCount = volumeLightCount;
+	return true;
+}
+
+/***********************************************************
+ *  RenderUpscale()
+ *
+ *  This method is used to stretch the scene, rendered into the
+ *  lower left width x height of the scene target, over the
+ *  caller's framebuffer.  Every output pixel takes a bilinear
+ *  sample of the scene, sharpened against the samples one
+ *  rendered pixel around it to win back some of the detail
+ *  the filtering softens.
+ ***********************************************************/
+void RenderPipeline::RenderUpscale(int width, int height, GLint outputFramebuffer, int outputWidth, int outputHeight)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+	glViewport(0, 0, outputWidth, outputHeight);
+	glDisable(GL_DEPTH_TEST);
+
+	glActiveTexture(GL_TEXTURE0 + UPSCALE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_sceneTarget.GetColorTexture(0));
+	glActiveTexture(GL_TEXTURE0);
+
+	m_pUpscaleShader->use();
+	glUniform2f(m_renderScaleLocation,
+		(float)width / (float)m_sceneTarget.GetWidth(),
+		(float)height / (float)m_sceneTarget.GetHeight());
+	glUniform1f(m_sharpnessLocation, UPSCALE_SHARPNESS);
+	glBindVertexArray(m_lightVertexArray);
+	// the output framebuffer, the scene texture, the program and
+	// the vertex array
+	CountStateChanges(4);
+
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	CountDrawCalls(1);
+
+	glEnable(GL_DEPTH_TEST);
+	glBindVertexArray(0);
+	m_pForwardShader->use();
+	CountStateChanges(1);
+}
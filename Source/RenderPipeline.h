@@ -0,0 +1,212 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderpipeline.h
+// ============
+// choose between the forward, the deferred and the software path for the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "FrameRingBuffer.h"
+#include "RenderTarget.h"
+#include "DynamicResolution.h"
+#include "ShaderInterface.h"
+
+class SceneManager;
+class ShadowManager;
+class SoftwareRasterizer;
+
+// the ways the scene can be shaded
+enum RENDER_PATH
+{
+	RENDER_PATH_FORWARD = 0,
+	RENDER_PATH_DEFERRED = 1,
+	RENDER_PATH_SOFTWARE = 2
+};
+
+// fragment and timing counts of one rendered frame
+struct RENDER_STATS
+{
+	// path the frame was rendered with
+	RENDER_PATH path;
+	// set when depth was laid down before the scene was shaded
+	bool bDepthPrepass;
+	// fragments that ran the lighting shader
+	GLuint64 shadedFragments;
+	// pixels covered by scene geometry
+	GLuint64 coveredPixels;
+	// fragments written by the geometry pass
+	GLuint64 geometryFragments;
+	// fragments that passed the depth test in the pre-pass
+	GLuint64 prepassFragments;
+	// fragments per covered pixel the scene shading would run
+	// without a pre-pass, 0 until the covered pixels are known
+	double overdraw;
+	// GPU time of the frame in milliseconds
+	double gpuTime;
+	// fraction of the output width and height the camera passes
+	// covered
+	float renderScale;
+};
+
+/***********************************************************
+ *  RenderPipeline
+ *
+ *  The forward path lights every fragment while drawing the
+ *  scene.  The deferred path first writes the surface values
+ *  into a geometry buffer, then lights each covered pixel once
+ *  with a full screen pass for the unbounded lights and one
+ *  box volume per bounded light.  The software path draws
+ *  the same recorded draws on the CPU and copies the result
+ *  into the framebuffer, as a reference for the GPU paths.
+ *  With dynamic resolution the GPU paths render at a scale of
+ *  the output picked from the measured frame time, and a
+ *  filtering pass stretches the result over the output.
+ ***********************************************************/
+class RenderPipeline
+{
+public:
+	// constructor
+	RenderPipeline(ShaderManager* pForwardShader, FrameRingBuffer* pFrameRingBuffer);
+	// destructor
+	~RenderPipeline();
+
+	// load the deferred shaders and create the geometry buffer
+	bool CreatePipeline(int width, int height);
+	// free the deferred shading resources
+	void DestroyPipeline();
+
+	// select the path used by the next frames
+	void SetRenderPath(RENDER_PATH renderPath);
+	RENDER_PATH GetRenderPath() const { return(m_renderPath); }
+
+	// lay down the scene depth before shading it
+	void SetDepthPrepass(bool bDepthPrepass) { m_bDepthPrepass = bDepthPrepass; }
+	bool GetDepthPrepass() const { return(m_bDepthPrepass); }
+
+	// draw the camera passes with reverse Z into a float depth
+	// buffer, only taken where glClipControl is supported
+	void SetReverseDepth(bool bReverseDepth) { m_bReverseDepth = bReverseDepth; }
+	bool GetReverseDepth() const { return(m_bReverseDepth && m_bClipControl); }
+
+	// scale of the camera passes, driven by the GPU frame time
+	DynamicResolution* GetDynamicResolution() { return(&m_dynamicResolution); }
+
+	// render the scene into the currently bound framebuffer
+	void RenderFrame(SceneManager* pSceneManager, const FRAME_DATA& frameData);
+
+	// counts of the most recent frame whose queries have finished
+	const RENDER_STATS& GetStats() const { return(m_stats); }
+	// shadow maps of the shadow casting lights
+	ShadowManager* GetShadowManager() { return(m_pShadowManager); }
+	// CPU renderer of the software path
+	SoftwareRasterizer* GetSoftwareRasterizer() { return(m_pSoftwareRasterizer); }
+
+	// bytes written per pixel into the geometry buffer
+	static const int GBUFFER_BYTES_PER_PIXEL = 14;
+
+private:
+	// frames of queries in flight before the results are read
+	static const int QUERY_FRAMES = 3;
+
+	// queries issued for one frame
+	enum FRAME_QUERY
+	{
+		QUERY_START_TIME = 0,
+		QUERY_END_TIME,
+		QUERY_PREPASS_SAMPLES,
+		QUERY_GEOMETRY_SAMPLES,
+		QUERY_FULLSCREEN_SAMPLES,
+		QUERY_VOLUME_SAMPLES,
+		QUERY_COVERAGE_SAMPLES,
+		QUERY_COUNT
+	};
+
+	// pointer to the forward shading program
+	ShaderManager* m_pForwardShader;
+	// pointer to the per-frame dynamic data buffer
+	FrameRingBuffer* m_pFrameRingBuffer;
+	// cached shadow maps drawn ahead of the scene
+	ShadowManager* m_pShadowManager;
+	// renderer of the software path
+	SoftwareRasterizer* m_pSoftwareRasterizer;
+	// depth only, geometry buffer and deferred lighting programs
+	ShaderManager* m_pDepthShader;
+	ShaderManager* m_pGBufferShader;
+	ShaderManager* m_pDeferredShader;
+	// filtering pass from the scaled scene to the output
+	ShaderManager* m_pUpscaleShader;
+	// counts the covered pixels after a forward pass
+	ShaderManager* m_pCoverageShader;
+	// deferred lighting uniforms, looked up once so the frame
+	// does not build a name string for every uniform set
+	GLint m_lightPassLocation;
+	GLint m_globalLightCountLocation;
+	GLint m_inverseViewProjectionLocation;
+	GLint m_reverseDepthLocation;
+	// upscale uniforms
+	GLint m_renderScaleLocation;
+	GLint m_sharpnessLocation;
+	// coverage uniform
+	GLint m_farDepthLocation;
+	// albedo, normal, material and depth attachments
+	RenderTarget m_gbuffer;
+	// color and float depth the camera passes draw into with
+	// reverse Z on the forward path or at a reduced scale, copied
+	// or upscaled into the caller's framebuffer afterwards
+	RenderTarget m_sceneTarget;
+	// empty vertex array for the generated light and full screen
+	// geometry
+	GLuint m_lightVertexArray;
+	// set once the deferred path can be used
+	bool m_bDeferredReady;
+	// path used by the next frames
+	RENDER_PATH m_renderPath;
+	// set when the next frames start with a depth pre-pass
+	bool m_bDepthPrepass;
+	// set when the next frames use reverse Z, and when the driver
+	// can switch the clip depth range for it
+	bool m_bReverseDepth;
+	bool m_bClipControl;
+	// set while the current frame's camera passes use reverse Z
+	bool m_bFrameReverseDepth;
+	// scale of the camera passes picked from the frame times
+	DynamicResolution m_dynamicResolution;
+
+	// query objects of every frame in flight
+	GLuint m_queries[QUERY_FRAMES][QUERY_COUNT];
+	// path each frame's queries were issued for, -1 when unused
+	int m_queryPath[QUERY_FRAMES];
+	// whether each frame's queries include the pre-pass
+	bool m_queryPrepass[QUERY_FRAMES];
+	// scale each frame's camera passes were rendered at
+	float m_queryScale[QUERY_FRAMES];
+	// frame whose queries are issued next
+	int m_queryFrame;
+	// counts of the last finished frame
+	RENDER_STATS m_stats;
+
+	// read back a finished frame's queries without waiting, true
+	// when a frame's results were taken
+	bool CollectStats();
+	// draw the scene depth only, ahead of the shading pass
+	void RenderDepthPrepass(SceneManager* pSceneManager);
+	// count the pixels the forward pass left scene depth in
+	void RenderCoverage();
+	// switch the depth state for the pass after the pre-pass and back
+	void BeginPrepassShading();
+	void EndPrepassShading();
+	// bind frame data that differs from the prepared view for the
+	// camera passes
+	void BindCameraData(const FRAME_DATA& cameraData);
+	// switch the camera passes to reverse Z and back
+	void BeginReverseDepth();
+	void EndReverseDepth();
+	// the two shading paths
+	void RenderForward(SceneManager* pSceneManager);
+	void RenderDeferred(SceneManager* pSceneManager, const FRAME_DATA& frameData, GLint outputFramebuffer);
+	// write the unbounded and bounded light lists for the lighting passes
+	bool UploadLightList(SceneManager* pSceneManager, int* pGlobalLightCount, int* pVolumeLightCount);
+	// stretch the scaled scene over the caller's framebuffer
+	void RenderUpscale(int width, int height, GLint outputFramebuffer, int outputWidth, int outputHeight);
+};
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertarget.cpp
+// ============
+// offscreen framebuffer with texture attachments
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderTarget.h"
+#include "ResourceTracker.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  RenderTarget()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderTarget::RenderTarget()
+{
+	m_framebufferID = 0;
+	for (int i = 0; i < MAX_COLOR_ATTACHMENTS; i++)
+	{
+		m_colorTextures[i] = 0;
+	}
+	m_colorCount = 0;
+	m_depthTexture = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~RenderTarget()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderTarget::~RenderTarget()
+{
+	DestroyTarget();
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used to create the framebuffer with one
+ *  texture per requested color format, plus a depth texture.
+ ***********************************************************/
+bool RenderTarget::CreateTarget(int width, int height, const GLenum* colorFormats, int colorCount, GLenum depthFormat)
+{
+	DestroyTarget();
+
+	if ((colorCount < 0) || (colorCount > MAX_COLOR_ATTACHMENTS))
+	{
+		std::cout << "Render target cannot have " << colorCount << " color attachments" << std::endl;
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_colorCount = colorCount;
+
+	glGenFramebuffers(1, &m_framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+
+	GLenum drawBuffers[MAX_COLOR_ATTACHMENTS];
+	for (int i = 0; i < colorCount; i++)
+	{
+		glGenTextures(1, &m_colorTextures[i]);
+		glBindTexture(GL_TEXTURE_2D, m_colorTextures[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, colorFormats[i], width, height);
+		TrackTexture(m_colorTextures[i], colorFormats[i], width, height, 1, 1, "RenderTarget color");
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_colorTextures[i], 0);
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+
+	if (GL_NONE != depthFormat)
+	{
+		glGenTextures(1, &m_depthTexture);
+		glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, depthFormat, width, height);
+		TrackTexture(m_depthTexture, depthFormat, width, height, 1, 1, "RenderTarget depth");
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (colorCount > 0)
+	{
+		glDrawBuffers(colorCount, drawBuffers);
+	}
+	else
+	{
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (GL_FRAMEBUFFER_COMPLETE != status)
+	{
+		std::cout << "Render target is incomplete, status 0x" << std::hex << status << std::dec << std::endl;
+		DestroyTarget();
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used to free the framebuffer and textures.
+ ***********************************************************/
+void RenderTarget::DestroyTarget()
+{
+	for (int i = 0; i < MAX_COLOR_ATTACHMENTS; i++)
+	{
+		if (0 != m_colorTextures[i])
+		{
+			UntrackResource(RESOURCE_TEXTURE, m_colorTextures[i]);
+			glDeleteTextures(1, &m_colorTextures[i]);
+			m_colorTextures[i] = 0;
+		}
+	}
+	if (0 != m_depthTexture)
+	{
+		UntrackResource(RESOURCE_TEXTURE, m_depthTexture);
+		glDeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+	}
+	if (0 != m_framebufferID)
+	{
+		glDeleteFramebuffers(1, &m_framebufferID);
+		m_framebufferID = 0;
+	}
+	m_colorCount = 0;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used to make the target the destination of
+ *  the following draw calls.
+ ***********************************************************/
+void RenderTarget::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glViewport(0, 0, m_width, m_height);
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertarget.h
+// ============
+// offscreen framebuffer with texture attachments
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  RenderTarget
+ *
+ *  A framebuffer object with up to four color textures and
+ *  an optional depth texture, used for rendering the scene
+ *  away from the display window.
+ ***********************************************************/
+class RenderTarget
+{
+public:
+	// constructor
+	RenderTarget();
+	// destructor
+	~RenderTarget();
+
+	// create the attachments, a depth format of GL_NONE skips the depth texture
+	bool CreateTarget(int width, int height, const GLenum* colorFormats, int colorCount, GLenum depthFormat);
+	// free the framebuffer and its attachments
+	void DestroyTarget();
+
+	// bind the framebuffer for drawing and cover it with the viewport
+	void Bind();
+
+	// attachment and size queries
+	GLuint GetFramebufferID() const { return(m_framebufferID); }
+	GLuint GetColorTexture(int index) const { return(m_colorTextures[index]); }
+	GLuint GetDepthTexture() const { return(m_depthTexture); }
+	int GetColorCount() const { return(m_colorCount); }
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+
+	// most color attachments a target can have
+	static const int MAX_COLOR_ATTACHMENTS = 4;
+
+private:
+	// GL framebuffer object
+	GLuint m_framebufferID;
+	// color attachment textures
+	GLuint m_colorTextures[MAX_COLOR_ATTACHMENTS];
+	// number of color attachments
+	int m_colorCount;
+	// depth attachment texture
+	GLuint m_depthTexture;
+	// size of the attachments in pixels
+	int m_width;
+	int m_height;
+};
@@ -0,0 +1,401 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcetracker.cpp
+// ============
+// account for the memory of the GL objects and of each frame's CPU allocations
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResourceTracker.h"
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+// declaration of global variables
+namespace
+{
+	const char* const RESOURCE_TYPE_NAMES[RESOURCE_TYPE_COUNT] = { "texture", "buffer", "program" };
+	const double BYTES_PER_MEGABYTE = 1024.0 * 1024.0;
+
+	// the loader thread creates textures and meshes, so the
+	// records are shared
+	std::mutex g_resourceMutex;
+	std::vector<TRACKED_RESOURCE> g_resources;
+	RESOURCE_TOTALS g_totals = {};
+	// heap bytes of the render thread at the end of the last frame
+	size_t g_lastHeapBytes = 0;
+	// set by the signal handler, read at the end of a frame
+	volatile std::sig_atomic_t g_bReportRequested = 0;
+
+	/***********************************************************
+	 *  GetTexelSize()
+	 *
+	 *  Bytes of one texel of an internal format.  Three channel
+	 *  formats are counted padded to four, the way drivers store
+	 *  them.
+	 ***********************************************************/
+	size_t GetTexelSize(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_R8:
+			return(1);
+		case GL_RG8:
+		case GL_R16F:
+		case GL_R16UI:
+		case GL_DEPTH_COMPONENT16:
+			return(2);
+		case GL_RGBA16F:
+		case GL_RGB16F:
+		case GL_RG32F:
+		case GL_DEPTH32F_STENCIL8:
+			return(8);
+		case GL_RGBA32F:
+		case GL_RGB32F:
+			return(16);
+		default:
+			// GL_RGB8, GL_RGBA8, GL_RGB10_A2, GL_R32F and the 24 and
+			// 32 bit depth formats
+			return(4);
+		}
+	}
+
+	/***********************************************************
+	 *  GetFormatName()
+	 *
+	 *  Name of the internal formats the scene uses, NULL for the
+	 *  others.
+	 ***********************************************************/
+	const char* GetFormatName(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_RGB8:
+			return("RGB8");
+		case GL_RGBA8:
+			return("RGBA8");
+		case GL_RGB10_A2:
+			return("RGB10_A2");
+		case GL_RGBA16F:
+			return("RGBA16F");
+		case GL_R16UI:
+			return("R16UI");
+		case GL_DEPTH_COMPONENT24:
+			return("DEPTH24");
+		case GL_DEPTH_COMPONENT32F:
+			return("DEPTH32F");
+		default:
+			return(NULL);
+		}
+	}
+
+	/***********************************************************
+	 *  AddResource()
+	 *
+	 *  Replace the record of the object or add a new one, the
+	 *  mutex has to be held.
+	 ***********************************************************/
+	void AddResource(const TRACKED_RESOURCE& resource)
+	{
+		bool bReplaced = false;
+		for (size_t i = 0; (i < g_resources.size()) && !bReplaced; i++)
+		{
+			TRACKED_RESOURCE& tracked = g_resources[i];
+			if ((tracked.type == resource.type) && (tracked.id == resource.id))
+			{
+				g_totals.counts[tracked.type]--;
+				g_totals.bytes[tracked.type] -= tracked.bytes;
+				g_totals.totalBytes -= tracked.bytes;
+				tracked = resource;
+				bReplaced = true;
+			}
+		}
+		if (!bReplaced)
+		{
+			g_resources.push_back(resource);
+		}
+
+		g_totals.counts[resource.type]++;
+		g_totals.bytes[resource.type] += resource.bytes;
+		g_totals.totalBytes += resource.bytes;
+		g_totals.peakBytes = std::max(g_totals.peakBytes, g_totals.totalBytes);
+	}
+
+	/***********************************************************
+	 *  RemoveResource()
+	 *
+	 *  Drop the record at the index, the mutex has to be held.
+	 ***********************************************************/
+	void RemoveResource(size_t index)
+	{
+		const TRACKED_RESOURCE& tracked = g_resources[index];
+		g_totals.counts[tracked.type]--;
+		g_totals.bytes[tracked.type] -= tracked.bytes;
+		g_totals.totalBytes -= tracked.bytes;
+
+		g_resources[index] = g_resources.back();
+		g_resources.pop_back();
+	}
+
+	/***********************************************************
+	 *  OnReportSignal()
+	 *
+	 *  Only a flag may be set inside the handler, the report is
+	 *  printed by the render thread.  Windows resets the handler
+	 *  on every signal, so it is installed again.
+	 ***********************************************************/
+	void OnReportSignal(int signalNumber)
+	{
+		g_bReportRequested = 1;
+		signal(signalNumber, OnReportSignal);
+	}
+}
+
+/***********************************************************
+ *  TrackTexture()
+ *
+ *  Record a texture with the size of all of its mip levels
+ *  and layers, a plain 2D texture has one layer.
+ ***********************************************************/
+void TrackTexture(GLuint id, GLenum format, int width, int height, int layers, int mipCount, const std::string& owner)
+{
+	if (0 == id)
+	{
+		return;
+	}
+
+	size_t texels = 0;
+	for (int level = 0; level < mipCount; level++)
+	{
+		texels += (size_t)std::max(width >> level, 1) * std::max(height >> level, 1);
+	}
+
+	TRACKED_RESOURCE resource;
+	resource.type = RESOURCE_TEXTURE;
+	resource.id = id;
+	resource.owner = owner;
+	resource.format = format;
+	resource.width = width;
+	resource.height = height;
+	resource.layers = std::max(layers, 1);
+	resource.mipCount = mipCount;
+	resource.bytes = texels * resource.layers * GetTexelSize(format);
+
+	std::lock_guard<std::mutex> lock(g_resourceMutex);
+	AddResource(resource);
+}
+
+/***********************************************************
+ *  TrackBuffer()
+ *
+ *  Record a buffer with the size of its data store, tracking
+ *  it again after a new glBufferData updates the size.
+ ***********************************************************/
+void TrackBuffer(GLuint id, size_t bytes, const std::string& owner)
+{
+	if (0 == id)
+	{
+		return;
+	}
+
+	TRACKED_RESOURCE resource = { RESOURCE_BUFFER, id, owner, 0, 0, 0, 0, 0, bytes };
+
+	std::lock_guard<std::mutex> lock(g_resourceMutex);
+	AddResource(resource);
+}
+
+/***********************************************************
+ *  TrackProgram()
+ *
+ *  Record a linked program, its binary length stands in for
+ *  the memory the driver keeps for it.
+ ***********************************************************/
+void TrackProgram(GLuint id, const std::string& owner)
+{
+	if (0 == id)
+	{
+		return;
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	TRACKED_RESOURCE resource = { RESOURCE_PROGRAM, id, owner, 0, 0, 0, 0, 0, (size_t)std::max(binaryLength, 0) };
+
+	std::lock_guard<std::mutex> lock(g_resourceMutex);
+	AddResource(resource);
+}
+
+/***********************************************************
+ *  UntrackResource() / UntrackResources()
+ *
+ *  Drop the records of deleted objects, an object that was
+ *  never tracked is ignored.
+ ***********************************************************/
+void UntrackResource(RESOURCE_TYPE type, GLuint id)
+{
+	std::lock_guard<std::mutex> lock(g_resourceMutex);
+	for (size_t i = 0; i < g_resources.size(); i++)
+	{
+		if ((g_resources[i].type == type) && (g_resources[i].id == id))
+		{
+			RemoveResource(i);
+			return;
+		}
+	}
+}
+
+void UntrackResources(RESOURCE_TYPE type, const std::string& owner)
+{
+	std::lock_guard<std::mutex> lock(g_resourceMutex);
+	size_t i = 0;
+	while (i < g_resources.size())
+	{
+		if ((g_resources[i].type == type) && (g_resources[i].owner == owner))
+		{
+			RemoveResource(i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetFullMipCount()
+ *
+ *  Levels glGenerateMipmap creates for the size.
+ ***********************************************************/
+int GetFullMipCount(int width, int height)
+{
+	int mipCount = 1;
+	int size = std::max(width, height);
+	while (size > 1)
+	{
+		size >>= 1;
+		mipCount++;
+	}
+	return(mipCount);
+}
+
+/***********************************************************
+ *  EndResourceFrame()
+ *
+ *  Add up what the frame allocated on the CPU, the arena is
+ *  reset at the start of every frame so its use is the
+ *  frame's, and the heap bytes are the ones allocated since
+ *  the last frame ended.
+ ***********************************************************/
+void EndResourceFrame(size_t arenaBytes)
+{
+	size_t heapBytes = GetThreadAllocatedBytes();
+	size_t frameBytes = arenaBytes + (heapBytes - g_lastHeapBytes);
+	g_lastHeapBytes = heapBytes;
+
+	{
+		std::lock_guard<std::mutex> lock(g_resourceMutex);
+		g_totals.frameCpuBytes = frameBytes;
+		g_totals.peakFrameCpuBytes = std::max(g_totals.peakFrameCpuBytes, frameBytes);
+		g_totals.frameCount++;
+	}
+
+	if (0 != g_bReportRequested)
+	{
+		g_bReportRequested = 0;
+		PrintResourceReport();
+	}
+}
+
+/***********************************************************
+ *  GetResourceTotals() / GetTrackedResources()
+ *
+ *  Copies, the records change on the loader thread.
+ ***********************************************************/
+RESOURCE_TOTALS GetResourceTotals()
+{
+	std::lock_guard<std::mutex> lock(g_resourceMutex);
+	return(g_totals);
+}
+
+std::vector<TRACKED_RESOURCE> GetTrackedResources()
+{
+	std::lock_guard<std::mutex> lock(g_resourceMutex);
+	return(g_resources);
+}
+
+/***********************************************************
+ *  PrintResourceReport()
+ *
+ *  Print the sums per type, the CPU use of the frames and
+ *  one line per tracked object, largest first.
+ ***********************************************************/
+void PrintResourceReport()
+{
+	RESOURCE_TOTALS totals = GetResourceTotals();
+	std::vector<TRACKED_RESOURCE> resources = GetTrackedResources();
+	std::sort(resources.begin(), resources.end(),
+		[](const TRACKED_RESOURCE& first, const TRACKED_RESOURCE& second)
+		{
+			return(first.bytes > second.bytes);
+		});
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "INFO: GL resources";
+	for (int type = 0; type < RESOURCE_TYPE_COUNT; type++)
+	{
+		std::cout << ", " << totals.counts[type] << " " << RESOURCE_TYPE_NAMES[type] << "s "
+			<< (totals.bytes[type] / BYTES_PER_MEGABYTE) << " MB";
+	}
+	std::cout << ", total " << (totals.totalBytes / BYTES_PER_MEGABYTE) << " MB, peak "
+		<< (totals.peakBytes / BYTES_PER_MEGABYTE) << " MB" << std::endl;
+	std::cout << "INFO: CPU allocations per frame, last " << (totals.frameCpuBytes / BYTES_PER_MEGABYTE)
+		<< " MB, peak " << (totals.peakFrameCpuBytes / BYTES_PER_MEGABYTE) << " MB over "
+		<< totals.frameCount << " frames" << std::endl;
+
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		const TRACKED_RESOURCE& resource = resources[i];
+		std::cout << "  " << std::left << std::setw(8) << RESOURCE_TYPE_NAMES[resource.type] << std::right
+			<< std::setw(6) << resource.id << std::setw(10) << (resource.bytes / BYTES_PER_MEGABYTE) << " MB  ";
+		if (RESOURCE_TEXTURE == resource.type)
+		{
+			const char* formatName = GetFormatName(resource.format);
+			if (NULL != formatName)
+			{
+				std::cout << formatName;
+			}
+			else
+			{
+				std::cout << "0x" << std::hex << resource.format << std::dec;
+			}
+			std::cout << " " << resource.width << "x" << resource.height;
+			if (resource.layers > 1)
+			{
+				std::cout << "x" << resource.layers;
+			}
+			std::cout << ", " << resource.mipCount << " mips  ";
+		}
+		std::cout << resource.owner << std::endl;
+	}
+
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+}
+
+/***********************************************************
+ *  InstallResourceReportSignal()
+ *
+ *  kill -USR1 <pid> prints a report without stopping the
+ *  application, Windows has no user signals and takes
+ *  Ctrl+Break in the console instead.
+ ***********************************************************/
+void InstallResourceReportSignal()
+{
+#ifdef _WIN32
+	signal(SIGBREAK, OnReportSignal);
+#else
+	signal(SIGUSR1, OnReportSignal);
+#endif
+}
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcetracker.h
+// ============
+// account for the memory of the GL objects and of each frame's CPU allocations
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// kinds of tracked GL objects
+enum RESOURCE_TYPE
+{
+	RESOURCE_TEXTURE,
+	RESOURCE_BUFFER,
+	RESOURCE_PROGRAM,
+	RESOURCE_TYPE_COUNT
+};
+
+// one live GL object
+struct TRACKED_RESOURCE
+{
+	RESOURCE_TYPE type;
+	GLuint id;
+	// what created the object, and for what
+	std::string owner;
+	// internal format and size of a texture, zero for the others
+	GLenum format;
+	int width;
+	int height;
+	int layers;
+	int mipCount;
+	// estimated bytes of GPU memory, including all mip levels
+	size_t bytes;
+};
+
+// sums over the tracked objects and the frames
+struct RESOURCE_TOTALS
+{
+	int counts[RESOURCE_TYPE_COUNT];
+	size_t bytes[RESOURCE_TYPE_COUNT];
+	// GPU bytes of all objects, now and at the most
+	size_t totalBytes;
+	size_t peakBytes;
+	// CPU bytes allocated by the last frame and by the largest one,
+	// the frame arena plus the heap, heap allocations are only
+	// counted in debug builds
+	size_t frameCpuBytes;
+	size_t peakFrameCpuBytes;
+	// frames ended since the start
+	unsigned long long frameCount;
+};
+
+// record a GL object when it gets its storage, an id that is tracked
+// already has its record replaced.  These may be called from any
+// thread with a GL context.
+void TrackTexture(GLuint id, GLenum format, int width, int height, int layers, int mipCount, const std::string& owner);
+void TrackBuffer(GLuint id, size_t bytes, const std::string& owner);
+void TrackProgram(GLuint id, const std::string& owner);
+// forget a GL object when it is deleted
+void UntrackResource(RESOURCE_TYPE type, GLuint id);
+// forget every object of a type the owner created
+void UntrackResources(RESOURCE_TYPE type, const std::string& owner);
+
+// levels of a full mip chain down to 1x1
+int GetFullMipCount(int width, int height);
+
+// end of a frame on the render thread, arenaBytes is what the frame
+// arena handed out.  A report that was asked for by the signal is
+// printed here.
+void EndResourceFrame(size_t arenaBytes);
+
+// current sums and a copy of every tracked object
+RESOURCE_TOTALS GetResourceTotals();
+std::vector<TRACKED_RESOURCE> GetTrackedResources();
+
+// print the sums and every tracked object, largest first
+void PrintResourceReport();
+// print a report at the end of the frame the process gets SIGUSR1,
+// or Ctrl+Break on Windows
+void InstallResourceReportSignal();
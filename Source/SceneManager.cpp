@@ -8,6 +8,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "AllocationCounter.h"
+#include "ResourceTracker.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +18,138 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+
+	// smallest draw list reserved in the frame arena
+	const int MIN_DRAW_CAPACITY = 64;
+	// start value of the scene bounds, any draw replaces it
+	const float EMPTY_BOUND = 1.0e30f;
+	// distance between the copies of a scaled up scene, the still life
+	// is 24 units wide and about 19 high
+	const float SCENE_COPY_SPACING_X = 30.0f;
+	const float SCENE_COPY_SPACING_Y = 22.0f;
+	// images loaded again to fill the texture slots
+	const char* FILL_TEXTURE_FILES[] =
+	{
+		"BackgroundTile.jpg",
+		"PotGold.jpg",
+		"gold-seamless-texture.jpg",
+		"melon.bmp",
+		"leaf.bmp",
+		"knife_handle.jpg"
+	};
+	const int FILL_TEXTURE_FILE_COUNT = 6;
+
+	/***********************************************************
+	 *  GetCopyGridSize()
+	 *
+	 *  Number of columns and rows of the square copy grid.
+	 ***********************************************************/
+	int GetCopyGridSize(int copies)
+	{
+		int gridSize = 1;
+		while ((gridSize * gridSize) < copies)
+		{
+			gridSize++;
+		}
+		return(gridSize);
+	}
+
+	// folder of the packed mesh files, next to the shaders
+	const char* MESH_CACHE_DIRECTORY = "MeshCache";
+	// generated primitive of each basic mesh, in MESH_TYPE order,
+	// the imported mesh comes from a file instead
+	const MESH_PRIMITIVE SCENE_PRIMITIVES[] =
+	{
+		PRIMITIVE_PLANE,
+		PRIMITIVE_BOX,
+		PRIMITIVE_SPHERE,
+		PRIMITIVE_TORUS,
+		PRIMITIVE_HALF_TORUS,
+		PRIMITIVE_TAPERED_CYLINDER
+	};
+
+	/***********************************************************
+	 *  LoadTextureFile()
+	 *
+	 *  Decode an image file into a new texture with mipmaps,
+	 *  returns the texture or 0.  This runs on the loader thread.
+	 ***********************************************************/
+	GLuint LoadTextureFile(const char* filename)
+	{
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+		GLuint textureID = 0;
+
+		// indicate to always flip images vertically when loaded
+		stbi_set_flip_vertically_on_load(true);
+
+		// try to parse the image data from the specified image file
+		unsigned char* image = stbi_load(
+			filename,
+			&width,
+			&height,
+			&colorChannels,
+			0);
+
+		// if the image was successfully read from the image file
+		if (image)
+		{
+			std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+
+			glGenTextures(1, &textureID);
+			glBindTexture(GL_TEXTURE_2D, textureID);
+
+			// set the texture wrapping parameters
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			// set texture filtering parameters
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			// if the loaded image is in RGB format
+			if (colorChannels == 3)
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+			// if the loaded image is in RGBA format - it supports transparency
+			else if (colorChannels == 4)
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+			else
+			{
+				std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+				stbi_image_free(image);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				glDeleteTextures(1, &textureID);
+				return(0);
+			}
+
+			// generate the texture mipmaps for mapping textures to lower resolutions
+			glGenerateMipmap(GL_TEXTURE_2D);
+			TrackTexture(textureID, (colorChannels == 3) ? GL_RGB8 : GL_RGBA8, width, height, 1,
+				GetFullMipCount(width, height), std::string("SceneManager ") + filename);
+
+			// free the image data from local memory
+			stbi_image_free(image);
+			glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+			return(textureID);
+		}
+
+		std::cout << "Could not load image:" << filename << std::endl;
+
+		// Error loading the image
+		return(0);
+	}
 }
 
 /***********************************************************
@@ -31,10 +157,55 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderManager *pShaderManager, FrameRingBuffer* pFrameRingBuffer, FrameArena* pFrameArena,
+	UploadQueue* pUploadQueue)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
+	m_pFrameRingBuffer = pFrameRingBuffer;
+	m_pFrameArena = pFrameArena;
+	m_pMeshLibrary = new MeshLibrary(MESH_CACHE_DIRECTORY);
+	for (int i = 0; i < MESH_TYPE_COUNT; i++)
+	{
+		m_meshIDs[i] = -1;
+	}
+	m_pThreadPool = new ThreadPool();
+	m_pLightManager = new LightManager(pFrameRingBuffer, m_pThreadPool, pFrameArena);
+	m_pUploadQueue = pUploadQueue;
+	m_pDrawCommands = NULL;
+	m_drawCommandCount = 0;
+	m_drawCommandCapacity = 0;
+	m_pMaterialStore = new MaterialStore();
+	m_drawDataOffset = -1;
+	m_drawDataStride = 0;
+	m_pMeshletDraws = NULL;
+	m_meshletCount = 0;
+	m_visibleMeshletCount = 0;
+	m_sceneCopies = 1;
+	m_copyOffset = glm::vec3(0.0f);
+	m_bTextureEveryDraw = false;
+	m_sceneBoundsMin = glm::vec3(EMPTY_BOUND);
+	m_sceneBoundsMax = glm::vec3(-EMPTY_BOUND);
+	m_importedTransform.scale = glm::vec3(1.0f);
+	m_importedTransform.rotationDegrees = glm::vec3(0.0f);
+	m_importedTransform.position = glm::vec3(0.0f);
+
+	// default shader data for draws, matching the old uniform defaults
+	m_currentDraw.model = glm::mat4(1.0f);
+	m_currentDraw.normalMatrix[0] = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+	m_currentDraw.normalMatrix[1] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+	m_currentDraw.normalMatrix[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+	m_currentTransform.scale = glm::vec3(1.0f);
+	m_currentTransform.rotationDegrees = glm::vec3(0.0f);
+	m_currentTransform.position = glm::vec3(0.0f);
+	m_bCurrentDynamic = false;
+	m_staticGeometryVersion = 0;
+	m_dynamicDrawCount = 0;
+	m_currentDraw.objectColor = glm::vec4(1.0f);
+	m_currentDraw.UVscale = glm::vec2(1.0f, 1.0f);
+	m_currentDraw.bUseTexture = false;
+	m_currentDraw.textureSlot = 0;
+	m_currentDraw.materialIndex = 0;
+	m_currentDraw.vertexFormat = VERTEX_FORMAT_PACKED;
 
 	// initialize the texture collection
 	for (int i = 0; i < 16; i++)
@@ -53,90 +224,89 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
-	delete m_basicMeshes;
-	m_basicMeshes = NULL;
+	delete m_pMeshLibrary;
+	m_pMeshLibrary = NULL;
+	delete m_pLightManager;
+	m_pLightManager = NULL;
+	delete m_pThreadPool;
+	m_pThreadPool = NULL;
 
 	// destroy the created OpenGL textures
 	DestroyGLTextures();
 
 	// Clear materials.
-	m_objectMaterials.clear();
+	delete m_pMaterialStore;
+	m_pMaterialStore = NULL;
+	m_pFrameRingBuffer = NULL;
+	m_pFrameArena = NULL;
+	m_pUploadQueue = NULL;
+	m_pDrawCommands = NULL;
 }
 
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for loading textures from image files
+ *  into the next available texture slot in memory.  Only the
+ *  image header is read here, decoding, the upload and the
+ *  mipmaps run on the upload queue's loader thread and the
+ *  slot shows the texture from the frame the upload is
+ *  finished in.
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
 	int width = 0;
 	int height = 0;
 	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
+	if (m_loadedTextures >= 16)
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		std::cout << "No texture slot left for image:" << filename << std::endl;
+		return false;
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	// a file that cannot be read is reported right away
+	if (!stbi_info(filename, &width, &height, &colorChannels))
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	// register the texture slot and associate it with the special
+	// tag string, it is not drawn with until the upload is done
+	int textureSlot = m_loadedTextures;
+	m_textureIDs[textureSlot].ID = 0;
+	m_textureIDs[textureSlot].tag = tag;
+	m_loadedTextures++;
 
-		return true;
+	if (NULL == m_pUploadQueue)
+	{
+		m_textureIDs[textureSlot].ID = LoadTextureFile(filename);
+		return(0 != m_textureIDs[textureSlot].ID);
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	std::string file = filename;
+	std::shared_ptr<GLuint> pTextureID = std::make_shared<GLuint>(0);
+	m_pUploadQueue->Submit([file, pTextureID]()
+	{
+		*pTextureID = LoadTextureFile(file.c_str());
+		return(0 != *pTextureID);
+	},
+	[this, textureSlot, pTextureID](bool bSucceeded)
+	{
+		if (!bSucceeded)
+		{
+			return;
+		}
+
+		// swap the texture into its slot
+		m_textureIDs[textureSlot].ID = *pTextureID;
+		glActiveTexture(GL_TEXTURE0 + textureSlot);
+		glBindTexture(GL_TEXTURE_2D, *pTextureID);
+		glActiveTexture(GL_TEXTURE0);
+	});
 
-	// Error loading the image
-	return false;
+	return true;
 }
 
 /***********************************************************
@@ -159,14 +329,21 @@ void SceneManager::BindGLTextures()
  *  DestroyGLTextures()
  *
  *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  used texture memory slots.  A slot whose upload has not
+ *  finished holds no texture yet.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		if (0 != m_textureIDs[i].ID)
+		{
+			UntrackResource(RESOURCE_TEXTURE, m_textureIDs[i].ID);
+			glDeleteTextures(1, &m_textureIDs[i].ID);
+		}
+		m_textureIDs[i].ID = -1;
 	}
+	m_loadedTextures = 0;
 }
 
 /***********************************************************
@@ -175,7 +352,7 @@ void SceneManager::DestroyGLTextures()
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const char* tag)
 {
 	int textureID = -1;
 	int index = 0;
@@ -201,7 +378,7 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const char* tag)
 {
 	int textureSlot = -1;
 	int index = 0;
@@ -222,45 +399,24 @@ int SceneManager::FindTextureSlot(std::string tag)
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  AddObjectMaterial()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for adding a defined material to the
+ *  material store, which keeps the shading values apart from
+ *  the tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+void SceneManager::AddObjectMaterial(const OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
-	{
-		return(false);
-	}
-
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
-	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
-	}
-
-	return(true);
+	m_pMaterialStore->AddMaterial(material.tag.c_str(), material.ambientStrength,
+		material.ambientColor, material.diffuseColor, material.specularColor, material.shininess);
 }
 
 /***********************************************************
  *  SetTransformations()
  *
  *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  using the passed in transformation values.  The matrices
+ *  are built for all draws at once in UpdateTransforms().
  ***********************************************************/
 void SceneManager::SetTransformations(
 	glm::vec3 scaleXYZ,
@@ -269,29 +425,9 @@ void SceneManager::SetTransformations(
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	m_currentTransform.scale = scaleXYZ;
+	m_currentTransform.rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	m_currentTransform.position = positionXYZ + m_copyOffset;
 }
 
 /***********************************************************
@@ -314,11 +450,8 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_currentDraw.bUseTexture = false;
+	m_currentDraw.objectColor = currentColor;
 }
 
 /***********************************************************
@@ -328,16 +461,15 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	int textureSlot = -1;
+	textureSlot = FindTextureSlot(textureTag);
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+	// fall back to the object color when the texture was never
+	// loaded or is still on the upload queue
+	m_currentDraw.bUseTexture = (textureSlot >= 0) && (0 != m_textureIDs[textureSlot].ID);
+	m_currentDraw.textureSlot = (textureSlot >= 0) ? textureSlot : 0;
 }
 
 /***********************************************************
@@ -348,10 +480,7 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_currentDraw.UVscale = glm::vec2(u, v);
 }
 
 /***********************************************************
@@ -361,25 +490,277 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
+{
+	int materialIndex = m_pMaterialStore->FindMaterial(materialTag);
+	if (materialIndex >= 0)
+	{
+		m_currentDraw.materialIndex = materialIndex;
+	}
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for recording a draw of one of the
+ *  basic meshes along with the current shader data.
+ ***********************************************************/
+void SceneManager::DrawMesh(MESH_TYPE mesh)
+{
+	// a scene that grows mid-frame moves its list to a larger
+	// block, the next frame starts out with the full size
+	if (m_drawCommandCount == m_drawCommandCapacity)
+	{
+		int capacity = (m_drawCommandCapacity > 0) ? (m_drawCommandCapacity * 2) : MIN_DRAW_CAPACITY;
+		DRAW_COMMAND* pDrawCommands = m_pFrameArena->AllocateArray<DRAW_COMMAND>(capacity);
+		if (m_drawCommandCount > 0)
+		{
+			memcpy(pDrawCommands, m_pDrawCommands, sizeof(DRAW_COMMAND) * m_drawCommandCount);
+		}
+		m_pDrawCommands = pDrawCommands;
+		m_drawCommandCapacity = capacity;
+	}
+
+	DRAW_COMMAND& command = m_pDrawCommands[m_drawCommandCount];
+	command.mesh = mesh;
+	command.transform = m_currentTransform;
+	command.bDynamic = m_bCurrentDynamic;
+	command.drawData = m_currentDraw;
+	if (m_bTextureEveryDraw && (m_loadedTextures > 0))
+	{
+		int textureSlot = m_drawCommandCount % m_loadedTextures;
+		command.drawData.bUseTexture = (0 != m_textureIDs[textureSlot].ID);
+		command.drawData.textureSlot = textureSlot;
+	}
+	if (m_meshIDs[mesh] >= 0)
+	{
+		command.drawData.vertexFormat = m_pMeshLibrary->GetMesh(m_meshIDs[mesh]).vertexFormat;
+	}
+	m_drawCommandCount++;
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for building the model and normal
+ *  matrices of every recorded draw in one pass.  The scene is
+ *  recorded in the same order every frame, so a draw whose
+ *  placement did not change reuses last frame's matrices.
+ *  Any change to a static draw bumps the static geometry
+ *  version so cached shadow maps are drawn again.  The box
+ *  around all draws is gathered on the way.
+ ***********************************************************/
+void SceneManager::UpdateTransforms()
 {
-	if (m_objectMaterials.size() > 0)
+	m_dynamicDrawCount = 0;
+	m_sceneBoundsMin = glm::vec3(EMPTY_BOUND);
+	m_sceneBoundsMax = glm::vec3(-EMPTY_BOUND);
+
+	if (m_transformCache.size() != (size_t)m_drawCommandCount)
+	{
+		m_staticGeometryVersion++;
+
+		TRANSFORM_CACHE empty;
+		empty.mesh = MESH_PLANE;
+		empty.meshVersion = 0;
+		empty.bDynamic = false;
+		// a zero scale never matches a recorded draw, so every
+		// new entry is built on first use
+		empty.transform.scale = glm::vec3(0.0f);
+		empty.transform.rotationDegrees = glm::vec3(0.0f);
+		empty.transform.position = glm::vec3(0.0f);
+		m_transformCache.resize(m_drawCommandCount, empty);
+	}
+
+	unsigned int meshVersion = m_pMeshLibrary->GetMeshVersion();
+	for (int i = 0; i < m_drawCommandCount; i++)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		const TRANSFORM& transform = m_pDrawCommands[i].transform;
+		TRANSFORM_CACHE& cache = m_transformCache[i];
+
+		if (m_pDrawCommands[i].bDynamic)
+		{
+			m_dynamicDrawCount++;
+		}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
+		// the model matrix includes the mesh's dequantize matrix,
+		// so it is built again for another mesh as well, and once a
+		// requested mesh has replaced its empty placeholder
+		bool bMeshChanged = (cache.mesh != m_pDrawCommands[i].mesh) || (cache.meshVersion != meshVersion);
+		if (bMeshChanged || (cache.bDynamic != m_pDrawCommands[i].bDynamic))
 		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			m_staticGeometryVersion++;
+			cache.mesh = m_pDrawCommands[i].mesh;
+			cache.meshVersion = meshVersion;
+			cache.bDynamic = m_pDrawCommands[i].bDynamic;
 		}
+
+		if (bMeshChanged || (memcmp(&cache.transform, &transform, sizeof(TRANSFORM)) != 0))
+		{
+			if (!m_pDrawCommands[i].bDynamic)
+			{
+				m_staticGeometryVersion++;
+			}
+
+			glm::mat4 rotation =
+				glm::rotate(glm::radians(transform.rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f)) *
+				glm::rotate(glm::radians(transform.rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+				glm::rotate(glm::radians(transform.rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+			cache.transform = transform;
+			cache.model = glm::translate(transform.position) * rotation * glm::scale(transform.scale) *
+				m_pMeshLibrary->GetDequantizeMatrix(m_meshIDs[cache.mesh]);
+
+			// the inverse transpose of rotation * scale is the same
+			// rotation with the inverse scale, a flattened axis keeps
+			// its normals instead of dividing by zero
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float inverseScale = (transform.scale[axis] != 0.0f) ? 1.0f / transform.scale[axis] : 1.0f;
+				cache.normalMatrix[axis] = glm::vec4(glm::vec3(rotation[axis]) * inverseScale, 0.0f);
+			}
+		}
+
+		DRAW_DATA& drawData = m_pDrawCommands[i].drawData;
+		drawData.model = cache.model;
+		drawData.normalMatrix[0] = cache.normalMatrix[0];
+		drawData.normalMatrix[1] = cache.normalMatrix[1];
+		drawData.normalMatrix[2] = cache.normalMatrix[2];
+
+		// the packed positions fill -1..1, the model matrix maps
+		// that cube to a box of this half size around its origin
+		glm::vec3 halfSize = glm::abs(glm::vec3(cache.model[0])) + glm::abs(glm::vec3(cache.model[1])) +
+			glm::abs(glm::vec3(cache.model[2]));
+		m_sceneBoundsMin = glm::min(m_sceneBoundsMin, glm::vec3(cache.model[3]) - halfSize);
+		m_sceneBoundsMax = glm::max(m_sceneBoundsMax, glm::vec3(cache.model[3]) + halfSize);
 	}
 }
 
+/***********************************************************
+ *  GetSceneDepth()
+ *
+ *  This method is used to get the view space depth of the
+ *  farthest corner of the box around the current frame's
+ *  draws, 0 when nothing is drawn.
+ ***********************************************************/
+float SceneManager::GetSceneDepth(const glm::mat4& view) const
+{
+	if (m_sceneBoundsMin.x > m_sceneBoundsMax.x)
+	{
+		return(0.0f);
+	}
+
+	float depth = 0.0f;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 point(
+			(corner & 1) ? m_sceneBoundsMax.x : m_sceneBoundsMin.x,
+			(corner & 2) ? m_sceneBoundsMax.y : m_sceneBoundsMin.y,
+			(corner & 4) ? m_sceneBoundsMax.z : m_sceneBoundsMin.z);
+		depth = std::max(depth, -(view * glm::vec4(point, 1.0f)).z);
+	}
+	return(depth);
+}
+
+/***********************************************************
+ *  WriteDrawCommands()
+ *
+ *  This method is used for writing the shader data of every
+ *  recorded draw into the frame ring buffer in one pass.
+ ***********************************************************/
+void SceneManager::WriteDrawCommands()
+{
+	m_drawDataOffset = -1;
+
+	if ((NULL == m_pFrameRingBuffer) || (m_drawCommandCount == 0))
+	{
+		return;
+	}
+
+	// each draw's data has to start on a binding offset boundary
+	GLsizeiptr alignment = m_pFrameRingBuffer->GetAlignment();
+	m_drawDataStride = ((sizeof(DRAW_DATA) + alignment - 1) / alignment) * alignment;
+
+	GLintptr baseOffset = 0;
+	unsigned char* pDrawData = (unsigned char*)m_pFrameRingBuffer->Allocate(
+		m_drawDataStride * m_drawCommandCount, &baseOffset);
+	if (NULL == pDrawData)
+	{
+		return;
+	}
+
+	for (int i = 0; i < m_drawCommandCount; i++)
+	{
+		memcpy(pDrawData + (m_drawDataStride * i), &m_pDrawCommands[i].drawData, sizeof(DRAW_DATA));
+	}
+
+	m_drawDataOffset = baseOffset;
+}
+
+/***********************************************************
+ *  SelectVisibleMeshlets()
+ *
+ *  This method is used for culling the meshlets of every
+ *  recorded draw against the camera.  The draw indirect
+ *  commands of the meshlets that are inside the view frustum
+ *  and not facing away are packed into the ring buffer, so
+ *  the camera passes of the frame never rasterize the rest.
+ ***********************************************************/
+void SceneManager::SelectVisibleMeshlets(const FRAME_DATA& frameData)
+{
+	m_pMeshletDraws = NULL;
+	m_meshletCount = 0;
+	m_visibleMeshletCount = 0;
+
+	// every meshlet visible is the most commands a draw can need
+	int commandSpace = 0;
+	for (int i = 0; i < m_drawCommandCount; i++)
+	{
+		int meshID = m_meshIDs[m_pDrawCommands[i].mesh];
+		if (meshID >= 0)
+		{
+			commandSpace += m_pMeshLibrary->GetMesh(meshID).meshlets.meshletCount;
+		}
+	}
+	if (0 == commandSpace)
+	{
+		return;
+	}
+
+	GLintptr baseOffset = 0;
+	DRAW_ELEMENTS_INDIRECT_COMMAND* pCommands = (DRAW_ELEMENTS_INDIRECT_COMMAND*)m_pFrameRingBuffer->Allocate(
+		sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND) * commandSpace, &baseOffset);
+	MESHLET_DRAW* pMeshletDraws = m_pFrameArena->AllocateArray<MESHLET_DRAW>(m_drawCommandCount);
+	if ((NULL == pCommands) || (NULL == pMeshletDraws))
+	{
+		return;
+	}
+
+	glm::mat4 viewProjection = frameData.projection * frameData.view;
+	int commandCount = 0;
+	for (int i = 0; i < m_drawCommandCount; i++)
+	{
+		pMeshletDraws[i].commandOffset = baseOffset + (sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND) * commandCount);
+		pMeshletDraws[i].commandCount = 0;
+
+		int meshID = m_meshIDs[m_pDrawCommands[i].mesh];
+		if (meshID < 0)
+		{
+			continue;
+		}
+
+		const MESH_MESHLETS& meshlets = m_pMeshLibrary->GetMesh(meshID).meshlets;
+		int visibleCount = 0;
+		pMeshletDraws[i].commandCount = CullMeshlets(meshlets, m_pDrawCommands[i].drawData.model, viewProjection,
+			frameData.viewPosition, pCommands + commandCount, &visibleCount);
+		commandCount += pMeshletDraws[i].commandCount;
+		m_meshletCount += meshlets.meshletCount;
+		m_visibleMeshletCount += visibleCount;
+	}
+
+	m_pMeshletDraws = pMeshletDraws;
+}
+
 /**************************************************************/
 /*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
 /*** preparing and rendering their own 3D replicated scenes.***/
@@ -484,7 +865,7 @@ void SceneManager::DefineObjectMaterials()
 	silver.tag = "silver";
 
 
-	m_objectMaterials.push_back(silver);
+	AddObjectMaterial(silver);
 
 	// Gold material.
 	OBJECT_MATERIAL goldMaterial;
@@ -495,7 +876,7 @@ void SceneManager::DefineObjectMaterials()
 	goldMaterial.shininess = 22.0;
 	goldMaterial.tag = "metal";
 
-	m_objectMaterials.push_back(goldMaterial);
+	AddObjectMaterial(goldMaterial);
 
 	// BlackMetal material.
 	OBJECT_MATERIAL blackMetalMaterial;
@@ -506,7 +887,7 @@ void SceneManager::DefineObjectMaterials()
 	blackMetalMaterial.shininess = 0.01;
 	blackMetalMaterial.tag = "blackmetal";
 
-	m_objectMaterials.push_back(blackMetalMaterial);
+	AddObjectMaterial(blackMetalMaterial);
 
 	// Blue Wood material.
 	OBJECT_MATERIAL blueWoodMaterial;
@@ -517,7 +898,7 @@ void SceneManager::DefineObjectMaterials()
 	blueWoodMaterial.shininess = 0.1;
 	blueWoodMaterial.tag = "bluewood";
 
-	m_objectMaterials.push_back(blueWoodMaterial);
+	AddObjectMaterial(blueWoodMaterial);
 
 	// Cheese material.
 	OBJECT_MATERIAL cheeseMaterial;
@@ -528,7 +909,7 @@ void SceneManager::DefineObjectMaterials()
 	cheeseMaterial.shininess = 0.3;
 	cheeseMaterial.tag = "cheese";
 
-	m_objectMaterials.push_back(cheeseMaterial);
+	AddObjectMaterial(cheeseMaterial);
 
 	// Turqoise material.
 	OBJECT_MATERIAL turqoiseMaterial;
@@ -539,9 +920,10 @@ void SceneManager::DefineObjectMaterials()
 	turqoiseMaterial.shininess = 0.1;
 	turqoiseMaterial.tag = "turqoise";
 
-	m_objectMaterials.push_back(turqoiseMaterial);
-
+	AddObjectMaterial(turqoiseMaterial);
 
+	// make the material table available to the shaders
+	m_pMaterialStore->Upload();
 }
 
 
@@ -549,7 +931,8 @@ void SceneManager::DefineObjectMaterials()
  *  SetupSceneLights()
  *
  *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  sources for the 3D scene.  Lights are assigned to clusters
+ *  every frame, so there is no fixed limit on their number.
  ***********************************************************/
 void SceneManager::SetupSceneLights()
 {
@@ -560,27 +943,29 @@ void SceneManager::SetupSceneLights()
 	//m_pShaderManager->setBoolValue(g_UseLightingName, true);
 
 	/*** STUDENTS - add the code BELOW for setting up light sources ***/
-	/*** Up to four light sources can be defined. Refer to the code ***/
-	/*** in the OpenGL Sample for help                              ***/
+	/*** Refer to the code in the OpenGL Sample for help            ***/
 	m_pShaderManager->setBoolValue(g_UseLightingName, true);
-	
-	// Main white light positioned and settings applied.
-	m_pShaderManager->setVec3Value("lightSources[0].position", 0.0f, 100.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientC", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseC", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularC", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStr", 25.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularInt", 0.9f);
 
-	// Softer blue light in foreground for specular reflection on pot handle.
+	LIGHT_DATA light;
 
-	m_pShaderManager->setVec3Value("lightSources[1].position", -2.0f, 0.0f, 10.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientC", 0.01f, 0.01f, 0.1f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseC", 0.5f, 0.5f, 1.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularC", 0.05f, 0.05f, 1.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStr", 1.5f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularInt", 0.9f);
+	// Main white light positioned and settings applied.
+	// A radius of zero keeps it lighting the whole scene.
+	light.position = glm::vec4(0.0f, 100.0f, 0.0f, 0.0f);
+	light.ambientColor = glm::vec4(0.2f, 0.2f, 0.2f, 25.0f);
+	light.diffuseColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.9f);
+	light.specularColor = glm::vec4(0.8f, 0.8f, 0.8f, 0.0f);
+	int mainLight = m_pLightManager->AddLight(light);
+	// the overhead light casts cascaded shadows straight down
+	m_pLightManager->SetDirectionalShadow(mainLight, glm::vec3(0.0f, -1.0f, 0.0f));
 
+	// Softer blue light in foreground for specular reflection on pot handle.
+	light.position = glm::vec4(-2.0f, 0.0f, 10.0f, 0.0f);
+	light.ambientColor = glm::vec4(0.01f, 0.01f, 0.1f, 1.5f);
+	light.diffuseColor = glm::vec4(0.5f, 0.5f, 1.0f, 0.9f);
+	light.specularColor = glm::vec4(0.05f, 0.05f, 1.0f, 0.0f);
+	int frontLight = m_pLightManager->AddLight(light);
+	// the front light throws the pot shadow back across the table
+	m_pLightManager->SetSpotShadow(frontLight, glm::vec3(0.0f, 2.0f, 0.0f), 90.0f);
 
 }
 
@@ -608,28 +993,220 @@ void SceneManager::PrepareScene()
 	// in the rendered 3D scene
 
 	// Added in items needed in final project to load them into memory.
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadTorusMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
+	// The meshes are generated on the first run only, later runs
+	// load them from the mesh cache.
+	for (int mesh = 0; mesh < MESH_IMPORTED; mesh++)
+	{
+		m_meshIDs[mesh] = m_pMeshLibrary->LoadPrimitive(GetDefaultMeshKey(SCENE_PRIMITIVES[mesh]));
+	}
 }
 
 /***********************************************************
- *  RenderScene()
+ *  PrepareFrame()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for recording the draws of the 3D scene
+ *  and writing their shader data for the current frame.  The
+ *  light sources are assigned to the view's clusters when the
+ *  forward shader needs them, after the draws are recorded so
+ *  the clusters can follow the scene's extent.  Resources the
+ *  upload queue has finished are swapped in first, so the
+ *  frame draws with them.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::PrepareFrame(const FRAME_DATA& frameData, bool bClusterLights, bool bUnboundedDepth)
 {
+	if (NULL != m_pUploadQueue)
+	{
+		m_pUploadQueue->Poll();
+	}
+
+	// once the scene has the same number of draws as last frame,
+	// recording it must not touch the heap
+	ALLOCATION_CHECK_BEGIN(recordAllocations);
+	int previousDrawCount = m_drawCommandCount;
+
+	// start a new list of draws in this frame's arena, sized for
+	// the previous frame's draws
+	m_drawCommandCapacity = (previousDrawCount > MIN_DRAW_CAPACITY) ? previousDrawCount : MIN_DRAW_CAPACITY;
+	m_pDrawCommands = m_pFrameArena->AllocateArray<DRAW_COMMAND>(m_drawCommandCapacity);
+	m_drawCommandCount = 0;
 
 	// Call functions to draw each part of scene.
 	DrawBackDrop();
-	DrawVase();
-	DrawChest();
-	DrawMelon();
-	DrawLeaves();
+
+	// a scaled up scene repeats the still life on a grid centered
+	// on the original
+	int gridSize = GetCopyGridSize(m_sceneCopies);
+	for (int copy = 0; copy < m_sceneCopies; copy++)
+	{
+		m_copyOffset = glm::vec3(
+			((copy % gridSize) - ((gridSize - 1) * 0.5f)) * SCENE_COPY_SPACING_X,
+			((copy / gridSize) - ((gridSize - 1) * 0.5f)) * SCENE_COPY_SPACING_Y,
+			0.0f);
+		DrawVase();
+		DrawChest();
+		DrawMelon();
+		DrawLeaves();
+	}
+	m_copyOffset = glm::vec3(0.0f);
+
+	DrawImportedMesh();
+
+	// build the matrices, then write the per-draw data once, every
+	// pass of the frame reuses it
+	UpdateTransforms();
+	WriteDrawCommands();
+	SelectVisibleMeshlets(frameData);
+
+	ALLOCATION_CHECK_END(recordAllocations, m_drawCommandCount == previousDrawCount);
+
+	if (bClusterLights)
+	{
+		// assign the light sources to the clusters of this view.
+		// Geometry past the far plane of the view would fall into
+		// the last depth slice and miss the lights near it, so the
+		// slices are stretched to the far side of the scene.  The
+		// far plane doubles until it is reached, the cluster bounds
+		// are then only rebuilt when the camera crosses a step.
+		FRAME_DATA clusterData = frameData;
+		if (bUnboundedDepth)
+		{
+			float sceneDepth = GetSceneDepth(frameData.view);
+			while ((clusterData.viewport.w > 0.0f) && (clusterData.viewport.w < sceneDepth))
+			{
+				clusterData.viewport.w *= 2.0f;
+			}
+		}
+		m_pLightManager->UpdateClusters(clusterData);
+	}
+	else
+	{
+		m_pLightManager->UploadLights();
+	}
+}
+
+/***********************************************************
+ *  SetSceneCopies()
+ *
+ *  This method is used to set how often the still life is
+ *  recorded from the next frame on.
+ ***********************************************************/
+void SceneManager::SetSceneCopies(int copies)
+{
+	m_sceneCopies = (copies > 1) ? copies : 1;
+}
+
+/***********************************************************
+ *  GetSceneCopyExtent()
+ *
+ *  This method is used to get the distance from the center
+ *  of the copy grid to its outer copies.
+ ***********************************************************/
+glm::vec2 SceneManager::GetSceneCopyExtent() const
+{
+	int gridSize = GetCopyGridSize(m_sceneCopies);
+	return(glm::vec2(
+		(gridSize - 1) * 0.5f * SCENE_COPY_SPACING_X,
+		(gridSize - 1) * 0.5f * SCENE_COPY_SPACING_Y));
+}
+
+/***********************************************************
+ *  FillTextureSlots()
+ *
+ *  This method is used to take the free texture slots with
+ *  more copies of the scene's images, so every slot holds its
+ *  own texture.
+ ***********************************************************/
+void SceneManager::FillTextureSlots()
+{
+	char tag[32];
+	for (int i = 0; m_loadedTextures < 16; i++)
+	{
+		snprintf(tag, sizeof(tag), "fill%d", i);
+		if (CreateGLTexture(FILL_TEXTURE_FILES[i % FILL_TEXTURE_FILE_COUNT], tag) == false)
+		{
+			break;
+		}
+	}
+	BindGLTextures();
+}
+
+/***********************************************************
+ *  RequestImportedMesh()
+ *
+ *  This method is used to import a mesh file on the upload
+ *  queue's loader thread while the scene keeps rendering.
+ *  The mesh is recorded every frame from now on and draws
+ *  nothing until its upload is finished.
+ ***********************************************************/
+bool SceneManager::RequestImportedMesh(const char* filename, glm::vec3 scaleXYZ, glm::vec3 positionXYZ)
+{
+	m_importedTransform.scale = scaleXYZ;
+	m_importedTransform.rotationDegrees = glm::vec3(0.0f);
+	m_importedTransform.position = positionXYZ;
+	m_meshIDs[MESH_IMPORTED] = m_pMeshLibrary->RequestMeshFile(filename, m_pUploadQueue);
+	if (m_meshIDs[MESH_IMPORTED] < 0)
+	{
+		std::cout << "Could not load mesh:" << filename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  drawing the basic 3D shapes recorded for this frame with
+ *  the currently active shader program.  It can be called for
+ *  every render pass of a frame, the filter picks the static
+ *  or the dynamic draws only.  Camera passes draw the meshlets
+ *  that passed this frame's culling, the other views draw the
+ *  whole meshes.
+ ***********************************************************/
+void SceneManager::RenderScene(DRAW_FILTER filter, bool bCameraView)
+{
+	if (m_drawDataOffset < 0)
+	{
+		return;
+	}
+
+	// the draws are replayed from the recorded list only
+	ALLOCATION_CHECK_BEGIN(renderAllocations);
+
+	bool bMeshlets = bCameraView && (NULL != m_pMeshletDraws);
+	if (bMeshlets)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_pFrameRingBuffer->GetBufferID());
+	}
+
+	for (int i = 0; i < m_drawCommandCount; i++)
+	{
+		if (((DRAW_STATIC == filter) && m_pDrawCommands[i].bDynamic) ||
+			((DRAW_DYNAMIC == filter) && !m_pDrawCommands[i].bDynamic))
+		{
+			continue;
+		}
+
+		m_pFrameRingBuffer->BindRange(GL_UNIFORM_BUFFER, DRAW_DATA_BINDING,
+			m_drawDataOffset + (m_drawDataStride * i), sizeof(DRAW_DATA));
+
+		if (bMeshlets)
+		{
+			m_pMeshLibrary->DrawMeshlets(m_meshIDs[m_pDrawCommands[i].mesh],
+				m_pMeshletDraws[i].commandOffset, m_pMeshletDraws[i].commandCount);
+		}
+		else
+		{
+			m_pMeshLibrary->DrawMesh(m_meshIDs[m_pDrawCommands[i].mesh]);
+		}
+	}
+
+	if (bMeshlets)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	ALLOCATION_CHECK_END(renderAllocations, true);
 }
 
 
@@ -680,7 +1257,7 @@ void SceneManager::DrawBackDrop() {
 	SetShaderMaterial("turqoise");
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
+	DrawMesh(MESH_PLANE);
 }
 
 // Draw the vase made up of 3 meshes.
@@ -730,7 +1307,7 @@ void SceneManager::DrawVase() {
 	SetShaderMaterial("silver");
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawTorusMesh();
+	DrawMesh(MESH_TORUS);
 
 	/****************************************************************/
 
@@ -770,7 +1347,7 @@ void SceneManager::DrawVase() {
 	SetShaderTexture("pot");
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawTaperedCylinderMesh();
+	DrawMesh(MESH_TAPERED_CYLINDER);
 
 	/****************************************************************/
 
@@ -807,7 +1384,7 @@ void SceneManager::DrawVase() {
 	SetShaderMaterial("metal");
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawHalfTorusMesh();
+	DrawMesh(MESH_HALF_TORUS);
 }
 
 // Draw chest object with two straps on front.
@@ -869,7 +1446,7 @@ void SceneManager::DrawChest() {
 	SetShaderTexture("rustic");
 	//SetShaderColor(0.0, 0.0, 1, 0.3);
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
+	DrawMesh(MESH_BOX);
 
 	/****************************************************************/
 
@@ -904,7 +1481,7 @@ void SceneManager::DrawChest() {
 	SetShaderMaterial("blackmetal");
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
+	DrawMesh(MESH_BOX);
 
 
 	/****************************************************************/
@@ -940,7 +1517,7 @@ void SceneManager::DrawChest() {
 	SetShaderMaterial("blackmetal");
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
+	DrawMesh(MESH_BOX);
 }
 
 // Draw melon 
@@ -1000,7 +1577,7 @@ void SceneManager::DrawMelon() {
 	SetShaderTexture("melon");
 	//SetShaderColor(0.0, 0.0, 1, 0.3);
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 }
 
@@ -1061,7 +1638,7 @@ void SceneManager::DrawLeaves() {
 	SetShaderTexture("leaf");
 	//SetShaderColor(0.0, 0.0, 1, 0.3);
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 
 	// set the XYZ scale for the mesh
@@ -1084,7 +1661,7 @@ void SceneManager::DrawLeaves() {
 		positionXYZ);
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 
 	// set the XYZ scale for the mesh
@@ -1107,7 +1684,7 @@ void SceneManager::DrawLeaves() {
 		positionXYZ);
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 
 
@@ -1133,7 +1710,7 @@ void SceneManager::DrawLeaves() {
 		positionXYZ);
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 
 	// set the XYZ scale for the mesh
@@ -1156,7 +1733,7 @@ void SceneManager::DrawLeaves() {
 		positionXYZ);
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 
 
@@ -1182,7 +1759,7 @@ void SceneManager::DrawLeaves() {
 		positionXYZ);
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 
 	// Last Cluster
@@ -1207,7 +1784,7 @@ void SceneManager::DrawLeaves() {
 		positionXYZ);
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 
 
@@ -1231,6 +1808,35 @@ void SceneManager::DrawLeaves() {
 		positionXYZ);
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	DrawMesh(MESH_SPHERE);
 
 }
+
+
+// Draw the mesh file requested with RequestImportedMesh().
+void SceneManager::DrawImportedMesh() {
+	// nothing was requested, the placeholder of a requested mesh
+	// draws nothing until its upload is finished
+	if (m_meshIDs[MESH_IMPORTED] < 0)
+	{
+		return;
+	}
+
+	// set the transformations into memory to be used on the drawn meshes
+	SetTransformations(
+		m_importedTransform.scale,
+		m_importedTransform.rotationDegrees.x,
+		m_importedTransform.rotationDegrees.y,
+		m_importedTransform.rotationDegrees.z,
+		m_importedTransform.position);
+
+	// Apply uv scale to texture.
+	SetTextureUVScale(1.0, 1.0);
+
+	// Load gold texture and material on the mesh.
+	SetShaderTexture("gold");
+	SetShaderMaterial("metal");
+
+	// draw the mesh with transformation values
+	DrawMesh(MESH_IMPORTED);
+}
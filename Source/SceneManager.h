@@ -10,7 +10,14 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "MeshLibrary.h"
+#include "FrameArena.h"
+#include "FrameRingBuffer.h"
+#include "LightManager.h"
+#include "MaterialStore.h"
+#include "ShaderInterface.h"
+#include "ThreadPool.h"
+#include "UploadQueue.h"
 
 #include <string>
 #include <vector>
@@ -25,7 +32,8 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(ShaderManager *pShaderManager, FrameRingBuffer* pFrameRingBuffer, FrameArena* pFrameArena,
+		UploadQueue* pUploadQueue);
 	// destructor
 	~SceneManager();
 
@@ -35,6 +43,8 @@ public:
 		uint32_t ID;
 	};
 
+	// a material as it is defined, the material store keeps
+	// the values and the tag apart
 	struct OBJECT_MATERIAL
 	{
 		float ambientStrength;
@@ -45,29 +55,140 @@ public:
 		std::string tag;
 	};
 
+	// the basic meshes that can be drawn in the scene
+	enum MESH_TYPE
+	{
+		MESH_PLANE,
+		MESH_BOX,
+		MESH_SPHERE,
+		MESH_TORUS,
+		MESH_HALF_TORUS,
+		MESH_TAPERED_CYLINDER,
+		// a mesh file loaded with RequestImportedMesh()
+		MESH_IMPORTED,
+		MESH_TYPE_COUNT
+	};
+
+	// placement of a draw as passed to SetTransformations()
+	struct TRANSFORM
+	{
+		glm::vec3 scale;
+		glm::vec3 rotationDegrees;
+		glm::vec3 position;
+	};
+
+	// one recorded draw with the shader data it needs
+	struct DRAW_COMMAND
+	{
+		MESH_TYPE mesh;
+		TRANSFORM transform;
+		bool bDynamic;
+		DRAW_DATA drawData;
+	};
+
+	// matrices built for the draw recorded at the same position
+	// in the previous frame
+	struct TRANSFORM_CACHE
+	{
+		MESH_TYPE mesh;
+		// mesh library version the model matrix was built at
+		unsigned int meshVersion;
+		TRANSFORM transform;
+		bool bDynamic;
+		glm::mat4 model;
+		glm::vec4 normalMatrix[3];
+	};
+
+	// meshlet commands of a recorded draw for the camera passes
+	struct MESHLET_DRAW
+	{
+		// ring buffer offset of the first draw indirect command
+		GLintptr commandOffset;
+		int commandCount;
+	};
+
+	// subsets of the recorded draws for RenderScene()
+	enum DRAW_FILTER
+	{
+		DRAW_ALL,
+		DRAW_STATIC,
+		DRAW_DYNAMIC
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
+	// generated meshes of the basic shapes
+	MeshLibrary* m_pMeshLibrary;
+	// mesh library id of each basic mesh
+	int m_meshIDs[MESH_TYPE_COUNT];
+	// worker threads shared by the scene systems
+	ThreadPool* m_pThreadPool;
+	// light sources and their cluster assignment
+	LightManager* m_pLightManager;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
-	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	MaterialStore* m_pMaterialStore;
+	// pointer to the per-frame dynamic data buffer
+	FrameRingBuffer* m_pFrameRingBuffer;
+	// transient storage that is released every frame
+	FrameArena* m_pFrameArena;
+	// loader thread for textures and mesh files
+	UploadQueue* m_pUploadQueue;
+	// shader data for the next recorded draw
+	DRAW_DATA m_currentDraw;
+	// placement for the next recorded draw
+	TRANSFORM m_currentTransform;
+	// set when the next recorded draws move from frame to frame
+	bool m_bCurrentDynamic;
+	// bumped whenever a static draw is added, removed or moved
+	unsigned int m_staticGeometryVersion;
+	// dynamic draws recorded for the current frame
+	int m_dynamicDrawCount;
+	// draws recorded for the current frame, held in the frame arena
+	DRAW_COMMAND* m_pDrawCommands;
+	int m_drawCommandCount;
+	int m_drawCommandCapacity;
+	// matrices of the previous frame's draws, rebuilt only when the
+	// placement of a draw changes
+	std::vector<TRANSFORM_CACHE> m_transformCache;
+	// world space box around the current frame's draws
+	glm::vec3 m_sceneBoundsMin;
+	glm::vec3 m_sceneBoundsMax;
+	// ring buffer offset of the first draw's data, -1 when not written
+	GLintptr m_drawDataOffset;
+	// bytes between the data of consecutive draws
+	GLsizeiptr m_drawDataStride;
+	// meshlets of each recorded draw that the camera can see,
+	// held in the frame arena, NULL when not selected
+	MESHLET_DRAW* m_pMeshletDraws;
+	// meshlets of the recorded draws and how many are visible
+	int m_meshletCount;
+	int m_visibleMeshletCount;
+	// copies of the still life drawn side by side, and the offset
+	// SetTransformations() adds for the copy being recorded
+	int m_sceneCopies;
+	glm::vec3 m_copyOffset;
+	// set when every draw samples a texture, cycling through the slots
+	bool m_bTextureEveryDraw;
+	// placement of the imported mesh
+	TRANSFORM m_importedTransform;
 
-	// load texture images and convert to OpenGL texture data
+	// load texture images and convert to OpenGL texture data, the
+	// texture is used once the upload queue has finished it
 	bool CreateGLTexture(const char* filename, std::string tag);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
-	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	int FindTextureID(const char* tag);
+	int FindTextureSlot(const char* tag);
+	// add a defined material to the material store
+	void AddObjectMaterial(const OBJECT_MATERIAL& material);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -87,7 +208,7 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -95,7 +216,17 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+
+	// record a draw of a basic mesh with the current shader data
+	void DrawMesh(MESH_TYPE mesh);
+	// build the model and normal matrices of the recorded draws
+	void UpdateTransforms();
+	// write the shader data of the recorded draws into the ring buffer
+	void WriteDrawCommands();
+	// cull the meshlets of the recorded draws for the camera and
+	// write the commands of the visible ones into the ring buffer
+	void SelectVisibleMeshlets(const FRAME_DATA& frameData);
 
 	// Define Materials.
 	void DefineObjectMaterials();
@@ -118,6 +249,9 @@ private:
 	// Draw Leaves
 	void DrawLeaves();
 
+	// Draw the imported mesh once it was requested
+	void DrawImportedMesh();
+
 public:
 
 	void LoadSceneTextures();
@@ -125,7 +259,72 @@ public:
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
-	void RenderScene();
+	// camera views draw only the meshlets selected for this frame,
+	// other views such as the shadow maps draw whole meshes
+	void RenderScene(DRAW_FILTER filter = DRAW_ALL, bool bCameraView = true);
+
+	// pick the vertex format of the basic meshes, has to be
+	// called before PrepareScene()
+	void SetVertexFormat(VERTEX_FORMAT format) { m_pMeshLibrary->SetVertexFormat(format); }
+
+	// mark the following draws as moving, so cached data such as
+	// the static shadow maps leave them out
+	void SetDynamicDraws(bool bDynamic) { m_bCurrentDynamic = bDynamic; }
+	// changes whenever the static geometry of the scene changes
+	unsigned int GetStaticGeometryVersion() const { return(m_staticGeometryVersion); }
+	// dynamic draws recorded for the current frame
+	int GetDynamicDrawCount() const { return(m_dynamicDrawCount); }
+	// meshlets of the current frame's draws and how many passed
+	// the camera culling
+	int GetMeshletCount() const { return(m_meshletCount); }
+	int GetVisibleMeshletCount() const { return(m_visibleMeshletCount); }
+
+	// draw the vase, chest, melon and leaves this many times on a
+	// square grid in front of the backdrop, for scaled up benchmark
+	// scenes, one draws the scene as it was built
+	void SetSceneCopies(int copies);
+	int GetSceneCopies() const { return(m_sceneCopies); }
+	// half the width and height of the grid the copies cover
+	glm::vec2 GetSceneCopyExtent() const;
+	// texture every draw, cycling through the loaded textures, for
+	// texture heavy benchmark scenes
+	void SetTextureEveryDraw(bool bTextureEveryDraw) { m_bTextureEveryDraw = bTextureEveryDraw; }
+	// load the scene's images again under new tags until all texture
+	// slots are taken
+	void FillTextureSlots();
+	// import a mesh file on the loader thread and draw it with the
+	// passed in placement from the frame its upload is finished in
+	bool RequestImportedMesh(const char* filename, glm::vec3 scaleXYZ, glm::vec3 positionXYZ);
+
+	// record the draws and lights of the scene for the current frame,
+	// a camera that draws past the far plane of the view, such as
+	// reverse Z with its infinite far plane, has the light clusters
+	// reach to the far side of the scene
+	void PrepareFrame(const FRAME_DATA& frameData, bool bClusterLights, bool bUnboundedDepth = false);
+	// largest view space depth of the current frame's draws
+	float GetSceneDepth(const glm::mat4& view) const;
+
+	// access the scene light sources
+	LightManager* GetLightManager() { return(m_pLightManager); }
+	// access the worker threads shared by the scene systems
+	ThreadPool* GetThreadPool() { return(m_pThreadPool); }
+	// access the defined object materials
+	MaterialStore* GetMaterialStore() { return(m_pMaterialStore); }
+
+	// the draws recorded for the current frame, for renderers
+	// that do not go through RenderScene()
+	const DRAW_COMMAND* GetDrawCommands() const { return(m_pDrawCommands); }
+	int GetDrawCommandCount() const { return(m_drawCommandCount); }
+	// mesh library id of a basic mesh and the library itself
+	int GetMeshID(MESH_TYPE mesh) const { return(m_meshIDs[mesh]); }
+	const MeshLibrary* GetMeshLibrary() const { return(m_pMeshLibrary); }
+	// GL texture in a texture slot, 0 while it is being uploaded
+	GLuint GetSlotTexture(int textureSlot) const
+	{
+		return(((textureSlot >= 0) && (textureSlot < m_loadedTextures)) ? m_textureIDs[textureSlot].ID : 0);
+	}
+	// set while textures or meshes are still on the upload queue
+	bool HasPendingUploads() const { return((NULL != m_pUploadQueue) && (m_pUploadQueue->GetPendingCount() > 0)); }
 
 	
 
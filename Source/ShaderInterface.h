@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderinterface.h
+// ============
+// CPU side mirrors of the uniform and storage blocks declared in the GLSL
+// shaders, the struct layouts must match the std140 / std430 rules exactly
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// binding points shared by the application and the shaders
+enum SHADER_BLOCK_BINDING
+{
+	FRAME_DATA_BINDING = 0,
+	DRAW_DATA_BINDING = 1,
+	MATERIAL_AMBIENT_BINDING = 2,
+	LIGHT_DATA_BINDING = 3,
+	CLUSTER_DATA_BINDING = 4,
+	CLUSTER_GRID_BINDING = 5,
+	LIGHT_INDEX_BINDING = 6,
+	LIGHT_LIST_BINDING = 7,
+	SHADOW_DATA_BINDING = 8,
+	MATERIAL_DIFFUSE_BINDING = 9,
+	MATERIAL_SPECULAR_BINDING = 10
+};
+
+/***********************************************************
+ *  FRAME_DATA
+ *
+ *  Camera values shared by every draw of a frame, mirrors the
+ *  std140 FrameData uniform block.
+ ***********************************************************/
+struct FRAME_DATA
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+	float padding;
+	// viewport width and height, near and far plane distances
+	glm::vec4 viewport;
+};
+
+/***********************************************************
+ *  DRAW_DATA
+ *
+ *  Values that change from one draw to the next, mirrors the
+ *  std140 DrawData uniform block.
+ ***********************************************************/
+struct DRAW_DATA
+{
+	glm::mat4 model;
+	// inverse transpose of the model rotation and scale, the
+	// columns of a std140 mat3 are padded to four floats
+	glm::vec4 normalMatrix[3];
+	glm::vec4 objectColor;
+	glm::vec2 UVscale;
+	int bUseTexture;
+	int textureSlot;
+	int materialIndex;
+	// VERTEX_FORMAT of the drawn mesh, picks how the vertex
+	// shader reads the normal
+	int vertexFormat;
+	int padding[2];
+};
+
+/***********************************************************
+ *  Material arrays
+ *
+ *  The MaterialAmbient, MaterialDiffuse and MaterialSpecular
+ *  storage blocks each hold one vec4 array, filled straight
+ *  from the hot arrays of the MaterialStore.
+ ***********************************************************/
+
+/***********************************************************
+ *  LIGHT_DATA
+ *
+ *  One light source, mirrors the std430 LightSource storage
+ *  block entry.  A radius of zero makes the light unbounded.
+ ***********************************************************/
+struct LIGHT_DATA
+{
+	// xyz world position, radius of influence in w
+	glm::vec4 position;
+	// rgb ambient color, specular focal strength in w
+	glm::vec4 ambientColor;
+	// rgb diffuse color, specular intensity in w
+	glm::vec4 diffuseColor;
+	// rgb specular color
+	glm::vec4 specularColor;
+};
+
+/***********************************************************
+ *  CLUSTER_DATA
+ *
+ *  Layout of the light cluster grid, mirrors the std140
+ *  ClusterData uniform block.
+ ***********************************************************/
+struct CLUSTER_DATA
+{
+	// tiles across, tiles down, depth slices, tile size in pixels
+	glm::uvec4 clusterGrid;
+	// depth slice scale and bias for log(view depth), near, far
+	glm::vec4 clusterDepth;
+};
+
+/***********************************************************
+ *  SHADOW_DATA
+ *
+ *  Shadow map projections of the shadow casting lights,
+ *  mirrors the std140 ShadowData uniform block.
+ ***********************************************************/
+struct SHADOW_DATA
+{
+	// world to shadow map clip space of every cascade
+	glm::mat4 cascadeViewProjection[3];
+	// world to shadow map clip space of the spot light
+	glm::mat4 spotViewProjection;
+	// view depth where each cascade ends
+	glm::vec4 cascadeSplits;
+	// directional light index, spot light index, cascade count,
+	// non-zero when shadows are enabled
+	glm::ivec4 shadowLights;
+	// cascade depth bias, spot depth bias, normal offset distance
+	glm::vec4 shadowBias;
+};
+
+static_assert(sizeof(FRAME_DATA) == 160, "FRAME_DATA must match the std140 FrameData block");
+static_assert(sizeof(DRAW_DATA) == 160, "DRAW_DATA must match the std140 DrawData block");
+static_assert(sizeof(glm::vec4) == 16, "material arrays must match the std140 vec4 array stride");
+static_assert(sizeof(LIGHT_DATA) == 64, "LIGHT_DATA must match the std430 LightSource block");
+static_assert(sizeof(CLUSTER_DATA) == 32, "CLUSTER_DATA must match the std140 ClusterData block");
+static_assert(sizeof(SHADOW_DATA) == 304, "SHADOW_DATA must match the std140 ShadowData block");
@@ -0,0 +1,521 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmanager.cpp
+// ============
+// render and cache the shadow maps of the shadow casting lights
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowManager.h"
+#include "RenderCounters.h"
+#include "ResourceTracker.h"
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// edge length of a cascade in texels
+	const int CASCADE_MAP_SIZE = 2048;
+	// edge length of the spot light map in texels
+	const int SPOT_MAP_SIZE = 1024;
+	// texture units the shadow maps are sampled from, past the
+	// scene textures and the geometry buffer
+	const int CASCADE_TEXTURE_UNIT = 20;
+	const int SPOT_TEXTURE_UNIT = 21;
+
+	// view depth covered by the cascades
+	const float SHADOW_DISTANCE = 40.0f;
+	// blend between uniform (0) and logarithmic (1) cascade splits
+	const float CASCADE_SPLIT_BLEND = 0.6f;
+	// a cascade only moves in steps of this fraction of its width,
+	// so the cached map survives small camera movements
+	const float CASCADE_SNAP_FRACTION = 0.125f;
+	// depth toward the light kept for casters outside the view
+	const float CASTER_DEPTH = 100.0f;
+	// near plane and depth past the aim point of the spot map
+	const float SPOT_NEAR_PLANE = 0.5f;
+	const float SPOT_RANGE = 40.0f;
+
+	// slope and constant depth offset while drawing the maps
+	const float SHADOW_OFFSET_FACTOR = 2.0f;
+	const float SHADOW_OFFSET_UNITS = 4.0f;
+	// depth compare bias and normal offset used by the shaders
+	const float CASCADE_DEPTH_BIAS = 0.0005f;
+	const float SPOT_DEPTH_BIAS = 0.0005f;
+	const float SHADOW_NORMAL_OFFSET = 0.02f;
+
+	// shadow shader uniform names
+	const char* g_LightViewProjectionName = "lightViewProjection";
+
+	/***********************************************************
+	 *  CreateShadowTexture()
+	 *
+	 *  Create a depth texture set up for hardware depth compares,
+	 *  a layer count of zero creates a plain 2D texture.
+	 ***********************************************************/
+	GLuint CreateShadowTexture(int size, int layers)
+	{
+		GLenum target = (layers > 0) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+		// outside the map nothing is in shadow
+		const GLfloat borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glBindTexture(target, texture);
+		if (layers > 0)
+		{
+			glTexStorage3D(target, 1, GL_DEPTH_COMPONENT32F, size, size, layers);
+			TrackTexture(texture, GL_DEPTH_COMPONENT32F, size, size, layers, 1, "ShadowManager cascades");
+		}
+		else
+		{
+			glTexStorage2D(target, 1, GL_DEPTH_COMPONENT32F, size, size);
+			TrackTexture(texture, GL_DEPTH_COMPONENT32F, size, size, 1, 1, "ShadowManager spot");
+		}
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, borderColor);
+		glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glBindTexture(target, 0);
+
+		return(texture);
+	}
+
+	/***********************************************************
+	 *  ChooseUpVector()
+	 *
+	 *  Pick an up vector that is not parallel to the direction a
+	 *  light looks in.
+	 ***********************************************************/
+	glm::vec3 ChooseUpVector(const glm::vec3& direction)
+	{
+		if (std::fabs(direction.y) > 0.99f * glm::length(direction))
+		{
+			return(glm::vec3(0.0f, 0.0f, -1.0f));
+		}
+		return(glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+}
+
+/***********************************************************
+ *  ShadowManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowManager::ShadowManager(FrameRingBuffer* pFrameRingBuffer)
+{
+	m_pFrameRingBuffer = pFrameRingBuffer;
+	m_pShadowShader = NULL;
+	m_lightViewProjectionLocation = -1;
+	m_framebufferID = 0;
+	m_staticCascades = 0;
+	m_staticSpot = 0;
+	m_cascades = 0;
+	m_spot = 0;
+	m_staticVersion = 0;
+	// no light has been drawn into the maps yet
+	m_cachedDirectional.lightIndex = -1;
+	m_cachedDirectional.aim = glm::vec3(0.0f);
+	m_cachedDirectional.fieldOfView = 0.0f;
+	m_cachedSpot = m_cachedDirectional;
+	m_cachedDirectionalLight.position = glm::vec4(0.0f);
+	m_cachedDirectionalLight.ambientColor = glm::vec4(0.0f);
+	m_cachedDirectionalLight.diffuseColor = glm::vec4(0.0f);
+	m_cachedDirectionalLight.specularColor = glm::vec4(0.0f);
+	m_cachedSpotLight = m_cachedDirectionalLight;
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		m_cascadeCenter[i] = glm::vec3(0.0f);
+		m_cascadeExtent[i] = 0.0f;
+		m_bCascadeValid[i] = false;
+		m_shadowData.cascadeViewProjection[i] = glm::mat4(1.0f);
+	}
+	m_bSpotValid = false;
+	m_shadowData.spotViewProjection = glm::mat4(1.0f);
+	m_shadowData.cascadeSplits = glm::vec4(0.0f);
+	m_shadowData.shadowLights = glm::ivec4(-1, -1, CASCADE_COUNT, 0);
+	m_shadowData.shadowBias = glm::vec4(CASCADE_DEPTH_BIAS, SPOT_DEPTH_BIAS, SHADOW_NORMAL_OFFSET, 0.0f);
+	m_bEnabled = true;
+	m_lastRenderedMaps = 0;
+}
+
+/***********************************************************
+ *  ~ShadowManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowManager::~ShadowManager()
+{
+	DestroyShadowMaps();
+	m_pFrameRingBuffer = NULL;
+}
+
+/***********************************************************
+ *  CreateShadowMaps()
+ *
+ *  This method is used to load the depth only program and
+ *  create the cached shadow maps and their framebuffer.
+ ***********************************************************/
+bool ShadowManager::CreateShadowMaps()
+{
+	DestroyShadowMaps();
+
+	m_pShadowShader = new ShaderManager();
+	GLuint shadowProgram = m_pShadowShader->LoadShaders(
+		"shadowVertexShader.glsl",
+		"depthFragmentShader.glsl");
+	TrackProgram(shadowProgram, "ShadowManager");
+	m_lightViewProjectionLocation = glGetUniformLocation(shadowProgram, g_LightViewProjectionName);
+
+	m_staticCascades = CreateShadowTexture(CASCADE_MAP_SIZE, CASCADE_COUNT);
+	m_staticSpot = CreateShadowTexture(SPOT_MAP_SIZE, 0);
+
+	// the maps are depth only
+	glGenFramebuffers(1, &m_framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_staticCascades, 0, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (GL_FRAMEBUFFER_COMPLETE != status)
+	{
+		std::cout << "Shadow framebuffer is incomplete, status 0x" << std::hex << status << std::dec << std::endl;
+		DestroyShadowMaps();
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  DestroyShadowMaps()
+ *
+ *  This method is used to free the shadow maps, the depth only
+ *  program and the framebuffer.
+ ***********************************************************/
+void ShadowManager::DestroyShadowMaps()
+{
+	GLuint* textures[4] = { &m_staticCascades, &m_staticSpot, &m_cascades, &m_spot };
+	for (int i = 0; i < 4; i++)
+	{
+		if (0 != *textures[i])
+		{
+			UntrackResource(RESOURCE_TEXTURE, *textures[i]);
+			glDeleteTextures(1, textures[i]);
+			*textures[i] = 0;
+		}
+	}
+	if (0 != m_framebufferID)
+	{
+		glDeleteFramebuffers(1, &m_framebufferID);
+		m_framebufferID = 0;
+	}
+	if (NULL != m_pShadowShader)
+	{
+		UntrackResources(RESOURCE_PROGRAM, "ShadowManager");
+		delete m_pShadowShader;
+		m_pShadowShader = NULL;
+	}
+
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		m_bCascadeValid[i] = false;
+	}
+	m_bSpotValid = false;
+}
+
+/***********************************************************
+ *  UpdateShadows()
+ *
+ *  This method is used to draw the shadow maps that no longer
+ *  match the scene, composite the dynamic draws when there are
+ *  any, and hand the shadow projections to the shaders.  The
+ *  draw data of the frame must already be written.
+ ***********************************************************/
+void ShadowManager::UpdateShadows(SceneManager* pSceneManager, const FRAME_DATA& frameData)
+{
+	m_lastRenderedMaps = 0;
+	m_shadowData.shadowLights = glm::ivec4(-1, -1, CASCADE_COUNT, 0);
+
+	if (m_bEnabled && (0 != m_framebufferID) && (NULL != pSceneManager))
+	{
+		LightManager* pLightManager = pSceneManager->GetLightManager();
+		const SHADOW_CASTER& directional = pLightManager->GetDirectionalShadow();
+		const SHADOW_CASTER& spot = pLightManager->GetSpotShadow();
+
+		// every cached map was drawn for older static geometry
+		if (pSceneManager->GetStaticGeometryVersion() != m_staticVersion)
+		{
+			m_staticVersion = pSceneManager->GetStaticGeometryVersion();
+			for (int i = 0; i < CASCADE_COUNT; i++)
+			{
+				m_bCascadeValid[i] = false;
+			}
+			m_bSpotValid = false;
+		}
+
+		// the composited maps are only needed once something moves
+		bool bDynamic = (pSceneManager->GetDynamicDrawCount() > 0);
+		if (bDynamic && (0 == m_cascades))
+		{
+			m_cascades = CreateShadowTexture(CASCADE_MAP_SIZE, CASCADE_COUNT);
+			m_spot = CreateShadowTexture(SPOT_MAP_SIZE, 0);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(SHADOW_OFFSET_FACTOR, SHADOW_OFFSET_UNITS);
+		m_pShadowShader->use();
+		CountStateChanges(2);
+
+		if (directional.lightIndex >= 0)
+		{
+			UpdateCascades(pSceneManager, frameData, bDynamic);
+			m_shadowData.shadowLights.x = directional.lightIndex;
+		}
+		if (spot.lightIndex >= 0)
+		{
+			UpdateSpot(pSceneManager, bDynamic);
+			m_shadowData.shadowLights.y = spot.lightIndex;
+		}
+		m_shadowData.shadowLights.w = 1;
+
+		glDisable(GL_POLYGON_OFFSET_FILL);
+
+		glActiveTexture(GL_TEXTURE0 + CASCADE_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, bDynamic ? m_cascades : m_staticCascades);
+		glActiveTexture(GL_TEXTURE0 + SPOT_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, bDynamic ? m_spot : m_staticSpot);
+		glActiveTexture(GL_TEXTURE0);
+		CountStateChanges(2);
+	}
+
+	if (NULL == m_pFrameRingBuffer)
+	{
+		return;
+	}
+
+	// the shaders read the block even when shadows are off
+	GLintptr shadowOffset = 0;
+	SHADOW_DATA* pShadowData = (SHADOW_DATA*)m_pFrameRingBuffer->Allocate(sizeof(SHADOW_DATA), &shadowOffset);
+	if (NULL != pShadowData)
+	{
+		memcpy(pShadowData, &m_shadowData, sizeof(SHADOW_DATA));
+		m_pFrameRingBuffer->BindRange(GL_UNIFORM_BUFFER, SHADOW_DATA_BINDING, shadowOffset, sizeof(SHADOW_DATA));
+	}
+}
+
+/***********************************************************
+ *  UpdateCascades()
+ *
+ *  This method is used to fit every cascade around a slice of
+ *  the view frustum.  A cascade is a square around the slice's
+ *  bounding sphere, which keeps its size while the camera turns,
+ *  and its center snaps to a coarse light space grid.  Only a
+ *  cascade whose snapped center or size changed is drawn again.
+ ***********************************************************/
+void ShadowManager::UpdateCascades(SceneManager* pSceneManager, const FRAME_DATA& frameData, bool bDynamic)
+{
+	LightManager* pLightManager = pSceneManager->GetLightManager();
+	const SHADOW_CASTER& caster = pLightManager->GetDirectionalShadow();
+	const LIGHT_DATA& light = pLightManager->GetLight(caster.lightIndex);
+
+	if ((memcmp(&m_cachedDirectional, &caster, sizeof(SHADOW_CASTER)) != 0) ||
+		(memcmp(&m_cachedDirectionalLight, &light, sizeof(LIGHT_DATA)) != 0))
+	{
+		m_cachedDirectional = caster;
+		m_cachedDirectionalLight = light;
+		for (int i = 0; i < CASCADE_COUNT; i++)
+		{
+			m_bCascadeValid[i] = false;
+		}
+	}
+
+	// light space looking along the light, centered on the origin
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), caster.aim, ChooseUpVector(caster.aim));
+
+	// view space rays through the four corners of the view
+	glm::mat4 inverseProjection = glm::inverse(frameData.projection);
+	glm::mat4 inverseView = glm::inverse(frameData.view);
+	glm::vec3 nearCorners[4];
+	glm::vec3 farCorners[4];
+	for (int corner = 0; corner < 4; corner++)
+	{
+		float x = (corner & 1) ? 1.0f : -1.0f;
+		float y = (corner & 2) ? 1.0f : -1.0f;
+		glm::vec4 nearPoint = inverseProjection * glm::vec4(x, y, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverseProjection * glm::vec4(x, y, 1.0f, 1.0f);
+		nearCorners[corner] = glm::vec3(nearPoint) / nearPoint.w;
+		farCorners[corner] = glm::vec3(farPoint) / farPoint.w;
+	}
+
+	float nearPlane = frameData.viewport.z;
+	float farPlane = std::fmin(frameData.viewport.w, SHADOW_DISTANCE);
+
+	for (int cascade = 0; cascade < CASCADE_COUNT; cascade++)
+	{
+		// blend of uniform and logarithmic split depths
+		float splitFraction = (float)(cascade + 1) / (float)CASCADE_COUNT;
+		float uniformSplit = nearPlane + (farPlane - nearPlane) * splitFraction;
+		float logSplit = nearPlane * std::pow(farPlane / nearPlane, splitFraction);
+		float sliceFar = uniformSplit + (logSplit - uniformSplit) * CASCADE_SPLIT_BLEND;
+		float sliceNear = (cascade == 0) ? nearPlane : m_shadowData.cascadeSplits[cascade - 1];
+		m_shadowData.cascadeSplits[cascade] = sliceFar;
+
+		// world space corners of the frustum slice
+		glm::vec3 sliceCorners[8];
+		glm::vec3 center(0.0f);
+		for (int corner = 0; corner < 4; corner++)
+		{
+			float rayNear = -nearCorners[corner].z;
+			float rayFar = -farCorners[corner].z;
+			for (int end = 0; end < 2; end++)
+			{
+				float depth = (end == 0) ? sliceNear : sliceFar;
+				float t = (depth - rayNear) / (rayFar - rayNear);
+				glm::vec3 viewPoint = nearCorners[corner] + (farCorners[corner] - nearCorners[corner]) * t;
+				sliceCorners[corner * 2 + end] = glm::vec3(inverseView * glm::vec4(viewPoint, 1.0f));
+				center = center + sliceCorners[corner * 2 + end];
+			}
+		}
+		center = center / 8.0f;
+
+		float radius = 0.0f;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			radius = std::fmax(radius, glm::length(sliceCorners[corner] - center));
+		}
+		// keep float noise from resizing the cascade
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		// the snap step is a whole number of texels, and the cascade
+		// is widened by it so the snapped square still holds the slice
+		float extent = radius * (1.0f + 2.0f * CASCADE_SNAP_FRACTION);
+		float texelSize = (2.0f * extent) / (float)CASCADE_MAP_SIZE;
+		float snapStep = texelSize * std::ceil((2.0f * radius * CASCADE_SNAP_FRACTION) / texelSize);
+
+		glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+		glm::vec3 snappedCenter(
+			std::floor(lightCenter.x / snapStep + 0.5f) * snapStep,
+			std::floor(lightCenter.y / snapStep + 0.5f) * snapStep,
+			std::floor(lightCenter.z / snapStep + 0.5f) * snapStep);
+
+		if (!m_bCascadeValid[cascade] ||
+			(memcmp(&m_cascadeCenter[cascade], &snappedCenter, sizeof(glm::vec3)) != 0) ||
+			(m_cascadeExtent[cascade] != extent))
+		{
+			glm::mat4 lightProjection = glm::ortho(
+				snappedCenter.x - extent, snappedCenter.x + extent,
+				snappedCenter.y - extent, snappedCenter.y + extent,
+				-snappedCenter.z - extent - CASTER_DEPTH, -snappedCenter.z + extent);
+			m_shadowData.cascadeViewProjection[cascade] = lightProjection * lightView;
+
+			RenderMap(pSceneManager, m_staticCascades, cascade, CASCADE_MAP_SIZE,
+				m_shadowData.cascadeViewProjection[cascade], SceneManager::DRAW_STATIC, true);
+
+			m_cascadeCenter[cascade] = snappedCenter;
+			m_cascadeExtent[cascade] = extent;
+			m_bCascadeValid[cascade] = true;
+		}
+	}
+
+	if (bDynamic)
+	{
+		// the moving draws go on top of a copy of the static maps
+		glCopyImageSubData(
+			m_staticCascades, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+			m_cascades, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+			CASCADE_MAP_SIZE, CASCADE_MAP_SIZE, CASCADE_COUNT);
+		for (int cascade = 0; cascade < CASCADE_COUNT; cascade++)
+		{
+			RenderMap(pSceneManager, m_cascades, cascade, CASCADE_MAP_SIZE,
+				m_shadowData.cascadeViewProjection[cascade], SceneManager::DRAW_DYNAMIC, false);
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateSpot()
+ *
+ *  This method is used to draw the spot light map again when
+ *  the light or its aim changed.
+ ***********************************************************/
+void ShadowManager::UpdateSpot(SceneManager* pSceneManager, bool bDynamic)
+{
+	LightManager* pLightManager = pSceneManager->GetLightManager();
+	const SHADOW_CASTER& caster = pLightManager->GetSpotShadow();
+	const LIGHT_DATA& light = pLightManager->GetLight(caster.lightIndex);
+
+	if ((memcmp(&m_cachedSpot, &caster, sizeof(SHADOW_CASTER)) != 0) ||
+		(memcmp(&m_cachedSpotLight, &light, sizeof(LIGHT_DATA)) != 0))
+	{
+		m_cachedSpot = caster;
+		m_cachedSpotLight = light;
+		m_bSpotValid = false;
+	}
+
+	if (!m_bSpotValid)
+	{
+		glm::vec3 lightPosition = glm::vec3(light.position);
+		glm::vec3 direction = caster.aim - lightPosition;
+		glm::mat4 lightView = glm::lookAt(lightPosition, caster.aim, ChooseUpVector(direction));
+		glm::mat4 lightProjection = glm::perspective(glm::radians(caster.fieldOfView), 1.0f,
+			SPOT_NEAR_PLANE, glm::length(direction) + SPOT_RANGE);
+		m_shadowData.spotViewProjection = lightProjection * lightView;
+
+		RenderMap(pSceneManager, m_staticSpot, -1, SPOT_MAP_SIZE,
+			m_shadowData.spotViewProjection, SceneManager::DRAW_STATIC, true);
+		m_bSpotValid = true;
+	}
+
+	if (bDynamic)
+	{
+		glCopyImageSubData(
+			m_staticSpot, GL_TEXTURE_2D, 0, 0, 0, 0,
+			m_spot, GL_TEXTURE_2D, 0, 0, 0, 0,
+			SPOT_MAP_SIZE, SPOT_MAP_SIZE, 1);
+		RenderMap(pSceneManager, m_spot, -1, SPOT_MAP_SIZE,
+			m_shadowData.spotViewProjection, SceneManager::DRAW_DYNAMIC, false);
+	}
+}
+
+/***********************************************************
+ *  RenderMap()
+ *
+ *  This method is used to draw the filtered scene draws into a
+ *  shadow map, or into one layer of the cascade array.
+ ***********************************************************/
+void ShadowManager::RenderMap(SceneManager* pSceneManager, GLuint texture, int layer, int size,
+	const glm::mat4& viewProjection, SceneManager::DRAW_FILTER filter, bool bClear)
+{
+	if (layer >= 0)
+	{
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+	}
+	else
+	{
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);
+	}
+	glViewport(0, 0, size, size);
+
+	if (bClear)
+	{
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	glUniformMatrix4fv(m_lightViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+	// the camera's meshlet culling does not hold for the light
+	pSceneManager->RenderScene(filter, false);
+	m_lastRenderedMaps++;
+}
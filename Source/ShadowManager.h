@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmanager.h
+// ============
+// render and cache the shadow maps of the shadow casting lights
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "FrameRingBuffer.h"
+#include "SceneManager.h"
+#include "ShaderInterface.h"
+
+/***********************************************************
+ *  ShadowManager
+ *
+ *  The directional light gets cascaded shadow maps that follow
+ *  the camera, the spot light gets one perspective shadow map.
+ *  The static draws are rendered into cached maps which are
+ *  only drawn again when the light, the static geometry or the
+ *  snapped position of a cascade changes.  Dynamic draws are
+ *  added on top of a copy of the cached maps every frame.
+ ***********************************************************/
+class ShadowManager
+{
+public:
+	// constructor
+	ShadowManager(FrameRingBuffer* pFrameRingBuffer);
+	// destructor
+	~ShadowManager();
+
+	// load the depth program and create the cached shadow maps
+	bool CreateShadowMaps();
+	// free the shadow maps
+	void DestroyShadowMaps();
+
+	// draw the out of date shadow maps, then write and bind the
+	// shadow data for the shaders, leaves the shadow framebuffer bound
+	void UpdateShadows(SceneManager* pSceneManager, const FRAME_DATA& frameData);
+
+	// leave the shadow maps out of the lighting while disabled, the
+	// software path has none, so comparisons with it turn them off
+	void SetEnabled(bool bEnabled) { m_bEnabled = bEnabled; }
+	bool GetEnabled() const { return(m_bEnabled); }
+
+	// shadow maps drawn by the last update, cached maps are not counted
+	int GetLastRenderedMaps() const { return(m_lastRenderedMaps); }
+
+	// number of directional shadow cascades
+	static const int CASCADE_COUNT = 3;
+
+private:
+	// pointer to the per-frame dynamic data buffer
+	FrameRingBuffer* m_pFrameRingBuffer;
+	// depth only program for the shadow passes
+	ShaderManager* m_pShadowShader;
+	// location of the light matrix in the shadow program
+	GLint m_lightViewProjectionLocation;
+	// framebuffer the shadow maps are attached to in turn
+	GLuint m_framebufferID;
+	// cascades and spot map holding the static draws only
+	GLuint m_staticCascades;
+	GLuint m_staticSpot;
+	// copies of the static maps with the dynamic draws added,
+	// created the first time a dynamic draw is recorded
+	GLuint m_cascades;
+	GLuint m_spot;
+
+	// static geometry the cached maps were drawn for
+	unsigned int m_staticVersion;
+	// lights the cached maps were drawn for
+	SHADOW_CASTER m_cachedDirectional;
+	SHADOW_CASTER m_cachedSpot;
+	LIGHT_DATA m_cachedDirectionalLight;
+	LIGHT_DATA m_cachedSpotLight;
+	// snapped light space center and half width of each cascade
+	glm::vec3 m_cascadeCenter[CASCADE_COUNT];
+	float m_cascadeExtent[CASCADE_COUNT];
+	// set while a cached map matches the scene
+	bool m_bCascadeValid[CASCADE_COUNT];
+	bool m_bSpotValid;
+
+	// set while the shaders use the shadow maps
+	bool m_bEnabled;
+	// shadow values handed to the shaders
+	SHADOW_DATA m_shadowData;
+	// maps drawn by the last update
+	int m_lastRenderedMaps;
+
+	// bring the cascades of the directional light up to date
+	void UpdateCascades(SceneManager* pSceneManager, const FRAME_DATA& frameData, bool bDynamic);
+	// bring the spot light map up to date
+	void UpdateSpot(SceneManager* pSceneManager, bool bDynamic);
+	// draw the scene into one shadow map or cascade layer
+	void RenderMap(SceneManager* pSceneManager, GLuint texture, int layer, int size,
+		const glm::mat4& viewProjection, SceneManager::DRAW_FILTER filter, bool bClear);
+};
@@ -0,0 +1,799 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.cpp
+// ============
+// render the recorded draws of the scene on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+#include "SceneManager.h"
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_RASTER_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// pixels along each side of a tile
+	const int TILE_SIZE = 64;
+	// fractional bits of the fixed point screen positions
+	const int SUBPIXEL_BITS = 4;
+	const int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+	// triangles are only clipped to the sides once they reach this
+	// far past the viewport in NDC, which keeps the fixed point
+	// positions inside 16 bits of whole pixels
+	const float GUARD_BAND = 2.0f;
+	// largest color buffer side the fixed point setup allows
+	const int MAX_BUFFER_SIZE = 4096;
+	// edge values at a tile corner are clamped to this, a tile is
+	// too small for a clamped value to change its sign
+	const long long EDGE_CLAMP = 1LL << 30;
+	// triangles set up by one task
+	const int TRIANGLES_PER_CHUNK = 1024;
+	// planes a triangle is clipped against, each keeps dot >= 0
+	const int CLIP_PLANE_COUNT = 6;
+	// most vertices a triangle can have after clipping
+	const int MAX_CLIP_VERTICES = 3 + CLIP_PLANE_COUNT;
+	// the frame is cleared to opaque black like the GL paths
+	const unsigned int CLEAR_COLOR = 0xFF000000;
+
+	/***********************************************************
+	 *  ClipDistance()
+	 *
+	 *  Distance of a clip space position inside one of the near,
+	 *  far and guard band side planes.
+	 ***********************************************************/
+	float ClipDistance(const glm::vec4& clip, int plane)
+	{
+		switch (plane)
+		{
+		case 0: return(clip.w + clip.z);
+		case 1: return(clip.w - clip.z);
+		case 2: return((GUARD_BAND * clip.w) + clip.x);
+		case 3: return((GUARD_BAND * clip.w) - clip.x);
+		case 4: return((GUARD_BAND * clip.w) + clip.y);
+		default: return((GUARD_BAND * clip.w) - clip.y);
+		}
+	}
+
+	/***********************************************************
+	 *  MakePlane()
+	 *
+	 *  Solve value, x slope and y slope of a value given at the
+	 *  three corners of a triangle, relative to the first corner.
+	 ***********************************************************/
+	glm::vec3 MakePlane(float v0, float v1, float v2, float dx1, float dy1, float dx2, float dy2, float inverseArea)
+	{
+		float slopeX = (((v1 - v0) * dy2) - ((v2 - v0) * dy1)) * inverseArea;
+		float slopeY = (((v2 - v0) * dx1) - ((v1 - v0) * dx2)) * inverseArea;
+		return(glm::vec3(v0, slopeX, slopeY));
+	}
+}
+
+/***********************************************************
+ *  SoftwareRasterizer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRasterizer::SoftwareRasterizer()
+{
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_chunkCount = 0;
+	m_presentTexture = 0;
+	m_presentFramebuffer = 0;
+	m_presentWidth = 0;
+	m_presentHeight = 0;
+	m_lastFrameTime = 0.0;
+	m_lastTriangleCount = 0;
+	m_viewProjection = glm::mat4(1.0f);
+}
+
+/***********************************************************
+ *  ~SoftwareRasterizer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	ReleaseResources();
+}
+
+/***********************************************************
+ *  ReleaseResources()
+ *
+ *  This method is used to drop the copied meshes and
+ *  textures and free the buffers and the GL objects used to
+ *  show the frame.
+ ***********************************************************/
+void SoftwareRasterizer::ReleaseResources()
+{
+	m_scene.ReleaseResources();
+	m_colorBuffer.clear();
+	m_depthBuffer.clear();
+	m_width = 0;
+	m_height = 0;
+
+	if (0 != m_presentFramebuffer)
+	{
+		glDeleteFramebuffers(1, &m_presentFramebuffer);
+		m_presentFramebuffer = 0;
+	}
+	if (0 != m_presentTexture)
+	{
+		UntrackResource(RESOURCE_TEXTURE, m_presentTexture);
+		glDeleteTextures(1, &m_presentTexture);
+		m_presentTexture = 0;
+	}
+	m_presentWidth = 0;
+	m_presentHeight = 0;
+}
+
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This method is used to render the draws the scene recorded
+ *  for the frame.  Resource copies and the shading state are
+ *  gathered on the calling thread, which owns the GL context,
+ *  then the vertex stage, the triangle setup and the tiles
+ *  are spread over the scene's thread pool.
+ ***********************************************************/
+void SoftwareRasterizer::RenderFrame(SceneManager* pSceneManager, const FRAME_DATA& frameData)
+{
+	if (NULL == pSceneManager)
+	{
+		return;
+	}
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	ResizeBuffers((int)frameData.viewport.x, (int)frameData.viewport.y);
+	if ((0 == m_width) || (0 == m_height))
+	{
+		return;
+	}
+
+	// the draw stream, with the meshes it needs copied on first use
+	int drawCount = pSceneManager->GetDrawCommandCount();
+	const SceneManager::DRAW_COMMAND* pDrawCommands = pSceneManager->GetDrawCommands();
+	m_drawData.resize(drawCount);
+	m_drawMeshes.resize(drawCount);
+	m_drawFirstVertex.resize(drawCount);
+	int vertexCount = 0;
+	for (int draw = 0; draw < drawCount; draw++)
+	{
+		m_drawData[draw] = &pDrawCommands[draw].drawData;
+		m_drawMeshes[draw] = m_scene.FindMesh(pSceneManager, pSceneManager->GetMeshID(pDrawCommands[draw].mesh));
+		m_drawFirstVertex[draw] = vertexCount;
+		if (NULL != m_drawMeshes[draw])
+		{
+			vertexCount += (int)m_drawMeshes[draw]->vertices.size();
+		}
+	}
+	m_clipVertices.resize(vertexCount);
+
+	// the values the fragment shader reads from its blocks
+	m_viewProjection = frameData.projection * frameData.view;
+	m_scene.GatherShading(pSceneManager, frameData);
+
+	ThreadPool* pThreadPool = pSceneManager->GetThreadPool();
+	pThreadPool->ParallelFor(drawCount, [this](int draw)
+	{
+		TransformDraw(draw);
+	});
+
+	// split the draws into chunks in draw order, so the bins keep
+	// the order the triangles were submitted in
+	m_chunkCount = 0;
+	for (int draw = 0; draw < drawCount; draw++)
+	{
+		if (NULL == m_drawMeshes[draw])
+		{
+			continue;
+		}
+		int triangleCount = (int)m_drawMeshes[draw]->indices.size() / 3;
+		for (int first = 0; first < triangleCount; first += TRIANGLES_PER_CHUNK)
+		{
+			if ((int)m_chunks.size() <= m_chunkCount)
+			{
+				m_chunks.push_back(SETUP_CHUNK());
+			}
+			SETUP_CHUNK& chunk = m_chunks[m_chunkCount];
+			chunk.draw = draw;
+			chunk.firstTriangle = first;
+			chunk.triangleCount = std::min(TRIANGLES_PER_CHUNK, triangleCount - first);
+			m_chunkCount++;
+		}
+	}
+	pThreadPool->ParallelFor(m_chunkCount, [this](int chunk)
+	{
+		SetupChunk(&m_chunks[chunk]);
+	});
+
+	GatherBins();
+
+	pThreadPool->ParallelFor(m_tilesX * m_tilesY, [this](int tile)
+	{
+		RasterizeTile(tile);
+	});
+
+	m_lastTriangleCount = 0;
+	for (int chunk = 0; chunk < m_chunkCount; chunk++)
+	{
+		m_lastTriangleCount += (int)m_chunks[chunk].triangles.size();
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	m_lastFrameTime = elapsed.count();
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  This method is used to copy the color buffer into the
+ *  passed in framebuffer through a texture and a blit, and
+ *  leaves that framebuffer bound.
+ ***********************************************************/
+void SoftwareRasterizer::Present(GLuint outputFramebuffer)
+{
+	if ((0 == m_width) || (0 == m_height))
+	{
+		return;
+	}
+
+	if ((m_presentWidth != m_width) || (m_presentHeight != m_height))
+	{
+		if (0 != m_presentTexture)
+		{
+			UntrackResource(RESOURCE_TEXTURE, m_presentTexture);
+			glDeleteTextures(1, &m_presentTexture);
+		}
+		glGenTextures(1, &m_presentTexture);
+		glBindTexture(GL_TEXTURE_2D, m_presentTexture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, m_width, m_height);
+		TrackTexture(m_presentTexture, GL_RGBA8, m_width, m_height, 1, 1, "SoftwareRasterizer");
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		if (0 == m_presentFramebuffer)
+		{
+			glGenFramebuffers(1, &m_presentFramebuffer);
+		}
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebuffer);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_presentTexture, 0);
+		m_presentWidth = m_width;
+		m_presentHeight = m_height;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_presentTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, m_colorBuffer.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+	glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+}
+
+/***********************************************************
+ *  ResizeBuffers()
+ *
+ *  This method is used to size the color and depth buffers
+ *  and the tile grid for the viewport.
+ ***********************************************************/
+void SoftwareRasterizer::ResizeBuffers(int width, int height)
+{
+	width = std::min(std::max(width, 0), MAX_BUFFER_SIZE);
+	height = std::min(std::max(height, 0), MAX_BUFFER_SIZE);
+	if ((width == m_width) && (height == m_height))
+	{
+		return;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_colorBuffer.assign((size_t)width * height, CLEAR_COLOR);
+	m_depthBuffer.assign((size_t)width * height, 1.0f);
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+/***********************************************************
+ *  TransformDraw()
+ *
+ *  This method runs the vertex shader over the vertices of
+ *  one draw.
+ ***********************************************************/
+void SoftwareRasterizer::TransformDraw(int draw)
+{
+	const CPU_MESH* pMesh = m_drawMeshes[draw];
+	if (NULL == pMesh)
+	{
+		return;
+	}
+
+	const DRAW_DATA& drawData = *m_drawData[draw];
+	glm::mat3 normalMatrix = glm::mat3(glm::vec3(drawData.normalMatrix[0]), glm::vec3(drawData.normalMatrix[1]),
+		glm::vec3(drawData.normalMatrix[2]));
+	CLIP_VERTEX* pOutput = &m_clipVertices[m_drawFirstVertex[draw]];
+	for (size_t i = 0; i < pMesh->vertices.size(); i++)
+	{
+		const CPU_VERTEX& vertex = pMesh->vertices[i];
+		glm::vec4 world = drawData.model * glm::vec4(vertex.position, 1.0f);
+		pOutput[i].world = glm::vec3(world);
+		pOutput[i].clip = m_viewProjection * world;
+		pOutput[i].normal = normalMatrix * vertex.normal;
+		pOutput[i].uv = vertex.uv;
+	}
+}
+
+/***********************************************************
+ *  SetupChunk()
+ *
+ *  This method is used to clip the triangles of a chunk to
+ *  the near and far planes and the guard band, set them up
+ *  and record every tile each one touches.
+ ***********************************************************/
+void SoftwareRasterizer::SetupChunk(SETUP_CHUNK* pChunk)
+{
+	pChunk->triangles.clear();
+	pChunk->binTiles.clear();
+	pChunk->binTriangles.clear();
+
+	const CPU_MESH& mesh = *m_drawMeshes[pChunk->draw];
+	const CLIP_VERTEX* pVertices = &m_clipVertices[m_drawFirstVertex[pChunk->draw]];
+
+	for (int triangle = pChunk->firstTriangle; triangle < pChunk->firstTriangle + pChunk->triangleCount; triangle++)
+	{
+		CLIP_VERTEX polygon[2][MAX_CLIP_VERTICES];
+		int polygonCount = 3;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			polygon[0][corner] = pVertices[mesh.indices[(triangle * 3) + corner]];
+		}
+
+		// only triangles crossing a plane are clipped, the ones
+		// fully outside any plane are dropped
+		int outsideAll = 0x3F;
+		int outsideAny = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			int outside = 0;
+			for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+			{
+				if (ClipDistance(polygon[0][corner].clip, plane) < 0.0f)
+				{
+					outside |= 1 << plane;
+				}
+			}
+			outsideAll &= outside;
+			outsideAny |= outside;
+		}
+		if (0 != outsideAll)
+		{
+			continue;
+		}
+
+		int current = 0;
+		for (int plane = 0; (plane < CLIP_PLANE_COUNT) && (0 != outsideAny) && (polygonCount >= 3); plane++)
+		{
+			if (0 == (outsideAny & (1 << plane)))
+			{
+				continue;
+			}
+
+			const CLIP_VERTEX* pInput = polygon[current];
+			CLIP_VERTEX* pClipped = polygon[1 - current];
+			int clippedCount = 0;
+			for (int i = 0; i < polygonCount; i++)
+			{
+				const CLIP_VERTEX& a = pInput[i];
+				const CLIP_VERTEX& b = pInput[(i + 1) % polygonCount];
+				float distanceA = ClipDistance(a.clip, plane);
+				float distanceB = ClipDistance(b.clip, plane);
+				if (distanceA >= 0.0f)
+				{
+					pClipped[clippedCount++] = a;
+				}
+				if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+				{
+					float t = distanceA / (distanceA - distanceB);
+					CLIP_VERTEX& v = pClipped[clippedCount++];
+					v.clip = glm::mix(a.clip, b.clip, t);
+					v.world = glm::mix(a.world, b.world, t);
+					v.normal = glm::mix(a.normal, b.normal, t);
+					v.uv = glm::mix(a.uv, b.uv, t);
+				}
+			}
+			polygonCount = clippedCount;
+			current = 1 - current;
+		}
+
+		// the clipped polygon is convex, so it is drawn as a fan
+		for (int i = 1; i + 1 < polygonCount; i++)
+		{
+			SETUP_TRIANGLE setup;
+			if (!SetupTriangle(pChunk->draw, polygon[current][0], polygon[current][i], polygon[current][i + 1], &setup))
+			{
+				continue;
+			}
+
+			int triangleIndex = (int)pChunk->triangles.size();
+			pChunk->triangles.push_back(setup);
+			for (int tileY = setup.minY / TILE_SIZE; tileY <= setup.maxY / TILE_SIZE; tileY++)
+			{
+				for (int tileX = setup.minX / TILE_SIZE; tileX <= setup.maxX / TILE_SIZE; tileX++)
+				{
+					pChunk->binTiles.push_back(tileX + (tileY * m_tilesX));
+					pChunk->binTriangles.push_back(triangleIndex);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  SetupTriangle()
+ *
+ *  This method is used to snap a triangle to the fixed point
+ *  grid, build its edge functions and its pixel bounds, and
+ *  turn the values it interpolates into screen space planes.
+ *  The scene is drawn two-sided, so back facing triangles are
+ *  turned around instead of being culled.
+ ***********************************************************/
+bool SoftwareRasterizer::SetupTriangle(int draw, const CLIP_VERTEX& v0, const CLIP_VERTEX& v1, const CLIP_VERTEX& v2,
+	SETUP_TRIANGLE* pTriangle) const
+{
+	const CLIP_VERTEX* pCorners[3] = { &v0, &v1, &v2 };
+	float inverseW[3];
+	float depth[3];
+	long long fixedX[3];
+	long long fixedY[3];
+	for (int corner = 0; corner < 3; corner++)
+	{
+		const glm::vec4& clip = pCorners[corner]->clip;
+		inverseW[corner] = 1.0f / clip.w;
+		float screenX = ((clip.x * inverseW[corner] * 0.5f) + 0.5f) * m_width;
+		float screenY = ((clip.y * inverseW[corner] * 0.5f) + 0.5f) * m_height;
+		depth[corner] = (clip.z * inverseW[corner] * 0.5f) + 0.5f;
+		fixedX[corner] = (long long)llroundf(screenX * SUBPIXEL_SCALE);
+		fixedY[corner] = (long long)llroundf(screenY * SUBPIXEL_SCALE);
+	}
+
+	long long area = ((fixedX[1] - fixedX[0]) * (fixedY[2] - fixedY[0])) - ((fixedY[1] - fixedY[0]) * (fixedX[2] - fixedX[0]));
+	if (0 == area)
+	{
+		return false;
+	}
+	if (area < 0)
+	{
+		std::swap(pCorners[1], pCorners[2]);
+		std::swap(inverseW[1], inverseW[2]);
+		std::swap(depth[1], depth[2]);
+		std::swap(fixedX[1], fixedX[2]);
+		std::swap(fixedY[1], fixedY[2]);
+	}
+
+	// pixel centers from the lowest to the highest corner, pixel x
+	// has its center at x * 16 + 8
+	long long minFixedX = std::min(std::min(fixedX[0], fixedX[1]), fixedX[2]);
+	long long maxFixedX = std::max(std::max(fixedX[0], fixedX[1]), fixedX[2]);
+	long long minFixedY = std::min(std::min(fixedY[0], fixedY[1]), fixedY[2]);
+	long long maxFixedY = std::max(std::max(fixedY[0], fixedY[1]), fixedY[2]);
+	pTriangle->minX = std::max((int)((minFixedX - (SUBPIXEL_SCALE / 2) + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS), 0);
+	pTriangle->minY = std::max((int)((minFixedY - (SUBPIXEL_SCALE / 2) + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS), 0);
+	pTriangle->maxX = std::min((int)((maxFixedX - (SUBPIXEL_SCALE / 2)) >> SUBPIXEL_BITS), m_width - 1);
+	pTriangle->maxY = std::min((int)((maxFixedY - (SUBPIXEL_SCALE / 2)) >> SUBPIXEL_BITS), m_height - 1);
+	if ((pTriangle->minX > pTriangle->maxX) || (pTriangle->minY > pTriangle->maxY))
+	{
+		return false;
+	}
+
+	// an edge is inside toward the third corner, pixels exactly on
+	// an edge belong to just one of the two triangles sharing it
+	for (int edge = 0; edge < 3; edge++)
+	{
+		int a = edge;
+		int b = (edge + 1) % 3;
+		long long edgeA = fixedY[a] - fixedY[b];
+		long long edgeB = fixedX[b] - fixedX[a];
+		bool bOwned = (edgeA > 0) || ((0 == edgeA) && (edgeB > 0));
+		pTriangle->edgeA[edge] = (int)edgeA;
+		pTriangle->edgeB[edge] = (int)edgeB;
+		pTriangle->edgeC[edge] = -((edgeA * fixedX[a]) + (edgeB * fixedY[a])) - (bOwned ? 0 : 1);
+	}
+
+	// the planes use the snapped positions, like the coverage
+	float x0 = (float)fixedX[0] / SUBPIXEL_SCALE;
+	float y0 = (float)fixedY[0] / SUBPIXEL_SCALE;
+	float dx1 = ((float)fixedX[1] / SUBPIXEL_SCALE) - x0;
+	float dy1 = ((float)fixedY[1] / SUBPIXEL_SCALE) - y0;
+	float dx2 = ((float)fixedX[2] / SUBPIXEL_SCALE) - x0;
+	float dy2 = ((float)fixedY[2] / SUBPIXEL_SCALE) - y0;
+	float inverseArea = 1.0f / ((dx1 * dy2) - (dx2 * dy1));
+
+	pTriangle->draw = draw;
+	pTriangle->originX = x0;
+	pTriangle->originY = y0;
+	pTriangle->depthPlane = MakePlane(depth[0], depth[1], depth[2], dx1, dy1, dx2, dy2, inverseArea);
+	pTriangle->inverseWPlane = MakePlane(inverseW[0], inverseW[1], inverseW[2], dx1, dy1, dx2, dy2, inverseArea);
+
+	float varyings[3][VARYING_COUNT];
+	for (int corner = 0; corner < 3; corner++)
+	{
+		const CLIP_VERTEX& vertex = *pCorners[corner];
+		float* pValues = varyings[corner];
+		pValues[VARYING_WORLD_X] = vertex.world.x;
+		pValues[VARYING_WORLD_Y] = vertex.world.y;
+		pValues[VARYING_WORLD_Z] = vertex.world.z;
+		pValues[VARYING_NORMAL_X] = vertex.normal.x;
+		pValues[VARYING_NORMAL_Y] = vertex.normal.y;
+		pValues[VARYING_NORMAL_Z] = vertex.normal.z;
+		pValues[VARYING_U] = vertex.uv.x;
+		pValues[VARYING_V] = vertex.uv.y;
+	}
+	for (int varying = 0; varying < VARYING_COUNT; varying++)
+	{
+		pTriangle->varyingPlanes[varying] = MakePlane(varyings[0][varying] * inverseW[0],
+			varyings[1][varying] * inverseW[1], varyings[2][varying] * inverseW[2], dx1, dy1, dx2, dy2, inverseArea);
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  GatherBins()
+ *
+ *  This method is used to sort the binned triangles of all
+ *  chunks by tile.  The chunks are walked in order, so every
+ *  tile sees its triangles in the order they were submitted.
+ ***********************************************************/
+void SoftwareRasterizer::GatherBins()
+{
+	int tileCount = m_tilesX * m_tilesY;
+	m_tileFirstBin.assign(tileCount + 1, 0);
+	for (int chunk = 0; chunk < m_chunkCount; chunk++)
+	{
+		const std::vector<int>& binTiles = m_chunks[chunk].binTiles;
+		for (size_t i = 0; i < binTiles.size(); i++)
+		{
+			m_tileFirstBin[binTiles[i] + 1]++;
+		}
+	}
+	for (int tile = 0; tile < tileCount; tile++)
+	{
+		m_tileFirstBin[tile + 1] += m_tileFirstBin[tile];
+	}
+
+	m_tileBins.resize(m_tileFirstBin[tileCount]);
+	m_tileCursor.assign(m_tileFirstBin.begin(), m_tileFirstBin.end() - 1);
+	for (int chunk = 0; chunk < m_chunkCount; chunk++)
+	{
+		const SETUP_CHUNK& setupChunk = m_chunks[chunk];
+		for (size_t i = 0; i < setupChunk.binTiles.size(); i++)
+		{
+			m_tileBins[m_tileCursor[setupChunk.binTiles[i]]++] = &setupChunk.triangles[setupChunk.binTriangles[i]];
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterizeTile()
+ *
+ *  This method is used to clear one tile and draw its
+ *  triangles.  The pixels are walked in 2x2 quads: coverage,
+ *  depth and the perspective divide of the varyings run on
+ *  all four pixels at once, and the quad gives the texture
+ *  coordinate slopes the mip level is picked from.  Depth is
+ *  tested with GL_LESS and the colors are blended with the
+ *  source alpha, like the GL paths.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTile(int tile)
+{
+	int tileX0 = (tile % m_tilesX) * TILE_SIZE;
+	int tileY0 = (tile / m_tilesX) * TILE_SIZE;
+	int tileX1 = std::min(tileX0 + TILE_SIZE, m_width);
+	int tileY1 = std::min(tileY0 + TILE_SIZE, m_height);
+
+	for (int y = tileY0; y < tileY1; y++)
+	{
+		std::fill(&m_colorBuffer[((size_t)y * m_width) + tileX0], &m_colorBuffer[((size_t)y * m_width) + tileX1], CLEAR_COLOR);
+		std::fill(&m_depthBuffer[((size_t)y * m_width) + tileX0], &m_depthBuffer[((size_t)y * m_width) + tileX1], 1.0f);
+	}
+
+	// pixel offsets of the quad lanes
+	const int laneX[4] = { 0, 1, 0, 1 };
+	const int laneY[4] = { 0, 0, 1, 1 };
+
+	for (int bin = m_tileFirstBin[tile]; bin < m_tileFirstBin[tile + 1]; bin++)
+	{
+		const SETUP_TRIANGLE& triangle = *m_tileBins[bin];
+		const DRAW_DATA& drawData = *m_drawData[triangle.draw];
+
+		// quads start on even pixels, the tiles do as well
+		int startX = std::max(triangle.minX, tileX0) & ~1;
+		int startY = std::max(triangle.minY, tileY0) & ~1;
+		int endX = std::min(triangle.maxX, tileX1 - 1);
+		int endY = std::min(triangle.maxY, tileY1 - 1);
+
+		// the mip level needs the texture size in texels
+		const CPU_TEXTURE* pTexture = NULL;
+		if ((0 != drawData.bUseTexture) && (drawData.textureSlot >= 0) && (drawData.textureSlot < CPU_TEXTURE_SLOTS))
+		{
+			pTexture = m_scene.GetShading().pSlotTextures[drawData.textureSlot];
+		}
+		bool bLod = (NULL != pTexture) && pTexture->bMipmapped;
+		glm::vec2 texelScale = bLod ? glm::vec2(pTexture->levelWidth[0] * drawData.UVscale.x,
+			pTexture->levelHeight[0] * drawData.UVscale.y) : glm::vec2(0.0f);
+
+		// edge values at the first quad, exact in 64 bits and then
+		// clamped so the steps across the tile fit in 32 bits
+		int rowEdge[3];
+		int laneEdge[3][4];
+		for (int edge = 0; edge < 3; edge++)
+		{
+			long long value = ((long long)triangle.edgeA[edge] * ((startX * SUBPIXEL_SCALE) + (SUBPIXEL_SCALE / 2))) +
+				((long long)triangle.edgeB[edge] * ((startY * SUBPIXEL_SCALE) + (SUBPIXEL_SCALE / 2))) + triangle.edgeC[edge];
+			rowEdge[edge] = (int)std::min(std::max(value, -EDGE_CLAMP), EDGE_CLAMP);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				laneEdge[edge][lane] = ((triangle.edgeA[edge] * laneX[lane]) + (triangle.edgeB[edge] * laneY[lane])) * SUBPIXEL_SCALE;
+			}
+		}
+
+		for (int quadY = startY; quadY <= endY; quadY += 2)
+		{
+			int quadEdge[3] = { rowEdge[0], rowEdge[1], rowEdge[2] };
+			for (int quadX = startX; quadX <= endX; quadX += 2)
+			{
+				// pixels of the quad inside all three edges
+				int coverage = 0;
+#ifdef SOFTWARE_RASTER_SSE
+				__m128i inside = _mm_setzero_si128();
+				for (int edge = 0; edge < 3; edge++)
+				{
+					__m128i values = _mm_add_epi32(_mm_set1_epi32(quadEdge[edge]),
+						_mm_loadu_si128((const __m128i*)laneEdge[edge]));
+					inside = _mm_or_si128(inside, values);
+				}
+				coverage = ~_mm_movemask_ps(_mm_castsi128_ps(inside)) & 0xF;
+#else
+				for (int lane = 0; lane < 4; lane++)
+				{
+					if ((quadEdge[0] + laneEdge[0][lane] >= 0) && (quadEdge[1] + laneEdge[1][lane] >= 0) &&
+						(quadEdge[2] + laneEdge[2][lane] >= 0))
+					{
+						coverage |= 1 << lane;
+					}
+				}
+#endif
+				for (int edge = 0; edge < 3; edge++)
+				{
+					quadEdge[edge] += triangle.edgeA[edge] * 2 * SUBPIXEL_SCALE;
+				}
+
+				// the lanes past the edge of the tile or the bounds
+				if (quadX + 1 >= tileX1)
+				{
+					coverage &= 0x5;
+				}
+				if (quadY + 1 >= tileY1)
+				{
+					coverage &= 0x3;
+				}
+				if (0 == coverage)
+				{
+					continue;
+				}
+
+				// depth and 1/w of the four pixel centers
+				float offsetX = (quadX + 0.5f) - triangle.originX;
+				float offsetY = (quadY + 0.5f) - triangle.originY;
+				float depth[4];
+				float w[4];
+				float* pDepth[4];
+#ifdef SOFTWARE_RASTER_SSE
+				__m128 pixelX = _mm_add_ps(_mm_set1_ps(offsetX), _mm_setr_ps(0.0f, 1.0f, 0.0f, 1.0f));
+				__m128 pixelY = _mm_add_ps(_mm_set1_ps(offsetY), _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f));
+				__m128 depthValues = _mm_add_ps(_mm_set1_ps(triangle.depthPlane.x),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depthPlane.y), pixelX),
+						_mm_mul_ps(_mm_set1_ps(triangle.depthPlane.z), pixelY)));
+				__m128 inverseW = _mm_add_ps(_mm_set1_ps(triangle.inverseWPlane.x),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.inverseWPlane.y), pixelX),
+						_mm_mul_ps(_mm_set1_ps(triangle.inverseWPlane.z), pixelY)));
+				_mm_storeu_ps(depth, depthValues);
+				_mm_storeu_ps(w, _mm_div_ps(_mm_set1_ps(1.0f), inverseW));
+#else
+				for (int lane = 0; lane < 4; lane++)
+				{
+					float x = offsetX + laneX[lane];
+					float y = offsetY + laneY[lane];
+					depth[lane] = triangle.depthPlane.x + (triangle.depthPlane.y * x) + (triangle.depthPlane.z * y);
+					w[lane] = 1.0f / (triangle.inverseWPlane.x + (triangle.inverseWPlane.y * x) + (triangle.inverseWPlane.z * y));
+				}
+#endif
+				for (int lane = 0; lane < 4; lane++)
+				{
+					pDepth[lane] = NULL;
+					if (0 != (coverage & (1 << lane)))
+					{
+						pDepth[lane] = &m_depthBuffer[((size_t)(quadY + laneY[lane]) * m_width) + quadX + laneX[lane]];
+						if (!(depth[lane] < *pDepth[lane]))
+						{
+							coverage &= ~(1 << lane);
+						}
+					}
+				}
+				if (0 == coverage)
+				{
+					continue;
+				}
+
+				// the varyings of all four pixels, the uncovered ones
+				// are still needed for the texture slopes
+				float varyings[4][VARYING_COUNT];
+				for (int varying = 0; varying < VARYING_COUNT; varying++)
+				{
+					const glm::vec3& plane = triangle.varyingPlanes[varying];
+#ifdef SOFTWARE_RASTER_SSE
+					float values[4];
+					_mm_storeu_ps(values, _mm_mul_ps(_mm_loadu_ps(w), _mm_add_ps(_mm_set1_ps(plane.x),
+						_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.y), pixelX), _mm_mul_ps(_mm_set1_ps(plane.z), pixelY)))));
+					for (int lane = 0; lane < 4; lane++)
+					{
+						varyings[lane][varying] = values[lane];
+					}
+#else
+					for (int lane = 0; lane < 4; lane++)
+					{
+						varyings[lane][varying] = w[lane] * (plane.x + (plane.y * (offsetX + laneX[lane])) +
+							(plane.z * (offsetY + laneY[lane])));
+					}
+#endif
+				}
+
+				float lod = 0.0f;
+				if (bLod)
+				{
+					glm::vec2 slopeX = glm::vec2(varyings[1][VARYING_U] - varyings[0][VARYING_U],
+						varyings[1][VARYING_V] - varyings[0][VARYING_V]) * texelScale;
+					glm::vec2 slopeY = glm::vec2(varyings[2][VARYING_U] - varyings[0][VARYING_U],
+						varyings[2][VARYING_V] - varyings[0][VARYING_V]) * texelScale;
+					float footprint = std::max(glm::dot(slopeX, slopeX), glm::dot(slopeY, slopeY));
+					lod = (footprint > 0.0f) ? 0.5f * log2f(footprint) : 0.0f;
+				}
+
+				for (int lane = 0; lane < 4; lane++)
+				{
+					if (0 == (coverage & (1 << lane)))
+					{
+						continue;
+					}
+
+					const float* pVaryings = varyings[lane];
+					glm::vec4 color = ShadeSurface(m_scene.GetShading(), drawData,
+						glm::vec3(pVaryings[VARYING_WORLD_X], pVaryings[VARYING_WORLD_Y], pVaryings[VARYING_WORLD_Z]),
+						glm::vec3(pVaryings[VARYING_NORMAL_X], pVaryings[VARYING_NORMAL_Y], pVaryings[VARYING_NORMAL_Z]),
+						glm::vec2(pVaryings[VARYING_U], pVaryings[VARYING_V]), lod, NULL);
+					unsigned int& pixel = m_colorBuffer[((size_t)(quadY + laneY[lane]) * m_width) + quadX + laneX[lane]];
+					glm::vec4 source = glm::clamp(color, 0.0f, 1.0f);
+					glm::vec4 destination = UnpackRGBA8(pixel);
+					pixel = PackRGBA8((source * source.w) + (destination * (1.0f - source.w)));
+					*pDepth[lane] = depth[lane];
+				}
+			}
+
+			for (int edge = 0; edge < 3; edge++)
+			{
+				rowEdge[edge] += triangle.edgeB[edge] * 2 * SUBPIXEL_SCALE;
+			}
+		}
+	}
+}
@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.h
+// ============
+// render the recorded draws of the scene on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CpuScene.h"
+#include "ShaderInterface.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class SceneManager;
+
+/***********************************************************
+ *  SoftwareRasterizer
+ *
+ *  Renders the draw stream SceneManager records for a frame
+ *  with the transform of vertexShader.glsl and the Phong and
+ *  texture model of fragmentShader.glsl.  The screen is split
+ *  into tiles; the triangles are transformed, clipped and
+ *  binned on all threads, then every thread rasterizes whole
+ *  tiles, four pixels of a 2x2 quad at a time with SSE.
+ *  Mesh and texture data is copied out of the GL objects the
+ *  first time a draw uses them and Present() goes through a
+ *  GL texture, so a GL context is required even though the
+ *  pixels are computed on the CPU; without a GPU it runs on
+ *  a software driver like Mesa llvmpipe.  Shadows are not
+ *  rendered.
+ ***********************************************************/
+class SoftwareRasterizer
+{
+public:
+	// constructor
+	SoftwareRasterizer();
+	// destructor
+	~SoftwareRasterizer();
+
+	// render the draws recorded for this frame into the color buffer
+	void RenderFrame(SceneManager* pSceneManager, const FRAME_DATA& frameData);
+	// copy the color buffer into the passed in framebuffer
+	void Present(GLuint outputFramebuffer);
+	// forget the copied meshes and textures and free the buffers
+	void ReleaseResources();
+
+	// size of the color buffer
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	// RGBA8 pixels with the bottom row first, as glReadPixels
+	// returns them
+	const unsigned int* GetColorBuffer() const { return(m_colorBuffer.data()); }
+	// CPU time of the last frame in milliseconds
+	double GetLastFrameTime() const { return(m_lastFrameTime); }
+	// triangles that reached the tiles in the last frame
+	int GetLastTriangleCount() const { return(m_lastTriangleCount); }
+
+private:
+	// a vertex after the vertex stage
+	struct CLIP_VERTEX
+	{
+		glm::vec4 clip;
+		glm::vec3 world;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// the values interpolated across a triangle, divided by w
+	enum VARYING
+	{
+		VARYING_WORLD_X,
+		VARYING_WORLD_Y,
+		VARYING_WORLD_Z,
+		VARYING_NORMAL_X,
+		VARYING_NORMAL_Y,
+		VARYING_NORMAL_Z,
+		VARYING_U,
+		VARYING_V,
+		VARYING_COUNT
+	};
+
+	// a triangle set up for the tiles
+	struct SETUP_TRIANGLE
+	{
+		// draw the triangle belongs to
+		int draw;
+		// edge functions in 28.4 fixed point, E = A*x + B*y + C
+		// with C including the fill rule bias
+		int edgeA[3];
+		int edgeB[3];
+		long long edgeC[3];
+		// pixel bounds
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		// screen position the planes below are relative to
+		float originX;
+		float originY;
+		// window depth, 1/w and the varyings over w as planes of
+		// value, x slope and y slope
+		glm::vec3 depthPlane;
+		glm::vec3 inverseWPlane;
+		glm::vec3 varyingPlanes[VARYING_COUNT];
+	};
+
+	// a run of triangles of one draw that one thread sets up
+	struct SETUP_CHUNK
+	{
+		int draw;
+		int firstTriangle;
+		int triangleCount;
+		std::vector<SETUP_TRIANGLE> triangles;
+		// tile of every binned triangle, with the triangle index
+		std::vector<int> binTiles;
+		std::vector<int> binTriangles;
+	};
+
+	// color and depth buffers
+	int m_width;
+	int m_height;
+	std::vector<unsigned int> m_colorBuffer;
+	std::vector<float> m_depthBuffer;
+	int m_tilesX;
+	int m_tilesY;
+
+	// copied meshes and textures and the shading of the frame
+	CpuScene m_scene;
+	glm::mat4 m_viewProjection;
+
+	// per frame work, kept between frames to reuse the memory
+	std::vector<CLIP_VERTEX> m_clipVertices;
+	std::vector<const DRAW_DATA*> m_drawData;
+	std::vector<const CPU_MESH*> m_drawMeshes;
+	std::vector<int> m_drawFirstVertex;
+	std::vector<SETUP_CHUNK> m_chunks;
+	int m_chunkCount;
+	std::vector<int> m_tileFirstBin;
+	std::vector<int> m_tileCursor;
+	std::vector<const SETUP_TRIANGLE*> m_tileBins;
+
+	// GL texture and framebuffer the color buffer is shown with
+	GLuint m_presentTexture;
+	GLuint m_presentFramebuffer;
+	int m_presentWidth;
+	int m_presentHeight;
+
+	// statistics of the last frame
+	double m_lastFrameTime;
+	int m_lastTriangleCount;
+
+	// size the buffers for the viewport
+	void ResizeBuffers(int width, int height);
+	// vertex stage of one draw
+	void TransformDraw(int draw);
+	// clip, set up and bin the triangles of one chunk
+	void SetupChunk(SETUP_CHUNK* pChunk);
+	// set up one clipped triangle, false when it covers no pixel
+	bool SetupTriangle(int draw, const CLIP_VERTEX& v0, const CLIP_VERTEX& v1, const CLIP_VERTEX& v2,
+		SETUP_TRIANGLE* pTriangle) const;
+	// sort the binned triangles by tile in submission order
+	void GatherBins();
+	// clear and rasterize one tile
+	void RasterizeTile(int tile);
+};
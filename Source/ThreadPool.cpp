@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.cpp
+// ============
+// persistent worker threads for splitting per-frame work across cores
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+/***********************************************************
+ *  ThreadPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ThreadPool::ThreadPool(int threadCount)
+{
+	m_pTask = NULL;
+	m_taskCount = 0;
+	m_nextTask = 0;
+	m_activeWorkers = 0;
+	m_batchNumber = 0;
+	m_bStopping = false;
+
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency();
+	}
+
+	// the calling thread is the first thread of every batch
+	for (int i = 1; i < threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  ~ThreadPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used to run a batch of tasks on all threads
+ *  of the pool and block until the batch is complete.
+ ***********************************************************/
+void ThreadPool::ParallelFor(int taskCount, const std::function<void(int)>& task)
+{
+	if (taskCount <= 0)
+	{
+		return;
+	}
+
+	// small batches are not worth waking the workers for
+	if ((taskCount == 1) || (m_workers.size() == 0))
+	{
+		for (int i = 0; i < taskCount; i++)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pTask = &task;
+		m_taskCount = taskCount;
+		m_nextTask = 0;
+		m_activeWorkers = (int)m_workers.size();
+		m_batchNumber++;
+	}
+	m_wakeCondition.notify_all();
+
+	RunTasks();
+
+	// wait for the workers to finish the tasks they picked up
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return(m_activeWorkers == 0); });
+	m_pTask = NULL;
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method runs on every worker thread, sleeping until a
+ *  batch is started and helping with it.
+ ***********************************************************/
+void ThreadPool::WorkerLoop()
+{
+	unsigned int lastBatch = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [this, lastBatch]() { return(m_bStopping || (m_batchNumber != lastBatch)); });
+			if (m_bStopping)
+			{
+				return;
+			}
+			lastBatch = m_batchNumber;
+		}
+
+		RunTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_activeWorkers--;
+		}
+		m_doneCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  RunTasks()
+ *
+ *  This method is used to claim and run tasks of the current
+ *  batch until every index has been handed out.
+ ***********************************************************/
+void ThreadPool::RunTasks()
+{
+	int taskIndex = m_nextTask.fetch_add(1);
+	while (taskIndex < m_taskCount)
+	{
+		(*m_pTask)(taskIndex);
+		taskIndex = m_nextTask.fetch_add(1);
+	}
+}
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ============
+// persistent worker threads for splitting per-frame work across cores
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  ThreadPool
+ *
+ *  The workers sleep until ParallelFor() hands them a batch
+ *  of tasks.  The calling thread works on the batch as well
+ *  and returns once every task has finished.
+ ***********************************************************/
+class ThreadPool
+{
+public:
+	// constructor, zero threads means one per hardware core
+	ThreadPool(int threadCount = 0);
+	// destructor
+	~ThreadPool();
+
+	// number of threads that take part in a batch, including the caller
+	int GetThreadCount() const { return((int)m_workers.size() + 1); }
+
+	// run task(index) for every index in [0, taskCount) and wait
+	void ParallelFor(int taskCount, const std::function<void(int)>& task);
+
+private:
+	// worker threads
+	std::vector<std::thread> m_workers;
+	// guards the batch state below
+	std::mutex m_mutex;
+	// signalled when a new batch is ready or the pool stops
+	std::condition_variable m_wakeCondition;
+	// signalled when the last worker leaves a batch
+	std::condition_variable m_doneCondition;
+	// task of the current batch
+	const std::function<void(int)>* m_pTask;
+	// number of tasks in the current batch
+	int m_taskCount;
+	// next task index to hand out
+	std::atomic<int> m_nextTask;
+	// workers still busy with the current batch
+	int m_activeWorkers;
+	// incremented for every batch so workers can spot new work
+	unsigned int m_batchNumber;
+	// set when the workers should exit
+	bool m_bStopping;
+
+	// worker thread entry point
+	void WorkerLoop();
+	// take tasks from the current batch until none are left
+	void RunTasks();
+};
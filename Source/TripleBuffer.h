@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// single producer / single consumer triple buffer used for handing state
+// snapshots from the update thread to the render thread without locking
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  The writer always owns one slot and the reader always owns
+ *  one slot, the third slot is exchanged between them.  The
+ *  writer never waits for the reader and the reader always
+ *  gets the most recently published value.
+ ***********************************************************/
+template <typename T>
+class TripleBuffer
+{
+public:
+	// constructor
+	TripleBuffer()
+	{
+		m_backIndex = 0;
+		m_middleIndex.store(1);
+		m_frontIndex = 2;
+	}
+
+	// publish a new value from the writer thread
+	void Write(const T& value)
+	{
+		m_slots[m_backIndex] = value;
+		// hand the filled slot over and take back the stale one
+		m_backIndex = m_middleIndex.exchange(m_backIndex | NEW_DATA_BIT) & INDEX_MASK;
+	}
+
+	// get the latest published value on the reader thread, the
+	// returned reference stays valid until the next call to Read()
+	const T& Read()
+	{
+		if (m_middleIndex.load() & NEW_DATA_BIT)
+		{
+			m_frontIndex = m_middleIndex.exchange(m_frontIndex) & INDEX_MASK;
+		}
+		return(m_slots[m_frontIndex]);
+	}
+
+private:
+	static const int INDEX_MASK = 3;
+	static const int NEW_DATA_BIT = 4;
+
+	// the three snapshot slots
+	T m_slots[3];
+	// slot owned by the writer
+	int m_backIndex;
+	// slot being exchanged, with the new data flag
+	std::atomic<int> m_middleIndex;
+	// slot owned by the reader
+	int m_frontIndex;
+};
@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////////////////////////////
+// uploadqueue.cpp
+// ============
+// create GL resources on a loader thread and hand them to the render thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UploadQueue.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  UploadQueue()
+ *
+ *  The constructor for the class.  The window hints set for
+ *  the main window are still in place, so the hidden window
+ *  gets a context of the same version and profile.
+ ***********************************************************/
+UploadQueue::UploadQueue(GLFWwindow* pMainWindow)
+{
+	m_pLoaderWindow = NULL;
+	m_bLoaderBusy = false;
+	m_bStopping = false;
+
+	if (NULL == pMainWindow)
+	{
+		return;
+	}
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_pLoaderWindow = glfwCreateWindow(1, 1, "", NULL, pMainWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (NULL == m_pLoaderWindow)
+	{
+		std::cout << "Could not create the loader context, resources are uploaded synchronously" << std::endl;
+		return;
+	}
+
+	m_loaderThread = std::thread(&UploadQueue::LoaderLoop, this);
+}
+
+/***********************************************************
+ *  ~UploadQueue()
+ *
+ *  The destructor for the class.  The loader thread finishes
+ *  the job it is working on, the resources of jobs that were
+ *  uploaded but never polled go with the context.
+ ***********************************************************/
+UploadQueue::~UploadQueue()
+{
+	if (NULL == m_pLoaderWindow)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+		m_waitingJobs.clear();
+	}
+	m_wakeCondition.notify_all();
+	m_loaderThread.join();
+
+	for (size_t i = 0; i < m_uploadedJobs.size(); i++)
+	{
+		glDeleteSync(m_uploadedJobs[i].fence);
+	}
+	m_uploadedJobs.clear();
+
+	glfwDestroyWindow(m_pLoaderWindow);
+	m_pLoaderWindow = NULL;
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used to queue a resource for the loader
+ *  thread.  Without a loader context the job is run and
+ *  finished right away on the calling thread.
+ ***********************************************************/
+void UploadQueue::Submit(const UPLOAD_WORK& work, const UPLOAD_DONE& done)
+{
+	if (NULL == m_pLoaderWindow)
+	{
+		bool bSucceeded = work();
+		done(bSucceeded);
+		return;
+	}
+
+	UPLOAD_JOB job;
+	job.work = work;
+	job.done = done;
+	job.fence = NULL;
+	job.bSucceeded = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_waitingJobs.push_back(job);
+	}
+	m_wakeCondition.notify_one();
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used to finish the uploaded jobs in the
+ *  order they were submitted.  The fences are only queried,
+ *  the first one that has not signalled ends the poll and
+ *  the rest is picked up in a later frame.
+ ***********************************************************/
+int UploadQueue::Poll()
+{
+	int finishedCount = 0;
+
+	while (true)
+	{
+		UPLOAD_JOB job;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_uploadedJobs.empty())
+			{
+				break;
+			}
+
+			GLenum status = glClientWaitSync(m_uploadedJobs.front().fence, 0, 0);
+			if ((GL_ALREADY_SIGNALED != status) && (GL_CONDITION_SATISFIED != status))
+			{
+				break;
+			}
+			job = m_uploadedJobs.front();
+			m_uploadedJobs.pop_front();
+		}
+
+		glDeleteSync(job.fence);
+		job.done(job.bSucceeded);
+		finishedCount++;
+	}
+
+	return(finishedCount);
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used to count the jobs that have been
+ *  submitted and not finished by Poll() yet.
+ ***********************************************************/
+int UploadQueue::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return((int)(m_waitingJobs.size() + m_uploadedJobs.size()) + (m_bLoaderBusy ? 1 : 0));
+}
+
+/***********************************************************
+ *  LoaderLoop()
+ *
+ *  This method runs on the loader thread, taking one job at a
+ *  time.  The fence is flushed to the GPU right away, so the
+ *  render thread can see it signal without a flush of its own.
+ ***********************************************************/
+void UploadQueue::LoaderLoop()
+{
+	glfwMakeContextCurrent(m_pLoaderWindow);
+
+	while (true)
+	{
+		UPLOAD_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [this]() { return(m_bStopping || !m_waitingJobs.empty()); });
+			if (m_bStopping)
+			{
+				break;
+			}
+			job = m_waitingJobs.front();
+			m_waitingJobs.pop_front();
+			m_bLoaderBusy = true;
+		}
+
+		job.bSucceeded = job.work();
+		job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_uploadedJobs.push_back(job);
+			m_bLoaderBusy = false;
+		}
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// uploadqueue.h
+// ============
+// create GL resources on a loader thread and hand them to the render thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// runs on the loader thread with the shared context current and
+// returns whether the resource could be created
+typedef std::function<bool()> UPLOAD_WORK;
+// runs on the render thread once the GPU has finished the work,
+// this is where the new resource is swapped into the scene
+typedef std::function<void(bool bSucceeded)> UPLOAD_DONE;
+
+/***********************************************************
+ *  UploadQueue
+ *
+ *  A hidden window shares the objects of the main window's
+ *  context with a loader thread.  File reads, decoding and
+ *  the GL uploads of a job all happen on that thread, which
+ *  fences the upload when it is done.  The render thread
+ *  calls Poll() once a frame and only finishes the jobs whose
+ *  fence has signalled, so it never waits on a load.  Vertex
+ *  arrays and framebuffers are not shared between contexts,
+ *  those have to be created by the done callback.
+ ***********************************************************/
+class UploadQueue
+{
+public:
+	// constructor, has to run on the thread that owns the window
+	UploadQueue(GLFWwindow* pMainWindow);
+	// destructor, jobs that have not finished are dropped
+	~UploadQueue();
+
+	// false when no shared context could be created, jobs are then
+	// run on the calling thread
+	bool IsAsync() const { return(NULL != m_pLoaderWindow); }
+
+	// queue a job, with a loader thread its done callback is only
+	// ever called from Poll()
+	void Submit(const UPLOAD_WORK& work, const UPLOAD_DONE& done);
+	// finish the jobs whose uploads the GPU has completed, returns
+	// how many were finished
+	int Poll();
+	// jobs submitted and not finished by Poll() yet
+	int GetPendingCount();
+
+private:
+	// one queued resource
+	struct UPLOAD_JOB
+	{
+		UPLOAD_WORK work;
+		UPLOAD_DONE done;
+		// signalled when the GPU has consumed the upload
+		GLsync fence;
+		bool bSucceeded;
+	};
+
+	// hidden window that owns the loader thread's context
+	GLFWwindow* m_pLoaderWindow;
+	std::thread m_loaderThread;
+	// guards the job lists below
+	std::mutex m_mutex;
+	// signalled when a job is queued or the loader should stop
+	std::condition_variable m_wakeCondition;
+	// jobs waiting for the loader thread
+	std::deque<UPLOAD_JOB> m_waitingJobs;
+	// jobs uploaded by the loader thread, waiting for their fence
+	std::deque<UPLOAD_JOB> m_uploadedJobs;
+	// job the loader thread is working on
+	bool m_bLoaderBusy;
+	// set when the loader thread should exit
+	bool m_bStopping;
+
+	// loader thread entry point
+	void LoaderLoop();
+};
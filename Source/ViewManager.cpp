@@ -8,40 +8,173 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "TripleBuffer.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <chrono>
+#include <mutex>
+
 // declaration of the global variables and defines
 namespace
 {
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
+
+	// length of one simulation step in seconds
+	const double UPDATE_TIMESTEP = 1.0 / 120.0;
+	// time a replayed frame advances the simulation by
+	const double REPLAY_FRAME_TIME = 1.0 / 60.0;
+	// longest stretch of simulation time caught up in one go
+	const double MAX_UPDATE_CATCHUP = 0.25;
 
 	// camera object used for viewing and interacting with
-	// the 3D scene
+	// the 3D scene, owned by the simulation thread once it runs
 	Camera* g_pCamera = nullptr;
 
+	// one published simulation step, holding the state before
+	// and after the step so the render thread can interpolate
+	struct CAMERA_SNAPSHOT
+	{
+		CAMERA_POSE previous;
+		CAMERA_POSE current;
+		double stepTime;
+	};
+
+	// snapshots travel from the simulation thread to the render thread
+	TripleBuffer<CAMERA_SNAPSHOT> g_cameraSnapshots;
+
+	// input gathered by the GLFW callbacks on the main thread and
+	// consumed by the simulation thread on every fixed step
+	struct INPUT_STATE
+	{
+		bool bForward;
+		bool bBackward;
+		bool bLeft;
+		bool bRight;
+		bool bUp;
+		bool bDown;
+		bool bOrthographicProjection;
+		float mouseOffsetX;
+		float mouseOffsetY;
+		// camera speed from scroll event.
+		float speed;
+	};
+	INPUT_STATE g_input = { false, false, false, false, false, false, false, 0.0f, 0.0f, 5.0f };
+	std::mutex g_inputMutex;
+
+	// shading path selected with the keyboard, only touched on the
+	// main thread by the key callback and the render loop
+	RENDER_PATH g_renderPath = RENDER_PATH_FORWARD;
+	bool g_bDepthPrepass = false;
+	bool g_bReverseDepth = false;
+	bool g_bDynamicResolution = false;
+
 	// these variables are used for mouse movement processing
 	float gLastX = WINDOW_WIDTH / 2.0f;
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// camera speed from scroll event.
-	float speed = 5.0;
+	/***********************************************************
+	 *  CaptureCameraState()
+	 *
+	 *  Copy the values the render thread needs out of the camera.
+	 ***********************************************************/
+	CAMERA_POSE CaptureCameraState(bool bOrthographic)
+	{
+		CAMERA_POSE state;
+		state.position = g_pCamera->Position;
+		state.front = g_pCamera->Front;
+		state.up = g_pCamera->Up;
+		state.zoom = g_pCamera->Zoom;
+		state.bOrthographic = bOrthographic;
+		return(state);
+	}
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	/***********************************************************
+	 *  RecordCamera()
+	 *
+	 *  Copy everything the movement of the camera depends on,
+	 *  for the start of a recording.
+	 ***********************************************************/
+	RECORDED_CAMERA RecordCamera(bool bOrthographic)
+	{
+		RECORDED_CAMERA camera;
+		camera.position = g_pCamera->Position;
+		camera.front = g_pCamera->Front;
+		camera.up = g_pCamera->Up;
+		camera.right = g_pCamera->Right;
+		camera.worldUp = g_pCamera->WorldUp;
+		camera.yaw = g_pCamera->Yaw;
+		camera.pitch = g_pCamera->Pitch;
+		camera.movementSpeed = g_pCamera->MovementSpeed;
+		camera.mouseSensitivity = g_pCamera->MouseSensitivity;
+		camera.zoom = g_pCamera->Zoom;
+		camera.bOrthographic = bOrthographic ? 1 : 0;
+		return(camera);
+	}
 
-	// the following variable is false when orthographic projection
-	// is off and true when it is on
-	bool bOrthographicProjection = false;
+	/***********************************************************
+	 *  RestoreCamera()
+	 *
+	 *  Put the camera back where a recording started.
+	 ***********************************************************/
+	void RestoreCamera(const RECORDED_CAMERA& camera)
+	{
+		g_pCamera->Position = camera.position;
+		g_pCamera->Front = camera.front;
+		g_pCamera->Up = camera.up;
+		g_pCamera->Right = camera.right;
+		g_pCamera->WorldUp = camera.worldUp;
+		g_pCamera->Yaw = camera.yaw;
+		g_pCamera->Pitch = camera.pitch;
+		g_pCamera->MovementSpeed = camera.movementSpeed;
+		g_pCamera->MouseSensitivity = camera.mouseSensitivity;
+		g_pCamera->Zoom = camera.zoom;
+	}
+
+	/***********************************************************
+	 *  RecordInput() / ReplayInput()
+	 *
+	 *  Convert the input of a step to and from the form it is
+	 *  recorded in.
+	 ***********************************************************/
+	RECORDED_INPUT RecordInput(const INPUT_STATE& input)
+	{
+		RECORDED_INPUT recorded;
+		recorded.buttons =
+			(input.bForward ? INPUT_BUTTON_FORWARD : 0) |
+			(input.bBackward ? INPUT_BUTTON_BACKWARD : 0) |
+			(input.bLeft ? INPUT_BUTTON_LEFT : 0) |
+			(input.bRight ? INPUT_BUTTON_RIGHT : 0) |
+			(input.bUp ? INPUT_BUTTON_UP : 0) |
+			(input.bDown ? INPUT_BUTTON_DOWN : 0) |
+			(input.bOrthographicProjection ? INPUT_BUTTON_ORTHOGRAPHIC : 0);
+		recorded.mouseOffsetX = input.mouseOffsetX;
+		recorded.mouseOffsetY = input.mouseOffsetY;
+		recorded.speed = input.speed;
+		return(recorded);
+	}
+
+	INPUT_STATE ReplayInput(const RECORDED_INPUT& recorded)
+	{
+		INPUT_STATE input;
+		input.bForward = (0 != (recorded.buttons & INPUT_BUTTON_FORWARD));
+		input.bBackward = (0 != (recorded.buttons & INPUT_BUTTON_BACKWARD));
+		input.bLeft = (0 != (recorded.buttons & INPUT_BUTTON_LEFT));
+		input.bRight = (0 != (recorded.buttons & INPUT_BUTTON_RIGHT));
+		input.bUp = (0 != (recorded.buttons & INPUT_BUTTON_UP));
+		input.bDown = (0 != (recorded.buttons & INPUT_BUTTON_DOWN));
+		input.bOrthographicProjection = (0 != (recorded.buttons & INPUT_BUTTON_ORTHOGRAPHIC));
+		input.mouseOffsetX = recorded.mouseOffsetX;
+		input.mouseOffsetY = recorded.mouseOffsetY;
+		input.speed = recorded.speed;
+		return(input);
+	}
 }
 
 /***********************************************************
@@ -50,17 +183,33 @@ namespace
  *  The constructor for the class
  ***********************************************************/
 ViewManager::ViewManager(
-	ShaderManager *pShaderManager)
+	ShaderManager *pShaderManager,
+	FrameRingBuffer* pFrameRingBuffer)
 {
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
+	m_pFrameRingBuffer = pFrameRingBuffer;
 	m_pWindow = NULL;
+	m_bUpdateRunning = false;
+	m_bFixedView = false;
+	m_viewWidth = 0;
+	m_viewHeight = 0;
+	m_bOrthographic = false;
+	m_replayFrame = 0;
+	m_replayStepTime = 0.0;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 2.0f, 12.0f);
 	g_pCamera->Front = glm::vec3(0.0f, 0.0f, -2.0f);
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
+
+	// publish the starting view so the first frame has a snapshot
+	CAMERA_SNAPSHOT snapshot;
+	snapshot.current = CaptureCameraState(false);
+	snapshot.previous = snapshot.current;
+	snapshot.stepTime = 0.0;
+	g_cameraSnapshots.Write(snapshot);
 }
 
 /***********************************************************
@@ -70,8 +219,13 @@ ViewManager::ViewManager(
  ***********************************************************/
 ViewManager::~ViewManager()
 {
+	// the simulation thread must be finished before the camera goes away
+	StopUpdateThread();
+	StopRecording();
+
 	// free up allocated memory
 	m_pShaderManager = NULL;
+	m_pFrameRingBuffer = NULL;
 	m_pWindow = NULL;
 	if (NULL != g_pCamera)
 	{
@@ -112,15 +266,182 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// Added new callback to capture mouse scroll events.
 	glfwSetScrollCallback(window, &ViewManager::scroll_callback);
 
+	// this callback is used to receive key press and release events
+	glfwSetKeyCallback(window, &ViewManager::Key_Callback);
+
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	m_pWindow = window;
 
+	// input is now flowing, so the simulation can start stepping
+	StartUpdateThread();
+
 	return(window);
 }
 
+/***********************************************************
+ *  GetWindowWidth() / GetWindowHeight()
+ *
+ *  These methods are used to get the size of the display
+ *  window the scene is rendered for.
+ ***********************************************************/
+int ViewManager::GetWindowWidth() const
+{
+	return(WINDOW_WIDTH);
+}
+
+int ViewManager::GetWindowHeight() const
+{
+	return(WINDOW_HEIGHT);
+}
+
+/***********************************************************
+ *  GetRenderPath()
+ *
+ *  This method is used to get the shading path selected with
+ *  the F (forward) and G (deferred) keys.
+ ***********************************************************/
+RENDER_PATH ViewManager::GetRenderPath() const
+{
+	return(g_renderPath);
+}
+
+/***********************************************************
+ *  GetDepthPrepass()
+ *
+ *  This method is used to get whether the depth pre-pass was
+ *  switched on, the Z key toggles it.
+ ***********************************************************/
+bool ViewManager::GetDepthPrepass() const
+{
+	return(g_bDepthPrepass);
+}
+
+/***********************************************************
+ *  SetReverseDepth() / GetReverseDepth()
+ *
+ *  These methods are used to pick reverse Z for the camera
+ *  passes, the R key toggles it.
+ ***********************************************************/
+void ViewManager::SetReverseDepth(bool bReverseDepth)
+{
+	g_bReverseDepth = bReverseDepth;
+}
+
+bool ViewManager::GetReverseDepth() const
+{
+	return(g_bReverseDepth);
+}
+
+/***********************************************************
+ *  SetDynamicResolution() / GetDynamicResolution()
+ *
+ *  These methods are used to let the GPU frame time pick the
+ *  resolution of the camera passes, the V key toggles it.
+ ***********************************************************/
+void ViewManager::SetDynamicResolution(bool bDynamicResolution)
+{
+	g_bDynamicResolution = bDynamicResolution;
+}
+
+bool ViewManager::GetDynamicResolution() const
+{
+	return(g_bDynamicResolution);
+}
+
+/***********************************************************
+ *  SetFixedView() / ClearFixedView()
+ *
+ *  These methods are used to view the scene from a pose that
+ *  was placed ahead of time instead of the simulated camera.
+ ***********************************************************/
+void ViewManager::SetFixedView(const CAMERA_POSE& pose)
+{
+	m_fixedView = pose;
+	m_bFixedView = true;
+}
+
+void ViewManager::ClearFixedView()
+{
+	m_bFixedView = false;
+}
+
+/***********************************************************
+ *  StartRecording() / StopRecording()
+ *
+ *  These methods are used to record the input the simulation
+ *  steps consume.  The simulation thread records, so the
+ *  recorder is only touched under the input lock.
+ ***********************************************************/
+bool ViewManager::StartRecording(const char* filename)
+{
+	std::lock_guard<std::mutex> lock(g_inputMutex);
+	return(m_inputRecorder.BeginRecording(filename, UPDATE_TIMESTEP));
+}
+
+void ViewManager::StopRecording()
+{
+	std::lock_guard<std::mutex> lock(g_inputMutex);
+	if (m_inputRecorder.IsRecording())
+	{
+		m_inputRecorder.EndRecording();
+	}
+}
+
+/***********************************************************
+ *  StartReplay()
+ *
+ *  This method is used to stop the simulation thread and put
+ *  the camera back where the recording started.  From here
+ *  on every PrepareSceneView() steps the simulation itself.
+ ***********************************************************/
+bool ViewManager::StartReplay(const char* filename)
+{
+	StopUpdateThread();
+
+	bool bLoaded = false;
+	{
+		std::lock_guard<std::mutex> lock(g_inputMutex);
+		bLoaded = m_inputRecorder.LoadReplay(filename, UPDATE_TIMESTEP);
+	}
+	if (!bLoaded)
+	{
+		if (NULL != m_pWindow)
+		{
+			StartUpdateThread();
+		}
+		return false;
+	}
+
+	const RECORDED_CAMERA& camera = m_inputRecorder.GetStartCamera();
+	RestoreCamera(camera);
+	m_bOrthographic = (0 != camera.bOrthographic);
+	m_replayFrame = 0;
+	m_replayStepTime = 0.0;
+
+	CAMERA_SNAPSHOT snapshot;
+	snapshot.current = CaptureCameraState(m_bOrthographic);
+	snapshot.previous = snapshot.current;
+	snapshot.stepTime = 0.0;
+	g_cameraSnapshots.Write(snapshot);
+
+	return true;
+}
+
+/***********************************************************
+ *  SetViewSize()
+ *
+ *  This method is used to size the view for a target that is
+ *  not the window, such as a capture at a fixed resolution.
+ ***********************************************************/
+void ViewManager::SetViewSize(int width, int height)
+{
+	m_viewWidth = width;
+	m_viewHeight = height;
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -150,8 +471,11 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	// queue the offsets for the simulation thread, which moves the
+	// 3D camera on its next fixed step
+	std::lock_guard<std::mutex> lock(g_inputMutex);
+	g_input.mouseOffsetX += xOffset;
+	g_input.mouseOffsetY += yOffset;
 }
 
 
@@ -166,78 +490,273 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 void ViewManager::scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
 	// Changed a global variable (but keep within limits .5 and 10. This speed is used in formula along with delta time to create appropriate speed.
-	speed -= (float)yoffset;
-	if (speed < 0.5f)
-		speed = 0.5f;
-	if (speed > 10.0f)
-		speed = 10.0f;
+	std::lock_guard<std::mutex> lock(g_inputMutex);
+	g_input.speed -= (float)yoffset;
+	if (g_input.speed < 0.5f)
+		g_input.speed = 0.5f;
+	if (g_input.speed > 10.0f)
+		g_input.speed = 10.0f;
 }
 
-
 /***********************************************************
- *  ProcessKeyboardEvents()
+ *  Key_Callback()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is automatically called from GLFW whenever a
+ *  key is pressed or released within the active GLFW display
+ *  window.  The key state is recorded for the simulation thread.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+	// key repeats do not change the held state
+	if (action == GLFW_REPEAT)
+	{
+		return;
+	}
+	bool bPressed = (action == GLFW_PRESS);
+
 	// close the window if the escape key has been pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if ((key == GLFW_KEY_ESCAPE) && bPressed)
+	{
+		glfwSetWindowShouldClose(window, true);
+		return;
+	}
+
+	// switch between forward, deferred and software rendering
+	if ((key == GLFW_KEY_F) && bPressed)
+	{
+		g_renderPath = RENDER_PATH_FORWARD;
+		return;
+	}
+	if ((key == GLFW_KEY_G) && bPressed)
+	{
+		g_renderPath = RENDER_PATH_DEFERRED;
+		return;
+	}
+	if ((key == GLFW_KEY_C) && bPressed)
+	{
+		g_renderPath = RENDER_PATH_SOFTWARE;
+		return;
+	}
+	// toggle the depth pre-pass
+	if ((key == GLFW_KEY_Z) && bPressed)
+	{
+		g_bDepthPrepass = !g_bDepthPrepass;
+		return;
+	}
+	// toggle reverse Z
+	if ((key == GLFW_KEY_R) && bPressed)
 	{
-		glfwSetWindowShouldClose(m_pWindow, true);
+		g_bReverseDepth = !g_bReverseDepth;
+		return;
+	}
+	// toggle dynamic resolution
+	if ((key == GLFW_KEY_V) && bPressed)
+	{
+		g_bDynamicResolution = !g_bDynamicResolution;
+		return;
 	}
 
+	std::lock_guard<std::mutex> lock(g_inputMutex);
+	switch (key)
+	{
+	// camera zooming in and out
+	case GLFW_KEY_W: g_input.bForward = bPressed; break;
+	case GLFW_KEY_S: g_input.bBackward = bPressed; break;
+	// camera panning left and right
+	case GLFW_KEY_A: g_input.bLeft = bPressed; break;
+	case GLFW_KEY_D: g_input.bRight = bPressed; break;
+	// camera panning up and down
+	case GLFW_KEY_Q: g_input.bUp = bPressed; break;
+	case GLFW_KEY_E: g_input.bDown = bPressed; break;
+	// Change perspection of projection matrix. Uses Keyboard keys P and O.
+	case GLFW_KEY_P:
+		if (bPressed)
+		{
+			g_input.bOrthographicProjection = false;
+		}
+		break;
+	case GLFW_KEY_O:
+		if (bPressed)
+		{
+			g_input.bOrthographicProjection = true;
+		}
+		break;
+	default:
+		break;
+	}
+}
 
+
+/***********************************************************
+ *  ProcessKeyboardEvents()
+ *
+ *  This method is called from the simulation thread on every
+ *  fixed step to apply the recorded keyboard and mouse input
+ *  to the camera.
+ ***********************************************************/
+void ViewManager::ProcessKeyboardEvents(float deltaTime)
+{
 	// if the camera object is null, then exit this method
 	if (NULL == g_pCamera)
 	{
 		return;
 	}
 
+	// take a consistent copy of the input and consume the mouse
+	// motion, or take the input of the replayed step
+	INPUT_STATE input;
+	{
+		std::lock_guard<std::mutex> lock(g_inputMutex);
+		if (m_inputRecorder.IsReplaying())
+		{
+			RECORDED_INPUT recorded;
+			if (m_inputRecorder.ReplayStep(&recorded) == false)
+			{
+				return;
+			}
+			input = ReplayInput(recorded);
+		}
+		else
+		{
+			input = g_input;
+			g_input.mouseOffsetX = 0.0f;
+			g_input.mouseOffsetY = 0.0f;
+
+			if (m_inputRecorder.IsRecording())
+			{
+				if (0 == m_inputRecorder.GetStepCount())
+				{
+					m_inputRecorder.SetStartCamera(RecordCamera(m_bOrthographic));
+				}
+				m_inputRecorder.RecordStep(RecordInput(input));
+			}
+		}
+	}
+	m_bOrthographic = input.bOrthographicProjection;
+
+	// the scroll speed scales the camera movement for this step
+	float stepTime = deltaTime * input.speed;
+
 	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	if (input.bForward)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		g_pCamera->ProcessKeyboard(FORWARD, stepTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+	if (input.bBackward)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		g_pCamera->ProcessKeyboard(BACKWARD, stepTime);
 	}
 
 	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+	if (input.bLeft)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		g_pCamera->ProcessKeyboard(LEFT, stepTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+	if (input.bRight)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		g_pCamera->ProcessKeyboard(RIGHT, stepTime);
 	}
 
 	// process camera panning up and down Added these new if/then statements to 
 	// utilize keyboard key Q and E to control up and down movement.
+	if (input.bUp)
+	{
+		g_pCamera->ProcessKeyboard(UP, stepTime);
+	}
+	if (input.bDown)
+	{
+		g_pCamera->ProcessKeyboard(DOWN, stepTime);
+	}
 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
+	// move the 3D camera according to the mouse movement since the last step
+	if ((input.mouseOffsetX != 0.0f) || (input.mouseOffsetY != 0.0f))
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		g_pCamera->ProcessMouseMovement(input.mouseOffsetX, input.mouseOffsetY);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
+}
+
+/***********************************************************
+ *  StartUpdateThread()
+ *
+ *  This method is used to start the fixed timestep simulation
+ *  thread that owns the camera.
+ ***********************************************************/
+void ViewManager::StartUpdateThread()
+{
+	// a replay steps the simulation on the render thread
+	if (m_bUpdateRunning || m_inputRecorder.IsReplaying())
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		return;
 	}
 
-	// Change perspection of projection matrix. Uses Keyboard keys P and O.
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+	m_bUpdateRunning = true;
+	m_updateThread = std::thread(&ViewManager::UpdateLoop, this);
+}
+
+/***********************************************************
+ *  StopUpdateThread()
+ *
+ *  This method is used to stop the simulation thread and wait
+ *  for it to exit.
+ ***********************************************************/
+void ViewManager::StopUpdateThread()
+{
+	m_bUpdateRunning = false;
+	if (m_updateThread.joinable())
 	{
-		bOrthographicProjection = false;
+		m_updateThread.join();
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+}
+
+/***********************************************************
+ *  UpdateLoop()
+ *
+ *  This method runs on the simulation thread.  It advances the
+ *  camera in fixed steps and publishes a snapshot after every
+ *  step, independent of how fast frames are being rendered.
+ ***********************************************************/
+void ViewManager::UpdateLoop()
+{
+	double nextStepTime = glfwGetTime();
+
+	while (m_bUpdateRunning)
 	{
-		bOrthographicProjection = true;
+		double currentTime = glfwGetTime();
+		if (currentTime < nextStepTime)
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(nextStepTime - currentTime));
+			continue;
+		}
+
+		// after a long stall, drop the backlog instead of fast forwarding
+		if ((currentTime - nextStepTime) > MAX_UPDATE_CATCHUP)
+		{
+			nextStepTime = currentTime;
+		}
+
+		StepSimulation(&nextStepTime);
 	}
 }
 
+/***********************************************************
+ *  StepSimulation()
+ *
+ *  This method is used to move the camera by one fixed step
+ *  and publish the state before and after the step.
+ ***********************************************************/
+void ViewManager::StepSimulation(double* pNextStepTime)
+{
+	CAMERA_SNAPSHOT snapshot;
+	snapshot.previous = CaptureCameraState(m_bOrthographic);
+
+	ProcessKeyboardEvents((float)UPDATE_TIMESTEP);
+
+	*pNextStepTime += UPDATE_TIMESTEP;
+	snapshot.current = CaptureCameraState(m_bOrthographic);
+	snapshot.stepTime = *pNextStepTime;
+	g_cameraSnapshots.Write(snapshot);
+}
+
 /***********************************************************
  *  PrepareSceneView()
  *
@@ -250,36 +769,82 @@ void ViewManager::PrepareSceneView()
 	glm::mat4 view;
 	glm::mat4 projection;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = (currentFrame - gLastFrame) * speed;
-	gLastFrame = currentFrame;
-
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	CAMERA_POSE pose;
+	if (m_bFixedView)
+	{
+		pose = m_fixedView;
+	}
+	else
+	{
+		// a replay runs the steps up to the fixed time of this frame,
+		// live views follow the clock
+		double viewTime = 0.0;
+		if (m_inputRecorder.IsReplaying())
+		{
+			m_replayFrame++;
+			viewTime = m_replayFrame * REPLAY_FRAME_TIME;
+			while ((m_replayStepTime <= viewTime) && !m_inputRecorder.IsReplayFinished())
+			{
+				StepSimulation(&m_replayStepTime);
+			}
+		}
+		else
+		{
+			viewTime = glfwGetTime();
+		}
+
+		// get the latest simulation step and blend toward it by how far
+		// the render time has advanced past the step that produced it
+		const CAMERA_SNAPSHOT& snapshot = g_cameraSnapshots.Read();
+		float blend = (float)((viewTime - snapshot.stepTime) / UPDATE_TIMESTEP) + 1.0f;
+		blend = glm::clamp(blend, 0.0f, 1.0f);
+
+		pose.position = glm::mix(snapshot.previous.position, snapshot.current.position, blend);
+		pose.front = glm::normalize(glm::mix(snapshot.previous.front, snapshot.current.front, blend));
+		pose.up = glm::normalize(glm::mix(snapshot.previous.up, snapshot.current.up, blend));
+		pose.zoom = glm::mix(snapshot.previous.zoom, snapshot.current.zoom, blend);
+		pose.bOrthographic = snapshot.current.bOrthographic;
+	}
+	glm::vec3 position = pose.position;
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	// get the current view matrix from the interpolated or fixed camera
+	view = glm::lookAt(position, position + pose.front, pose.up);
 
 	// define the current projection matrix, uses P and O to toggle boolean.
 
-	if (bOrthographicProjection) {
-		projection = glm::ortho(-20.0f, 20.0f,-15.0f, 15.0f, 0.1f,50.0f);
+	int viewWidth = ((m_viewWidth > 0) && (m_viewHeight > 0)) ? m_viewWidth : WINDOW_WIDTH;
+	int viewHeight = ((m_viewWidth > 0) && (m_viewHeight > 0)) ? m_viewHeight : WINDOW_HEIGHT;
+	// with reverse Z the camera passes have no far plane, the far
+	// distance still bounds the light clusters and shadow cascades
+	float nearPlane = 0.1f;
+	float farPlane = 100.0f;
+	if (pose.bOrthographic) {
+		farPlane = 50.0f;
+		projection = glm::ortho(-20.0f, 20.0f,-15.0f, 15.0f, nearPlane, farPlane);
 	}
 	else {
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(pose.zoom), (GLfloat)viewWidth / (GLfloat)viewHeight, nearPlane, farPlane);
 	}
+
+	// keep the frame values for the systems that work in view space
+	m_frameData.view = view;
+	m_frameData.projection = projection;
+	m_frameData.viewPosition = position;
+	m_frameData.padding = 0.0f;
+	m_frameData.viewport = glm::vec4((float)viewWidth, (float)viewHeight, nearPlane, farPlane);
 	
 	
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
-	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+	// if the frame ring buffer object is valid
+	if (NULL != m_pFrameRingBuffer)
+	{
+		GLintptr offset = 0;
+		FRAME_DATA* pFrameData = (FRAME_DATA*)m_pFrameRingBuffer->Allocate(sizeof(FRAME_DATA), &offset);
+		if (NULL != pFrameData)
+		{
+			// write the view and projection matrices and the view position
+			// of the camera straight into the mapped frame data
+			*pFrameData = m_frameData;
+			m_pFrameRingBuffer->BindRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, offset, sizeof(FRAME_DATA));
+		}
 	}
 }
\ No newline at end of file
@@ -10,17 +10,36 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "FrameRingBuffer.h"
+#include "ShaderInterface.h"
+#include "RenderPipeline.h"
+#include "InputRecorder.h"
 #include "camera.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+#include <atomic>
+#include <thread>
+
+// camera values the view is built from, as kept by Camera, with
+// the projection picked with the P and O keys
+struct CAMERA_POSE
+{
+	glm::vec3 position;
+	glm::vec3 front;
+	glm::vec3 up;
+	float zoom;
+	bool bOrthographic;
+};
+
 class ViewManager
 {
 public:
 	// constructor
 	ViewManager(
-		ShaderManager* pShaderManager);
+		ShaderManager* pShaderManager,
+		FrameRingBuffer* pFrameRingBuffer);
 	// destructor
 	~ViewManager();
 
@@ -30,14 +49,48 @@ public:
 	// Added Scroll callback method.
 	static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
+	// keyboard callback for recording key state changes
+	static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the per-frame dynamic data buffer
+	FrameRingBuffer* m_pFrameRingBuffer;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// camera values of the current frame
+	FRAME_DATA m_frameData;
+	// fixed timestep simulation thread
+	std::thread m_updateThread;
+	// set while the simulation thread should keep running
+	std::atomic<bool> m_bUpdateRunning;
+	// pose used in place of the simulated camera, for rendering
+	// views that were placed ahead of time
+	CAMERA_POSE m_fixedView;
+	bool m_bFixedView;
+	// size the view is rendered at, zero for the window size
+	int m_viewWidth;
+	int m_viewHeight;
+	// camera input of the simulation steps, recorded or replayed
+	InputRecorder m_inputRecorder;
+	// projection picked by the last simulation step
+	bool m_bOrthographic;
+	// frames of a replay, which step the simulation by a fixed time
+	// per frame instead of following the clock
+	unsigned int m_replayFrame;
+	double m_replayStepTime;
 
 	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	void ProcessKeyboardEvents(float deltaTime);
+
+	// start and stop the fixed timestep simulation thread
+	void StartUpdateThread();
+	void StopUpdateThread();
+	// simulation thread entry point
+	void UpdateLoop();
+	// advance the camera by one step ending at the next step time
+	void StepSimulation(double* pNextStepTime);
 
 public:
 	// create the initial OpenGL display window
@@ -45,4 +98,43 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// view the scene from a fixed pose until the fixed view is cleared,
+	// the keyboard and mouse keep moving the camera underneath
+	void SetFixedView(const CAMERA_POSE& pose);
+	void ClearFixedView();
+	// render the view at another size than the window, for offscreen
+	// targets, zero goes back to the window size
+	void SetViewSize(int width, int height);
+
+	// record the input of every simulation step into a file, until the
+	// recording is stopped or the view manager goes away
+	bool StartRecording(const char* filename);
+	void StopRecording();
+	// replay a recording instead of the live input.  The simulation
+	// then runs on the render thread, stepped by a fixed time each
+	// frame, so every replay takes the same camera path.
+	bool StartReplay(const char* filename);
+	bool IsReplaying() const { return(m_inputRecorder.IsReplaying()); }
+	// every step of the replay has been rendered
+	bool IsReplayFinished() const { return(m_inputRecorder.IsReplayFinished()); }
+
+	// get the camera values of the current frame
+	const FRAME_DATA& GetFrameData() const { return(m_frameData); }
+
+	// get the size of the display window
+	int GetWindowWidth() const;
+	int GetWindowHeight() const;
+
+	// get the shading path selected with the keyboard
+	RENDER_PATH GetRenderPath() const;
+	// get whether the depth pre-pass was switched on with the keyboard
+	bool GetDepthPrepass() const;
+	// reverse Z, switched with the keyboard or from the command line
+	void SetReverseDepth(bool bReverseDepth);
+	bool GetReverseDepth() const;
+	// dynamic resolution, switched with the keyboard or from the
+	// command line
+	void SetDynamicResolution(bool bDynamicResolution);
+	bool GetDynamicResolution() const;
 };
\ No newline at end of file
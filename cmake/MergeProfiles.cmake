@@ -0,0 +1,19 @@
+###############################################################################
+# MergeProfiles.cmake
+# ============
+# merge the raw Clang profiles of the profile run into merged.profdata
+#
+# cmake -DLLVM_PROFDATA=<tool> -DPROFILE_DIR=<folder> -P MergeProfiles.cmake
+###############################################################################
+
+file(GLOB rawProfiles "${PROFILE_DIR}/*.profraw")
+if(NOT rawProfiles)
+	message(FATAL_ERROR "The profile run left no raw profiles in ${PROFILE_DIR}")
+endif()
+
+execute_process(
+	COMMAND "${LLVM_PROFDATA}" merge -output=${PROFILE_DIR}/merged.profdata ${rawProfiles}
+	RESULT_VARIABLE mergeResult)
+if(NOT mergeResult EQUAL 0)
+	message(FATAL_ERROR "llvm-profdata could not merge the profiles in ${PROFILE_DIR}")
+endif()
@@ -0,0 +1,13 @@
+#version 440 core
+
+// clip depth of the far end of the depth range, 1 for the regular
+// depth and 0 for reverse Z
+uniform float farDepth;
+
+// one triangle at the far end covering the whole view, the corners
+// come from the vertex index so no vertex buffer is bound
+void main()
+{
+   vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   gl_Position = vec4(corner * 2.0 - 1.0, farDepth, 1.0);
+}
@@ -0,0 +1,250 @@
+#version 440 core
+
+struct Material 
+{
+    vec3 ambientColor;
+    float ambientStrength;
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+}; 
+
+// Light source names shortened and applied in CalcLightSource function.
+// position.w is the radius of influence (0 for an unbounded light),
+// ambientC.w the focal strength and diffuseC.w the specular intensity.
+struct LightSource 
+{
+    vec4 position;	
+    vec4 ambientC;
+    vec4 diffuseC;
+    vec4 specularC;
+};
+
+flat in uint lightIndex;
+
+out vec4 outFragmentColor;
+
+// camera values written once per frame into the frame ring buffer
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+    vec4 viewport;
+};
+
+// all defined object materials, one array per value, indexed by the
+// geometry buffer
+layout (std140, binding = 2) readonly buffer MaterialAmbientBlock
+{
+    // rgb ambient color, ambient strength in w
+    vec4 materialAmbient[];
+};
+layout (std140, binding = 9) readonly buffer MaterialDiffuseBlock
+{
+    vec4 materialDiffuse[];
+};
+layout (std140, binding = 10) readonly buffer MaterialSpecularBlock
+{
+    // rgb specular color, shininess in w
+    vec4 materialSpecular[];
+};
+
+// all light sources of the scene
+layout (std430, binding = 3) readonly buffer LightBlock
+{
+    LightSource lightSources[];
+};
+
+// unbounded light indices first, then the bounded ones
+layout (std430, binding = 7) readonly buffer LightListBlock
+{
+    uint lightList[];
+};
+
+// shadow map projections of the shadow casting lights
+layout (std140, binding = 8) uniform ShadowData
+{
+    mat4 cascadeViewProjection[3];
+    mat4 spotViewProjection;
+    vec4 cascadeSplits;   // view depth where each cascade ends
+    ivec4 shadowLights;   // directional light, spot light, cascade count, enabled
+    vec4 shadowBias;      // cascade bias, spot bias, normal offset
+};
+
+// geometry buffer attachments, bound past the scene texture slots
+layout (binding = 16) uniform sampler2D gbufferAlbedo;
+layout (binding = 17) uniform sampler2D gbufferNormal;
+layout (binding = 18) uniform usampler2D gbufferMaterial;
+layout (binding = 19) uniform sampler2D gbufferDepth;
+
+// cached shadow maps, bound past the scene and geometry buffer textures
+layout (binding = 20) uniform sampler2DArrayShadow cascadeShadowMap;
+layout (binding = 21) uniform sampler2DShadow spotShadowMap;
+
+// 0 for the full screen pass, 1 for the light volume pass
+uniform int lightPass;
+// number of unbounded lights at the start of the light list
+uniform int globalLightCount;
+// turns window depth back into world positions
+uniform mat4 inverseViewProjection;
+// 1 when the depth holds reverse Z, cleared to 0 with a [0, 1] clip depth
+uniform int reverseDepth;
+
+// material of the current pixel, unpacked from the material table
+Material material;
+
+// function prototypes
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection, float shadow);
+float CalcShadow(uint lightIndex, vec3 position, vec3 normal);
+
+void main()
+{
+   ivec2 pixel = ivec2(gl_FragCoord.xy);
+   float depth = texelFetch(gbufferDepth, pixel, 0).x;
+
+   // nothing was drawn here, keep the background
+   if((reverseDepth != 0) ? (depth <= 0.0) : (depth >= 1.0))
+   {
+      discard;
+   }
+
+   float clipDepth = (reverseDepth != 0) ? depth : depth * 2.0 - 1.0;
+   vec4 clipPosition = inverseViewProjection * vec4((gl_FragCoord.xy / viewport.xy) * 2.0 - 1.0, clipDepth, 1.0);
+   vec3 fragmentPosition = clipPosition.xyz / clipPosition.w;
+
+   if(lightPass != 0)
+   {
+      // the volume box is larger than the light's sphere
+      vec4 lightPosition = lightSources[lightIndex].position;
+      if(length(lightPosition.xyz - fragmentPosition) > lightPosition.w)
+      {
+         discard;
+      }
+   }
+
+   uint materialSlot = texelFetch(gbufferMaterial, pixel, 0).x;
+   material.ambientColor = materialAmbient[materialSlot].xyz;
+   material.ambientStrength = materialAmbient[materialSlot].w;
+   material.diffuseColor = materialDiffuse[materialSlot].xyz;
+   material.specularColor = materialSpecular[materialSlot].xyz;
+   material.shininess = materialSpecular[materialSlot].w;
+
+   vec3 lightNormal = normalize(texelFetch(gbufferNormal, pixel, 0).xyz * 2.0 - 1.0);
+   vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+   vec3 phongResult = vec3(0.0f);
+
+   if(lightPass == 0)
+   {
+      for(int i = 0; i < globalLightCount; i++)
+      {
+         uint globalLight = lightList[i];
+         float shadow = CalcShadow(globalLight, fragmentPosition, lightNormal);
+         phongResult += CalcLightSource(lightSources[globalLight], lightNormal, fragmentPosition, viewDirection, shadow);
+      }
+   }
+   else
+   {
+      float shadow = CalcShadow(lightIndex, fragmentPosition, lightNormal);
+      phongResult = CalcLightSource(lightSources[lightIndex], lightNormal, fragmentPosition, viewDirection, shadow);
+   }
+
+   vec4 albedo = texelFetch(gbufferAlbedo, pixel, 0);
+   outFragmentColor = vec4(phongResult * albedo.xyz, 1.0);
+}
+
+// calculates the color when using a directional light.
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection, float shadow)
+{
+   vec3 ambient;
+   vec3 diffuse;
+   vec3 specular;
+
+   //**Calculate Ambient lighting**
+
+   ambient = light.ambientC.xyz + (material.ambientColor * material.ambientStrength);
+
+   //**Calculate Diffuse lighting**
+
+   // Calculate distance (light direction) between light source and fragments/pixels
+   vec3 lightDirection = normalize(light.position.xyz - vertexPosition); 
+   // Calculate diffuse impact by generating dot product of normal and light
+   float impact = max(dot(lightNormal, lightDirection), 0.0);
+   // Generate diffuse material color   
+   diffuse = impact * material.diffuseColor; 
+
+   //**Calculate Specular lighting**
+
+   // Calculate reflection vector
+   vec3 reflectDir = reflect(-lightDirection, lightNormal);
+   // Calculate specular component
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.ambientC.w);
+   specular = (light.diffuseC.w * material.shininess) * specularComponent * material.specularColor;
+
+   //**Calculate falloff for bounded lights**
+
+   float attenuation = 1.0;
+   if(light.position.w > 0.0)
+   {
+      float range = clamp(length(light.position.xyz - vertexPosition) / light.position.w, 0.0, 1.0);
+      attenuation = (1.0 - range * range) * (1.0 - range * range);
+   }
+  
+   // shadows only block the direct light
+   return((ambient + (diffuse + specular) * shadow) * attenuation);
+}
+
+// how much of a shadow casting light reaches the position, 1.0 for
+// every other light.  Four filtered taps soften the shadow edges.
+float CalcShadow(uint lightIndex, vec3 position, vec3 normal)
+{
+   if(shadowLights.w == 0)
+   {
+      return(1.0);
+   }
+
+   // moving along the normal keeps surfaces from shadowing themselves
+   vec4 offsetPosition = vec4(position + normal * shadowBias.z, 1.0);
+
+   if(int(lightIndex) == shadowLights.x)
+   {
+      float viewDepth = -(view * vec4(position, 1.0)).z;
+      for(int cascade = 0; cascade < shadowLights.z; cascade++)
+      {
+         if(viewDepth < cascadeSplits[cascade])
+         {
+            vec4 shadowPosition = cascadeViewProjection[cascade] * offsetPosition;
+            vec3 coords = (shadowPosition.xyz / shadowPosition.w) * 0.5 + 0.5;
+            vec2 texel = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+            float lit = 0.0;
+            for(int tap = 0; tap < 4; tap++)
+            {
+               vec2 offset = vec2((tap & 1) * 2 - 1, (tap & 2) - 1) * texel;
+               lit += texture(cascadeShadowMap, vec4(coords.xy + offset, float(cascade), coords.z - shadowBias.x));
+            }
+            return(lit * 0.25);
+         }
+      }
+      return(1.0);
+   }
+
+   if(int(lightIndex) == shadowLights.y)
+   {
+      vec4 shadowPosition = spotViewProjection * offsetPosition;
+      if(shadowPosition.w <= 0.0)
+      {
+         return(1.0);
+      }
+      vec3 coords = (shadowPosition.xyz / shadowPosition.w) * 0.5 + 0.5;
+      vec2 texel = 1.0 / vec2(textureSize(spotShadowMap, 0));
+      float lit = 0.0;
+      for(int tap = 0; tap < 4; tap++)
+      {
+         vec2 offset = vec2((tap & 1) * 2 - 1, (tap & 2) - 1) * texel;
+         lit += texture(spotShadowMap, vec3(coords.xy + offset, coords.z - shadowBias.y));
+      }
+      return(lit * 0.25);
+   }
+
+   return(1.0);
+}
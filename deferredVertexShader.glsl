@@ -0,0 +1,67 @@
+#version 440 core
+
+// one light source, see fragmentShader.glsl for the packing
+struct LightSource 
+{
+    vec4 position;	
+    vec4 ambientC;
+    vec4 diffuseC;
+    vec4 specularC;
+};
+
+flat out uint lightIndex;
+
+// camera values written once per frame into the frame ring buffer
+layout (std140, binding = 0) uniform FrameData
+{
+   mat4 view;
+   mat4 projection;
+   vec3 viewPosition;
+   vec4 viewport;
+};
+
+// all light sources of the scene
+layout (std430, binding = 3) readonly buffer LightBlock
+{
+   LightSource lightSources[];
+};
+
+// unbounded light indices first, then the bounded ones
+layout (std430, binding = 7) readonly buffer LightListBlock
+{
+   uint lightList[];
+};
+
+// 0 for the full screen pass, 1 for the light volume pass
+uniform int lightPass;
+// number of unbounded lights at the start of the light list
+uniform int globalLightCount;
+
+// corners of the unit cube, bit 0 is x, bit 1 is y, bit 2 is z
+const int CUBE_INDICES[36] = int[36](
+   0, 2, 1, 1, 2, 3,
+   4, 5, 6, 5, 7, 6,
+   0, 4, 2, 2, 4, 6,
+   1, 3, 5, 3, 7, 5,
+   0, 1, 4, 1, 5, 4,
+   2, 6, 3, 3, 6, 7);
+
+void main()
+{
+   if(lightPass == 0)
+   {
+      // one triangle covering the whole screen
+      vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+      lightIndex = 0;
+      gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+   }
+   else
+   {
+      // box around the sphere of influence of one bounded light
+      lightIndex = lightList[globalLightCount + gl_InstanceID];
+      LightSource light = lightSources[lightIndex];
+      int corner = CUBE_INDICES[gl_VertexID];
+      vec3 offset = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1) * 2.0 - 1.0;
+      gl_Position = projection * view * vec4(light.position.xyz + offset * light.position.w, 1.0);
+   }
+}
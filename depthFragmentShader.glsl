@@ -0,0 +1,6 @@
+#version 440 core
+
+// the depth pre-pass only writes depth, there is no color output
+void main()
+{
+}
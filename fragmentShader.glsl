@@ -10,18 +10,18 @@ struct Material
 }; 
 
 // Light source names shortened and applied in CalcLightSource function.
+// position.w is the radius of influence (0 for an unbounded light),
+// ambientC.w the focal strength and diffuseC.w the specular intensity.
 struct LightSource 
 {
-    vec3 position;	
-    vec3 ambientC;
-    vec3 diffuseC;
-    vec3 specularC;
-    float focalStr;
-    float specularInt;
+    vec4 position;	
+    vec4 ambientC;
+    vec4 diffuseC;
+    vec4 specularC;
 };
 
-// Lights total changed to 2.
-#define TOTAL_LIGHTS 2
+// Texture slots bound by the scene manager.
+#define TOTAL_TEXTURES 16
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
@@ -29,20 +29,102 @@ in vec2 fragmentTextureCoordinate;
 
 out vec4 outFragmentColor;
 
-uniform bool bUseTexture=false;
+// camera values written once per frame into the frame ring buffer
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+};
+
+// per draw values written into the frame ring buffer
+layout (std140, binding = 1) uniform DrawData
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 objectColor;
+    vec2 UVscale;
+    int bUseTexture;
+    int textureSlot;
+    int materialIndex;
+    int vertexFormat;
+};
+
+// all defined object materials, one array per value, indexed by materialIndex
+layout (std140, binding = 2) readonly buffer MaterialAmbientBlock
+{
+    // rgb ambient color, ambient strength in w
+    vec4 materialAmbient[];
+};
+layout (std140, binding = 9) readonly buffer MaterialDiffuseBlock
+{
+    vec4 materialDiffuse[];
+};
+layout (std140, binding = 10) readonly buffer MaterialSpecularBlock
+{
+    // rgb specular color, shininess in w
+    vec4 materialSpecular[];
+};
+
+// all light sources of the scene
+layout (std430, binding = 3) readonly buffer LightBlock
+{
+    LightSource lightSources[];
+};
+
+// layout of the light cluster grid
+layout (std140, binding = 4) uniform ClusterData
+{
+    uvec4 clusterGrid;   // tiles across, tiles down, depth slices, tile size
+    vec4 clusterDepth;   // depth slice scale and bias, near, far
+};
+
+// first light index and light count of every cluster
+layout (std430, binding = 5) readonly buffer ClusterBlock
+{
+    uvec2 clusters[];
+};
+
+// light indices of all clusters, packed back to back
+layout (std430, binding = 6) readonly buffer LightIndexBlock
+{
+    uint lightIndices[];
+};
+
+// shadow map projections of the shadow casting lights
+layout (std140, binding = 8) uniform ShadowData
+{
+    mat4 cascadeViewProjection[3];
+    mat4 spotViewProjection;
+    vec4 cascadeSplits;   // view depth where each cascade ends
+    ivec4 shadowLights;   // directional light, spot light, cascade count, enabled
+    vec4 shadowBias;      // cascade bias, spot bias, normal offset
+};
+
 uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
-uniform sampler2D objectTexture;
-uniform vec3 viewPosition;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
-uniform LightSource lightSources[TOTAL_LIGHTS];
-uniform Material material;
+layout (binding = 0) uniform sampler2D objectTextures[TOTAL_TEXTURES];
+
+// cached shadow maps, bound past the scene and geometry buffer textures
+layout (binding = 20) uniform sampler2DArrayShadow cascadeShadowMap;
+layout (binding = 21) uniform sampler2DShadow spotShadowMap;
+
+// material of the current draw, unpacked from the material table
+Material material;
 
 // function prototypes
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection, float shadow);
+float CalcShadow(uint lightIndex, vec3 position, vec3 normal);
+uint FindCluster();
 
 void main()
 {
+   int materialSlot = materialIndex;
+   material.ambientColor = materialAmbient[materialSlot].xyz;
+   material.ambientStrength = materialAmbient[materialSlot].w;
+   material.diffuseColor = materialDiffuse[materialSlot].xyz;
+   material.specularColor = materialSpecular[materialSlot].xyz;
+   material.shininess = materialSpecular[materialSlot].w;
+
    if(bUseLighting == true)
    {
       // properties
@@ -50,14 +132,18 @@ void main()
       vec3 viewDirection = normalize(viewPosition - fragmentPosition);
       vec3 phongResult = vec3(0.0f);
 
-      for(int i = 0; i < TOTAL_LIGHTS; i++)
+      // only the lights assigned to this fragment's cluster can reach it
+      uvec2 cluster = clusters[FindCluster()];
+      for(uint i = 0; i < cluster.y; i++)
       {
-         phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
+         uint lightIndex = lightIndices[cluster.x + i];
+         float shadow = CalcShadow(lightIndex, fragmentPosition, lightNormal);
+         phongResult += CalcLightSource(lightSources[lightIndex], lightNormal, fragmentPosition, viewDirection, shadow); 
       }   
     
-      if(bUseTexture == true)
+      if(bUseTexture != 0)
       {
-         vec4 textureColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+         vec4 textureColor = texture(objectTextures[textureSlot], fragmentTextureCoordinate * UVscale);
          outFragmentColor = vec4(phongResult * textureColor.xyz, 1.0);
       }
       else
@@ -67,9 +153,9 @@ void main()
    }
    else 
    {
-      if(bUseTexture == true)
+      if(bUseTexture != 0)
       {
-         outFragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+         outFragmentColor = texture(objectTextures[textureSlot], fragmentTextureCoordinate * UVscale);
       }
       else
       {
@@ -79,7 +165,7 @@ void main()
 }
 
 // calculates the color when using a directional light.
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection, float shadow)
 {
    vec3 ambient;
    vec3 diffuse;
@@ -87,12 +173,12 @@ vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, v
 
    //**Calculate Ambient lighting**
 
-   ambient = light.ambientC + (material.ambientColor * material.ambientStrength);
+   ambient = light.ambientC.xyz + (material.ambientColor * material.ambientStrength);
 
    //**Calculate Diffuse lighting**
 
    // Calculate distance (light direction) between light source and fragments/pixels
-   vec3 lightDirection = normalize(light.position - vertexPosition); 
+   vec3 lightDirection = normalize(light.position.xyz - vertexPosition); 
    // Calculate diffuse impact by generating dot product of normal and light
    float impact = max(dot(lightNormal, lightDirection), 0.0);
    // Generate diffuse material color   
@@ -103,8 +189,87 @@ vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, v
    // Calculate reflection vector
    vec3 reflectDir = reflect(-lightDirection, lightNormal);
    // Calculate specular component
-   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.focalStr);
-   specular = (light.specularInt * material.shininess) * specularComponent * material.specularColor;
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.ambientC.w);
+   specular = (light.diffuseC.w * material.shininess) * specularComponent * material.specularColor;
+
+   //**Calculate falloff for bounded lights**
+
+   float attenuation = 1.0;
+   if(light.position.w > 0.0)
+   {
+      float range = clamp(length(light.position.xyz - vertexPosition) / light.position.w, 0.0, 1.0);
+      attenuation = (1.0 - range * range) * (1.0 - range * range);
+   }
   
-   return(ambient + diffuse + specular);
+   // shadows only block the direct light
+   return((ambient + (diffuse + specular) * shadow) * attenuation);
+}
+
+// how much of a shadow casting light reaches the position, 1.0 for
+// every other light.  Four filtered taps soften the shadow edges.
+float CalcShadow(uint lightIndex, vec3 position, vec3 normal)
+{
+   if(shadowLights.w == 0)
+   {
+      return(1.0);
+   }
+
+   // moving along the normal keeps surfaces from shadowing themselves
+   vec4 offsetPosition = vec4(position + normal * shadowBias.z, 1.0);
+
+   if(int(lightIndex) == shadowLights.x)
+   {
+      float viewDepth = -(view * vec4(position, 1.0)).z;
+      for(int cascade = 0; cascade < shadowLights.z; cascade++)
+      {
+         if(viewDepth < cascadeSplits[cascade])
+         {
+            vec4 shadowPosition = cascadeViewProjection[cascade] * offsetPosition;
+            vec3 coords = (shadowPosition.xyz / shadowPosition.w) * 0.5 + 0.5;
+            vec2 texel = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+            float lit = 0.0;
+            for(int tap = 0; tap < 4; tap++)
+            {
+               vec2 offset = vec2((tap & 1) * 2 - 1, (tap & 2) - 1) * texel;
+               lit += texture(cascadeShadowMap, vec4(coords.xy + offset, float(cascade), coords.z - shadowBias.x));
+            }
+            return(lit * 0.25);
+         }
+      }
+      return(1.0);
+   }
+
+   if(int(lightIndex) == shadowLights.y)
+   {
+      vec4 shadowPosition = spotViewProjection * offsetPosition;
+      if(shadowPosition.w <= 0.0)
+      {
+         return(1.0);
+      }
+      vec3 coords = (shadowPosition.xyz / shadowPosition.w) * 0.5 + 0.5;
+      vec2 texel = 1.0 / vec2(textureSize(spotShadowMap, 0));
+      float lit = 0.0;
+      for(int tap = 0; tap < 4; tap++)
+      {
+         vec2 offset = vec2((tap & 1) * 2 - 1, (tap & 2) - 1) * texel;
+         lit += texture(spotShadowMap, vec3(coords.xy + offset, coords.z - shadowBias.y));
+      }
+      return(lit * 0.25);
+   }
+
+   return(1.0);
+}
+
+// finds the light cluster containing the current fragment.
+uint FindCluster()
+{
+   // exponential depth slice from the view space depth
+   float viewDepth = max(-(view * vec4(fragmentPosition, 1.0)).z, clusterDepth.z);
+   uint slice = uint(max(log(viewDepth) * clusterDepth.x + clusterDepth.y, 0.0));
+   slice = min(slice, clusterGrid.z - 1);
+
+   // screen tile from the window position
+   uvec2 tile = min(uvec2(gl_FragCoord.xy) / clusterGrid.w, clusterGrid.xy - 1);
+
+   return(tile.x + clusterGrid.x * (tile.y + clusterGrid.y * slice));
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+#version 440 core
+
+// Texture slots bound by the scene manager.
+#define TOTAL_TEXTURES 16
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+// geometry buffer attachments
+layout (location = 0) out vec4 outAlbedo;
+layout (location = 1) out vec4 outNormal;
+layout (location = 2) out uint outMaterial;
+
+// per draw values written into the frame ring buffer
+layout (std140, binding = 1) uniform DrawData
+{
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 objectColor;
+    vec2 UVscale;
+    int bUseTexture;
+    int textureSlot;
+    int materialIndex;
+    int vertexFormat;
+};
+
+layout (binding = 0) uniform sampler2D objectTextures[TOTAL_TEXTURES];
+
+void main()
+{
+   // surface color, lit later by the deferred lighting passes
+   if(bUseTexture != 0)
+   {
+      outAlbedo = vec4(texture(objectTextures[textureSlot], fragmentTextureCoordinate * UVscale).xyz, 1.0);
+   }
+   else
+   {
+      outAlbedo = objectColor;
+   }
+
+   // the unsigned normal format stores the direction moved into 0..1
+   outNormal = vec4(normalize(fragmentVertexNormal) * 0.5 + 0.5, 0.0);
+   outMaterial = uint(materialIndex);
+}
@@ -0,0 +1,23 @@
+#version 440 core
+layout (location = 0) in vec3 inVertexPosition;
+
+// per draw values written into the frame ring buffer
+layout (std140, binding = 1) uniform DrawData
+{
+   mat4 model;
+   mat3 normalMatrix;
+   vec4 objectColor;
+   vec2 UVscale;
+   int bUseTexture;
+   int textureSlot;
+   int materialIndex;
+   int vertexFormat;
+};
+
+// world to shadow map clip space of the map being drawn
+uniform mat4 lightViewProjection;
+
+void main()
+{
+   gl_Position = lightViewProjection * model * vec4(inVertexPosition, 1.0f);
+}
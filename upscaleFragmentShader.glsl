@@ -0,0 +1,36 @@
+#version 440 core
+
+out vec4 outFragmentColor;
+
+// scene color, rendered into the lower left corner of a texture
+// the size of the output
+layout (binding = 22) uniform sampler2D sceneColor;
+
+// rendered width and height as a fraction of the texture size
+uniform vec2 renderScale;
+// how much of the difference to the neighbors is added back,
+// 0 leaves the plain bilinear result
+uniform float sharpness;
+
+void main()
+{
+   vec2 texel = 1.0 / vec2(textureSize(sceneColor, 0));
+   // the filter stays half a texel inside the rendered corner so it
+   // never blends in what lies beyond it
+   vec2 lowest = 0.5 * texel;
+   vec2 highest = renderScale - 0.5 * texel;
+   vec2 uv = clamp(gl_FragCoord.xy * texel * renderScale, lowest, highest);
+
+   vec3 center = texture(sceneColor, uv).rgb;
+   vec3 left = texture(sceneColor, clamp(uv - vec2(texel.x, 0.0), lowest, highest)).rgb;
+   vec3 right = texture(sceneColor, clamp(uv + vec2(texel.x, 0.0), lowest, highest)).rgb;
+   vec3 below = texture(sceneColor, clamp(uv - vec2(0.0, texel.y), lowest, highest)).rgb;
+   vec3 above = texture(sceneColor, clamp(uv + vec2(0.0, texel.y), lowest, highest)).rgb;
+
+   // unsharp mask against the rendered pixels around the sample,
+   // limited to their range so edges do not ring
+   vec3 sharpened = center + sharpness * (4.0 * center - left - right - below - above);
+   vec3 lowestColor = min(center, min(min(left, right), min(below, above)));
+   vec3 highestColor = max(center, max(max(left, right), max(below, above)));
+   outFragmentColor = vec4(clamp(sharpened, lowestColor, highestColor), 1.0);
+}
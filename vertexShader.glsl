@@ -1,4 +1,4 @@
-#version 330 core
+#version 440 core
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
@@ -7,14 +7,52 @@ out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// the depth pre-pass and the color pass must compute the same depth
+invariant gl_Position;
+
+// camera values written once per frame into the frame ring buffer
+layout (std140, binding = 0) uniform FrameData
+{
+   mat4 view;
+   mat4 projection;
+   vec3 viewPosition;
+};
+
+// per draw values written into the frame ring buffer
+layout (std140, binding = 1) uniform DrawData
+{
+   mat4 model;
+   mat3 normalMatrix;
+   vec4 objectColor;
+   vec2 UVscale;
+   int bUseTexture;
+   int textureSlot;
+   int materialIndex;
+   int vertexFormat;
+};
+
+// matches VERTEX_FORMAT_COMPACT in MeshCache.h
+const int VERTEX_FORMAT_COMPACT = 1;
+
+// unfold a normal stored on the octahedron |x|+|y|+|z| = 1, the
+// lower half was folded over the corners of the xy square
+vec3 DecodeOctahedral(vec2 folded)
+{
+   vec3 normal = vec3(folded, 1.0 - abs(folded.x) - abs(folded.y));
+   float lower = max(-normal.z, 0.0);
+   normal.x += (normal.x >= 0.0) ? -lower : lower;
+   normal.y += (normal.y >= 0.0) ? -lower : lower;
+   return normalize(normal);
+}
 
 void main()
 {
    fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
    gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
+   // the normal matrix undoes the model's non-uniform scale
+   // every vertex of a draw has the same format, so the branch
+   // costs nothing next to the bandwidth the compact format saves
+   vec3 normal = (vertexFormat == VERTEX_FORMAT_COMPACT) ? DecodeOctahedral(inVertexNormal.xy) : inVertexNormal;
+   fragmentVertexNormal = normalMatrix * normal;
    fragmentTextureCoordinate = inTextureCoordinate;
-}
\ No newline at end of file
+}